@@ -108,6 +108,76 @@ FIRM_API void set_irp_globals_entity_usage_state(ir_entity_usage_computed_state
  */
 FIRM_API void assure_irp_globals_entity_usage_computed(void);
 
+/**
+ * Assure that the interprocedural points-to information has been computed.
+ *
+ * This is a whole-program, field-sensitive, unification based (Steensgaard
+ * style) points-to analysis over all graphs of the program. It follows
+ * pointers through Alloc, Member, Sel, Load/Store, Call and Return nodes and
+ * through global initializers. Once computed, get_alias_relation() reports
+ * pointers into objects of different points-to classes as not aliasing.
+ *
+ * The analysis is opt-in: no optimization computes it on its own, as it
+ * needs the whole program. Call it once all graphs are constructed; the
+ * alias queries of later optimizations use it until it is freed.
+ *
+ * The results are attached to the nodes existing at analysis time. Nodes
+ * created later are traced back to their base address or treated
+ * conservatively. Transformations that add pointer flows between existing
+ * nodes of different graphs, like inlining, invalidate the information;
+ * call free_irp_points_to() before running them.
+ */
+FIRM_API void assure_irp_points_to_computed(void);
+
+/**
+ * Frees the interprocedural points-to information.
+ */
+FIRM_API void free_irp_points_to(void);
+
+/** The effects of a call on a memory location. */
+typedef enum ir_modref {
+	ir_modref_none   = 0,       /**< The call does not access the location. */
+	ir_modref_ref    = 1u << 0, /**< The call may read the location. */
+	ir_modref_mod    = 1u << 1, /**< The call may write the location. */
+	ir_modref_modref = ir_modref_ref | ir_modref_mod,
+} ir_modref;
+ENUM_BITSET(ir_modref)
+
+/**
+ * Determine if a call may read or write the memory at a given address.
+ *
+ * Without interprocedural mod/ref summaries only the properties of the
+ * called method type and locals whose address is never taken are
+ * considered.
+ *
+ * @param call  The Call node.
+ * @param addr  The address of the memory access.
+ * @param type  The type of the object found at @p addr.
+ * @param size  The size in bytes of the memory access.
+ */
+FIRM_API ir_modref get_call_modref(const ir_node *call, const ir_node *addr,
+                                   const ir_type *type, unsigned size);
+
+/**
+ * Assure that the interprocedural mod/ref summaries have been computed.
+ *
+ * For every function a summary of the global variables it may read or
+ * write, including all functions it calls, is computed bottom-up over the
+ * call graph. Accesses to global variables whose address is never taken are
+ * recorded precisely, all other memory is summarized by a single flag.
+ * The summaries are used by get_call_modref(). Callee information computed
+ * by cgana() is used for indirect calls if present.
+ *
+ * Transformations that add accesses to global variables to a function
+ * invalidate the summaries; call free_irp_modref() before running them.
+ */
+FIRM_API void assure_irp_modref_computed(void);
+
+/**
+ * Frees the interprocedural mod/ref summaries.
+ */
+FIRM_API void free_irp_modref(void);
+
 /**
  * Returns the memory disambiguator options for a graph.
  *
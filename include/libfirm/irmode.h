@@ -99,6 +99,15 @@ FIRM_API ir_mode *new_float_mode(const char *name,
  */
 FIRM_API ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size);
 
+/**
+ * Creates a new mode for fixed-width vectors of @p n_elements values of
+ * the integer or float mode @p element_mode.
+ * Arithmetic will be set to irma_none, operations on vector modes work
+ * element-wise. There are no tarvals for vector modes.
+ */
+FIRM_API ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                                  unsigned n_elements);
+
 /** Returns the ident* of the mode */
 FIRM_API ident *get_mode_ident(const ir_mode *mode);
 
@@ -276,6 +285,11 @@ FIRM_API int mode_is_num(const ir_mode *mode);
  */
 FIRM_API int mode_is_data(const ir_mode *mode);
 
+/**
+ * Returns 1 if @p mode is a vector mode, 0 otherwise.
+ */
+FIRM_API int mode_is_vector(const ir_mode *mode);
+
 /**
  * Returns true if a value of mode @p sm can be converted to mode @p lm without
  * loss.
@@ -350,6 +364,16 @@ FIRM_API ir_mode *get_reference_offset_mode(const ir_mode *mode);
  */
 FIRM_API void set_reference_offset_mode(ir_mode *ref_mode, ir_mode *int_mode);
 
+/**
+ * Returns the mode of the elements of the vector mode @p mode.
+ */
+FIRM_API ir_mode *get_vector_element_mode(const ir_mode *mode);
+
+/**
+ * Returns the number of elements of the vector mode @p mode.
+ */
+FIRM_API unsigned get_vector_n_elements(const ir_mode *mode);
+
 /**
  * Returns size of bits used for to encode the mantissa (for float modes).
  * This includes the leading one for modes with irma_x86_extended_float.
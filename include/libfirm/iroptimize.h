@@ -189,6 +189,50 @@ FIRM_API void combine_memops(ir_graph *irg);
  */
 FIRM_API void opt_ldst(ir_graph *irg);
 
+/**
+ * Hoists loop-invariant Loads out of loops.
+ *
+ * A Load is moved in front of a loop if its address is loop-invariant and no
+ * Store, CopyB or Call in the loop may modify the loaded memory.  Calls are
+ * judged by the mod/ref summaries of their callees if these have been
+ * computed.  Loads in conditionally executed blocks are only hoisted if their
+ * address is known to be dereferenceable.
+ */
+FIRM_API void hoist_invariant_loads(ir_graph *irg);
+
+/**
+ * Promotes memory locations to registers inside of loops.
+ *
+ * A location with a loop-invariant address, which is stored in a loop and
+ * not accessed otherwise by any Load, Store, CopyB or Call in it, is loaded
+ * once in front of the loop, its value is carried in registers and it is
+ * stored back on every edge leaving the loop.
+ */
+FIRM_API void promote_loop_scalars(ir_graph *irg);
+
+/**
+ * Superword level parallelism vectorizer.
+ *
+ * Stores of adjacent elements in a block together with the isomorphic
+ * operations and adjacent Loads computing their values are combined into
+ * operations on vector modes, if the target has vector registers (see
+ * ir_target_vector_size()).
+ */
+FIRM_API void slp_vectorize(ir_graph *irg);
+
+/**
+ * Loop vectorizer.
+ *
+ * Innermost counted loops are preceded by a loop executing as many
+ * iterations at once as fit into a vector register, the original loop
+ * handles the remaining iterations.  Consecutive Loads and Stores, simple
+ * arithmetic, minimum and maximum and reductions with these operations are
+ * supported.  The vector loop is guarded by
+ * runtime checks of the trip count and, if alias analysis cannot prove
+ * independence, of the overlap of the accessed memory ranges.
+ */
+FIRM_API void loop_vectorize(ir_graph *irg);
+
 /**
  * Optimize the frame type of an irg by removing
  * never touched entities.
@@ -201,6 +245,21 @@ FIRM_API void opt_ldst(ir_graph *irg);
  */
 FIRM_API void opt_frame_irg(ir_graph *irg);
 
+/**
+ * Overlaps entities of the frame type of an irg whose lifetimes are
+ * disjoint.  An entity is live in the blocks between its first and last
+ * accesses, entities whose address escapes are live everywhere.  Entities
+ * which do not interfere are replaced by the fields of a union, so they get
+ * the same offset during frame layout.
+ *
+ * @param irg  The graph whose frame type will be optimized
+ *
+ * Should run after the optimizations which move memory accesses between
+ * blocks.  The layout state of the frame type will be set to
+ * layout_undefined if entities were overlapped.
+ */
+FIRM_API void color_frame_entities(ir_graph *irg);
+
 /** Possible flags for the Operator Scalar Replacement. */
 typedef enum osr_flags {
 	osr_flag_none               = 0,  /**< no additional flags */
@@ -300,6 +359,19 @@ FIRM_API void remove_phi_cycles(ir_graph *irg);
  */
 FIRM_API void proc_cloning(float threshold);
 
+/**
+ * Propagates constants and value ranges of parameters and results across
+ * the callgraph.  Parameters with the same constant in all calls are
+ * replaced by the constant, as are constant results at the call sites.
+ * Functions called with different constants get specialized copies, which
+ * the calls are redirected to, as long as the copies grow the program by at
+ * most @p max_growth percent.  Functions which are externally visible or
+ * whose address is taken are not specialized in place.
+ *
+ * @param max_growth  maximum growth of the program by copies in percent
+ */
+FIRM_API void interprocedural_sccp(unsigned max_growth);
+
 /**
  * Reassociation.
  *
@@ -360,10 +432,31 @@ FIRM_API void normalize_one_return(ir_graph *irg);
  */
 FIRM_API void normalize_n_returns(ir_graph *irg);
 
+/**
+ * Promotes heap allocations which do not escape @p irg to the stack frame.
+ * Calls of @p alloc_func with a constant size of at most @p max_size bytes
+ * outside of loops are replaced by uninitialized frame entities if the
+ * allocated pointer is neither stored, passed to a call, returned nor
+ * converted.  Calls of @p free_func freeing such an allocation are removed.
+ *
+ * @param irg         the graph which should be optimized
+ * @param alloc_func  the function allocating memory like malloc, i.e. it
+ *                    takes the size in bytes, returns uninitialized memory
+ *                    and has no other side effects; may be NULL
+ * @param free_func   the function freeing allocated memory, may be NULL
+ * @param max_size    the maximum size of promoted allocations in bytes
+ */
+FIRM_API void promote_heap_allocations(ir_graph *irg, ir_entity *alloc_func,
+                                       ir_entity *free_func,
+                                       unsigned max_size);
+
 /**
  * Performs the scalar replacement optimization.
  * Replaces local compound entities (like structures and arrays)
  * with atomic values if possible. Does not handle classes yet.
+ * Array elements are replaced if they are only selected with constant
+ * indices.  If the address of a part of an entity escapes, this part stays
+ * in memory while the others are still replaced.
  *
  * @param irg  the graph which should be optimized
  */
@@ -399,10 +492,31 @@ FIRM_API void combo(ir_graph *irg);
 /** pointer to an optimization function */
 typedef void (*opt_ptr)(ir_graph *irg);
 
+/**
+ * Devirtualizes calls of methods selected by Member nodes using the class
+ * hierarchy, assuming that all classes of the program are known.
+ *
+ * Calls on objects of a known class and calls of methods with a single
+ * implementation become direct calls.  Calls of methods with at most
+ * @p max_guards + 1 implementations are speculated: the selected address is
+ * compared with all but one implementation, which are called directly, and the
+ * indirect call remains as fallback.  The direct calls may then be inlined.
+ *
+ * @param max_guards  maximum number of speculative direct calls per call
+ */
+FIRM_API void devirtualize_calls(unsigned max_guards);
+
 /**
  * Heuristic inliner. Calculates a benefice value for every call and inlines
  * those calls with a value higher than the threshold.
  *
+ * The benefice of a call grows with its execution frequency, which is
+ * estimated unless the graphs already have block execution frequencies, e.g.
+ * from a profile.  Calls are inlined in order of their benefice per node
+ * added to the program, estimated from the size of the callee without the
+ * nodes folded by constant arguments.  The total code growth is limited by
+ * set_inline_growth_budget().
+ *
  * @param maxsize             Do not inline any calls if a method has more than
  *                            maxsize firm nodes.  It may reach this limit by
  *                            inlining.
@@ -413,6 +527,25 @@ typedef void (*opt_ptr)(ir_graph *irg);
 FIRM_API void inline_functions(unsigned maxsize, int inline_threshold,
                                opt_ptr after_inline_opt);
 
+/**
+ * Sets by how many percent inline_functions() may grow the whole program.
+ * Calls to functions marked always_inline are not limited.  The default is
+ * 100, i.e. the program may double its size.
+ */
+FIRM_API void set_inline_growth_budget(unsigned percent);
+
+/**
+ * Partial inliner.  A called function with more than @p maxsize nodes which
+ * starts with a hot early exit, e.g. a check of its arguments followed by a
+ * return, is split: the rest of the function is moved into a new local
+ * function, which is called after the early exit.  The remaining small entry
+ * of the function is inlined into all callers, so only the calls not taking
+ * the early exit leave the caller.
+ *
+ * @param maxsize  only split functions with more than maxsize firm nodes
+ */
+FIRM_API void partial_inline_functions(unsigned maxsize);
+
 /**
  * Combines congruent blocks into one.
  *
@@ -434,11 +567,84 @@ FIRM_API void do_loop_inversion(ir_graph *irg);
  */
 FIRM_API void do_loop_unrolling(ir_graph *irg);
 
+/**
+ * Unrolls innermost counted loops.
+ *
+ * Loops with a small constant trip count are replaced by the code of all
+ * their iterations.  Loops whose trip count is only known at runtime get an
+ * unrolled copy which executes several iterations per exit test, the
+ * original loop executes the remaining iterations.  The unroll factor is
+ * chosen from the loop size, the register pressure and the block execution
+ * frequencies.
+ *
+ * @param irg          the graph
+ * @param max_size     maximum number of nodes of the unrolled loop body
+ * @param n_registers  number of registers for the values live across the
+ *                     loop body, e.g. the general purpose registers of the
+ *                     target
+ */
+FIRM_API void unroll_counted_loops(ir_graph *irg, unsigned max_size,
+                                   unsigned n_registers);
+
+/**
+ * Interchanges and tiles perfectly nested counted loops.
+ *
+ * An innermost loop and the loop around it are exchanged if this reduces
+ * the strides of the memory accesses in the inner loop and no dependence
+ * between them is reversed.  If the accesses reuse memory of the previous
+ * iteration of the outer loop, but the inner loop walks away from it, the
+ * inner loop is additionally split into tiles, which are iterated by a new
+ * loop around the nest.
+ *
+ * @param irg        the graph
+ * @param tile_size  number of inner iterations per tile, 0 disables tiling
+ */
+FIRM_API void interchange_loops(ir_graph *irg, unsigned tile_size);
+
+/**
+ * Replaces loops filling or copying memory by calls to memset, memcpy or
+ * memmove.
+ *
+ * Counted innermost loops whose only side effect is a store to consecutive
+ * addresses are handled if the stored value is loop invariant and consists
+ * of equal bytes, or if it is loaded from consecutive addresses with the
+ * same stride.  Copies which may overlap become memmove calls if the
+ * destination lies in front of the source.  Short constant copies become
+ * CopyB nodes.
+ *
+ * @param irg  the graph
+ */
+FIRM_API void replace_loop_idioms(ir_graph *irg);
+
+/**
+ * Inserts prefetches for loads with constant strides in innermost loops.
+ *
+ * The address is prefetched as many iterations ahead as needed to cover
+ * the memory latency, assuming every node of the loop body takes a cycle,
+ * but at most half the expected iterations per entry of the loop.  Only
+ * loops executed more often than the function according to the block
+ * execution frequencies, which are estimated if no profile provided them,
+ * are handled.
+ *
+ * @param irg      the graph
+ * @param latency  expected memory latency in cycles
+ */
+FIRM_API void insert_prefetches(ir_graph *irg, unsigned latency);
+
 /**
  * Perform loop peeling on a given graph.
  */
 FIRM_API void do_loop_peeling(ir_graph *irg);
 
+/**
+ * Perform loop unswitching on a given graph.
+ * A loop containing a Cond or Switch with a loop invariant selector is
+ * duplicated for every outcome of the test, which is then evaluated once in
+ * front of the loop.  The code growth is bounded and weighted with the
+ * execution frequency of the test.
+ */
+FIRM_API void do_loop_unswitching(ir_graph *irg);
+
 /**
  * Removes all entities which are unused.
  *
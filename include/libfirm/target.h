@@ -82,6 +82,14 @@ FIRM_API int ir_target_supports_pic(void);
  */
 FIRM_API int ir_target_fast_unaligned_memaccess(void);
 
+/**
+ * Returns the size in bytes of the vector registers of the target or 0 if
+ * the backend does not support vector modes.
+ * Vector modes of this size support Load, Store and Phi as well as Add, Sub,
+ * And, Or and Eor; Mul is only supported for float elements.
+ */
+FIRM_API unsigned ir_target_vector_size(void);
+
 /**
  * Returns supported float arithmetic mode or NULL if mode_D and mode_F
  * are supported natively.
@@ -7,6 +7,13 @@
  * @file
  * @brief   Data-flow driven minimal fixpoint value range analysis
  * @author  Christoph Mallon
+ *
+ * The analysis computes for each integer node which bits are known to be
+ * zero or one and an interval of its possible values. Both parts refine each
+ * other. The ranges of Phis which keep growing are widened to the bounds of
+ * their mode to reach a fixpoint quickly, afterwards a few narrowing rounds
+ * recover the bounds of induction variables from Confirm nodes and exit
+ * tests.
  */
 #include "constbits.h"
 
@@ -34,8 +41,8 @@
 
 /* TODO:
  * - Implement cleared/set bit calculation for Div, Mod
- * - Implement min/max calculation for And, Eor, Or, Not, Conv, Shl, Shr, Shrs, Mux
- * - Implement min/max calculation for Add, Sub, Minus, Mul, Div, Mod, Conv, Shl, Shr, Shrs, Mux
+ * - Implement min/max calculation for Div, Mod, Shl, Shr, Shrs besides the
+ *   bounds implied by the known bits
  */
 
 /* Tables of the cleared/set bit lattice
@@ -107,15 +114,23 @@
  * A - B = A + -B = (Amin (-B)min, Amax + (-B)max) = (Amin - Bmax, Amax - Bmin)
  */
 
+/** Number of times the range of a Phi may grow before it is widened. */
+#define WIDEN_THRESHOLD 2
+/** Number of narrowing rounds after the fixpoint has been reached. */
+#define NARROW_ROUNDS   2
+
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
+/** The node being narrowed, NULL during the fixpoint iteration. */
+static ir_node const *narrow_node;
+
 static bool is_undefined(bitinfo const *const b)
 {
 	return tarval_is_null(b->z) && tarval_is_all_one(b->o);
 }
 
 /** Set analysis information for node @p irn. */
-static bool set_bitinfo(ir_node const *const irn, ir_tarval *const z, ir_tarval *const o)
+static bool set_bitinfo(ir_node const *const irn, ir_tarval *const z, ir_tarval *const o, ir_tarval *const min, ir_tarval *const max)
 {
 	ir_graph   *const irg  = get_irn_irg(irn);
 	ir_nodemap *const map  = &irg->bitinfo.map;
@@ -124,16 +139,18 @@ static bool set_bitinfo(ir_node const *const irn, ir_tarval *const z, ir_tarval
 		struct obstack *const obst = &irg->bitinfo.obst;
 		b = OALLOCZ(obst, bitinfo);
 		ir_nodemap_insert(map, irn, b);
-	} else if (z == b->z && o == b->o) {
+	} else if (z == b->z && o == b->o && min == b->min && max == b->max) {
 		return false;
-	} else {
+	} else if (irn != narrow_node) {
 		/* Assert ascending chain. */
 		assert(tarval_is_null(tarval_andnot(b->z, z)));
 		assert(tarval_is_null(tarval_andnot(o, b->o)));
 	}
-	b->z = z;
-	b->o = o;
-	DB((dbg, LEVEL_3, "Set %+F: 0:%T 1:%T%s\n", irn, z, o, is_undefined(b) ? " (bottom)" : tarval_is_all_one(z) && tarval_is_null(o) ? " (top)" : ""));
+	b->z   = z;
+	b->o   = o;
+	b->min = min;
+	b->max = max;
+	DB((dbg, LEVEL_3, "Set %+F: 0:%T 1:%T [%T, %T]%s\n", irn, z, o, min, max, is_undefined(b) ? " (bottom)" : tarval_is_all_one(z) && tarval_is_null(o) ? " (top)" : ""));
 	return true;
 }
 
@@ -142,6 +159,106 @@ static bool mode_is_intb(ir_mode const *const m)
 	return mode_is_int(m) || m == mode_b;
 }
 
+bool bitinfo_has_range(bitinfo const *const b)
+{
+	return b->min != NULL && tarval_cmp(b->min, b->max) != ir_relation_greater;
+}
+
+static ir_tarval *tv_min(ir_tarval *const a, ir_tarval *const b)
+{
+	return tarval_cmp(a, b) == ir_relation_greater ? b : a;
+}
+
+static ir_tarval *tv_max(ir_tarval *const a, ir_tarval *const b)
+{
+	return tarval_cmp(a, b) == ir_relation_less ? b : a;
+}
+
+static bool tv_less(ir_tarval const *const a, ir_tarval const *const b)
+{
+	return tarval_cmp(a, b) == ir_relation_less;
+}
+
+/** Evaluates @p func, returns tarval_bad if the result overflows. */
+static ir_tarval *eval_no_wrap(ir_tarval *(*func)(ir_tarval const*, ir_tarval const*), ir_tarval const *const a, ir_tarval const *const b)
+{
+	int const old_wrap_on_overflow = tarval_get_wrap_on_overflow();
+	tarval_set_wrap_on_overflow(false);
+	ir_tarval *const res = func(a, b);
+	tarval_set_wrap_on_overflow(old_wrap_on_overflow);
+	return res;
+}
+
+/**
+ * Intersects the known bits and the range of an integer value with the
+ * information each of them implies about the other one. A NULL range stands
+ * for the full range of the mode.
+ */
+static void refine(ir_mode *const m, ir_tarval **const z, ir_tarval **const o, ir_tarval **const min, ir_tarval **const max)
+{
+	ir_tarval *const all_one = get_mode_all_one(m);
+	ir_tarval *const zero    = get_mode_null(m);
+
+	/* Bounds implied by the bits. */
+	ir_tarval *bmin = *o;
+	ir_tarval *bmax = *z;
+	if (mode_is_signed(m)) {
+		ir_tarval *const sign = get_mode_min(m);
+		bmin = tarval_or(*o, tarval_and(*z, sign));
+		bmax = tarval_and(*z, tarval_ornot(*o, sign));
+	}
+	if (*min == NULL) {
+		*min = bmin;
+		*max = bmax;
+	} else {
+		*min = tv_max(*min, bmin);
+		*max = tv_min(*max, bmax);
+	}
+	if (tv_less(*max, *min))
+		goto undefined;
+
+	/* All values of a range share the common prefix of its bounds. */
+	int       const hb    = get_tarval_highest_bit(tarval_eor(*min, *max));
+	unsigned  const bits  = get_mode_size_bits(m);
+	ir_tarval *const known
+		= hb < 0                   ? all_one
+		: (unsigned)hb + 1 >= bits ? zero
+		: tarval_shl_unsigned(all_one, hb + 1);
+	*z = tarval_and(*z, tarval_ornot(*min, known));
+	*o = tarval_or(*o, tarval_and(*min, known));
+	if (!tarval_is_null(tarval_andnot(*o, *z)))
+		goto undefined;
+	return;
+
+undefined:
+	*z   = zero;
+	*o   = all_one;
+	*min = get_mode_max(m);
+	*max = get_mode_min(m);
+}
+
+/**
+ * Returns whether the Proj @p pn of Switch @p sw may be taken if the selector
+ * has the value range of @p b.
+ */
+static bool switch_proj_reachable(ir_node const *const sw, unsigned const pn, bitinfo const *const b)
+{
+	ir_switch_table const *const table = get_Switch_table((ir_node*)sw);
+	for (size_t i = 0, n = ir_switch_table_get_n_entries(table); i < n; ++i) {
+		ir_switch_table_entry const *const entry = ir_switch_table_get_entry_const(table, i);
+		if (entry->pn == 0)
+			continue;
+		if (pn == pn_Switch_default) {
+			/* An entry covering all values makes the default unreachable. */
+			if (!tv_less(b->min, entry->min) && !tv_less(entry->max, b->max))
+				return false;
+		} else if (entry->pn == pn && !tv_less(entry->max, b->min) && !tv_less(b->max, entry->min)) {
+			return true;
+		}
+	}
+	return pn == pn_Switch_default;
+}
+
 bitinfo const *try_get_bitinfo(ir_node const *const irn)
 {
 	ir_graph   *const irg = get_irn_irg(irn);
@@ -162,7 +279,8 @@ static bitinfo *get_bitinfo_direct(ir_node const *const irn)
 	bitinfo          *b   = ir_nodemap_get(bitinfo, map, irn);
 	if (!b && is_Const(irn) && mode_is_intb(get_irn_mode(irn))) {
 		ir_tarval *const tv = get_Const_tarval(irn);
-		set_bitinfo(irn, tv, tv);
+		ir_tarval *const r  = mode_is_int(get_irn_mode(irn)) ? tv : NULL;
+		set_bitinfo(irn, tv, tv, r, r);
 		b = ir_nodemap_get(bitinfo, map, irn);
 	}
 	return b;
@@ -196,6 +314,10 @@ static bitinfo *get_bitinfo_recursive(ir_node const *const irn)
 		if (b->state == BITINFO_INVALID) {
 			b->z = get_mode_null(mode);
 			b->o = get_mode_all_one(mode);
+			if (mode_is_int(mode)) {
+				b->min = get_mode_max(mode);
+				b->max = get_mode_min(mode);
+			}
 		}
 		ir_nodemap_insert(map, irn, b);
 
@@ -218,6 +340,8 @@ static bool transfer(ir_node const *const irn)
 	ir_mode   *const m = get_irn_mode(irn);
 	ir_tarval       *z;
 	ir_tarval       *o;
+	ir_tarval       *min = NULL;
+	ir_tarval       *max = NULL;
 
 	if (m == mode_X) {
 		DB((dbg, LEVEL_3, "transfer %+F\n", irn));
@@ -254,8 +378,13 @@ unreachable_X:
 					bitinfo *const b        = get_bitinfo_recursive(selector);
 					if (is_undefined(b))
 						goto unreachable_X;
-					/* TODO */
-					goto cannot_analyse_X;
+					if (!bitinfo_has_range(b))
+						goto cannot_analyse_X;
+					if (!switch_proj_reachable(pred, get_Proj_num(irn), b)) {
+						z = o = f;
+					} else {
+						goto result_unknown_X;
+					}
 				} else {
 					goto cannot_analyse_X;
 				}
@@ -308,12 +437,21 @@ result_unknown_X:
 repeatphi:
 			z = get_mode_null(m);
 			o = get_mode_all_one(m);
+			if (mode_is_int(m)) {
+				/* Start with the empty range. */
+				min = get_mode_max(m);
+				max = get_mode_min(m);
+			}
 			foreach_irn_in(block, i, pred_block) {
 				bitinfo *const b_cfg = get_bitinfo_recursive(pred_block);
 				if (b_cfg->z != f) {
 					bitinfo *const b = get_bitinfo_recursive(get_Phi_pred(irn, i));
 					z = tarval_or( z, b->z);
 					o = tarval_and(o, b->o);
+					if (min != NULL) {
+						min = tv_min(min, b->min);
+						max = tv_max(max, b->max);
+					}
 				}
 			}
 			/* Computing bitinfo for operand 1 might render operand 0 unstable.
@@ -327,6 +465,23 @@ repeatphi:
 					}
 				}
 			}
+
+			/* Widen the range if it keeps growing, so induction variables do not
+			 * need one iteration per value.  The narrowing rounds recover the
+			 * bounds afterwards. */
+			bitinfo *const self = get_bitinfo_direct(irn);
+			if (min != NULL && narrow_node == NULL && bitinfo_has_range(self)) {
+				bool const grow_min = tv_less(min, self->min);
+				bool const grow_max = tv_less(self->max, max);
+				if ((grow_min || grow_max) && ++self->n_growths > WIDEN_THRESHOLD) {
+					if (grow_min)
+						min = get_mode_min(m);
+					if (grow_max)
+						max = get_mode_max(m);
+				}
+				min = tv_min(min, self->min);
+				max = tv_max(max, self->max);
+			}
 		} else {
 			/* Undefined if any input is undefined. */
 			foreach_irn_in(irn, i, pred) {
@@ -338,26 +493,71 @@ repeatphi:
 			switch (get_irn_opcode(irn)) {
 				case iro_Bad:
 undefined:
-					z = get_mode_null(m);
-					o = get_mode_all_one(m);
+					z   = get_mode_null(m);
+					o   = get_mode_all_one(m);
+					min = NULL;
+					max = NULL;
 					break;
 
 				case iro_Const: {
 					z = o = get_Const_tarval(irn);
+					if (mode_is_int(m))
+						min = max = z;
 					break;
 				}
 
 				case iro_Confirm: {
-					ir_node *const v = get_Confirm_value(irn);
-					bitinfo *const b = get_bitinfo_recursive(v);
-					/* TODO Use bound and relation. */
-					z = b->z;
-					o = b->o;
-					if ((get_Confirm_relation(irn) & ~ir_relation_unordered) == ir_relation_equal) {
-						bitinfo *const bound_b = get_bitinfo_recursive(get_Confirm_bound(irn));
+					ir_node     *const v        = get_Confirm_value(irn);
+					bitinfo     *const b        = get_bitinfo_recursive(v);
+					bitinfo     *const bound_b  = get_bitinfo_recursive(get_Confirm_bound(irn));
+					ir_relation  const relation = get_Confirm_relation(irn) & ~ir_relation_unordered;
+					z   = b->z;
+					o   = b->o;
+					min = b->min;
+					max = b->max;
+					if (bound_b == NULL || get_irn_mode(get_Confirm_bound(irn)) != m)
+						break;
+					if (relation == ir_relation_equal) {
 						z = tarval_and(z, bound_b->z);
 						o = tarval_or( o, bound_b->o);
 					}
+					if (min == NULL || !bitinfo_has_range(bound_b))
+						break;
+
+					ir_tarval *const one = get_mode_one(m);
+					switch (relation) {
+					case ir_relation_equal:
+						min = tv_max(min, bound_b->min);
+						max = tv_min(max, bound_b->max);
+						break;
+					case ir_relation_less:
+						if (bound_b->max == get_mode_min(m))
+							goto undefined;
+						max = tv_min(max, tarval_sub(bound_b->max, one));
+						break;
+					case ir_relation_less_equal:
+						max = tv_min(max, bound_b->max);
+						break;
+					case ir_relation_greater:
+						if (bound_b->min == get_mode_max(m))
+							goto undefined;
+						min = tv_max(min, tarval_add(bound_b->min, one));
+						break;
+					case ir_relation_greater_equal:
+						min = tv_max(min, bound_b->min);
+						break;
+					case ir_relation_less_greater:
+						/* Exclude a constant bound at the border of the range. */
+						if (bound_b->min != bound_b->max || min == max)
+							break;
+						if (bound_b->min == min)
+							min = tarval_add(min, one);
+						else if (bound_b->max == max)
+							max = tarval_sub(max, one);
+						break;
+					default:
+						break;
+					}
 					break;
 				}
 
@@ -508,6 +708,10 @@ undefined:
 					ir_tarval *const nc  = tarval_or(tarval_or(lnc, rnc), vnc);
 					z = tarval_or(vz, nc);
 					o = tarval_andnot(vz, nc);
+					if (l->min != NULL && r->min != NULL) {
+						min = eval_no_wrap(tarval_add, l->min, r->min);
+						max = eval_no_wrap(tarval_add, l->max, r->max);
+					}
 					break;
 				}
 
@@ -530,6 +734,10 @@ undefined:
 					ir_tarval *const nc  = tarval_or(tarval_or(lnc, rnc), vnc);
 					z = tarval_or(vz, nc);
 					o = tarval_andnot(vz, nc);
+					if (l->min != NULL && r->min != NULL) {
+						min = eval_no_wrap(tarval_sub, l->min, r->max);
+						max = eval_no_wrap(tarval_sub, l->max, r->min);
+					}
 					break;
 				}
 
@@ -570,6 +778,17 @@ undefined:
 							ro = tarval_shr(ro, one);
 						}
 					}
+					if (l->min != NULL && r->min != NULL) {
+						/* The extremes are among the products of the bounds. */
+						ir_tarval *const p0 = eval_no_wrap(tarval_mul, l->min, r->min);
+						ir_tarval *const p1 = eval_no_wrap(tarval_mul, l->min, r->max);
+						ir_tarval *const p2 = eval_no_wrap(tarval_mul, l->max, r->min);
+						ir_tarval *const p3 = eval_no_wrap(tarval_mul, l->max, r->max);
+						if (p0 != tarval_bad && p1 != tarval_bad && p2 != tarval_bad && p3 != tarval_bad) {
+							min = tv_min(tv_min(p0, p1), tv_min(p2, p3));
+							max = tv_max(tv_max(p0, p1), tv_max(p2, p3));
+						}
+					}
 					break;
 				}
 
@@ -585,6 +804,11 @@ undefined:
 					ir_tarval *const nc  = tarval_or(bnc, vnc);
 					z = tarval_or(vz, nc);
 					o = tarval_andnot(vz, nc);
+					if (b->min != NULL) {
+						ir_tarval *const zero = get_mode_null(m);
+						min = eval_no_wrap(tarval_sub, zero, b->max);
+						max = eval_no_wrap(tarval_sub, zero, b->min);
+					}
 					break;
 
 				}
@@ -630,6 +854,22 @@ undefined:
 						goto result_unknown;
 					z = tarval_convert_to(b->z, m);
 					o = tarval_convert_to(b->o, m);
+					if (b->min != NULL && mode_is_int(m)) {
+						/* The range is kept if its width does not change, i.e. no
+						 * value wraps around. */
+						ir_mode   *const src_mode  = get_irn_mode(get_Conv_op(irn));
+						ir_tarval *const cmin      = tarval_convert_to(b->min, m);
+						ir_tarval *const cmax      = tarval_convert_to(b->max, m);
+						ir_tarval *const src_width = eval_no_wrap(tarval_sub, b->max, b->min);
+						ir_tarval *const width     = eval_no_wrap(tarval_sub, cmax, cmin);
+						if (src_width != tarval_bad && width != tarval_bad &&
+						    !tv_less(cmax, cmin) &&
+						    tarval_convert_to(src_width, m) == width &&
+						    tarval_convert_to(width, src_mode) == src_width) {
+							min = cmin;
+							max = cmax;
+						}
+					}
 					break;
 				}
 
@@ -638,14 +878,22 @@ undefined:
 					bitinfo *const bt = get_bitinfo_recursive(get_Mux_true(irn));
 					bitinfo *const c  = get_bitinfo_recursive(get_Mux_sel(irn));
 					if (c->o == t) {
-						z = bt->z;
-						o = bt->o;
+						z   = bt->z;
+						o   = bt->o;
+						min = bt->min;
+						max = bt->max;
 					} else if (c->z == f) {
-						z = bf->z;
-						o = bf->o;
+						z   = bf->z;
+						o   = bf->o;
+						min = bf->min;
+						max = bf->max;
 					} else {
 						z = tarval_or( bf->z, bt->z);
 						o = tarval_and(bf->o, bt->o);
+						if (bf->min != NULL && bt->min != NULL) {
+							min = tv_min(bf->min, bt->min);
+							max = tv_max(bf->max, bt->max);
+						}
 					}
 					break;
 				}
@@ -660,6 +908,28 @@ undefined:
 					ir_tarval  *const rz       = r->z;
 					ir_tarval  *const ro       = r->o;
 					ir_relation const relation = get_Cmp_relation(irn);
+					if (bitinfo_has_range(l) && bitinfo_has_range(r)) {
+						/* Decide the comparison by the value ranges. */
+						ir_relation possible = ir_relation_less_equal_greater;
+						if (tv_less(l->max, r->min)) {
+							possible = ir_relation_less;
+						} else if (tv_less(r->max, l->min)) {
+							possible = ir_relation_greater;
+						} else if (l->min == l->max && l->min == r->min && r->min == r->max) {
+							possible = ir_relation_equal;
+						} else if (!tv_less(r->min, l->max)) {
+							possible = ir_relation_less_equal;
+						} else if (!tv_less(l->min, r->max)) {
+							possible = ir_relation_greater_equal;
+						}
+						if ((possible & ~relation) == 0) {
+							z = o = t;
+							break;
+						} else if ((possible & relation) == 0) {
+							z = o = f;
+							break;
+						}
+					}
 					switch (relation) {
 						case ir_relation_less_greater:
 							if (!tarval_is_null(tarval_andnot(ro, lz)) ||
@@ -733,8 +1003,10 @@ undefined:
 						unsigned       pn = get_Proj_num(irn);
 						ir_node *const op = get_Tuple_pred(pred, pn);
 						bitinfo *const b  = get_bitinfo_recursive(op);
-						z = b->z;
-						o = b->o;
+						z   = b->z;
+						o   = b->o;
+						min = b->min;
+						max = b->max;
 						goto set_info;
 					}
 					goto cannot_analyse;
@@ -744,8 +1016,10 @@ undefined:
 cannot_analyse:
 					DB((dbg, LEVEL_4, "cannot analyse %+F\n", irn));
 result_unknown:
-					z = get_mode_all_one(m);
-					o = get_mode_null(m);
+					z   = get_mode_all_one(m);
+					o   = get_mode_null(m);
+					min = NULL;
+					max = NULL;
 					break;
 				}
 			}
@@ -754,8 +1028,31 @@ result_unknown:
 		return false;
 	}
 
-set_info:;
-	bool changed = set_bitinfo(irn, z, o);
+set_info:
+	if (mode_is_int(m)) {
+		if (min == tarval_bad || max == tarval_bad) {
+			min = NULL;
+			max = NULL;
+		}
+		refine(m, &z, &o, &min, &max);
+	} else {
+		min = NULL;
+		max = NULL;
+	}
+	if (irn == narrow_node) {
+		/* Only keep the information which is better than the fixpoint. */
+		bitinfo const *const old = get_bitinfo_direct(irn);
+		z = tarval_and(z, old->z);
+		o = tarval_or( o, old->o);
+		if (min != NULL) {
+			min = tv_max(min, old->min);
+			max = tv_min(max, old->max);
+			refine(m, &z, &o, &min, &max);
+		}
+		if (!tarval_is_null(tarval_andnot(o, z)))
+			return false;
+	}
+	bool changed = set_bitinfo(irn, z, o, min, max);
 	DB((dbg, LEVEL_4, "finish transfer %+F\n", irn));
 	return changed;
 }
@@ -842,6 +1139,36 @@ static void calc_bitinfo_walker(ir_node *const n, void *const env)
 		get_bitinfo_recursive(n);
 }
 
+static void narrow_walker(ir_node *const n, void *const env)
+{
+	bool *const changed = (bool*)env;
+
+	if (!mode_is_intb(get_irn_mode(n)) || is_Const(n))
+		return;
+	bitinfo const *const b = get_bitinfo_direct(n);
+	if (b == NULL || is_undefined(b))
+		return;
+	narrow_node = n;
+	*changed   |= transfer(n);
+	narrow_node = NULL;
+}
+
+/**
+ * Recomputes the information of all values once more without widening. The
+ * fixpoint is sound, so each transfer applied to it yields a sound result,
+ * which is intersected with the current one.
+ */
+static void narrow(ir_graph *const irg)
+{
+	for (unsigned i = 0; i != NARROW_ROUNDS; ++i) {
+		bool changed = false;
+		irg_walk_graph(irg, NULL, narrow_walker, &changed);
+		DB((dbg, LEVEL_2, "narrowing round %u changed %s\n", i, changed ? "something" : "nothing"));
+		if (!changed)
+			break;
+	}
+}
+
 #if VERIFY_CONSTBITS
 static void verify_constbits_walker(ir_node *const n, void *const env)
 {
@@ -886,6 +1213,8 @@ void constbits_analyze(ir_graph *const irg)
 #if VERIFY_CONSTBITS
 	verify_constbits(irg);
 #endif
+
+	narrow(irg);
 }
 
 void constbits_clear(ir_graph *const irg)
@@ -15,7 +15,10 @@ typedef struct bitinfo
 {
 	ir_tarval    *z; /**< safe zeroes, 0 = bit is zero,       1 = bit maybe is 1 */
 	ir_tarval    *o; /**< safe ones,   0 = bit maybe is zero, 1 = bit is 1 */
+	ir_tarval    *min; /**< lower bound of the value, NULL if not an integer */
+	ir_tarval    *max; /**< upper bound of the value, NULL if not an integer */
 	bitinfo_state state;
+	unsigned      n_growths; /**< number of times a Phi range grew */
 } bitinfo;
 
 /** Get analysis information for node irn */
@@ -29,7 +32,13 @@ bitinfo *get_bitinfo(ir_node const *irn);
 bitinfo const *try_get_bitinfo(ir_node const *irn);
 
 /**
- * Compute value range fixpoint aka which bits of value are constant zero/one.
+ * Returns true if the value range of @p b is known and not empty.
+ */
+bool bitinfo_has_range(bitinfo const *b);
+
+/**
+ * Compute value range fixpoint aka which bits of value are constant zero/one
+ * and the interval of possible values of integer nodes.
  * The result is available via @see get_bitinfo.
  */
 void constbits_analyze(ir_graph *irg);
@@ -0,0 +1,726 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Dependence tests for memory accesses in loop nests.
+ *
+ * The difference of two decomposed addresses is a linear function of the
+ * iteration numbers of both accesses.  The accesses touch the same memory
+ * if it lies within the sizes of the accesses, so the tests check whether
+ * the function can reach this interval:  The GCD test checks divisibility,
+ * the Banerjee test compares the interval with the minimum and maximum of
+ * the function for each direction vector, using the trip counts from the
+ * scalar evolution analysis where known.  If only one loop is involved the
+ * exact SIV tests compute the possible dependence distances.
+ *
+ * Elements of the same multi-dimensional array are only equal if all their
+ * indices are, so each dimension is tested on its own if both addresses are
+ * built from Sel nodes.
+ */
+#include "depend.h"
+
+#include "debug.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "panic.h"
+#include "scev.h"
+#include "tv.h"
+#include "type_t.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <limits.h>
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+struct dep_info_t {
+	ir_graph    *irg;
+	scev_info_t *scev;
+};
+
+/** Maximum number of Sel and Member nodes followed in an address. */
+#define MAX_ADDRESS_DEPTH 8
+
+dep_info_t *dep_new(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.depend");
+
+	dep_info_t *const info = XMALLOCZ(dep_info_t);
+	info->irg  = irg;
+	info->scev = scev_new(irg);
+	return info;
+}
+
+void dep_free(dep_info_t *const info)
+{
+	scev_free(info->scev);
+	free(info);
+}
+
+/** Returns whether @p inner is @p loop or nested in it. */
+static bool loop_contains(ir_loop const *const loop, ir_loop const *inner)
+{
+	if (inner == NULL)
+		return false;
+	unsigned const depth = get_loop_depth(loop);
+	while (get_loop_depth(inner) > depth)
+		inner = get_loop_outer_loop(inner);
+	return inner == loop;
+}
+
+/**
+ * The arithmetic on coefficients and offsets is checked.  Results must be in
+ * [-LONG_MAX, LONG_MAX], so they can be negated.  On overflow the accesses
+ * are assumed to be dependent.
+ */
+static bool checked_add(long const a, long const b, long *const res)
+{
+	return !__builtin_add_overflow(a, b, res) && *res != LONG_MIN;
+}
+
+static bool checked_sub(long const a, long const b, long *const res)
+{
+	return !__builtin_sub_overflow(a, b, res) && *res != LONG_MIN;
+}
+
+static bool checked_mul(long const a, long const b, long *const res)
+{
+	return !__builtin_mul_overflow(a, b, res) && *res != LONG_MIN;
+}
+
+static bool add_symbol(dep_affine *const affine, ir_node *const node,
+                       long const coeff)
+{
+	for (unsigned i = 0; i < affine->n_symbols; ++i) {
+		dep_symbol *const symbol = &affine->symbols[i];
+		if (symbol->node != node)
+			continue;
+		if (!checked_add(symbol->coeff, coeff, &symbol->coeff))
+			return false;
+		if (symbol->coeff == 0)
+			affine->symbols[i] = affine->symbols[--affine->n_symbols];
+		return true;
+	}
+	if (affine->n_symbols == DEP_MAX_SYMBOLS || coeff == LONG_MIN)
+		return false;
+	affine->symbols[affine->n_symbols++] = (dep_symbol){ node, coeff };
+	return true;
+}
+
+static bool add_node(dep_info_t *info, dep_affine *affine, ir_node *node,
+                     long coeff, unsigned depth);
+
+static bool add_scev(dep_info_t *const info, dep_affine *const affine,
+                     scev const *const s, long const coeff,
+                     unsigned const depth)
+{
+	if (s->kind == SCEV_ADDREC) {
+		scev const *const step = s->step;
+		if (!scev_is_constant(step) || !tarval_is_long(step->offset))
+			return false;
+		for (unsigned k = 0; k < affine->depth; ++k) {
+			if (affine->loops[k] == s->loop) {
+				long term;
+				return checked_mul(coeff, get_tarval_long(step->offset), &term)
+				    && checked_add(affine->coeffs[k], term, &affine->coeffs[k])
+				    && add_scev(info, affine, s->start, coeff, depth);
+			}
+		}
+		/* The recurrence belongs to a loop not surrounding the access. */
+		return false;
+	}
+
+	long offset;
+	if (!tarval_is_long(s->offset)
+	 || !checked_mul(coeff, get_tarval_long(s->offset), &offset)
+	 || !checked_add(affine->offset, offset, &affine->offset))
+		return false;
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		scev_term const *const term = &s->terms[i];
+		long term_coeff;
+		if (!tarval_is_long(term->coeff)
+		 || !checked_mul(coeff, get_tarval_long(term->coeff), &term_coeff))
+			return false;
+		if (is_Sel(term->node) || is_Member(term->node)) {
+			if (!add_node(info, affine, term->node, term_coeff, depth))
+				return false;
+			continue;
+		}
+		/* Symbols must have the same value in all iterations of the nest. */
+		ir_loop *const loop = get_irn_loop(get_block(term->node));
+		if (affine->depth > 0 && loop_contains(affine->loops[0], loop))
+			return false;
+		if (!add_symbol(affine, term->node, term_coeff))
+			return false;
+	}
+	return true;
+}
+
+static bool add_node(dep_info_t *const info, dep_affine *const affine,
+                     ir_node *const node, long const coeff,
+                     unsigned const depth)
+{
+	if (depth == 0)
+		return false;
+
+	if (is_Sel(node)) {
+		ir_type *const type    = get_Sel_type(node);
+		ir_type *const element = get_array_element_type(type);
+		if (get_type_state(element) != layout_fixed)
+			return false;
+		long size;
+		return checked_mul(coeff, get_type_size(element), &size)
+		    && add_node(info, affine, get_Sel_ptr(node), coeff, depth - 1)
+		    && add_scev(info, affine, scev_get(info->scev, get_Sel_index(node)),
+		                size, depth - 1);
+	}
+
+	if (is_Member(node)) {
+		ir_entity *const entity = get_Member_entity(node);
+		ir_type   *const owner  = get_entity_owner(entity);
+		if (get_type_state(owner) != layout_fixed
+		 || get_entity_bitfield_size(entity) != 0)
+			return add_symbol(affine, node, coeff);
+		long offset;
+		return checked_mul(coeff, get_entity_offset(entity), &offset)
+		    && checked_add(affine->offset, offset, &affine->offset)
+		    && add_node(info, affine, get_Member_ptr(node), coeff, depth - 1);
+	}
+
+	return add_scev(info, affine, scev_get(info->scev, node), coeff, depth);
+}
+
+/** Sets the loop nest of @p block and clears the terms of @p affine. */
+static bool init_affine(dep_affine *const affine, ir_node *const block)
+{
+	memset(affine, 0, sizeof(*affine));
+
+	ir_loop *loop = get_irn_loop(block);
+	if (loop == NULL)
+		return false;
+	unsigned const depth = get_loop_depth(loop);
+	if (depth > DEP_MAX_DEPTH)
+		return false;
+	affine->depth = depth;
+	for (unsigned k = depth; k-- > 0; loop = get_loop_outer_loop(loop))
+		affine->loops[k] = loop;
+	return true;
+}
+
+bool dep_decompose(dep_info_t *const info, ir_node *const ptr,
+                   ir_node *const block, dep_affine *const affine)
+{
+	return init_affine(affine, block)
+	    && add_node(info, affine, ptr, 1, MAX_ADDRESS_DEPTH);
+}
+
+/** Decomposes the array index @p index used in @p block. */
+static bool decompose_index(dep_info_t *const info, ir_node *const index,
+                            ir_node *const block, dep_affine *const affine)
+{
+	return init_affine(affine, block)
+	    && add_scev(info, affine, scev_get(info->scev, index), 1,
+	                MAX_ADDRESS_DEPTH);
+}
+
+/**
+ * Returns the last iteration of @p loop, in which @p block is executed, or
+ * -1 if it is unknown.
+ */
+static long get_max_iteration(dep_info_t *const info, ir_loop *const loop,
+                              ir_node const *const block)
+{
+	bool              may_be_zero;
+	scev const *const count = scev_get_backedge_count(info->scev, loop,
+	                                                  &may_be_zero);
+	if (count == NULL || !scev_is_constant(count)
+	 || !tarval_is_long(count->offset))
+		return -1;
+	long const n = get_tarval_long(count->offset);
+	if (n < 0)
+		return -1;
+	/* If the header tests for the exit, the other blocks are not executed in
+	 * the last iteration. */
+	ir_node *const exit = scev_get_exit_block(info->scev, loop);
+	if (n > 0 && exit != NULL && block != exit && has_backedges(exit))
+		return n - 1;
+	return n;
+}
+
+/** A range of values, possibly unbounded. */
+typedef struct dep_range {
+	long min;
+	long max;
+	bool min_inf; /**< no lower bound */
+	bool max_inf; /**< no upper bound */
+} dep_range;
+
+/**
+ * Extends @p range by the values c0 + c1 * w of the corners of an iteration
+ * space, with w between 0 and @p w, which is -1 if unbounded.  Values, which
+ * overflow, make the range unbounded.
+ */
+static void add_corners(dep_range *const range, long const (*const corners)[2],
+                        unsigned const n_corners, long const w)
+{
+	for (unsigned i = 0; i < n_corners; ++i) {
+		long const c0 = corners[i][0];
+		long const c1 = corners[i][1];
+		long value = c0;
+		long term;
+		if (w < 0) {
+			if (c1 < 0)
+				range->min_inf = true;
+			else if (c1 > 0)
+				range->max_inf = true;
+		} else if (!checked_mul(c1, w, &term)
+		        || !checked_add(c0, term, &value)) {
+			range->min_inf = true;
+			range->max_inf = true;
+			continue;
+		}
+		range->min = MIN(range->min, value);
+		range->max = MAX(range->max, value);
+	}
+}
+
+/**
+ * Computes the range of a * i - b * j where i and j are iterations of a loop
+ * with at most @p n backedges, or -1 if unknown, and i relates to j as given
+ * by @p dir.  Returns false if no iterations satisfy the direction.
+ */
+static bool get_term_range(long const a, long const b, long const n,
+                           unsigned const dir, dep_range *const range)
+{
+	*range = (dep_range){ LONG_MAX, LONG_MIN, false, false };
+	long a_b;
+	if (!checked_sub(a, b, &a_b)) {
+		*range = (dep_range){ 0, 0, true, true };
+		return true;
+	}
+	switch (dir) {
+	case DEP_DIR_ALL: {
+		long const corners[][2] = { { 0, 0 }, { 0, a }, { 0, -b }, { 0, a_b } };
+		add_corners(range, corners, ARRAY_SIZE(corners), n);
+		return true;
+	}
+	case DEP_DIR_EQ: {
+		long const corners[][2] = { { 0, 0 }, { 0, a_b } };
+		add_corners(range, corners, ARRAY_SIZE(corners), n);
+		return true;
+	}
+	case DEP_DIR_LT: {
+		/* j = i + 1 + e with i + e <= n - 1 */
+		if (n == 0)
+			return false;
+		long const corners[][2] = { { -b, 0 }, { -b, a_b }, { -b, -b } };
+		add_corners(range, corners, ARRAY_SIZE(corners), n < 0 ? -1 : n - 1);
+		return true;
+	}
+	case DEP_DIR_GT: {
+		if (n == 0)
+			return false;
+		long const corners[][2] = { { a, 0 }, { a, a_b }, { a, a } };
+		add_corners(range, corners, ARRAY_SIZE(corners), n < 0 ? -1 : n - 1);
+		return true;
+	}
+	}
+	panic("invalid direction");
+}
+
+static void add_range(dep_range *const sum, dep_range const *const range)
+{
+	sum->min_inf |= range->min_inf
+	             || !checked_add(sum->min, range->min, &sum->min);
+	sum->max_inf |= range->max_inf
+	             || !checked_add(sum->max, range->max, &sum->max);
+}
+
+/** The linear dependence problem lo <= sum(a[k]*i[k] - b[k]*j[k]) <= hi. */
+typedef struct dep_problem {
+	dep_info_t       *info;
+	dep_affine const *src;
+	dep_affine const *dst;
+	unsigned          n_common;  /**< number of common loops */
+	long              lo;
+	long              hi;
+	long              n[DEP_MAX_DEPTH];     /**< backedge counts, -1 unknown */
+	unsigned          dirs[DEP_MAX_DEPTH];  /**< current direction vector */
+} dep_problem;
+
+/** Returns the coefficient of the source access in loop k. */
+static long get_src_coeff(dep_problem const *const p, unsigned const k)
+{
+	return k < p->src->depth ? p->src->coeffs[k] : 0;
+}
+
+/** Returns the coefficient of the destination access in loop k. */
+static long get_dst_coeff(dep_problem const *const p, unsigned const k)
+{
+	return k < p->dst->depth ? p->dst->coeffs[k] : 0;
+}
+
+/**
+ * Banerjee test: Enumerates the direction vectors of the common loops and
+ * adds the directions of all vectors, which admit a solution, to @p result.
+ * Returns false if no vector admits a solution.
+ */
+static bool banerjee(dep_problem *const p, unsigned const k,
+                     dep_range const *const sum, dep_result *const result)
+{
+	/* n_common is at most DEP_MAX_DEPTH, which bounds the recursion. */
+	if (k == p->n_common || k == DEP_MAX_DEPTH) {
+		if ((!sum->max_inf && sum->max < p->lo)
+		 || (!sum->min_inf && sum->min > p->hi))
+			return false;
+		for (unsigned l = 0; l < p->n_common; ++l)
+			result->directions[l] |= p->dirs[l];
+		return true;
+	}
+
+	long const a     = get_src_coeff(p, k);
+	long const b     = get_dst_coeff(p, k);
+	bool       found = false;
+	for (unsigned dir = DEP_DIR_LT; dir <= DEP_DIR_GT; dir <<= 1) {
+		dep_range range;
+		if (!get_term_range(a, b, p->n[k], dir, &range))
+			continue;
+		dep_range next = *sum;
+		add_range(&next, &range);
+		p->dirs[k] = dir;
+		found |= banerjee(p, k + 1, &next, result);
+	}
+	return found;
+}
+
+static long gcd(long a, long b)
+{
+	a = a < 0 ? -a : a;
+	b = b < 0 ? -b : b;
+	while (b != 0) {
+		long const t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static long floor_div(long const a, long const b)
+{
+	long const q = a / b;
+	return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static long ceil_div(long const a, long const b)
+{
+	long const q = a / b;
+	return (a % b != 0 && (a < 0) == (b < 0)) ? q + 1 : q;
+}
+
+/**
+ * Computes the values x with lo <= c * x <= hi, limited to [min, max].
+ * Returns false if there are none.
+ */
+static bool solve_range(long const c, long const lo, long const hi,
+                        long *const min, long *const max)
+{
+	long const l = c > 0 ? ceil_div(lo, c)  : ceil_div(hi, c);
+	long const h = c > 0 ? floor_div(hi, c) : floor_div(lo, c);
+	*min = MAX(*min, l);
+	*max = MIN(*max, h);
+	return *min <= *max;
+}
+
+/**
+ * Exact SIV test if only loop k has nonzero coefficients.  Restricts the
+ * directions of loop k in @p result and returns false if the accesses are
+ * independent.
+ */
+static bool siv(dep_problem const *const p, unsigned const k,
+                dep_result *const result)
+{
+	long const a = get_src_coeff(p, k);
+	long const b = get_dst_coeff(p, k);
+	long const n = p->n[k];
+	if (a == b) {
+		/* Strong SIV: a * i - a * j = -a * distance */
+		long min = n < 0 ? LONG_MIN / 2 : -n;
+		long max = n < 0 ? LONG_MAX / 2 :  n;
+		if (!solve_range(-a, p->lo, p->hi, &min, &max))
+			return false;
+		result->directions[k] &= (min < 0 ? DEP_DIR_GT : 0)
+		                       | (min <= 0 && max >= 0 ? DEP_DIR_EQ : 0)
+		                       | (max > 0 ? DEP_DIR_LT : 0);
+		if (min == max) {
+			result->distance_known[k] = true;
+			result->distances[k]      = min;
+		}
+		return result->directions[k] != 0;
+	}
+	if (a == 0 || b == 0) {
+		/* Weak-zero SIV: only one access moves through the memory. */
+		long min = 0;
+		long max = n < 0 ? LONG_MAX / 2 : n;
+		return solve_range(a != 0 ? a : -b, p->lo, p->hi, &min, &max);
+	}
+	return true;
+}
+
+/** Sets the common loops of two blocks, all iterations are dependent. */
+static void init_result(ir_node *const src_block, ir_node *const dst_block,
+                        dep_result *const result)
+{
+	memset(result, 0, sizeof(*result));
+
+	ir_loop *la = get_irn_loop(src_block);
+	ir_loop *lb = get_irn_loop(dst_block);
+	if (la == NULL || lb == NULL)
+		return;
+	while (get_loop_depth(la) > get_loop_depth(lb))
+		la = get_loop_outer_loop(la);
+	while (get_loop_depth(lb) > get_loop_depth(la))
+		lb = get_loop_outer_loop(lb);
+	while (la != lb) {
+		la = get_loop_outer_loop(la);
+		lb = get_loop_outer_loop(lb);
+	}
+	unsigned const depth = get_loop_depth(la);
+	if (depth > DEP_MAX_DEPTH)
+		return;
+	result->n_loops = depth;
+	for (unsigned k = depth; k-- > 0; la = get_loop_outer_loop(la)) {
+		result->loops[k]      = la;
+		result->directions[k] = DEP_DIR_ALL;
+	}
+}
+
+/**
+ * Tests whether the accesses @p src and @p dst with the decomposed addresses
+ * @p a and @p b touch the same memory.  Accesses of @p src_size and
+ * @p dst_size units overlap if the difference of the addresses is in
+ * (-src_size, dst_size).  Restricts the directions in @p result, which must
+ * allow all directions, and returns false if the accesses are independent.
+ */
+static bool test_affine(dep_info_t *const info, dep_access const *const src,
+                        dep_access const *const dst, dep_affine *const a,
+                        dep_affine const *const b, long const src_size,
+                        long const dst_size, dep_result *const result)
+{
+	/* The symbols must cancel out. */
+	for (unsigned i = 0; i < b->n_symbols; ++i) {
+		if (!add_symbol(a, b->symbols[i].node, -b->symbols[i].coeff))
+			return true;
+	}
+	if (a->n_symbols != 0)
+		return true;
+
+	long diff;
+	long lo;
+	long hi;
+	if (!checked_sub(a->offset, b->offset, &diff)
+	 || !checked_sub(1 - src_size, diff, &lo)
+	 || !checked_sub(dst_size - 1, diff, &hi))
+		return true;
+
+	unsigned    n_common = result->n_loops;
+	dep_problem p        = {
+		.info     = info,
+		.src      = a,
+		.dst      = b,
+		.n_common = n_common,
+		.lo       = lo,
+		.hi       = hi,
+	};
+
+	/* Iterations of loops around only one access are unrelated to the
+	 * iterations of the other access. */
+	long      g         = 0;
+	bool      unrelated = false;
+	dep_range others    = { 0, 0, false, false };
+	for (unsigned k = 0, n = MAX(a->depth, b->depth); k < n; ++k) {
+		long const ca = k < a->depth ? a->coeffs[k] : 0;
+		long const cb = k < b->depth ? b->coeffs[k] : 0;
+		g = gcd(gcd(g, ca), cb);
+		if (k < n_common) {
+			long const n_src = get_max_iteration(info, a->loops[k], src->block);
+			long const n_dst = get_max_iteration(info, a->loops[k], dst->block);
+			p.n[k] = n_src < 0 || n_dst < 0 ? -1 : MAX(n_src, n_dst);
+			continue;
+		}
+		dep_range range;
+		if (ca != 0) {
+			get_term_range(ca, 0, get_max_iteration(info, a->loops[k], src->block),
+			               DEP_DIR_ALL, &range);
+			add_range(&others, &range);
+			unrelated = true;
+		}
+		if (cb != 0) {
+			get_term_range(0, cb, get_max_iteration(info, b->loops[k], dst->block),
+			               DEP_DIR_ALL, &range);
+			add_range(&others, &range);
+			unrelated = true;
+		}
+	}
+
+	/* ZIV test */
+	if (g == 0)
+		return p.lo <= 0 && 0 <= p.hi;
+
+	/* GCD test */
+	long multiple;
+	if (checked_mul(floor_div(p.hi, g), g, &multiple) && multiple < p.lo) {
+		DB((dbg, LEVEL_2, "%+F and %+F independent by GCD test\n",
+		    src->ptr, dst->ptr));
+		return false;
+	}
+
+	for (unsigned k = 0; k < n_common; ++k)
+		result->directions[k] = 0;
+	if (!banerjee(&p, 0, &others, result)) {
+		DB((dbg, LEVEL_2, "%+F and %+F independent by Banerjee test\n",
+		    src->ptr, dst->ptr));
+		return false;
+	}
+
+	/* If the terms of all but one loop cancel out in the remaining
+	 * directions, the exact SIV test applies to this loop. */
+	unsigned n_variant = 0;
+	unsigned variant   = 0;
+	for (unsigned k = 0; k < n_common; ++k) {
+		long const ca = get_src_coeff(&p, k);
+		long const cb = get_dst_coeff(&p, k);
+		if ((ca == 0 && cb == 0)
+		 || (ca == cb && result->directions[k] == DEP_DIR_EQ))
+			continue;
+		++n_variant;
+		variant = k;
+	}
+	if (!unrelated && n_variant == 1 && !siv(&p, variant, result)) {
+		DB((dbg, LEVEL_2, "%+F and %+F independent by SIV test\n",
+		    src->ptr, dst->ptr));
+		return false;
+	}
+
+	for (unsigned k = 0; k < n_common; ++k) {
+		if (result->directions[k] == DEP_DIR_EQ) {
+			result->distance_known[k] = true;
+			result->distances[k]      = 0;
+		}
+	}
+	return true;
+}
+
+/** Maximum number of array dimensions tested separately. */
+#define MAX_DIMENSIONS DEP_MAX_DEPTH
+
+/**
+ * Collects the indices of accesses to elements of the same array, innermost
+ * dimension first.  Returns the number of dimensions or 0 if the addresses
+ * do not have this form.
+ */
+static unsigned get_subscripts(dep_access const *const src,
+                               dep_access const *const dst,
+                               ir_node **const src_index,
+                               ir_node **const dst_index)
+{
+	ir_node *a = src->ptr;
+	ir_node *b = dst->ptr;
+	if (!is_Sel(a) || !is_Sel(b) || get_Sel_type(a) != get_Sel_type(b))
+		return 0;
+	ir_type *const element = get_array_element_type(get_Sel_type(a));
+	if (get_type_state(element) != layout_fixed
+	 || src->size > get_type_size(element)
+	 || dst->size > get_type_size(element))
+		return 0;
+
+	unsigned n = 0;
+	for (; is_Sel(a) && is_Sel(b); a = get_Sel_ptr(a), b = get_Sel_ptr(b)) {
+		ir_type *const type = get_Sel_type(a);
+		if (n == MAX_DIMENSIONS || get_Sel_type(b) != type)
+			return 0;
+		src_index[n] = get_Sel_index(a);
+		dst_index[n] = get_Sel_index(b);
+		++n;
+	}
+	return a == b && n > 1 ? n : 0;
+}
+
+bool dep_test(dep_info_t *const info, dep_access const *const src,
+              dep_access const *const dst, dep_result *const result)
+{
+	init_result(src->block, dst->block, result);
+	if (result->n_loops == 0)
+		return true;
+
+	/* Accesses to elements of the same array overlap only if all indices
+	 * are equal, assuming that the indices of the inner dimensions are in
+	 * bounds.  Test each dimension on its own. */
+	ir_node       *src_index[MAX_DIMENSIONS];
+	ir_node       *dst_index[MAX_DIMENSIONS];
+	unsigned const n_dims = get_subscripts(src, dst, src_index, dst_index);
+	if (n_dims > 0) {
+		dep_result const all = *result;
+		for (unsigned d = 0; d < n_dims; ++d) {
+			dep_affine a;
+			dep_affine b;
+			if (!decompose_index(info, src_index[d], src->block, &a)
+			 || !decompose_index(info, dst_index[d], dst->block, &b))
+				continue;
+			dep_result dim = all;
+			if (!test_affine(info, src, dst, &a, &b, 1, 1, &dim))
+				return false;
+			for (unsigned k = 0; k < result->n_loops; ++k) {
+				result->directions[k] &= dim.directions[k];
+				if (result->directions[k] == 0)
+					return false;
+				if (!dim.distance_known[k])
+					continue;
+				if (result->distance_known[k]
+				 && result->distances[k] != dim.distances[k])
+					return false;
+				result->distance_known[k] = true;
+				result->distances[k]      = dim.distances[k];
+			}
+		}
+		return true;
+	}
+
+	dep_affine a;
+	dep_affine b;
+	if (!dep_decompose(info, src->ptr, src->block, &a)
+	 || !dep_decompose(info, dst->ptr, dst->block, &b))
+		return true;
+	return test_affine(info, src, dst, &a, &b, src->size, dst->size, result);
+}
+
+/** Fills @p access for a Load or Store, returns false for other nodes. */
+static bool get_access(ir_node *const node, dep_access *const access)
+{
+	access->block = get_nodes_block(node);
+	if (is_Load(node)) {
+		access->ptr  = get_Load_ptr(node);
+		access->size = get_mode_size_bytes(get_Load_mode(node));
+		return true;
+	}
+	if (is_Store(node)) {
+		access->ptr  = get_Store_ptr(node);
+		access->size = get_mode_size_bytes(get_irn_mode(get_Store_value(node)));
+		return true;
+	}
+	return false;
+}
+
+bool dep_test_memops(dep_info_t *const info, ir_node *const src,
+                     ir_node *const dst, dep_result *const result)
+{
+	dep_access src_access;
+	dep_access dst_access;
+	if (get_access(src, &src_access) && get_access(dst, &dst_access))
+		return dep_test(info, &src_access, &dst_access, result);
+
+	init_result(get_nodes_block(src), get_nodes_block(dst), result);
+	return true;
+}
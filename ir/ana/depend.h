@@ -0,0 +1,117 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Dependence tests for memory accesses in loop nests.
+ *
+ * Addresses built from Sel, Member and address arithmetic are decomposed
+ * into affine functions of the iteration numbers of the surrounding loops.
+ * For two accesses the iterations in which they touch the same memory are
+ * described by the direction and, where unique, the distance of the
+ * dependence in every loop both accesses are nested in.  Independence is
+ * shown with the ZIV, strong and weak-zero SIV, GCD and Banerjee tests,
+ * which are applied to each index of multi-dimensional arrays separately.
+ * Indices of all but the outermost dimension are assumed to be in bounds.
+ */
+#ifndef FIRM_ANA_DEPEND_H
+#define FIRM_ANA_DEPEND_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/** Maximum depth of analysed loop nests. */
+#define DEP_MAX_DEPTH 4
+
+/** Maximum number of symbolic terms of a decomposed address. */
+#define DEP_MAX_SYMBOLS 4
+
+/**
+ * Directions of a dependence in a loop.  They compare the iteration of the
+ * source access with the iteration of the destination access.
+ */
+typedef enum dep_direction {
+	DEP_DIR_LT  = 1 << 0, /**< source in an earlier iteration */
+	DEP_DIR_EQ  = 1 << 1, /**< both in the same iteration */
+	DEP_DIR_GT  = 1 << 2, /**< source in a later iteration */
+	DEP_DIR_ALL = DEP_DIR_LT | DEP_DIR_EQ | DEP_DIR_GT,
+} dep_direction;
+
+/** A loop invariant term of a decomposed address. */
+typedef struct dep_symbol {
+	ir_node *node;  /**< the invariant value, e.g. the array base */
+	long     coeff; /**< its factor, never zero */
+} dep_symbol;
+
+/**
+ * An address as affine function of the iteration numbers of its loop nest:
+ * offset + sum(symbols) + sum(coeffs[k] * iteration of loops[k]).
+ * Iterations are counted from 0 in every execution of the loop.
+ */
+typedef struct dep_affine {
+	unsigned   depth;                      /**< number of loops */
+	ir_loop   *loops[DEP_MAX_DEPTH];       /**< loop nest, outermost first */
+	long       coeffs[DEP_MAX_DEPTH];      /**< increment per iteration */
+	long       offset;                     /**< constant part in bytes */
+	unsigned   n_symbols;                  /**< number of symbolic terms */
+	dep_symbol symbols[DEP_MAX_SYMBOLS];   /**< the symbolic terms */
+} dep_affine;
+
+/** A memory access. */
+typedef struct dep_access {
+	ir_node  *ptr;   /**< the accessed address */
+	ir_node  *block; /**< the block executing the access */
+	unsigned  size;  /**< number of accessed bytes */
+} dep_access;
+
+/** The dependence between two accesses. */
+typedef struct dep_result {
+	unsigned  n_loops;                       /**< number of common loops */
+	ir_loop  *loops[DEP_MAX_DEPTH];          /**< common loops, outermost first */
+	unsigned  directions[DEP_MAX_DEPTH];     /**< possible dep_directions */
+	bool      distance_known[DEP_MAX_DEPTH]; /**< distance is unique */
+	long      distances[DEP_MAX_DEPTH];      /**< destination iteration minus
+	                                              source iteration */
+} dep_result;
+
+typedef struct dep_info_t dep_info_t;
+
+/**
+ * Creates a dependence analysis object for a graph.
+ * Requires consistent loop information.
+ */
+dep_info_t *dep_new(ir_graph *irg);
+
+/** Frees a dependence analysis object. */
+void dep_free(dep_info_t *info);
+
+/**
+ * Decomposes the address @p ptr accessed in @p block.
+ * Returns false if it is no affine function of the iteration numbers with
+ * loop invariant symbols.
+ */
+bool dep_decompose(dep_info_t *info, ir_node *ptr, ir_node *block,
+                   dep_affine *affine);
+
+/**
+ * Tests whether the access @p dst may touch memory accessed by @p src.
+ * Returns false if the accesses are independent.  Otherwise @p result
+ * describes the iterations in which both may access the same memory,
+ * conservatively all of them if the addresses cannot be decomposed.
+ * Accesses to different objects are not recognized, this is left to the
+ * alias analysis.
+ */
+bool dep_test(dep_info_t *info, dep_access const *src, dep_access const *dst,
+              dep_result *result);
+
+/**
+ * Like dep_test() for two Load or Store nodes.  Other nodes are
+ * conservatively assumed to be dependent in all iterations.
+ */
+bool dep_test_memops(dep_info_t *info, ir_node *src, ir_node *dst,
+                     dep_result *result);
+
+#endif
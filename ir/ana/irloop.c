@@ -11,6 +11,7 @@
  */
 #include "irloop_t.h"
 
+#include "array.h"
 #include "irprog_t.h"
 #include <stdlib.h>
 
@@ -160,3 +161,101 @@ int is_loop_invariant(const ir_node *n, const ir_node *block)
 	ir_node const *const b = get_block_const(n);
 	return !is_loop_variant(l, get_irn_loop(b));
 }
+
+bool is_innermost_loop(ir_loop const *const loop)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		if (*get_loop_element(loop, i).kind == k_ir_loop)
+			return false;
+	}
+	return true;
+}
+
+static void collect_innermost_loops(ir_loop *const loop, ir_loop ***const loops)
+{
+	bool innermost = true;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			innermost = false;
+			collect_innermost_loops(element.son, loops);
+		}
+	}
+	if (innermost)
+		ARR_APP1(ir_loop*, *loops, loop);
+}
+
+ir_loop **get_innermost_loops(ir_graph *const irg)
+{
+	assert(irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO));
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	ir_loop  *root  = get_irg_loop(irg);
+	for (size_t i = 0, n = get_loop_n_elements(root); i < n; ++i) {
+		loop_element const element = get_loop_element(root, i);
+		if (*element.kind == k_ir_loop)
+			collect_innermost_loops(element.son, &loops);
+	}
+	return loops;
+}
+
+bool get_loop_shape(ir_loop *const loop, loop_shape_t *const shape)
+{
+	size_t const n_blocks = get_loop_n_elements(loop);
+	if (n_blocks > 2)
+		return false;
+
+	ir_node *header = NULL;
+	for (size_t i = 0; i < n_blocks; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind != k_ir_node)
+			return false;
+		if (has_backedges(element.node)) {
+			if (header != NULL)
+				return false;
+			header = element.node;
+		}
+	}
+	if (header == NULL || get_Block_n_cfgpreds(header) != 2)
+		return false;
+
+	int const entry_pos = is_backedge(header, 0) ? 1 : 0;
+	int const back_pos  = 1 - entry_pos;
+	if (is_backedge(header, entry_pos) || !is_backedge(header, back_pos)
+	 || is_Bad(get_Block_cfgpred(header, entry_pos)))
+		return false;
+
+	ir_node *const latch = get_Block_cfgpred_block(header, back_pos);
+	ir_node       *stay;
+	if (n_blocks == 1) {
+		if (latch != header)
+			return false;
+		stay = get_Block_cfgpred(header, back_pos);
+	} else {
+		if (latch == header || get_irn_loop(latch) != loop
+		 || get_Block_n_cfgpreds(latch) != 1
+		 || get_Block_cfgpred_block(latch, 0) != header
+		 || !is_Jmp(get_Block_cfgpred(header, back_pos)))
+			return false;
+		stay = get_Block_cfgpred(latch, 0);
+	}
+	if (!is_Proj(stay))
+		return false;
+	ir_node *const cond = get_Proj_pred(stay);
+	if (!is_Cond(cond) || get_nodes_block(cond) != header
+	 || !is_Cmp(get_Cond_selector(cond)))
+		return false;
+
+	bool     const exit_on_true = get_Proj_num(stay) == pn_Cond_false;
+	unsigned const exit_pn      = exit_on_true ? pn_Cond_true : pn_Cond_false;
+	ir_node *const exit         = get_Proj_for_pn(cond, exit_pn);
+	if (exit == NULL)
+		return false;
+
+	shape->header       = header;
+	shape->latch        = latch;
+	shape->entry_pos    = entry_pos;
+	shape->cmp          = get_Cond_selector(cond);
+	shape->exit_on_true = exit_on_true;
+	shape->exit         = exit;
+	return true;
+}
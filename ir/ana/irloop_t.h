@@ -73,6 +73,43 @@ void set_irn_loop(ir_node *n, ir_loop *loop);
  */
 void mature_loops(ir_loop *loop, struct obstack *obst);
 
+/** Checks whether @p loop contains no further loops. */
+bool is_innermost_loop(ir_loop const *loop);
+
+/**
+ * Returns a flexible array of the innermost loops of @p irg, which must
+ * have consistent loop information.  The caller frees it with DEL_ARR_F().
+ */
+ir_loop **get_innermost_loops(ir_graph *irg);
+
+/**
+ * The blocks of a loop consisting of the header and at most one further
+ * block, which is left only by the exit test at the end of the header.
+ */
+typedef struct loop_shape_t {
+	ir_node *header;
+	ir_node *latch;        /**< block with the backedge, may be header */
+	int      entry_pos;    /**< position of the loop entry in header */
+	ir_node *cmp;          /**< the exit test */
+	bool     exit_on_true; /**< the loop is left if cmp holds */
+	ir_node *exit;         /**< the Proj leaving the loop */
+} loop_shape_t;
+
+/**
+ * Checks whether @p loop has the shape described by loop_shape_t and fills
+ * @p shape if so.  The loop must not contain further loops and the graph
+ * must have consistent out edges.
+ */
+bool get_loop_shape(ir_loop *loop, loop_shape_t *shape);
+
+/** Checks whether @p node belongs to a block of the loop @p shape. */
+static inline bool is_in_loop_shape(loop_shape_t const *const shape,
+                                    ir_node const *const node)
+{
+	ir_node const *const block = get_block_const(node);
+	return block == shape->header || block == shape->latch;
+}
+
 /* -------- inline functions -------- */
 
 static inline int _is_ir_loop(const void *thing)
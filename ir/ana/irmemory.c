@@ -23,6 +23,7 @@
 #include "irprintf.h"
 #include "irprog_t.h"
 #include "panic.h"
+#include "pta.h"
 #include "type_t.h"
 #include "typerep.h"
 #include "util.h"
@@ -431,6 +432,10 @@ pointer:
 		}
 	}
 
+	/* pointers into different points-to classes cannot alias */
+	if (pta_get_alias_relation(addr1, addr2) == ir_no_alias)
+		return ir_no_alias;
+
 	/* Type based alias analysis */
 	if (options & aa_opt_type_based) {
 		ir_alias_relation rel;
@@ -0,0 +1,501 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory SSA overlay partitioned by alias classes.
+ *
+ * Alias classes are the connected components of the may-alias relation
+ * between the accesses.  The reaching definition of a class is found by
+ * following the memory chain backwards over nodes not writing the class;
+ * the results are cached for some of the memory values passed.  Virtual Phis are
+ * created before their operands are analysed, which breaks cycles.  If all
+ * operands turn out to be the same definition, the Phi is forwarded to it.
+ */
+#include "memssa.h"
+
+#include "array.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "hashptr.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "obst.h"
+#include "pmap.h"
+#include "set.h"
+#include "unionfind.h"
+#include "xmalloc.h"
+
+/** Maximum number of alias queries to partition the accesses.  If more are
+ * needed, all accesses end up in a single class. */
+#define MAX_ALIAS_QUERIES 65536
+/** Distance of cached memory values on a chain not writing a class. */
+#define MEMO_DISTANCE     16
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+struct memssa_def {
+	memssa_kind  kind;
+	ir_node     *node;
+	unsigned     n_preds;
+	memssa_def **preds;   /**< operands of virtual Phis and Syncs */
+	memssa_def  *forward; /**< the definition a trivial Phi stands for */
+};
+
+/** A memory access. */
+typedef struct access_t {
+	ir_node       *node;
+	ir_node const *ptr;
+	ir_type const *type;
+	unsigned       size;
+	unsigned       cls;
+} access_t;
+
+/** A cached reaching definition of a memory value for a class. */
+typedef struct reaching_t {
+	ir_node const *mem;
+	unsigned       cls;
+	memssa_def    *def;
+} reaching_t;
+
+struct memssa_t {
+	ir_graph      *irg;
+	access_t      *accesses;     /**< flexible array of all accesses */
+	unsigned       n_classes;
+	unsigned     **class_members; /**< access indices per class */
+	unsigned char *read_only;    /**< per class: 0 unknown, 1 yes, 2 no */
+	ir_node      **calls;        /**< flexible array of all Calls */
+	bool           has_unknown_writers; /**< other nodes writing memory */
+	ir_nodemap     classes;      /**< maps accesses to class + 1 */
+	ir_nodemap     defs;         /**< maps nodes to their MEMSSA_DEF/ENTRY */
+	set           *reaching;     /**< cache of reaching definitions */
+	struct obstack obst;
+};
+
+static int cmp_reaching(void const *const elt, void const *const key, size_t const size)
+{
+	(void)size;
+	reaching_t const *const a = (reaching_t const*)elt;
+	reaching_t const *const b = (reaching_t const*)key;
+	return a->mem != b->mem || a->cls != b->cls;
+}
+
+static unsigned hash_reaching(reaching_t const *const entry)
+{
+	return hash_combine(get_irn_idx(entry->mem), entry->cls);
+}
+
+/** Returns whether the memory operation @p node never writes memory. */
+static bool is_transparent(ir_node const *const node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+	case iro_Div:
+	case iro_Mod:
+	case iro_Alloc:
+		return true;
+	default:
+		return is_memop(node) && is_irn_const_memory(node);
+	}
+}
+
+static void collect_accesses(ir_node *const node, void *const data)
+{
+	memssa_t *const ms = (memssa_t*)data;
+	access_t        access;
+	access.node = node;
+	switch (get_irn_opcode(node)) {
+	case iro_Call:
+		ARR_APP1(ir_node*, ms->calls, node);
+		return;
+	case iro_Load:
+		access.ptr  = get_Load_ptr(node);
+		access.type = get_Load_type(node);
+		access.size = get_mode_size_bytes(get_Load_mode(node));
+		break;
+	case iro_Store:
+		access.ptr  = get_Store_ptr(node);
+		access.type = get_Store_type(node);
+		access.size = get_mode_size_bytes(get_irn_mode(get_Store_value(node)));
+		break;
+	case iro_CopyB:
+		/* The source is added as separate access below, both are united. */
+		access.ptr  = get_CopyB_dst(node);
+		access.type = get_CopyB_type(node);
+		access.size = get_type_size(access.type);
+		ARR_APP1(access_t, ms->accesses, access);
+		access.ptr  = get_CopyB_src(node);
+		break;
+	default:
+		if (is_memop(node) && !is_transparent(node))
+			ms->has_unknown_writers = true;
+		return;
+	}
+	ARR_APP1(access_t, ms->accesses, access);
+}
+
+/**
+ * Returns the global or local variable @p ptr points into, if it is known.
+ * get_alias_relation() never reports accesses into different such variables
+ * as aliasing, so they need not be compared.
+ */
+static ir_entity *get_base_entity(ir_node const *ptr)
+{
+	ir_node const *const frame = get_irg_frame(get_irn_irg(ptr));
+	for (;;) {
+		switch (get_irn_opcode(ptr)) {
+		case iro_Add: {
+			ir_node const *const left = get_Add_left(ptr);
+			ptr = mode_is_reference(get_irn_mode(left)) ? left : get_Add_right(ptr);
+			break;
+		}
+		case iro_Sub:
+			ptr = get_Sub_left(ptr);
+			break;
+		case iro_Sel:
+			ptr = get_Sel_ptr(ptr);
+			break;
+		case iro_Member: {
+			ir_node const *const pred = get_Member_ptr(ptr);
+			if (pred == frame) {
+				ir_entity *const entity = get_Member_entity(ptr);
+				return is_parameter_entity(entity) ? NULL : entity;
+			}
+			ptr = pred;
+			break;
+		}
+		case iro_Address: {
+			ir_entity *const entity = get_Address_entity(ptr);
+			return get_entity_owner(entity) == get_tls_type() ? NULL : entity;
+		}
+		default:
+			return NULL;
+		}
+	}
+}
+
+/**
+ * Partitions the accesses into the connected components of may-alias.
+ * Accesses into the same variable are united right away, so only accesses
+ * through other pointers need alias queries.
+ */
+static void compute_classes(memssa_t *const ms)
+{
+	size_t const n       = ARR_LEN(ms->accesses);
+	int   *const uf      = XMALLOCN(int, n);
+	size_t       queries = 0;
+	bool         give_up = get_irg_memory_disambiguator_options(ms->irg) & aa_opt_always_alias;
+	uf_init(uf, n);
+
+	ir_entity **const bases = XMALLOCN(ir_entity*, n);
+	pmap       *const first = pmap_create();
+	for (size_t i = 0; i < n; ++i) {
+		access_t const *const a = &ms->accesses[i];
+		bases[i] = get_base_entity(a->ptr);
+		if (i > 0 && (give_up || a->node == ms->accesses[i - 1].node))
+			uf_union(uf, uf_find(uf, i - 1), uf_find(uf, i));
+		if (bases[i] == NULL)
+			continue;
+		size_t const same = (size_t)pmap_get(void, first, bases[i]);
+		if (same != 0)
+			uf_union(uf, uf_find(uf, same - 1), uf_find(uf, i));
+		else
+			pmap_insert(first, bases[i], (void*)(i + 1));
+	}
+	pmap_destroy(first);
+
+	for (size_t i = 0; i < n && !give_up; ++i) {
+		if (bases[i] != NULL)
+			continue;
+		access_t const *const a = &ms->accesses[i];
+		for (size_t j = 0; j < n; ++j) {
+			int const ri = uf_find(uf, i);
+			int const rj = uf_find(uf, j);
+			if (ri == rj || (bases[j] == NULL && j < i))
+				continue;
+			if (++queries > MAX_ALIAS_QUERIES) {
+				DB((dbg, LEVEL_1, "%+F: too many accesses, using a single class\n", ms->irg));
+				give_up = true;
+				break;
+			}
+			access_t const *const b = &ms->accesses[j];
+			if (get_alias_relation(a->ptr, a->type, a->size, b->ptr, b->type, b->size) != ir_no_alias)
+				uf_union(uf, ri, rj);
+		}
+	}
+	if (give_up) {
+		for (size_t i = 1; i < n; ++i)
+			uf_union(uf, uf_find(uf, 0), uf_find(uf, i));
+	}
+	free(bases);
+
+	/* Number the classes densely. */
+	unsigned *const class_of_rep = XMALLOCN(unsigned, n);
+	for (size_t i = 0; i < n; ++i) {
+		if (uf_find(uf, i) == (int)i)
+			class_of_rep[i] = ms->n_classes++;
+	}
+	ms->class_members = OALLOCNZ(&ms->obst, unsigned*, ms->n_classes);
+	ms->read_only     = OALLOCNZ(&ms->obst, unsigned char, ms->n_classes);
+	for (unsigned c = 0; c < ms->n_classes; ++c)
+		ms->class_members[c] = NEW_ARR_F(unsigned, 0);
+	for (size_t i = 0; i < n; ++i) {
+		access_t *const a   = &ms->accesses[i];
+		unsigned  const cls = class_of_rep[uf_find(uf, i)];
+		a->cls = cls;
+		ARR_APP1(unsigned, ms->class_members[cls], (unsigned)i);
+		ir_nodemap_insert(&ms->classes, a->node, (void*)(size_t)(cls + 1));
+	}
+	free(class_of_rep);
+	free(uf);
+	DB((dbg, LEVEL_1, "%+F: %zu accesses in %u classes, %zu alias queries\n", ms->irg, n, ms->n_classes, queries));
+}
+
+memssa_t *memssa_new(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.memssa");
+
+	memssa_t *const ms = XMALLOCZ(memssa_t);
+	ms->irg      = irg;
+	ms->accesses = NEW_ARR_F(access_t, 0);
+	ms->calls    = NEW_ARR_F(ir_node*, 0);
+	ms->reaching = new_set(cmp_reaching, 64);
+	ir_nodemap_init(&ms->classes, irg);
+	ir_nodemap_init(&ms->defs, irg);
+	obstack_init(&ms->obst);
+
+	irg_walk_graph(irg, NULL, collect_accesses, ms);
+	compute_classes(ms);
+	return ms;
+}
+
+void memssa_free(memssa_t *const ms)
+{
+	for (unsigned c = 0; c < ms->n_classes; ++c)
+		DEL_ARR_F(ms->class_members[c]);
+	DEL_ARR_F(ms->accesses);
+	DEL_ARR_F(ms->calls);
+	del_set(ms->reaching);
+	ir_nodemap_destroy(&ms->classes);
+	ir_nodemap_destroy(&ms->defs);
+	obstack_free(&ms->obst, NULL);
+	free(ms);
+}
+
+unsigned memssa_get_n_classes(memssa_t const *const ms)
+{
+	return ms->n_classes;
+}
+
+int memssa_get_class(memssa_t const *const ms, ir_node const *const node)
+{
+	size_t const cls = (size_t)ir_nodemap_get(void, &ms->classes, node);
+	return (int)cls - 1;
+}
+
+static memssa_def *resolve(memssa_def *def)
+{
+	while (def->forward != NULL)
+		def = def->forward;
+	return def;
+}
+
+/** Returns the shared MEMSSA_DEF or MEMSSA_ENTRY definition of @p node. */
+static memssa_def *get_node_def(memssa_t *const ms, ir_node *const node, memssa_kind const kind)
+{
+	memssa_def *def = ir_nodemap_get(memssa_def, &ms->defs, node);
+	if (def == NULL) {
+		def = OALLOCZ(&ms->obst, memssa_def);
+		def->kind = kind;
+		def->node = node;
+		ir_nodemap_insert(&ms->defs, node, def);
+	}
+	return def;
+}
+
+/** Returns whether @p call may write memory of class @p cls. */
+static bool call_writes_class(memssa_t const *const ms, ir_node const *const call, unsigned const cls)
+{
+	unsigned const *const members = ms->class_members[cls];
+	for (size_t i = 0, n = ARR_LEN(members); i < n; ++i) {
+		access_t const *const a = &ms->accesses[members[i]];
+		if (get_call_modref(call, a->ptr, a->type, a->size) & ir_modref_mod)
+			return true;
+	}
+	return false;
+}
+
+/** Returns whether nothing in the graph writes memory of class @p cls. */
+static bool is_read_only(memssa_t *const ms, unsigned const cls)
+{
+	if (ms->read_only[cls] == 0) {
+		bool read_only = !ms->has_unknown_writers;
+		unsigned const *const members = ms->class_members[cls];
+		for (size_t i = 0, n = ARR_LEN(members); read_only && i < n; ++i) {
+			if (!is_Load(ms->accesses[members[i]].node))
+				read_only = false;
+		}
+		for (size_t i = 0, n = ARR_LEN(ms->calls); read_only && i < n; ++i) {
+			if (call_writes_class(ms, ms->calls[i], cls))
+				read_only = false;
+		}
+		ms->read_only[cls] = read_only ? 1 : 2;
+	}
+	return ms->read_only[cls] == 1;
+}
+
+static reaching_t *find_reaching(memssa_t *const ms, ir_node const *const mem, unsigned const cls)
+{
+	reaching_t const key = { mem, cls, NULL };
+	return set_find(reaching_t, ms->reaching, &key, sizeof(key), hash_reaching(&key));
+}
+
+static void set_reaching(memssa_t *const ms, ir_node const *const mem, unsigned const cls, memssa_def *const def)
+{
+	reaching_t const key   = { mem, cls, NULL };
+	reaching_t      *entry = set_insert(reaching_t, ms->reaching, &key, sizeof(key), hash_reaching(&key));
+	entry->def = def;
+}
+
+static memssa_def *get_reaching(memssa_t *ms, unsigned cls, ir_node *mem);
+
+/** Creates a virtual Phi or Sync, which is forwarded if it is trivial. */
+static memssa_def *merge(memssa_t *const ms, ir_node *const node, memssa_kind const kind, unsigned const cls)
+{
+	int         const arity = get_irn_arity(node);
+	memssa_def *const def   = OALLOCZ(&ms->obst, memssa_def);
+	def->kind    = kind;
+	def->node    = node;
+	def->n_preds = arity;
+	def->preds   = OALLOCN(&ms->obst, memssa_def*, arity);
+	set_reaching(ms, node, cls, def);
+
+	memssa_def *same    = NULL;
+	bool        trivial = true;
+	foreach_irn_in(node, i, pred) {
+		memssa_def *const pred_def = resolve(get_reaching(ms, cls, pred));
+		def->preds[i] = pred_def;
+		if (pred_def == def || pred_def == same)
+			continue;
+		if (same != NULL)
+			trivial = false;
+		same = pred_def;
+	}
+	if (trivial) {
+		def->forward = same != NULL ? same : get_node_def(ms, node, MEMSSA_ENTRY);
+		return def->forward;
+	}
+	DB((dbg, LEVEL_3, "class %u: virtual %s at %+F\n", cls, kind == MEMSSA_PHI ? "Phi" : "Sync", node));
+	return def;
+}
+
+static memssa_def *get_reaching(memssa_t *const ms, unsigned const cls, ir_node *mem)
+{
+	if (is_read_only(ms, cls))
+		return get_node_def(ms, get_irg_initial_mem(ms->irg), MEMSSA_ENTRY);
+
+	/* Memory values passed on the way get the same definition.  Caching all
+	 * of them for every class is too expensive, so only the start, merges and
+	 * values whose index is a multiple of MEMO_DISTANCE are cached. */
+	ir_node   **passed = NEW_ARR_F(ir_node*, 0);
+	memssa_def *def;
+	for (bool first = true;; first = false) {
+		bool const cached = first || is_Phi(mem) || is_Sync(mem)
+		                 || get_irn_idx(mem) % MEMO_DISTANCE == 0;
+		if (cached) {
+			reaching_t const *const entry = find_reaching(ms, mem, cls);
+			if (entry != NULL) {
+				def = resolve(entry->def);
+				break;
+			}
+			ARR_APP1(ir_node*, passed, mem);
+		}
+
+		if (is_Phi(mem)) {
+			def = merge(ms, mem, MEMSSA_PHI, cls);
+			break;
+		} else if (is_Sync(mem)) {
+			def = merge(ms, mem, MEMSSA_SYNC, cls);
+			break;
+		} else if (!is_Proj(mem)) {
+			/* NoMem, Unknown, Bad */
+			def = get_node_def(ms, mem, MEMSSA_ENTRY);
+			break;
+		}
+
+		ir_node *const pred = get_Proj_pred(mem);
+		switch (get_irn_opcode(pred)) {
+		case iro_Start:
+			def = get_node_def(ms, mem, MEMSSA_ENTRY);
+			goto done;
+		case iro_Store:
+		case iro_CopyB: {
+			/* Accesses created later have no class and write anything. */
+			int const pred_cls = memssa_get_class(ms, pred);
+			if (pred_cls >= 0 && pred_cls != (int)cls)
+				goto pass;
+			break;
+		}
+		case iro_Call:
+			if (!call_writes_class(ms, pred, cls))
+				goto pass;
+			break;
+		default:
+			if (is_transparent(pred))
+				goto pass;
+			break;
+		}
+		def = get_node_def(ms, pred, MEMSSA_DEF);
+		break;
+pass:
+		mem = get_memop_mem(pred);
+	}
+done:
+	for (size_t i = 0, n = ARR_LEN(passed); i < n; ++i)
+		set_reaching(ms, passed[i], cls, def);
+	DEL_ARR_F(passed);
+	return def;
+}
+
+memssa_def const *memssa_get_reaching_def(memssa_t *const ms, unsigned const cls, ir_node *const mem)
+{
+	assert(cls < ms->n_classes);
+	return get_reaching(ms, cls, mem);
+}
+
+memssa_def const *memssa_get_clobber(memssa_t *const ms, ir_node *const node)
+{
+	int const cls = memssa_get_class(ms, node);
+	if (cls < 0)
+		return NULL;
+	return get_reaching(ms, cls, get_memop_mem(node));
+}
+
+memssa_kind memssa_get_kind(memssa_def const *const def)
+{
+	return def->kind;
+}
+
+ir_node *memssa_get_node(memssa_def const *const def)
+{
+	return def->node;
+}
+
+unsigned memssa_get_n_preds(memssa_def const *const def)
+{
+	return def->n_preds;
+}
+
+memssa_def const *memssa_get_pred(memssa_def const *const def, unsigned const pos)
+{
+	assert(pos < def->n_preds);
+	memssa_def const *pred = def->preds[pos];
+	while (pred->forward != NULL)
+		pred = pred->forward;
+	return pred;
+}
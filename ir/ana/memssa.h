@@ -0,0 +1,86 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory SSA overlay partitioned by alias classes.
+ *
+ * The memory accesses of a graph (Loads, Stores and CopyBs) are partitioned
+ * into alias classes, such that accesses of different classes never alias
+ * according to get_alias_relation().  For each class the single memory chain
+ * of the graph is then viewed as a sparse SSA form of its own: definitions
+ * are the nodes which may write memory of the class, virtual Phis and Syncs
+ * are only created where different definitions meet.
+ *
+ * Everything is computed on demand and cached, so asking for the nearest
+ * clobbering definition of an access is cheap after the first query.
+ * Transformations which only add, move or remove nodes not writing memory
+ * (like Loads) keep the information valid.
+ */
+#ifndef FIRM_ANA_MEMSSA_H
+#define FIRM_ANA_MEMSSA_H
+
+#include "firm_types.h"
+
+/** Kinds of memory SSA definitions. */
+typedef enum memssa_kind {
+	MEMSSA_ENTRY, /**< memory on graph entry or of unknown origin */
+	MEMSSA_DEF,   /**< a node which may write memory of the class */
+	MEMSSA_PHI,   /**< virtual Phi at a memory Phi */
+	MEMSSA_SYNC,  /**< virtual Sync at a Sync */
+} memssa_kind;
+
+typedef struct memssa_def memssa_def;
+typedef struct memssa_t   memssa_t;
+
+/**
+ * Partitions the memory accesses of a graph into alias classes and creates
+ * an (initially empty) memory SSA overlay for it.
+ * The entity usage state should be computed, as for get_alias_relation().
+ */
+memssa_t *memssa_new(ir_graph *irg);
+
+/** Frees a memory SSA overlay. */
+void memssa_free(memssa_t *ms);
+
+/** Returns the number of alias classes. */
+unsigned memssa_get_n_classes(memssa_t const *ms);
+
+/**
+ * Returns the alias class of the Load, Store or CopyB @p node or -1 if the
+ * node did not exist when the overlay was created.
+ */
+int memssa_get_class(memssa_t const *ms, ir_node const *node);
+
+/**
+ * Returns the nearest definition of alias class @p cls reaching the memory
+ * value @p mem.
+ */
+memssa_def const *memssa_get_reaching_def(memssa_t *ms, unsigned cls,
+                                          ir_node *mem);
+
+/**
+ * Returns the nearest definition which may clobber the memory accessed by
+ * the Load, Store or CopyB @p node before it is executed, or NULL if the
+ * node has no alias class.
+ */
+memssa_def const *memssa_get_clobber(memssa_t *ms, ir_node *node);
+
+/** Returns the kind of a definition. */
+memssa_kind memssa_get_kind(memssa_def const *def);
+
+/**
+ * Returns the node of a definition: The writing node for MEMSSA_DEF, the Phi
+ * or Sync for virtual Phis and Syncs and the memory value for MEMSSA_ENTRY.
+ */
+ir_node *memssa_get_node(memssa_def const *def);
+
+/** Returns the number of predecessors of a virtual Phi or Sync. */
+unsigned memssa_get_n_preds(memssa_def const *def);
+
+/** Returns predecessor @p pos of a virtual Phi or Sync. */
+memssa_def const *memssa_get_pred(memssa_def const *def, unsigned pos);
+
+#endif
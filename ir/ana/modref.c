@@ -0,0 +1,511 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural mod/ref summaries for calls.
+ *
+ * For every graph a summary is computed describing which memory it may read
+ * (ref) or write (mod), including the effects of all functions it calls. The
+ * summaries are computed bottom-up over the strongly connected components of
+ * the call graph, all graphs of a component share one summary.
+ *
+ * Memory is divided into three parts:
+ *  - global entities whose address is never taken ("tracked" entities). They
+ *    can only be accessed by name, so the summary records them precisely.
+ *  - the frame of the function itself. It cannot be visible to a caller
+ *    except through pointers and is ignored.
+ *  - everything else (parameter reachable objects, escaped locals, heap),
+ *    summarized by a single flag.
+ *
+ * Calls into code without a graph may call back every function whose
+ * address escaped or which is visible externally, so they are summarized by
+ * the union of the summaries of those entry points.
+ */
+#include "array.h"
+#include "cgana.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "pmap.h"
+#include "raw_bitset.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** The memory effects of a function. */
+typedef struct modref_summary {
+	unsigned *ref;           /**< tracked entities possibly read */
+	unsigned *mod;           /**< tracked entities possibly written */
+	bool      ref_other : 1; /**< may read other memory */
+	bool      mod_other : 1; /**< may write other memory */
+	bool      calls_unknown : 1; /**< may call code without a summary */
+} modref_summary;
+
+/** Per graph data. */
+typedef struct modref_graph {
+	ir_graph       *irg;
+	modref_summary *summary;  /**< the (shared) summary of the SCC */
+	ir_node       **calls;    /**< all Call nodes of the graph */
+	ir_graph      **callees;  /**< all callee graphs (may contain duplicates) */
+	unsigned        dfs_num;  /**< Tarjan DFS number, 0 if not visited */
+	unsigned        low;      /**< Tarjan low link */
+	bool            on_stack;
+} modref_graph;
+
+typedef struct modref_env {
+	struct obstack  obst;
+	pmap           *index;    /**< tracked entity -> index + 1 */
+	size_t          n_tracked;
+	pmap           *graphs;   /**< ir_graph -> modref_graph */
+	modref_summary  unknown;  /**< effects of calls to unknown code */
+	modref_graph  **stack;    /**< Tarjan stack */
+	unsigned        next_dfs;
+} modref_env;
+
+/** The current summaries, NULL if not computed. */
+static modref_env *modref;
+
+/**
+ * Returns the index of a tracked entity or -1 if the entity can be accessed
+ * by other means than by its name.
+ */
+static long get_tracked_index(const ir_entity *entity)
+{
+	void *idx = pmap_get(void, modref->index, entity);
+	return idx != NULL ? (long)PTR_TO_INT(idx) - 1 : -1;
+}
+
+static modref_summary *new_summary(void)
+{
+	modref_summary *res = OALLOCZ(&modref->obst, modref_summary);
+	res->ref = rbitset_obstack_alloc(&modref->obst, modref->n_tracked);
+	res->mod = rbitset_obstack_alloc(&modref->obst, modref->n_tracked);
+	return res;
+}
+
+static void summary_or(modref_summary *dst, const modref_summary *src,
+                       bool with_mod)
+{
+	if (dst == src)
+		return;
+	rbitset_or(dst->ref, src->ref, modref->n_tracked);
+	dst->ref_other     |= src->ref_other;
+	dst->calls_unknown |= src->calls_unknown;
+	if (with_mod) {
+		rbitset_or(dst->mod, src->mod, modref->n_tracked);
+		dst->mod_other |= src->mod_other;
+	}
+}
+
+/**
+ * Returns the entity an address is based on, or NULL if it is not based on a
+ * single entity.
+ */
+static ir_entity *get_base_entity(const ir_node *addr, bool *is_frame)
+{
+	*is_frame = false;
+	for (;;) {
+		switch (get_irn_opcode(addr)) {
+		case iro_Address:
+			return get_Address_entity(addr);
+		case iro_Member: {
+			ir_node *ptr = get_Member_ptr(addr);
+			if (ptr == get_irg_frame(get_irn_irg(addr))) {
+				*is_frame = true;
+				return get_Member_entity(addr);
+			}
+			addr = ptr;
+			break;
+		}
+		case iro_Sel:
+			addr = get_Sel_ptr(addr);
+			break;
+		case iro_Id:
+			addr = get_Id_pred(addr);
+			break;
+		case iro_Add: {
+			ir_node *right = get_Add_right(addr);
+			addr = mode_is_reference(get_irn_mode(right)) ? right
+			                                              : get_Add_left(addr);
+			break;
+		}
+		case iro_Sub:
+			addr = get_Sub_left(addr);
+			break;
+		default:
+			return NULL;
+		}
+	}
+}
+
+/** Records a read or write of the memory at @p addr. */
+static void record_access(modref_summary *summary, const ir_node *addr,
+                          bool write)
+{
+	bool       is_frame;
+	ir_entity *entity = get_base_entity(addr, &is_frame);
+	if (entity != NULL && is_frame)
+		return;
+	long idx = entity != NULL ? get_tracked_index(entity) : -1;
+	if (idx < 0) {
+		if (write)
+			summary->mod_other = true;
+		else
+			summary->ref_other = true;
+	} else if (write) {
+		rbitset_set(summary->mod, idx);
+	} else {
+		rbitset_set(summary->ref, idx);
+	}
+}
+
+/** Returns the graph of a callee if its effects can be summarized. */
+static ir_graph *get_callee_graph(const ir_entity *callee)
+{
+	if (is_unknown_entity(callee))
+		return NULL;
+	return get_entity_linktime_irg(callee);
+}
+
+/**
+ * Calls @p func for all possible callees of @p call. The entity is NULL if
+ * unknown code may be called.
+ */
+static void foreach_callee(const ir_node *call,
+                           void (*func)(ir_entity *callee, void *data),
+                           void *data)
+{
+	ir_entity *callee = get_Call_callee(call);
+	if (callee != NULL) {
+		func(callee, data);
+	} else if (cg_call_has_callees(call)) {
+		for (size_t i = 0, n = cg_get_call_n_callees(call); i < n; ++i)
+			func(cg_get_call_callee(call, i), data);
+	} else {
+		func(NULL, data);
+	}
+}
+
+static void collect_callee(ir_entity *callee, void *data)
+{
+	modref_graph *graph = (modref_graph*)data;
+	ir_graph     *irg   = callee != NULL ? get_callee_graph(callee) : NULL;
+	if (irg != NULL)
+		ARR_APP1(ir_graph*, graph->callees, irg);
+}
+
+/** Collects the local effects of all nodes of a graph. */
+static void collect_effects(ir_node *node, void *data)
+{
+	modref_graph   *graph   = (modref_graph*)data;
+	modref_summary *summary = graph->summary;
+
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+		record_access(summary, get_Load_ptr(node), false);
+		return;
+	case iro_Store:
+		record_access(summary, get_Store_ptr(node), true);
+		return;
+	case iro_CopyB:
+		record_access(summary, get_CopyB_src(node), false);
+		record_access(summary, get_CopyB_dst(node), true);
+		return;
+	case iro_Call:
+		ARR_APP1(ir_node*, graph->calls, node);
+		foreach_callee(node, collect_callee, graph);
+		return;
+	case iro_Builtin:
+		if (is_irn_const_memory(node))
+			return;
+		/* FALLTHROUGH */
+	case iro_ASM:
+	case iro_Free:
+		summary->ref_other = true;
+		summary->mod_other = true;
+		return;
+	default:
+		return;
+	}
+}
+
+/**
+ * Returns the summary of a callee, the unknown summary for code without a
+ * graph.
+ */
+static modref_summary *get_callee_summary(const ir_entity *callee)
+{
+	if (callee == NULL)
+		return &modref->unknown;
+	ir_graph *irg = get_callee_graph(callee);
+	if (irg == NULL)
+		return &modref->unknown;
+	modref_graph *graph = pmap_get(modref_graph, modref->graphs, irg);
+	return graph != NULL ? graph->summary : &modref->unknown;
+}
+
+/** Returns the properties a call to @p callee is known to have. */
+static mtp_additional_properties get_callee_properties(const ir_node *call,
+                                                       const ir_entity *callee)
+{
+	mtp_additional_properties props
+		= get_method_additional_properties(get_Call_type(call));
+	if (callee != NULL)
+		props |= get_entity_additional_properties(callee);
+	return props;
+}
+
+typedef struct call_env {
+	const ir_node  *call;
+	modref_summary *summary;
+} call_env;
+
+static void add_callee_effects(ir_entity *callee, void *data)
+{
+	call_env                 *env   = (call_env*)data;
+	mtp_additional_properties props = get_callee_properties(env->call, callee);
+	if (props & mtp_property_pure)
+		return;
+	modref_summary *callee_summary = get_callee_summary(callee);
+	if (callee_summary == &modref->unknown) {
+		/* the unknown summary is not complete before all graphs are done */
+		env->summary->calls_unknown = true;
+		env->summary->ref_other     = true;
+		if (!(props & mtp_property_no_write))
+			env->summary->mod_other = true;
+		return;
+	}
+	summary_or(env->summary, callee_summary,
+	           !(props & mtp_property_no_write));
+}
+
+static modref_graph *get_modref_graph(ir_graph *irg)
+{
+	return pmap_get(modref_graph, modref->graphs, irg);
+}
+
+/**
+ * Tarjan's SCC algorithm on the call graph. Summaries are completed when
+ * the root of an SCC is finished, at which point all callees outside the SCC
+ * are done already.
+ */
+static void visit_graph(modref_graph *graph)
+{
+	graph->dfs_num  = graph->low = ++modref->next_dfs;
+	graph->on_stack = true;
+	ARR_APP1(modref_graph*, modref->stack, graph);
+
+	for (size_t i = 0, n = ARR_LEN(graph->callees); i < n; ++i) {
+		modref_graph *callee = get_modref_graph(graph->callees[i]);
+		if (callee == NULL)
+			continue;
+		if (callee->dfs_num == 0) {
+			visit_graph(callee);
+			graph->low = MIN(graph->low, callee->low);
+		} else if (callee->on_stack) {
+			graph->low = MIN(graph->low, callee->dfs_num);
+		}
+	}
+
+	if (graph->low != graph->dfs_num)
+		return;
+
+	/* pop the SCC and merge the local effects of its members */
+	modref_summary *summary = graph->summary;
+	size_t          len     = ARR_LEN(modref->stack);
+	size_t          first   = len;
+	do {
+		modref_graph *member = modref->stack[--first];
+		member->on_stack = false;
+		summary_or(summary, member->summary, true);
+		member->summary = summary;
+	} while (modref->stack[first] != graph);
+
+	for (size_t i = first; i < len; ++i) {
+		modref_graph *member = modref->stack[i];
+		call_env      env    = { .summary = summary };
+		for (size_t c = 0, n = ARR_LEN(member->calls); c < n; ++c) {
+			env.call = member->calls[c];
+			foreach_callee(env.call, add_callee_effects, &env);
+		}
+	}
+	ARR_SHRINKLEN(modref->stack, first);
+}
+
+/**
+ * Returns true if code without a graph may call the function of @p irg.
+ */
+static bool is_entry_graph(const ir_graph *irg)
+{
+	ir_entity *entity = get_irg_entity(irg);
+	return (get_entity_usage(entity) & ir_usage_address_taken)
+	    || entity_is_externally_visible(entity);
+}
+
+static void collect_tracked_entities(void)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *segment = get_segment_type(s);
+		for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
+			ir_entity *entity = get_compound_member(segment, i);
+			if (get_entity_kind(entity) != IR_ENTITY_NORMAL
+			    || (get_entity_usage(entity) & ir_usage_address_taken))
+				continue;
+			pmap_insert(modref->index, entity,
+			            INT_TO_PTR(++modref->n_tracked));
+		}
+	}
+}
+
+static void analyze_program(void)
+{
+	assure_irp_globals_entity_usage_computed();
+	collect_tracked_entities();
+
+	modref->unknown.ref = rbitset_obstack_alloc(&modref->obst,
+	                                            modref->n_tracked);
+	modref->unknown.mod = rbitset_obstack_alloc(&modref->obst,
+	                                            modref->n_tracked);
+	modref->unknown.ref_other     = true;
+	modref->unknown.mod_other     = true;
+	modref->unknown.calls_unknown = true;
+
+	foreach_irp_irg(i, irg) {
+		modref_graph *graph = OALLOCZ(&modref->obst, modref_graph);
+		graph->irg     = irg;
+		graph->summary = new_summary();
+		graph->calls   = NEW_ARR_F(ir_node*, 0);
+		graph->callees = NEW_ARR_F(ir_graph*, 0);
+		pmap_insert(modref->graphs, irg, graph);
+		irg_walk_graph(irg, NULL, collect_effects, graph);
+	}
+
+	modref->stack = NEW_ARR_F(modref_graph*, 0);
+	foreach_irp_irg(i, irg) {
+		modref_graph *graph = get_modref_graph(irg);
+		if (graph->dfs_num == 0)
+			visit_graph(graph);
+	}
+	DEL_ARR_F(modref->stack);
+
+	/* unknown code may call back into every entry point */
+	foreach_irp_irg(i, irg) {
+		if (is_entry_graph(irg))
+			summary_or(&modref->unknown, get_modref_graph(irg)->summary, true);
+	}
+	foreach_irp_irg(i, irg) {
+		modref_graph *graph = get_modref_graph(irg);
+		if (graph->summary->calls_unknown)
+			summary_or(graph->summary, &modref->unknown, true);
+		DEL_ARR_F(graph->calls);
+		DEL_ARR_F(graph->callees);
+		graph->calls   = NULL;
+		graph->callees = NULL;
+		DB((dbg, LEVEL_2, "%+F: ref %zu, mod %zu tracked entities%s%s\n", irg,
+		    rbitset_popcount(graph->summary->ref, modref->n_tracked),
+		    rbitset_popcount(graph->summary->mod, modref->n_tracked),
+		    graph->summary->ref_other ? ", reads other" : "",
+		    graph->summary->mod_other ? ", writes other" : ""));
+	}
+}
+
+void assure_irp_modref_computed(void)
+{
+	if (modref != NULL)
+		return;
+	FIRM_DBG_REGISTER(dbg, "firm.ana.modref");
+
+	modref = XMALLOCZ(modref_env);
+	obstack_init(&modref->obst);
+	modref->index  = pmap_create();
+	modref->graphs = pmap_create();
+
+	analyze_program();
+	DB((dbg, LEVEL_1, "mod/ref summaries: %zu tracked entities\n",
+	    modref->n_tracked));
+}
+
+void free_irp_modref(void)
+{
+	if (modref == NULL)
+		return;
+	pmap_destroy(modref->index);
+	pmap_destroy(modref->graphs);
+	obstack_free(&modref->obst, NULL);
+	free(modref);
+	modref = NULL;
+}
+
+typedef struct query_env {
+	const ir_node *call;
+	long           idx;    /**< index of the tracked entity or -1 */
+	ir_modref      result;
+} query_env;
+
+static void query_callee(ir_entity *callee, void *data)
+{
+	query_env                *env     = (query_env*)data;
+	mtp_additional_properties props   = get_callee_properties(env->call, callee);
+	const modref_summary     *summary = get_callee_summary(callee);
+	if (props & mtp_property_pure)
+		return;
+
+	ir_modref res;
+	if (env->idx < 0) {
+		res = (summary->ref_other ? ir_modref_ref : ir_modref_none)
+		    | (summary->mod_other ? ir_modref_mod : ir_modref_none);
+	} else {
+		res = (rbitset_is_set(summary->ref, env->idx) ? ir_modref_ref
+		                                              : ir_modref_none)
+		    | (rbitset_is_set(summary->mod, env->idx) ? ir_modref_mod
+		                                              : ir_modref_none);
+	}
+	if (props & mtp_property_no_write)
+		res &= ~ir_modref_mod;
+	env->result |= res;
+}
+
+ir_modref get_call_modref(const ir_node *call, const ir_node *addr,
+                          const ir_type *type, unsigned size)
+{
+	(void)type;
+	(void)size;
+	ir_graph *irg = get_irn_irg(call);
+	if (get_irg_memory_disambiguator_options(irg) & aa_opt_always_alias)
+		return ir_modref_modref;
+
+	mtp_additional_properties props
+		= get_method_additional_properties(get_Call_type(call));
+	if (props & mtp_property_pure)
+		return ir_modref_none;
+
+	/* a callee cannot reach locals whose address is never taken */
+	bool       is_frame;
+	ir_entity *entity = get_base_entity(addr, &is_frame);
+	if (entity != NULL && is_frame
+	    && irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE)
+	    && !(get_entity_usage(entity) & ir_usage_address_taken))
+		return ir_modref_none;
+
+	if (modref == NULL)
+		return ir_modref_modref;
+
+	query_env env = { .call = call, .idx = -1, .result = ir_modref_none };
+	if (entity != NULL && !is_frame) {
+		env.idx = get_tracked_index(entity);
+		/* entity created after the analysis */
+		if (env.idx < 0 && !(get_entity_usage(entity) & ir_usage_address_taken))
+			return ir_modref_modref;
+	}
+	foreach_callee(call, query_callee, &env);
+	return env.result;
+}
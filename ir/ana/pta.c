@@ -0,0 +1,966 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural points-to analysis.
+ *
+ * A unification based points-to analysis in the style of Steensgaard
+ * ("Points-to Analysis in Almost Linear Time", POPL 1996) over all graphs of
+ * the program.
+ *
+ * Abstract objects are created for entities, Alloc nodes and calls to
+ * malloc-like functions. Each value is described by the equivalence class of
+ * the objects it may point to. Values flowing through Phis, memory, calls and
+ * returns are unified, so the analysis needs a single pass over each graph.
+ *
+ * The analysis is field-sensitive: members of a compound object get their own
+ * sub-objects as long as the object is only accessed through Member nodes of
+ * a single owner type. Objects accessed through pointer arithmetic, by CopyB
+ * or as a whole are collapsed into a single location.
+ *
+ * Everything escaping to code invisible to the analysis is merged into one
+ * "unknown" object, which may alias everything else that escaped.
+ */
+#include "pta.h"
+
+#include "array.h"
+#include "cgana.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "obst.h"
+#include "pmap.h"
+#include "set.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+typedef struct pt_node  pt_node;
+typedef struct pt_field pt_field;
+
+/** A field sub-object of an abstract object. */
+struct pt_field {
+	ir_entity *entity; /**< the selected member */
+	pt_node   *node;   /**< the sub-object */
+	pt_field  *next;   /**< next field of the same object */
+};
+
+/** An equivalence class of abstract objects. */
+struct pt_node {
+	pt_node  *parent;        /**< union-find parent */
+	pt_node  *content;       /**< objects pointed to by the stored values */
+	pt_field *fields;        /**< field sub-objects */
+	ir_type  *owner;         /**< owner type of the selected members */
+	pt_node  *region;        /**< union-find parent of the enclosing region */
+	pt_node  *next;          /**< list of all nodes */
+	unsigned  rank;          /**< union-find rank */
+	bool      collapsed : 1; /**< fields are not distinguished */
+	bool      direct    : 1; /**< accessed without selecting a member */
+};
+
+/** Maps node or entity numbers to classes. */
+typedef struct pt_entry {
+	long     nr;
+	pt_node *node;
+} pt_entry;
+
+/** The parameter and result classes of a graph. */
+typedef struct pt_graph_info {
+	size_t    n_params;
+	size_t    n_results;
+	pt_node **params;
+	pt_node **results;
+} pt_graph_info;
+
+typedef struct pta_env {
+	struct obstack obst;
+	pt_node       *unknown;   /**< class of everything that escaped */
+	pt_node       *all_nodes; /**< list of all nodes */
+	set           *values;    /**< node_nr -> class of reference values */
+	set           *entities;  /**< entity nr -> class of the entity */
+	pmap          *graphs;    /**< ir_graph -> pt_graph_info */
+	pt_node      **worklist;  /**< pairs of nodes waiting to be unified */
+} pta_env;
+
+/** The current points-to information, NULL if not computed. */
+static pta_env *pta;
+
+/** Marks nodes that have been visited and do not carry a pointer. */
+static pt_node no_pointer;
+
+static int cmp_entry(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	const pt_entry *e1 = (const pt_entry*)elt;
+	const pt_entry *e2 = (const pt_entry*)key;
+	return e1->nr != e2->nr;
+}
+
+static pt_node *new_pt_node(void)
+{
+	pt_node *res = OALLOCZ(&pta->obst, pt_node);
+	res->parent    = res;
+	res->region    = res;
+	res->next      = pta->all_nodes;
+	pta->all_nodes = res;
+	return res;
+}
+
+static pt_node *find(pt_node *node)
+{
+	pt_node *root = node;
+	while (root->parent != root)
+		root = root->parent;
+
+	/* path compression */
+	while (node != root) {
+		pt_node *next = node->parent;
+		node->parent = root;
+		node         = next;
+	}
+	return root;
+}
+
+static void push_pair(pt_node *a, pt_node *b)
+{
+	ARR_APP1(pt_node*, pta->worklist, a);
+	ARR_APP1(pt_node*, pta->worklist, b);
+}
+
+static pt_field *find_field(const pt_node *node, const ir_entity *entity)
+{
+	for (pt_field *field = node->fields; field != NULL; field = field->next) {
+		if (field->entity == entity)
+			return field;
+	}
+	return NULL;
+}
+
+/**
+ * Stops distinguishing the fields of a representative: all sub-objects are
+ * scheduled for unification with the object itself.
+ */
+static void collapse_node(pt_node *node)
+{
+	assert(node->parent == node);
+	node->collapsed = true;
+	node->owner     = NULL;
+	for (pt_field *field = node->fields; field != NULL; field = field->next) {
+		push_pair(node, field->node);
+	}
+	node->fields = NULL;
+}
+
+/** Joins the classes of two nodes, further joins are put on the worklist. */
+static void join(pt_node *a, pt_node *b)
+{
+	a = find(a);
+	b = find(b);
+	if (a == b)
+		return;
+	if (a->rank < b->rank) {
+		pt_node *t = a;
+		a = b;
+		b = t;
+	} else if (a->rank == b->rank) {
+		++a->rank;
+	}
+	b->parent = a;
+
+	if (a->content == NULL) {
+		a->content = b->content;
+	} else if (b->content != NULL) {
+		push_pair(a->content, b->content);
+	}
+
+	bool collapse = a->collapsed || b->collapsed;
+	if (a->owner == NULL) {
+		a->owner = b->owner;
+	} else if (b->owner != NULL && a->owner != b->owner) {
+		collapse = true;
+	}
+	a->direct |= b->direct;
+
+	for (pt_field *field = b->fields, *next; field != NULL; field = next) {
+		next = field->next;
+		pt_field *match = find_field(a, field->entity);
+		if (match != NULL) {
+			push_pair(match->node, field->node);
+		} else {
+			field->next = a->fields;
+			a->fields   = field;
+		}
+	}
+	b->fields = NULL;
+
+	if (collapse || (a->direct && a->fields != NULL))
+		collapse_node(a);
+}
+
+static void process_worklist(void)
+{
+	while (ARR_LEN(pta->worklist) > 0) {
+		size_t   len = ARR_LEN(pta->worklist);
+		pt_node *a   = pta->worklist[len - 2];
+		pt_node *b   = pta->worklist[len - 1];
+		ARR_SHRINKLEN(pta->worklist, len - 2);
+		join(a, b);
+	}
+}
+
+/**
+ * Unifies two classes. NULL stands for "no pointer" and is neutral.
+ */
+static pt_node *unify(pt_node *a, pt_node *b)
+{
+	if (a == NULL)
+		return b != NULL ? find(b) : NULL;
+	if (b == NULL)
+		return find(a);
+	push_pair(a, b);
+	process_worklist();
+	return find(a);
+}
+
+/** Returns the class of the values stored in the objects of @p node. */
+static pt_node *get_content(pt_node *node)
+{
+	node = find(node);
+	if (node->content == NULL)
+		node->content = new_pt_node();
+	return find(node->content);
+}
+
+/** Records that the objects of @p node are accessed as a whole. */
+static void mark_direct(pt_node *node)
+{
+	node = find(node);
+	if (node->direct)
+		return;
+	node->direct = true;
+	if (node->fields != NULL) {
+		collapse_node(node);
+		process_worklist();
+	}
+}
+
+/** Returns the class of the member @p entity of the objects of @p node. */
+static pt_node *get_field(pt_node *node, ir_entity *entity)
+{
+	node = find(node);
+	if (node->collapsed)
+		return node;
+
+	/* members of unions overlap */
+	ir_type *owner = get_entity_owner(entity);
+	if (is_Union_type(owner)) {
+		mark_direct(node);
+		return find(node);
+	}
+	if (node->direct || (node->owner != NULL && node->owner != owner)) {
+		collapse_node(node);
+		process_worklist();
+		return find(node);
+	}
+	node->owner = owner;
+
+	pt_field *field = find_field(node, entity);
+	if (field == NULL) {
+		field         = OALLOC(&pta->obst, pt_field);
+		field->entity = entity;
+		field->node   = new_pt_node();
+		field->next   = node->fields;
+		node->fields  = field;
+	}
+	return find(field->node);
+}
+
+/** Returns whether code outside the analysis may access an entity. */
+static bool entity_escapes(const ir_entity *entity)
+{
+	if (get_entity_linkage(entity) & IR_LINKAGE_HIDDEN_USER)
+		return true;
+	return is_segment_type(get_entity_owner(entity))
+	    && entity_is_externally_visible(entity);
+}
+
+/** Returns the class of the object of an entity. */
+static pt_node *get_entity_node(ir_entity *entity)
+{
+	long      nr    = get_entity_nr(entity);
+	pt_entry  key   = { nr, NULL };
+	pt_entry *entry = set_insert(pt_entry, pta->entities, &key, sizeof(key),
+	                             (unsigned)nr);
+	if (entry->node == NULL) {
+		pt_node *node = new_pt_node();
+		entry->node = node;
+		if (entity_escapes(entity))
+			unify(node, pta->unknown);
+	}
+	return find(entry->node);
+}
+
+static pt_graph_info *get_graph_info(ir_graph *irg)
+{
+	pt_graph_info *info = pmap_get(pt_graph_info, pta->graphs, irg);
+	if (info != NULL)
+		return info;
+
+	ir_entity *entity = get_irg_entity(irg);
+	ir_type   *mtp    = get_entity_type(entity);
+	info            = OALLOC(&pta->obst, pt_graph_info);
+	info->n_params  = get_method_n_params(mtp);
+	info->n_results = get_method_n_ress(mtp);
+	info->params    = OALLOCN(&pta->obst, pt_node*, info->n_params);
+	info->results   = OALLOCN(&pta->obst, pt_node*, info->n_results);
+
+	/* callers outside of the analysis may pass and receive anything */
+	bool escapes = entity_is_externally_visible(entity)
+	            || (get_entity_usage(entity) & ir_usage_address_taken);
+	for (size_t i = 0; i < info->n_params; ++i) {
+		info->params[i] = escapes ? pta->unknown : new_pt_node();
+	}
+	for (size_t i = 0; i < info->n_results; ++i) {
+		info->results[i] = escapes ? pta->unknown : new_pt_node();
+	}
+	pmap_insert(pta->graphs, irg, info);
+	return info;
+}
+
+/** Returns whether values of mode @p mode may carry (parts of) pointers. */
+static bool may_carry_pointer(const ir_mode *mode)
+{
+	return mode_is_data(mode);
+}
+
+/**
+ * Returns the class of a value in the graph currently analyzed, creating a
+ * placeholder for values not visited yet.
+ */
+static pt_node *get_value(ir_node *node)
+{
+	if (!may_carry_pointer(get_irn_mode(node)))
+		return NULL;
+	pt_node *res = (pt_node*)get_irn_link(node);
+	if (res == &no_pointer)
+		return NULL;
+	if (res == NULL) {
+		/* a loop-carried value, will be unified when visited */
+		res = new_pt_node();
+		set_irn_link(node, res);
+	}
+	return find(res);
+}
+
+/** Returns the class of the pointers escaping to unknown code. */
+static pt_node *escape(pt_node *node)
+{
+	return unify(node, pta->unknown);
+}
+
+static pt_node *get_address_target(ir_node *ptr)
+{
+	pt_node *res = get_value(ptr);
+	return res != NULL ? res : find(pta->unknown);
+}
+
+static pt_node *load_from(ir_node *ptr)
+{
+	pt_node *target = get_address_target(ptr);
+	mark_direct(target);
+	return get_content(target);
+}
+
+static void store_to(ir_node *ptr, pt_node *value)
+{
+	pt_node *target = get_address_target(ptr);
+	mark_direct(target);
+	unify(get_content(target), value);
+}
+
+static void escape_arguments(ir_node *call)
+{
+	for (int i = 0, n = get_Call_n_params(call); i < n; ++i) {
+		escape(get_value(get_Call_param(call, i)));
+	}
+}
+
+static void pass_arguments(ir_node *call, ir_entity *callee)
+{
+	ir_graph *irg = callee != get_unknown_entity()
+	              ? get_entity_linktime_irg(callee) : NULL;
+	if (irg == NULL) {
+		/* malloc-like functions do not capture their arguments */
+		if (callee == get_unknown_entity()
+		    || !(get_entity_additional_properties(callee) & mtp_property_malloc))
+			escape_arguments(call);
+		return;
+	}
+
+	pt_graph_info *info = get_graph_info(irg);
+	for (int i = 0, n = get_Call_n_params(call); i < n; ++i) {
+		pt_node *arg = get_value(get_Call_param(call, i));
+		if ((size_t)i < info->n_params) {
+			unify(arg, info->params[i]);
+		} else {
+			escape(arg);
+		}
+	}
+}
+
+static pt_node *get_callee_result(ir_entity *callee, unsigned num)
+{
+	if (callee == get_unknown_entity())
+		return find(pta->unknown);
+	ir_graph *irg = get_entity_linktime_irg(callee);
+	if (irg == NULL) {
+		/* each call to a malloc-like function is an allocation site */
+		if (get_entity_additional_properties(callee) & mtp_property_malloc)
+			return new_pt_node();
+		return find(pta->unknown);
+	}
+	pt_graph_info *info = get_graph_info(irg);
+	if (num >= info->n_results)
+		return find(pta->unknown);
+	return find(info->results[num]);
+}
+
+static pt_node *get_call_result(ir_node *call, unsigned num)
+{
+	ir_entity *callee = get_Call_callee(call);
+	if (callee != NULL)
+		return get_callee_result(callee, num);
+	if (!cg_call_has_callees(call))
+		return find(pta->unknown);
+
+	pt_node *res = NULL;
+	for (size_t i = 0, n = cg_get_call_n_callees(call); i < n; ++i) {
+		res = unify(res, get_callee_result(cg_get_call_callee(call, i), num));
+	}
+	return res != NULL ? res : find(pta->unknown);
+}
+
+static void process_call(ir_node *call)
+{
+	ir_entity *callee = get_Call_callee(call);
+	if (callee != NULL) {
+		pass_arguments(call, callee);
+	} else if (cg_call_has_callees(call)) {
+		for (size_t i = 0, n = cg_get_call_n_callees(call); i < n; ++i) {
+			pass_arguments(call, cg_get_call_callee(call, i));
+		}
+	} else {
+		escape_arguments(call);
+	}
+}
+
+/** Returns whether a builtin just computes a value from its arguments. */
+static bool is_value_builtin(ir_builtin_kind kind)
+{
+	switch (kind) {
+	case ir_bk_ffs:
+	case ir_bk_clz:
+	case ir_bk_ctz:
+	case ir_bk_popcount:
+	case ir_bk_parity:
+	case ir_bk_bswap:
+	case ir_bk_saturating_increment:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/** Returns whether a builtin neither captures nor returns its arguments. */
+static bool is_harmless_builtin(ir_builtin_kind kind)
+{
+	switch (kind) {
+	case ir_bk_trap:
+	case ir_bk_debugbreak:
+	case ir_bk_prefetch:
+	case ir_bk_may_alias:
+		return true;
+	default:
+		return is_value_builtin(kind);
+	}
+}
+
+static pt_node *get_builtin_arguments(ir_node *builtin)
+{
+	pt_node *res = NULL;
+	for (int i = 0, n = get_Builtin_n_params(builtin); i < n; ++i) {
+		res = unify(res, get_value(get_Builtin_param(builtin, i)));
+	}
+	return res;
+}
+
+static pt_node *compute_proj(ir_node *proj)
+{
+	ir_node *pred = get_Proj_pred(proj);
+	unsigned num  = get_Proj_num(proj);
+	switch (get_irn_opcode(pred)) {
+	case iro_Proj: {
+		ir_node *tuple = get_Proj_pred(pred);
+		if (is_Start(tuple)) {
+			pt_graph_info *info = get_graph_info(get_irn_irg(proj));
+			if (num >= info->n_params)
+				return find(pta->unknown);
+			return find(info->params[num]);
+		} else if (is_Call(tuple)) {
+			return get_call_result(tuple, num);
+		}
+		return find(pta->unknown);
+	}
+
+	case iro_Load:
+		assert(num == pn_Load_res);
+		return load_from(get_Load_ptr(pred));
+
+	case iro_Alloc:
+		return new_pt_node();
+
+	case iro_Builtin: {
+		ir_builtin_kind kind = get_Builtin_kind(pred);
+		if (is_value_builtin(kind))
+			return get_builtin_arguments(pred);
+		return find(pta->unknown);
+	}
+
+	case iro_Start:
+	case iro_Div:
+	case iro_Mod:
+		return NULL;
+
+	default:
+		return find(pta->unknown);
+	}
+}
+
+/** Unifies the classes of all data operands of a node. */
+static pt_node *unify_operands(ir_node *node)
+{
+	pt_node *res = NULL;
+	foreach_irn_in(node, i, pred) {
+		res = unify(res, get_value(pred));
+	}
+	return res;
+}
+
+/** Computes the class of a data value in the graph currently analyzed. */
+static pt_node *compute_value(ir_node *node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Address:
+		return get_entity_node(get_Address_entity(node));
+
+	case iro_Member: {
+		ir_node   *ptr    = get_Member_ptr(node);
+		ir_entity *entity = get_Member_entity(node);
+		if (ptr == get_irg_frame(get_irn_irg(node)))
+			return get_entity_node(entity);
+		pt_node *target = get_value(ptr);
+		return target != NULL ? get_field(target, entity) : NULL;
+	}
+
+	case iro_Sel:
+		/* all array elements share one object */
+		return get_value(get_Sel_ptr(node));
+
+	case iro_Confirm:
+		return get_value(get_Confirm_value(node));
+
+	case iro_Id:
+		return get_value(get_Id_pred(node));
+
+	case iro_Proj:
+		return compute_proj(node);
+
+	case iro_Phi:
+	case iro_Mux:
+	case iro_Conv:
+	case iro_Bitcast:
+		return unify_operands(node);
+
+	case iro_Add:
+	case iro_Sub:
+	case iro_Mul:
+	case iro_Mulh:
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+	case iro_Shl:
+	case iro_Shr:
+	case iro_Shrs:
+	case iro_Minus:
+	case iro_Not: {
+		pt_node *res = unify_operands(node);
+		/* pointer arithmetic may reach any part of the object */
+		if (res != NULL && mode_is_reference(get_irn_mode(node))
+		    && !res->collapsed) {
+			collapse_node(res);
+			process_worklist();
+			res = find(res);
+		}
+		return res;
+	}
+
+	case iro_Const:
+	case iro_Size:
+	case iro_Align:
+	case iro_Offset:
+	case iro_Unknown:
+	case iro_Bad:
+	case iro_Dummy:
+		return NULL;
+
+	default:
+		return find(pta->unknown);
+	}
+}
+
+/** Handles nodes with effects on memory or other graphs. */
+static void process_effects(ir_node *node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Store:
+		store_to(get_Store_ptr(node), get_value(get_Store_value(node)));
+		return;
+
+	case iro_CopyB: {
+		pt_node *dst = get_address_target(get_CopyB_dst(node));
+		pt_node *src = get_address_target(get_CopyB_src(node));
+		if (!dst->collapsed) {
+			collapse_node(dst);
+			process_worklist();
+		}
+		src = find(src);
+		if (!src->collapsed) {
+			collapse_node(src);
+			process_worklist();
+		}
+		unify(get_content(dst), get_content(src));
+		return;
+	}
+
+	case iro_Call:
+		process_call(node);
+		return;
+
+	case iro_Return: {
+		pt_graph_info *info = get_graph_info(get_irn_irg(node));
+		for (int i = 0, n = get_Return_n_ress(node); i < n; ++i) {
+			pt_node *res = get_value(get_Return_res(node, i));
+			if ((size_t)i < info->n_results) {
+				unify(res, info->results[i]);
+			} else {
+				escape(res);
+			}
+		}
+		return;
+	}
+
+	case iro_Builtin:
+		if (!is_harmless_builtin(get_Builtin_kind(node)))
+			escape(get_builtin_arguments(node));
+		return;
+
+	case iro_ASM:
+		for (int i = 0, n = get_ASM_n_inputs(node); i < n; ++i) {
+			escape(get_value(get_ASM_input(node, i)));
+		}
+		return;
+
+	case iro_Raise:
+		escape(get_value(get_Raise_exo_ptr(node)));
+		return;
+
+	default:
+		return;
+	}
+}
+
+static void record_value(const ir_node *node, pt_node *value)
+{
+	long      nr  = get_irn_node_nr(node);
+	pt_entry  key = { nr, value };
+	(void)set_insert(pt_entry, pta->values, &key, sizeof(key), (unsigned)nr);
+}
+
+static void analyze_node(ir_node *node, void *env)
+{
+	(void)env;
+	ir_mode *mode = get_irn_mode(node);
+	if (!may_carry_pointer(mode)) {
+		process_effects(node);
+		return;
+	}
+
+	pt_node *value = compute_value(node);
+	pt_node *old   = (pt_node*)get_irn_link(node);
+	if (old != NULL)
+		value = unify(old, value);
+	set_irn_link(node, value != NULL ? value : &no_pointer);
+	if (value != NULL && mode_is_reference(mode))
+		record_value(node, value);
+}
+
+static void analyze_graph(ir_graph *irg)
+{
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, firm_clear_link, NULL, NULL);
+	irg_walk_graph(irg, NULL, analyze_node, NULL);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+}
+
+/** Computes the class of a value in an initializer. */
+static pt_node *get_const_value(ir_node *node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Address:
+		return get_entity_node(get_Address_entity(node));
+	case iro_Const:
+	case iro_Size:
+	case iro_Align:
+	case iro_Offset:
+	case iro_Unknown:
+		return NULL;
+	case iro_Add:
+	case iro_Sub:
+	case iro_Conv:
+	case iro_Bitcast: {
+		pt_node *res = NULL;
+		foreach_irn_in(node, i, pred) {
+			res = unify(res, get_const_value(pred));
+		}
+		return res;
+	}
+	default:
+		return find(pta->unknown);
+	}
+}
+
+static void analyze_initializer(pt_node *target, ir_type *type,
+                                ir_initializer_t const *initializer)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_CONST: {
+		ir_node *value = get_initializer_const_value(initializer);
+		pt_node *res   = get_const_value(value);
+		if (res != NULL) {
+			mark_direct(target);
+			unify(get_content(target), res);
+		}
+		return;
+	}
+	case IR_INITIALIZER_TARVAL:
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_COMPOUND: {
+		size_t n = get_initializer_compound_n_entries(initializer);
+		if (is_Array_type(type)) {
+			ir_type *element_type = get_array_element_type(type);
+			for (size_t i = 0; i < n; ++i) {
+				ir_initializer_t const *sub
+					= get_initializer_compound_value(initializer, i);
+				analyze_initializer(target, element_type, sub);
+			}
+		} else {
+			size_t n_members = get_compound_n_members(type);
+			for (size_t i = 0; i < n && i < n_members; ++i) {
+				ir_entity *member = get_compound_member(type, i);
+				ir_initializer_t const *sub
+					= get_initializer_compound_value(initializer, i);
+				pt_node *field = get_field(target, member);
+				analyze_initializer(field, get_entity_type(member), sub);
+			}
+		}
+		return;
+	}
+	}
+	panic("invalid initializer found");
+}
+
+static void analyze_initializers(ir_type *segment)
+{
+	for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
+		ir_entity *entity = get_compound_member(segment, i);
+		if (get_entity_kind(entity) != IR_ENTITY_NORMAL)
+			continue;
+		ir_initializer_t const *init = get_entity_initializer(entity);
+		if (init == NULL)
+			continue;
+		analyze_initializer(get_entity_node(entity), get_entity_type(entity),
+		                    init);
+	}
+}
+
+static pt_node *find_region(pt_node *node)
+{
+	pt_node *root = node;
+	while (root->region != root)
+		root = root->region;
+	while (node != root) {
+		pt_node *next = node->region;
+		node->region = root;
+		node         = next;
+	}
+	return root;
+}
+
+/**
+ * Merges every object with its field sub-objects into regions of memory that
+ * may overlap.
+ */
+static void compute_regions(void)
+{
+	for (pt_node *node = pta->all_nodes; node != NULL; node = node->next) {
+		if (node->parent != node)
+			continue;
+		for (pt_field *field = node->fields; field != NULL;
+		     field = field->next) {
+			pt_node *region       = find_region(node);
+			pt_node *field_region = find_region(find(field->node));
+			if (region != field_region)
+				field_region->region = region;
+		}
+	}
+}
+
+static void analyze_program(void)
+{
+	pta->unknown            = new_pt_node();
+	pta->unknown->collapsed = true;
+	pta->unknown->direct    = true;
+	pta->unknown->content   = pta->unknown;
+
+	assure_irp_globals_entity_usage_computed();
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		analyze_initializers(get_segment_type(s));
+	}
+
+	foreach_irp_irg(i, irg) {
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_TUPLES);
+		analyze_graph(irg);
+	}
+
+	compute_regions();
+}
+
+void assure_irp_points_to_computed(void)
+{
+	if (pta != NULL)
+		return;
+	FIRM_DBG_REGISTER(dbg, "firm.ana.pta");
+
+	pta = XMALLOCZ(pta_env);
+	obstack_init(&pta->obst);
+	pta->values   = new_set(cmp_entry, 1024);
+	pta->entities = new_set(cmp_entry, 256);
+	pta->graphs   = pmap_create();
+	pta->worklist = NEW_ARR_F(pt_node*, 0);
+
+	analyze_program();
+
+	pmap_destroy(pta->graphs);
+	pta->graphs = NULL;
+	DEL_ARR_F(pta->worklist);
+	pta->worklist = NULL;
+	DB((dbg, LEVEL_1, "points-to analysis: %zu pointer values\n",
+	    set_count(pta->values)));
+}
+
+void free_irp_points_to(void)
+{
+	if (pta == NULL)
+		return;
+	del_set(pta->values);
+	del_set(pta->entities);
+	obstack_free(&pta->obst, NULL);
+	free(pta);
+	pta = NULL;
+}
+
+static pt_node *lookup_entity(const ir_entity *entity)
+{
+	long      nr    = get_entity_nr(entity);
+	pt_entry  key   = { nr, NULL };
+	pt_entry *entry = set_find(pt_entry, pta->entities, &key, sizeof(key),
+	                           (unsigned)nr);
+	return entry != NULL ? entry->node : NULL;
+}
+
+/**
+ * Looks up the class of an address. Nodes created after the analysis are
+ * traced back to the object they are based on.
+ */
+static pt_node *lookup_address(const ir_node *addr)
+{
+	for (;;) {
+		long      nr    = get_irn_node_nr(addr);
+		pt_entry  key   = { nr, NULL };
+		pt_entry *entry = set_find(pt_entry, pta->values, &key, sizeof(key),
+		                           (unsigned)nr);
+		if (entry != NULL)
+			return entry->node;
+
+		switch (get_irn_opcode(addr)) {
+		case iro_Address:
+			return lookup_entity(get_Address_entity(addr));
+		case iro_Member: {
+			ir_node *ptr = get_Member_ptr(addr);
+			if (ptr == get_irg_frame(get_irn_irg(addr)))
+				return lookup_entity(get_Member_entity(addr));
+			addr = ptr;
+			break;
+		}
+		case iro_Sel:
+			addr = get_Sel_ptr(addr);
+			break;
+		case iro_Confirm:
+			addr = get_Confirm_value(addr);
+			break;
+		case iro_Add:
+		case iro_Sub: {
+			ir_node *left = get_binop_left(addr);
+			if (mode_is_reference(get_irn_mode(left))) {
+				addr = left;
+				break;
+			}
+			ir_node *right = get_binop_right(addr);
+			if (!mode_is_reference(get_irn_mode(right)))
+				return NULL;
+			addr = right;
+			break;
+		}
+		default:
+			return NULL;
+		}
+	}
+}
+
+ir_alias_relation pta_get_alias_relation(const ir_node *addr1,
+                                         const ir_node *addr2)
+{
+	if (pta == NULL)
+		return ir_may_alias;
+	pt_node *node1 = lookup_address(addr1);
+	pt_node *node2 = lookup_address(addr2);
+	if (node1 == NULL || node2 == NULL)
+		return ir_may_alias;
+
+	pt_node *region1 = find_region(find(node1));
+	pt_node *region2 = find_region(find(node2));
+	pt_node *unknown = find_region(find(pta->unknown));
+	if (region1 == region2 || region1 == unknown || region2 == unknown)
+		return ir_may_alias;
+	return ir_no_alias;
+}
@@ -0,0 +1,26 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief    Interprocedural points-to analysis -- private header.
+ */
+#ifndef FIRM_ANA_PTA_H
+#define FIRM_ANA_PTA_H
+
+#include "irmemory.h"
+
+/**
+ * Determines the alias relation of two addresses using the results of the
+ * points-to analysis.
+ *
+ * @return ir_no_alias if @p addr1 and @p addr2 provably point into disjoint
+ *         objects, ir_may_alias otherwise (in particular if no points-to
+ *         information has been computed).
+ */
+ir_alias_relation pta_get_alias_relation(const ir_node *addr1,
+                                         const ir_node *addr2);
+
+#endif
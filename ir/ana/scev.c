@@ -0,0 +1,825 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Scalar evolution analysis over the loop tree.
+ *
+ * The evolution of a node is computed on demand from the evolutions of its
+ * operands.  A Phi in a loop header becomes an add-recurrence, if all values
+ * entering the loop are equal and every backedge value is the Phi plus the
+ * same loop invariant step.  Affine expressions are kept in the mode of the
+ * value, so all arithmetic wraps around exactly like the represented nodes.
+ */
+#include "scev.h"
+
+#include "debug.h"
+#include "ircons.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "obst.h"
+#include "tv.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+struct scev_info_t {
+	ir_graph      *irg;
+	ir_nodemap     map;  /**< maps nodes to their evolution */
+	struct obstack obst;
+};
+
+static ir_mode *get_arith_mode(ir_mode *const mode)
+{
+	return mode_is_reference(mode) ? get_reference_offset_mode(mode) : mode;
+}
+
+static bool is_scev_mode(ir_mode *const mode)
+{
+	return mode_is_int(mode)
+	    || (mode_is_reference(mode) && get_reference_offset_mode(mode) != NULL);
+}
+
+/** Returns whether @p inner is @p loop or nested in it. */
+static bool loop_contains(ir_loop const *const loop, ir_loop const *inner)
+{
+	if (inner == NULL)
+		return false;
+	unsigned const depth = get_loop_depth(loop);
+	while (get_loop_depth(inner) > depth)
+		inner = get_loop_outer_loop(inner);
+	return inner == loop;
+}
+
+static ir_loop *get_node_loop(ir_node const *const node)
+{
+	return get_irn_loop(get_block_const(node));
+}
+
+/** Evaluates @p func, returns tarval_bad if the result overflows. */
+static ir_tarval *eval_no_wrap(ir_tarval *(*func)(ir_tarval const*, ir_tarval const*), ir_tarval const *const a, ir_tarval const *const b)
+{
+	int const old_wrap_on_overflow = tarval_get_wrap_on_overflow();
+	tarval_set_wrap_on_overflow(false);
+	ir_tarval *const res = func(a, b);
+	tarval_set_wrap_on_overflow(old_wrap_on_overflow);
+	return res;
+}
+
+static scev *new_scev(scev_info_t *const info, scev_kind const kind, ir_mode *const mode)
+{
+	scev *const s = OALLOCZ(&info->obst, scev);
+	s->kind = kind;
+	s->mode = mode;
+	return s;
+}
+
+static scev const *new_const(scev_info_t *const info, ir_mode *const mode, ir_tarval *const tv)
+{
+	scev *const s = new_scev(info, SCEV_AFFINE, mode);
+	s->offset = tv;
+	return s;
+}
+
+static scev const *new_symbol(scev_info_t *const info, ir_node *const node)
+{
+	ir_mode *const mode  = get_irn_mode(node);
+	ir_mode *const arith = get_arith_mode(mode);
+	scev    *const s     = new_scev(info, SCEV_AFFINE, mode);
+	s->offset         = get_mode_null(arith);
+	s->n_terms        = 1;
+	s->terms[0].node  = node;
+	s->terms[0].coeff = get_mode_one(arith);
+	return s;
+}
+
+static scev const *new_addrec(scev_info_t *const info, ir_mode *const mode, ir_loop *const loop, scev const *const start, scev const *const step)
+{
+	if (start == NULL || step == NULL)
+		return NULL;
+	if (scev_is_constant(step) && tarval_is_null(step->offset))
+		return start;
+	scev *const s = new_scev(info, SCEV_ADDREC, mode);
+	s->loop  = loop;
+	s->start = start;
+	s->step  = step;
+	return s;
+}
+
+bool scev_is_constant(scev const *const s)
+{
+	return s->kind == SCEV_AFFINE && s->n_terms == 0;
+}
+
+bool scev_is_invariant(scev const *const s, ir_loop const *const loop)
+{
+	if (s->kind == SCEV_ADDREC)
+		return !loop_contains(loop, s->loop);
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		if (loop_contains(loop, get_node_loop(s->terms[i].node)))
+			return false;
+	}
+	return true;
+}
+
+static bool scev_equal(scev const *const a, scev const *const b)
+{
+	if (a == b)
+		return true;
+	if (a->kind != b->kind || a->mode != b->mode)
+		return false;
+	if (a->kind == SCEV_ADDREC)
+		return a->loop == b->loop && scev_equal(a->start, b->start)
+		    && scev_equal(a->step, b->step);
+	if (a->offset != b->offset || a->n_terms != b->n_terms)
+		return false;
+	for (unsigned i = 0; i < a->n_terms; ++i) {
+		if (a->terms[i].node != b->terms[i].node
+		 || a->terms[i].coeff != b->terms[i].coeff)
+			return false;
+	}
+	return true;
+}
+
+/** Changes the mode of @p s to @p mode of the same size. */
+static scev const *scev_convert(scev_info_t *const info, scev const *const s, ir_mode *const mode)
+{
+	if (s == NULL || s->mode == mode)
+		return s;
+	ir_mode *const arith = get_arith_mode(mode);
+	if (get_mode_size_bits(arith) != get_mode_size_bits(get_arith_mode(s->mode)))
+		return NULL;
+
+	if (s->kind == SCEV_ADDREC)
+		return new_addrec(info, mode, s->loop, scev_convert(info, s->start, mode), scev_convert(info, s->step, arith));
+
+	scev *const res = new_scev(info, SCEV_AFFINE, mode);
+	res->offset  = tarval_convert_to(s->offset, arith);
+	res->n_terms = s->n_terms;
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		res->terms[i].node  = s->terms[i].node;
+		res->terms[i].coeff = tarval_convert_to(s->terms[i].coeff, arith);
+	}
+	return res;
+}
+
+/** Adds two affine expressions, the terms are kept sorted by node index. */
+static scev const *add_affine(scev_info_t *const info, ir_mode *const mode, scev const *const a, scev const *const b)
+{
+	scev *const res = new_scev(info, SCEV_AFFINE, mode);
+	res->offset = tarval_add(a->offset, b->offset);
+	unsigned i = 0;
+	unsigned j = 0;
+	unsigned n = 0;
+	while (i < a->n_terms || j < b->n_terms) {
+		scev_term term;
+		if (j == b->n_terms || (i < a->n_terms && get_irn_idx(a->terms[i].node) < get_irn_idx(b->terms[j].node))) {
+			term = a->terms[i++];
+		} else if (i == a->n_terms || get_irn_idx(b->terms[j].node) < get_irn_idx(a->terms[i].node)) {
+			term = b->terms[j++];
+		} else {
+			term.node  = a->terms[i].node;
+			term.coeff = tarval_add(a->terms[i++].coeff, b->terms[j++].coeff);
+			if (tarval_is_null(term.coeff))
+				continue;
+		}
+		if (n == SCEV_MAX_TERMS)
+			return NULL;
+		res->terms[n++] = term;
+	}
+	res->n_terms = n;
+	return res;
+}
+
+static scev const *scev_add(scev_info_t *const info, scev const *a, scev const *b)
+{
+	if (a == NULL || b == NULL)
+		return NULL;
+	if (get_arith_mode(a->mode) != get_arith_mode(b->mode))
+		return NULL;
+	ir_mode *const mode = mode_is_reference(b->mode) ? b->mode : a->mode;
+	if (a->kind == SCEV_AFFINE && b->kind == SCEV_AFFINE)
+		return add_affine(info, mode, a, b);
+
+	/* Let a be the recurrence of the innermost loop. */
+	if (a->kind == SCEV_AFFINE || (b->kind == SCEV_ADDREC && get_loop_depth(b->loop) > get_loop_depth(a->loop))) {
+		scev const *const t = a;
+		a = b;
+		b = t;
+	}
+	if (b->kind == SCEV_ADDREC && b->loop == a->loop)
+		return new_addrec(info, mode, a->loop, scev_add(info, a->start, b->start), scev_add(info, a->step, b->step));
+	if (!scev_is_invariant(b, a->loop))
+		return NULL;
+	return new_addrec(info, mode, a->loop, scev_add(info, a->start, b), a->step);
+}
+
+/** Multiplies @p s by the constant @p factor. */
+static scev const *scev_scale(scev_info_t *const info, scev const *const s, ir_tarval *const factor)
+{
+	if (s == NULL)
+		return NULL;
+	ir_mode *const arith = get_arith_mode(s->mode);
+	if (s->kind == SCEV_ADDREC)
+		return new_addrec(info, arith, s->loop, scev_scale(info, s->start, factor), scev_scale(info, s->step, factor));
+
+	scev *const res = new_scev(info, SCEV_AFFINE, arith);
+	res->offset = tarval_mul(s->offset, factor);
+	unsigned n = 0;
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		ir_tarval *const coeff = tarval_mul(s->terms[i].coeff, factor);
+		if (tarval_is_null(coeff))
+			continue;
+		res->terms[n].node  = s->terms[i].node;
+		res->terms[n].coeff = coeff;
+		++n;
+	}
+	res->n_terms = n;
+	return res;
+}
+
+static scev const *scev_negate(scev_info_t *const info, scev const *const s)
+{
+	if (s == NULL)
+		return NULL;
+	return scev_scale(info, s, get_mode_all_one(get_arith_mode(s->mode)));
+}
+
+/**
+ * Returns the evolution of operand @p op of a node with mode @p mode.
+ * Integer operands are converted to the arithmetic mode of the node.
+ */
+static scev const *get_operand(scev_info_t *const info, ir_node *const op, ir_mode *const mode)
+{
+	if (!is_scev_mode(get_irn_mode(op)))
+		return NULL;
+	scev const *const s = scev_get(info, op);
+	if (mode_is_reference(s->mode) && mode_is_reference(mode))
+		return s->mode == mode ? s : NULL;
+	return scev_convert(info, s, get_arith_mode(mode));
+}
+
+/** Returns the evolution of @p node if it is defined outside of @p loop. */
+static scev const *get_invariant(scev_info_t *const info, ir_node *const node, ir_loop const *const loop, ir_mode *const mode)
+{
+	if (loop_contains(loop, get_node_loop(node)))
+		return NULL;
+	return get_operand(info, node, mode);
+}
+
+/**
+ * Returns the difference d between @p node and @p phi, if node computes
+ * phi + d with d invariant in @p loop.
+ */
+static scev const *get_delta(scev_info_t *const info, ir_node *const node, ir_node *const phi, ir_loop const *const loop)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	if (node == phi)
+		return new_const(info, get_arith_mode(mode), get_mode_null(get_arith_mode(mode)));
+
+	switch (get_irn_opcode(node)) {
+	case iro_Add: {
+		ir_node     *const left  = get_Add_left(node);
+		ir_node     *const right = get_Add_right(node);
+		scev const  *const dl    = get_delta(info, left, phi, loop);
+		if (dl != NULL)
+			return scev_add(info, dl, get_invariant(info, right, loop, get_arith_mode(mode)));
+		scev const  *const dr    = get_delta(info, right, phi, loop);
+		if (dr != NULL)
+			return scev_add(info, get_invariant(info, left, loop, get_arith_mode(mode)), dr);
+		return NULL;
+	}
+
+	case iro_Sub: {
+		scev const *const dl = get_delta(info, get_Sub_left(node), phi, loop);
+		if (dl == NULL)
+			return NULL;
+		scev const *const r = get_invariant(info, get_Sub_right(node), loop, get_arith_mode(mode));
+		return scev_add(info, dl, scev_negate(info, r));
+	}
+
+	case iro_Confirm:
+		return get_delta(info, get_Confirm_value(node), phi, loop);
+
+	default:
+		return NULL;
+	}
+}
+
+/** Computes the evolution of a Phi, which is a recurrence in loop headers. */
+static scev const *analyze_phi(scev_info_t *const info, ir_node *const phi)
+{
+	ir_node *const block = get_nodes_block(phi);
+	if (!has_backedges(block))
+		return NULL;
+
+	ir_loop    *const loop  = get_irn_loop(block);
+	ir_mode    *const mode  = get_irn_mode(phi);
+	scev const       *start = NULL;
+	scev const       *step  = NULL;
+	foreach_irn_in(phi, i, pred) {
+		if (is_backedge(block, i)) {
+			ir_node *const pred_block = get_Block_cfgpred_block(block, i);
+			if (pred_block == NULL || !loop_contains(loop, get_irn_loop(pred_block)))
+				return NULL;
+			scev const *const delta = get_delta(info, pred, phi, loop);
+			if (delta == NULL || (step != NULL && !scev_equal(step, delta)))
+				return NULL;
+			step = delta;
+		} else {
+			scev const *const s = get_operand(info, pred, mode);
+			if (s == NULL || !scev_is_invariant(s, loop) || (start != NULL && !scev_equal(start, s)))
+				return NULL;
+			start = s;
+		}
+	}
+	if (start == NULL || step == NULL)
+		return NULL;
+	DB((dbg, LEVEL_2, "%+F is a recurrence of loop %ld\n", phi, get_loop_loop_nr(loop)));
+	return new_addrec(info, mode, loop, start, step);
+}
+
+static scev const *extend_addrec(scev_info_t *info, scev const *s, ir_mode *mode);
+
+static scev const *analyze(scev_info_t *const info, ir_node *const node)
+{
+	ir_mode *const mode  = get_irn_mode(node);
+	ir_mode *const arith = get_arith_mode(mode);
+	switch (get_irn_opcode(node)) {
+	case iro_Const:
+		if (!mode_is_int(mode))
+			return NULL;
+		return new_const(info, mode, get_Const_tarval(node));
+
+	case iro_Add:
+		return scev_add(info, get_operand(info, get_Add_left(node), mode), get_operand(info, get_Add_right(node), mode));
+
+	case iro_Sub: {
+		scev const *const l = get_operand(info, get_Sub_left(node), mode);
+		scev const *const r = get_operand(info, get_Sub_right(node), mode);
+		return scev_add(info, l, scev_negate(info, r));
+	}
+
+	case iro_Minus:
+		return scev_negate(info, get_operand(info, get_Minus_op(node), mode));
+
+	case iro_Mul: {
+		scev const *const l = get_operand(info, get_Mul_left(node), mode);
+		scev const *const r = get_operand(info, get_Mul_right(node), mode);
+		if (l == NULL || r == NULL)
+			return NULL;
+		if (scev_is_constant(r))
+			return scev_scale(info, l, r->offset);
+		if (scev_is_constant(l))
+			return scev_scale(info, r, l->offset);
+		return NULL;
+	}
+
+	case iro_Shl: {
+		ir_node *const right = get_Shl_right(node);
+		if (!is_Const(right))
+			return NULL;
+		long const amount = get_Const_long(right);
+		if (amount < 0 || (unsigned long)amount >= get_mode_size_bits(mode))
+			return NULL;
+		ir_tarval *const factor = tarval_shl_unsigned(get_mode_one(arith), amount);
+		return scev_scale(info, get_operand(info, get_Shl_left(node), mode), factor);
+	}
+
+	case iro_Conv: {
+		ir_node *const op      = get_Conv_op(node);
+		ir_mode *const op_mode = get_irn_mode(op);
+		if (!is_scev_mode(op_mode))
+			return NULL;
+		scev const *const s = scev_get(info, op);
+		if (get_mode_size_bits(arith) > get_mode_size_bits(get_arith_mode(op_mode)))
+			return extend_addrec(info, s, mode);
+		return scev_convert(info, s, mode);
+	}
+
+	case iro_Confirm:
+		return scev_get(info, get_Confirm_value(node));
+
+	case iro_Phi:
+		return analyze_phi(info, node);
+
+	default:
+		return NULL;
+	}
+}
+
+scev const *scev_get(scev_info_t *const info, ir_node *const node)
+{
+	scev const *res = ir_nodemap_get(scev const, &info->map, node);
+	if (res != NULL)
+		return res;
+
+	/* Describe the node by itself while it is analysed, this breaks cycles in
+	 * irreducible control flow. */
+	scev const *const symbol = new_symbol(info, node);
+	ir_nodemap_insert(&info->map, node, (void*)symbol);
+
+	res = scev_convert(info, analyze(info, node), get_irn_mode(node));
+	if (res == NULL) {
+		res = symbol;
+	} else {
+		ir_nodemap_insert(&info->map, node, (void*)res);
+	}
+	return res;
+}
+
+typedef struct exit_env_t {
+	ir_loop *loop;
+	ir_node *exit;    /**< the control flow node leaving the loop */
+	unsigned n_exits;
+} exit_env_t;
+
+static void find_exits(ir_node *const block, void *const data)
+{
+	exit_env_t *const env = (exit_env_t*)data;
+	if (loop_contains(env->loop, get_irn_loop(block)))
+		return;
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node *const pred_block = get_Block_cfgpred_block(block, i);
+		if (pred_block != NULL && loop_contains(env->loop, get_irn_loop(pred_block))) {
+			env->exit = get_Block_cfgpred(block, i);
+			++env->n_exits;
+		}
+	}
+}
+
+/**
+ * Finds the header of @p loop and its block with backedges, if there is a
+ * single one.
+ */
+static ir_node *find_header(ir_loop const *const loop, ir_node **const latch)
+{
+	*latch = NULL;
+	for (size_t e = 0, n = get_loop_n_elements(loop); e < n; ++e) {
+		loop_element const element = get_loop_element(loop, e);
+		if (*element.kind != k_ir_node || !is_Block(element.node) || !has_backedges(element.node))
+			continue;
+		ir_node *const header = element.node;
+		for (int i = 0, n_preds = get_Block_n_cfgpreds(header); i < n_preds; ++i) {
+			if (!is_backedge(header, i))
+				continue;
+			ir_node *const pred_block = get_Block_cfgpred_block(header, i);
+			*latch = *latch == NULL ? pred_block : header;
+		}
+		if (*latch == header)
+			*latch = NULL;
+		return header;
+	}
+	return NULL;
+}
+
+/**
+ * Computes how often the loop continues, if it stays in the loop as long as
+ * start + k * step @p relation end holds for iteration k.
+ */
+static scev const *compute_count(scev_info_t *const info, scev const *const start, ir_tarval *const step, scev const *const end, ir_relation const relation, bool *const may_be_zero)
+{
+	ir_mode   *const mode   = end->mode;
+	ir_mode   *const smode  = mode_is_signed(mode) ? mode : find_signed_mode(mode);
+	ir_tarval *const one    = get_mode_one(mode);
+	bool       const down   = tarval_is_negative(tarval_convert_to(step, smode));
+	bool       const is_const = scev_is_constant(start) && scev_is_constant(end);
+
+	*may_be_zero = false;
+	if (relation == ir_relation_less_greater) {
+		/* The difference counts the iterations modulo the mode size. */
+		if (step == one)
+			return scev_add(info, end, scev_negate(info, start));
+		if (tarval_is_all_one(step))
+			return scev_add(info, start, scev_negate(info, end));
+		if (!is_const)
+			return NULL;
+		ir_tarval *const diff  = tarval_convert_to(tarval_sub(end->offset, start->offset), smode);
+		ir_tarval *const sstep = tarval_convert_to(step, smode);
+		if (!tarval_is_null(tarval_mod(diff, sstep)))
+			return NULL;
+		ir_tarval *const count = tarval_div(diff, sstep);
+		if (tarval_is_negative(count))
+			return NULL;
+		return new_const(info, mode, tarval_convert_to(count, mode));
+	}
+
+	bool       strict;
+	ir_tarval *dist_step;
+	if (!down && (relation == ir_relation_less || relation == ir_relation_less_equal)) {
+		strict    = relation == ir_relation_less;
+		dist_step = step;
+	} else if (down && (relation == ir_relation_greater || relation == ir_relation_greater_equal)) {
+		strict    = relation == ir_relation_greater;
+		dist_step = tarval_neg(step);
+		if (mode_is_signed(mode) && tarval_is_negative(dist_step))
+			return NULL;
+	} else {
+		return NULL;
+	}
+
+	if (!is_const) {
+		/* Without overflow only a unit step reaches the end exactly. */
+		if (!strict || dist_step != one)
+			return NULL;
+		*may_be_zero = true;
+		return down ? scev_add(info, start, scev_negate(info, end))
+		            : scev_add(info, end, scev_negate(info, start));
+	}
+
+	ir_tarval *const s = start->offset;
+	ir_tarval *const e = end->offset;
+	if (!(tarval_cmp(s, e) & relation))
+		return new_const(info, mode, get_mode_null(mode));
+
+	ir_tarval *const dist = down ? eval_no_wrap(tarval_sub, s, e) : eval_no_wrap(tarval_sub, e, s);
+	if (dist == tarval_bad)
+		return NULL;
+	ir_tarval       *count = tarval_div(dist, dist_step);
+	if (!strict || !tarval_is_null(tarval_mod(dist, dist_step)))
+		count = eval_no_wrap(tarval_add, count, one);
+	if (count == tarval_bad)
+		return NULL;
+
+	/* The value leaving the loop must not wrap around, otherwise the loop
+	 * would continue. */
+	ir_tarval *const last_dist = eval_no_wrap(tarval_mul, count, dist_step);
+	if (last_dist == tarval_bad)
+		return NULL;
+	ir_tarval *const last = down ? eval_no_wrap(tarval_sub, s, last_dist) : eval_no_wrap(tarval_add, s, last_dist);
+	if (last == tarval_bad)
+		return NULL;
+	return new_const(info, mode, count);
+}
+
+/**
+ * Finds the exit test of @p loop: The loop is left as soon as the
+ * add-recurrence @p l with constant step does not stand in @p relation to the
+ * loop invariant @p r anymore.  The test is evaluated in @p exiting_block.
+ */
+static bool find_exit_test(scev_info_t *const info, ir_loop *const loop, scev const **const l, scev const **const r, ir_relation *const relation, ir_node **const exiting_block)
+{
+	exit_env_t env = { loop, NULL, 0 };
+	irg_block_walk_graph(info->irg, find_exits, NULL, &env);
+	if (env.n_exits != 1 || !is_Proj(env.exit))
+		return false;
+
+	ir_node *latch;
+	ir_node *const header = find_header(loop, &latch);
+	ir_node *const cond   = get_Proj_pred(env.exit);
+	if (header == NULL || !is_Cond(cond))
+		return false;
+	/* The exit test must be executed exactly once per iteration. */
+	ir_node *const exiting = get_nodes_block(cond);
+	if (exiting != header && exiting != latch)
+		return false;
+	ir_node *const cmp = get_Cond_selector(cond);
+	if (!is_Cmp(cmp))
+		return false;
+	ir_node *const left = get_Cmp_left(cmp);
+	if (!mode_is_int(get_irn_mode(left)))
+		return false;
+
+	ir_relation rel = get_Cmp_relation(cmp);
+	if (get_Proj_num(env.exit) == pn_Cond_true)
+		rel = get_negated_relation(rel);
+	scev const *sl = scev_get(info, left);
+	scev const *sr = scev_get(info, get_Cmp_right(cmp));
+	if (sl->kind != SCEV_ADDREC || sl->loop != loop) {
+		scev const *const t = sl;
+		sl  = sr;
+		sr  = t;
+		rel = get_inversed_relation(rel);
+	}
+	if (sl->kind != SCEV_ADDREC || sl->loop != loop || !scev_is_constant(sl->step)
+	 || !scev_is_invariant(sr, loop))
+		return false;
+
+	*l             = sl;
+	*r             = sr;
+	*relation      = rel & ~ir_relation_unordered;
+	*exiting_block = exiting;
+	return true;
+}
+
+/**
+ * Converts the add-recurrence @p s with constant start and unit step to the
+ * wider @p mode.  Its value must not wrap around while the loop iterates:
+ * This holds if the loop is left as soon as a recurrence with the same step
+ * passes an invariant bound, or a constant bound which is not the extreme
+ * value of the mode, and @p s never exceeds that recurrence, i.e. starts
+ * at the same value or a constant not past its constant start.
+ */
+static scev const *extend_addrec(scev_info_t *const info, scev const *const s, ir_mode *const mode)
+{
+	if (s->kind != SCEV_ADDREC || !scev_is_constant(s->start) || !scev_is_constant(s->step))
+		return NULL;
+	ir_tarval *const step = s->step->offset;
+	bool       const up   = tarval_is_one(step);
+	if (!up && !tarval_is_all_one(step))
+		return NULL;
+
+	scev const  *l;
+	scev const  *r;
+	ir_relation  relation;
+	ir_node     *exiting;
+	if (!find_exit_test(info, s->loop, &l, &r, &relation, &exiting) || l->mode != s->mode
+	 || l->step->offset != step)
+		return NULL;
+	if (relation != (up ? ir_relation_less : ir_relation_greater)) {
+		/* An inclusive constant bound other than the extreme value is
+		 * passed, too. */
+		if (relation != (up ? ir_relation_less_equal : ir_relation_greater_equal)
+		 || !scev_is_constant(r))
+			return NULL;
+		ir_tarval *const bound   = tarval_convert_to(r->offset, s->mode);
+		ir_tarval *const extreme = up ? get_mode_max(s->mode) : get_mode_min(s->mode);
+		if (bound == tarval_bad || bound == extreme)
+			return NULL;
+	}
+	/* Compare the starts like the exit test compares the values, the sign
+	 * of their wrapped difference says nothing about their order. */
+	scev const *const diff = scev_add(info, s->start, scev_negate(info, l->start));
+	if (diff == NULL || !scev_is_constant(diff))
+		return NULL;
+	if (!tarval_is_null(diff->offset)) {
+		if (!scev_is_constant(l->start))
+			return NULL;
+		ir_relation const order = tarval_cmp(s->start->offset, l->start->offset);
+		if (!(order & (up ? ir_relation_less : ir_relation_greater)))
+			return NULL;
+	}
+
+	ir_mode   *const arith = get_arith_mode(mode);
+	ir_tarval *const start = tarval_convert_to(s->start->offset, arith);
+	ir_tarval *const wstep = up ? get_mode_one(arith) : get_mode_all_one(arith);
+	return new_addrec(info, mode, s->loop, new_const(info, mode, start), new_const(info, arith, wstep));
+}
+
+scev const *scev_get_backedge_count(scev_info_t *const info, ir_loop *const loop, bool *const may_be_zero)
+{
+	scev const  *l;
+	scev const  *r;
+	ir_relation  relation;
+	ir_node     *exiting;
+	if (!find_exit_test(info, loop, &l, &r, &relation, &exiting))
+		return NULL;
+
+	scev const *const count = compute_count(info, l->start, l->step->offset, r, relation, may_be_zero);
+	DB((dbg, LEVEL_2, "loop %ld: backedge count %s%s\n", get_loop_loop_nr(loop),
+	    count == NULL ? "unknown" : scev_is_constant(count) ? "constant" : "symbolic",
+	    *may_be_zero ? " (may be zero)" : ""));
+	return count;
+}
+
+ir_node *scev_get_exit_block(scev_info_t *const info, ir_loop *const loop)
+{
+	scev const  *l;
+	scev const  *r;
+	ir_relation  relation;
+	ir_node     *exiting;
+	if (!find_exit_test(info, loop, &l, &r, &relation, &exiting))
+		return NULL;
+	return exiting;
+}
+
+scev const *scev_get_exit_value(scev_info_t *const info, ir_node *const node, ir_loop *const loop)
+{
+	scev const *const s = scev_get(info, node);
+	if (scev_is_invariant(s, loop))
+		return s;
+	if (s->kind != SCEV_ADDREC || s->loop != loop)
+		return NULL;
+
+	bool              may_be_zero;
+	scev const *const count = scev_get_backedge_count(info, loop, &may_be_zero);
+	if (count == NULL || may_be_zero)
+		return NULL;
+
+	ir_mode *const arith = get_arith_mode(s->mode);
+	if (scev_is_constant(count)) {
+		ir_tarval *const n = tarval_convert_to(count->offset, arith);
+		return scev_add(info, s->start, scev_scale(info, s->step, n));
+	}
+	if (scev_is_constant(s->step))
+		return scev_add(info, s->start, scev_scale(info, scev_convert(info, count, arith), s->step->offset));
+	return NULL;
+}
+
+bool scev_get_distance(scev const *const a, scev const *const b,
+                       long *const dist)
+{
+	if (a->kind != SCEV_AFFINE || b->kind != SCEV_AFFINE
+	 || a->n_terms != b->n_terms)
+		return false;
+	for (unsigned i = 0; i < a->n_terms; ++i) {
+		bool found = false;
+		for (unsigned j = 0; j < b->n_terms && !found; ++j) {
+			found = a->terms[i].node == b->terms[j].node
+			     && a->terms[i].coeff == b->terms[j].coeff;
+		}
+		if (!found)
+			return false;
+	}
+	ir_tarval *const diff  = tarval_sub(b->offset, a->offset);
+	ir_mode   *const mode  = get_tarval_mode(diff);
+	ir_mode   *const smode = mode_is_signed(mode) ? mode : find_signed_mode(mode);
+	ir_tarval *const sdiff = tarval_convert_to(diff, smode);
+	if (!tarval_is_long(sdiff))
+		return false;
+	*dist = get_tarval_long(sdiff);
+	return true;
+}
+
+bool scev_is_buildable(scev const *const s)
+{
+	if (s->kind != SCEV_AFFINE)
+		return false;
+
+	ir_mode *const mode   = s->mode;
+	ir_mode *const arith  = get_arith_mode(mode);
+	bool           base   = false;
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		scev_term const *const term  = &s->terms[i];
+		ir_mode         *const nmode = get_irn_mode(term->node);
+		if (mode_is_reference(nmode)) {
+			if (!mode_is_reference(mode) || base || !tarval_is_one(term->coeff))
+				return false;
+			base = true;
+		} else if (get_mode_size_bits(nmode) != get_mode_size_bits(arith)) {
+			return false;
+		}
+	}
+	return base || !mode_is_reference(mode);
+}
+
+ir_node *scev_build(scev const *const s, ir_node *const block)
+{
+	if (!scev_is_buildable(s))
+		return NULL;
+
+	ir_graph *const irg   = get_irn_irg(block);
+	ir_mode  *const mode  = s->mode;
+	ir_mode  *const arith = get_arith_mode(mode);
+	ir_node        *base  = NULL;
+	ir_node        *sum   = NULL;
+	for (unsigned i = 0; i < s->n_terms; ++i) {
+		scev_term const *const term  = &s->terms[i];
+		ir_node               *node  = term->node;
+		ir_mode         *const nmode = get_irn_mode(node);
+		if (mode_is_reference(nmode)) {
+			base = node;
+			continue;
+		}
+		if (nmode != arith)
+			node = new_r_Conv(block, node, arith);
+		if (!tarval_is_one(term->coeff))
+			node = new_r_Mul(block, node, new_r_Const(irg, term->coeff));
+		sum = sum != NULL ? new_r_Add(block, sum, node) : node;
+	}
+	if (sum == NULL || !tarval_is_null(s->offset)) {
+		ir_node *const c = new_r_Const(irg, s->offset);
+		sum = sum != NULL ? new_r_Add(block, sum, c) : c;
+	}
+	if (!mode_is_reference(mode))
+		return sum;
+	return new_r_Add(block, base, sum);
+}
+
+ir_node *scev_build_count(scev const *const count, unsigned const extra,
+                          ir_node *const block, ir_mode *const umode)
+{
+	ir_mode *const mode = count->mode;
+	ir_node       *res  = scev_build(count, block);
+	if (mode_is_signed(mode))
+		res = new_r_Conv(block, res, find_unsigned_mode(mode));
+	if (get_irn_mode(res) != umode)
+		res = new_r_Conv(block, res, umode);
+	if (extra != 0) {
+		ir_graph *const irg = get_irn_irg(block);
+		res = new_r_Add(block, res, new_r_Const_long(irg, umode, extra));
+	}
+	return res;
+}
+
+scev_info_t *scev_new(ir_graph *const irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.scev");
+	assert(irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO));
+
+	scev_info_t *const info = XMALLOCZ(scev_info_t);
+	info->irg = irg;
+	ir_nodemap_init(&info->map, irg);
+	obstack_init(&info->obst);
+	return info;
+}
+
+void scev_free(scev_info_t *const info)
+{
+	ir_nodemap_destroy(&info->map);
+	obstack_free(&info->obst, NULL);
+	free(info);
+}
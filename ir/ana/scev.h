@@ -0,0 +1,139 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Scalar evolution analysis over the loop tree.
+ *
+ * Integer and address values are described either as affine expressions of
+ * other nodes or as add-recurrences {start,+,step}<loop>, i.e. the value is
+ * start in the first iteration of loop and grows by step in each further
+ * iteration.  Based on this the number of iterations of a loop and the
+ * values after leaving a loop can be computed.
+ */
+#ifndef FIRM_ANA_SCEV_H
+#define FIRM_ANA_SCEV_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/** Maximum number of node terms of an affine expression. */
+#define SCEV_MAX_TERMS 3
+
+/** Kinds of scalar evolutions. */
+typedef enum scev_kind {
+	SCEV_AFFINE, /**< offset plus a sum of node multiples */
+	SCEV_ADDREC, /**< add-recurrence {start,+,step}<loop> */
+} scev_kind;
+
+/** A node multiple of an affine expression. */
+typedef struct scev_term {
+	ir_node   *node;  /**< the node */
+	ir_tarval *coeff; /**< the factor, never zero */
+} scev_term;
+
+typedef struct scev scev;
+
+/** The evolution of a value. */
+struct scev {
+	scev_kind   kind;
+	ir_mode    *mode;  /**< mode of the value, arithmetic uses its offset mode */
+	/* SCEV_AFFINE */
+	ir_tarval  *offset;                 /**< constant part */
+	unsigned    n_terms;                /**< number of node terms */
+	scev_term   terms[SCEV_MAX_TERMS];  /**< the node terms */
+	/* SCEV_ADDREC */
+	ir_loop    *loop;  /**< the loop the recurrence belongs to */
+	scev const *start; /**< value in the first iteration, invariant in loop */
+	scev const *step;  /**< increment per iteration, invariant in loop */
+};
+
+typedef struct scev_info_t scev_info_t;
+
+/**
+ * Creates a scalar evolution object for a graph.
+ * The evolutions are computed on demand and cached until scev_free().
+ * Requires consistent loop information.
+ */
+scev_info_t *scev_new(ir_graph *irg);
+
+/** Frees a scalar evolution object. */
+void scev_free(scev_info_t *info);
+
+/**
+ * Returns the evolution of the integer or address value @p node.
+ * Values which cannot be analysed are described by the node itself.
+ */
+scev const *scev_get(scev_info_t *info, ir_node *node);
+
+/** Returns whether @p s is a constant, i.e. affine without node terms. */
+bool scev_is_constant(scev const *s);
+
+/** Returns whether the value described by @p s does not change in @p loop. */
+bool scev_is_invariant(scev const *s, ir_loop const *loop);
+
+/**
+ * Computes how often the backedges of @p loop are taken before the loop is
+ * left, i.e. the number of iterations minus one.
+ *
+ * Only loops with a single exit controlled by a comparison of an
+ * add-recurrence of the loop with constant step against a loop invariant
+ * value are handled.  The exit test must be in the loop header or in the
+ * single block with backedges, so it is evaluated once per iteration.
+ *
+ * @param may_be_zero  set to true if the result is symbolic and only valid
+ *                     if the first exit test stays in the loop, otherwise
+ *                     the backedges are never taken
+ * @return the count in the mode of the compared values or NULL
+ */
+scev const *scev_get_backedge_count(scev_info_t *info, ir_loop *loop,
+                                    bool *may_be_zero);
+
+/**
+ * Returns the block evaluating the exit test of @p loop, i.e. its header or
+ * the block with backedges, if the loop is handled by
+ * scev_get_backedge_count().  Returns NULL otherwise.
+ */
+ir_node *scev_get_exit_block(scev_info_t *info, ir_loop *loop);
+
+/**
+ * Returns the value @p node has in the iteration in which @p loop is left.
+ * The node must be evaluated in every iteration before the exit test.
+ * Returns NULL if the value cannot be computed.
+ */
+scev const *scev_get_exit_value(scev_info_t *info, ir_node *node,
+                                ir_loop *loop);
+
+/**
+ * Checks whether the affine expressions @p a and @p b differ only by a
+ * constant and stores @p b minus @p a in @p dist if so.
+ */
+bool scev_get_distance(scev const *a, scev const *b, long *dist);
+
+/**
+ * Returns whether @p s is an affine expression which scev_build() can
+ * construct.
+ */
+bool scev_is_buildable(scev const *s);
+
+/**
+ * Builds nodes computing the affine expression @p s at the end of @p block.
+ * All terms of @p s must dominate the block.
+ * Returns NULL, without creating any nodes, if @p s is no affine expression
+ * which can be built.
+ */
+ir_node *scev_build(scev const *s, ir_node *block);
+
+/**
+ * Builds the non-negative count @p count plus @p extra at the end of
+ * @p block.  The result has the unsigned mode @p umode, which must not be
+ * narrower than the mode of the count, and @p extra is added in it, so the
+ * largest signed count does not overflow.
+ */
+ir_node *scev_build_count(scev const *count, unsigned extra, ir_node *block,
+                          ir_mode *umode);
+
+#endif
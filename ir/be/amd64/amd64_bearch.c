@@ -512,9 +512,10 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
 
 static void introduce_prologue_epilogue(ir_graph *irg, bool omit_fp)
 {
-	/* introduce epilogue for every return node */
+	/* introduce epilogue for every return node, tail calls have the same
+	 * memory and stack inputs */
 	foreach_irn_in(get_irg_end_block(irg), i, ret) {
-		assert(is_amd64_ret(ret));
+		assert(is_amd64_ret(ret) || is_amd64_tail_call(ret));
 		introduce_epilogue(ret, omit_fp);
 	}
 
@@ -627,7 +628,8 @@ static void amd64_finish_and_emit(ir_graph *irg)
 	/* fix stack entity offsets */
 	be_fix_stack_nodes(irg, &amd64_registers[REG_RSP]);
 	be_birg_from_irg(irg)->non_ssa_regs = NULL;
-	unsigned const p2align = AMD64_PO2_STACK_ALIGNMENT;
+	unsigned const p2align = x86_needs_aligned_stack(irg)
+		? AMD64_PO2_STACK_ALIGNMENT : log2_floor(AMD64_REGISTER_SIZE);
 	be_sim_stack_pointer(irg, misalign, p2align, amd64_sp_sim);
 
 	/* Fix 2-address code constraints. */
@@ -662,7 +664,13 @@ static void amd64_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_RSP);
 
-	foreach_irp_irg(i, irg) {
+	if (be_options.ipra)
+		x86_ipra_init(N_AMD64_REGISTERS);
+	if (amd64_optimize_cc)
+		x86_collect_unaligned_stack_functions(AMD64_REGISTER_SIZE);
+	ir_graph **const irgs = x86_get_irg_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!be_step_first(irg))
 			continue;
 
@@ -682,9 +690,13 @@ static void amd64_generate_code(FILE *output, const char *cup_name)
 		be_step_regalloc(irg, &amd64_regalloc_if);
 
 		amd64_finish_and_emit(irg);
+		amd64_record_clobbers(irg);
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
+	x86_ipra_free();
+	x86_free_unaligned_stack_functions();
 
 	be_finish();
 	pmap_destroy(amd64_constants);
@@ -747,12 +759,13 @@ static void amd64_lower_for_target(void)
 		be_after_transform(irg, "lower-copyb");
 	}
 
-	ir_builtin_kind supported[6];
+	ir_builtin_kind supported[7];
 	size_t  s = 0;
 	supported[s++] = ir_bk_ffs;
 	supported[s++] = ir_bk_clz;
 	supported[s++] = ir_bk_ctz;
 	supported[s++] = ir_bk_compare_swap;
+	supported[s++] = ir_bk_prefetch;
 	supported[s++] = ir_bk_saturating_increment;
 	supported[s++] = ir_bk_va_start;
 
@@ -787,6 +800,7 @@ static void amd64_init(void)
 	ir_target.experimental = "the amd64 backend is experimental and unfinished (consider the ia32 backend)";
 	ir_target.fast_unaligned_memaccess = true;
 	ir_target.float_int_overflow       = ir_overflow_indefinite;
+	ir_target.vector_size              = 16;
 }
 
 static unsigned amd64_get_op_estimated_cost(const ir_node *node)
@@ -822,6 +836,8 @@ void be_init_arch_amd64(void)
 
 	static const lc_opt_table_entry_t options[] = {
 		LC_OPT_ENT_BOOL("no-red-zone", "gcc compatibility",                &amd64_use_red_zone),
+		LC_OPT_ENT_BOOL("optcc",       "optimize calling convention",      &amd64_optimize_cc),
+		LC_OPT_ENT_INT ("private-callee-saves", "callee saved registers besides rbp of local functions", &amd64_private_callee_saves),
 		LC_OPT_LAST
 	};
 	lc_opt_entry_t *be_grp    = lc_opt_get_grp(firm_opt_get_root(), "be");
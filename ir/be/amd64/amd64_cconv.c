@@ -31,7 +31,9 @@
  * Note: "X64 ABI" refers to the Windows ABI for x86_64 (the SysV ABI
  * calls itself "AMD64 ABI").
  */
-bool amd64_use_red_zone = true;
+bool amd64_use_red_zone         = true;
+bool amd64_optimize_cc          = true;
+int  amd64_private_callee_saves = 5;
 
 static const unsigned ignore_regs[] = {
 	REG_RSP,
@@ -53,6 +55,38 @@ static const arch_register_t* const float_param_regs[] = {
 };
 static unsigned n_float_param_regs;
 
+/* the calling convention of local functions, whose address is not taken,
+ * passes more parameters in registers */
+static const arch_register_t* const private_param_regs[] = {
+	&amd64_registers[REG_RDI],
+	&amd64_registers[REG_RSI],
+	&amd64_registers[REG_RDX],
+	&amd64_registers[REG_RCX],
+	&amd64_registers[REG_R8],
+	&amd64_registers[REG_R9],
+	&amd64_registers[REG_R10],
+	&amd64_registers[REG_R11],
+};
+
+static const arch_register_t* const private_float_param_regs[] = {
+	&amd64_registers[REG_XMM0],
+	&amd64_registers[REG_XMM1],
+	&amd64_registers[REG_XMM2],
+	&amd64_registers[REG_XMM3],
+	&amd64_registers[REG_XMM4],
+	&amd64_registers[REG_XMM5],
+	&amd64_registers[REG_XMM6],
+	&amd64_registers[REG_XMM7],
+	&amd64_registers[REG_XMM8],
+	&amd64_registers[REG_XMM9],
+	&amd64_registers[REG_XMM10],
+	&amd64_registers[REG_XMM11],
+	&amd64_registers[REG_XMM12],
+	&amd64_registers[REG_XMM13],
+	&amd64_registers[REG_XMM14],
+	&amd64_registers[REG_XMM15],
+};
+
 static const arch_register_t* const result_regs[] = {
 	&amd64_registers[REG_RAX],
 	&amd64_registers[REG_RDX],
@@ -70,6 +104,31 @@ static const arch_register_t* const x87_result_regs[] = {
 static unsigned default_caller_saves[BITSET_SIZE_ELEMS(N_AMD64_REGISTERS)];
 static unsigned default_callee_saves[BITSET_SIZE_ELEMS(N_AMD64_REGISTERS)];
 
+/* callee saves of local functions besides rbp, the last ones become caller
+ * saves first */
+static const unsigned private_callee_saves_gp[] = {
+	REG_RBX,
+	REG_R12,
+	REG_R13,
+	REG_R14,
+	REG_R15,
+};
+static unsigned private_caller_saves[BITSET_SIZE_ELEMS(N_AMD64_REGISTERS)];
+static unsigned private_callee_saves[BITSET_SIZE_ELEMS(N_AMD64_REGISTERS)];
+
+/* the x87 stack has to be empty at calls, so it is always clobbered */
+static const unsigned x87_regs[] = {
+	REG_ST0,
+	REG_ST1,
+	REG_ST2,
+	REG_ST3,
+	REG_ST4,
+	REG_ST5,
+	REG_ST6,
+	REG_ST7,
+};
+static unsigned x87_clobbers[BITSET_SIZE_ELEMS(N_AMD64_REGISTERS)];
+
 static void check_omit_fp(ir_node *node, void *env)
 {
 	/* omit-fp is not possible if:
@@ -92,10 +151,18 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 		amd64_get_irg_data(irg)->omit_fp = omit_fp;
 	}
 
+	/* all callers of a private function are known, so it may use a faster
+	 * calling convention */
+	bool const is_private = amd64_optimize_cc
+		&& (get_method_additional_properties(function_type) & mtp_property_private)
+		&& !is_method_variadic(function_type);
+
 	unsigned *caller_saves = rbitset_malloc(N_AMD64_REGISTERS);
 	unsigned *callee_saves = rbitset_malloc(N_AMD64_REGISTERS);
-	rbitset_copy(caller_saves, default_caller_saves, N_AMD64_REGISTERS);
-	rbitset_copy(callee_saves, default_callee_saves, N_AMD64_REGISTERS);
+	rbitset_copy(caller_saves, is_private ? private_caller_saves
+	                                      : default_caller_saves, N_AMD64_REGISTERS);
+	rbitset_copy(callee_saves, is_private ? private_callee_saves
+	                                      : default_callee_saves, N_AMD64_REGISTERS);
 
 	/* determine how parameters are passed */
 	size_t              n_params           = get_method_n_params(function_type);
@@ -105,8 +172,19 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 	                                                   n_params);
 	/* x64 always reserves space to spill the first 4 arguments to have it
 	 * easy in case of variadic functions. */
-	bool amd64_use_x64_abi = ir_platform.amd64_x64abi;
+	bool amd64_use_x64_abi = ir_platform.amd64_x64abi && !is_private;
 	unsigned stack_offset = amd64_use_x64_abi ? 32 : 0;
+
+	arch_register_t const *const *gp_regs      = param_regs;
+	arch_register_t const *const *float_regs   = float_param_regs;
+	size_t                        n_gp_regs    = n_param_regs;
+	size_t                        n_float_regs = n_float_param_regs;
+	if (is_private) {
+		gp_regs      = private_param_regs;
+		float_regs   = private_float_param_regs;
+		n_gp_regs    = ARRAY_SIZE(private_param_regs);
+		n_float_regs = ARRAY_SIZE(private_float_param_regs);
+	}
 	for (size_t i = 0; i < n_params; ++i) {
 		ir_type *param_type = get_method_param_type(function_type,i);
 		reg_or_stackslot_t *param = &params[i];
@@ -116,14 +194,14 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 		if (is_aggregate_type(param_type)) {
 			goto use_memory;
 
-		} else if (mode_is_float(mode) && float_param_regnum < n_float_param_regs
+		} else if (mode_is_float(mode) && float_param_regnum < n_float_regs
 		    && mode != x86_mode_E) {
-			param->reg = float_param_regs[float_param_regnum++];
+			param->reg = float_regs[float_param_regnum++];
 			if (amd64_use_x64_abi) {
 				++param_regnum;
 			}
-		} else if (!mode_is_float(mode) && param_regnum < n_param_regs) {
-			param->reg = param_regs[param_regnum++];
+		} else if (!mode_is_float(mode) && param_regnum < n_gp_regs) {
+			param->reg = gp_regs[param_regnum++];
 			if (amd64_use_x64_abi) {
 				++float_param_regnum;
 			}
@@ -221,8 +299,19 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 	return cconv;
 }
 
+void amd64_record_clobbers(ir_graph *const irg)
+{
+	if (!be_options.ipra)
+		return;
+	ir_type     *const type  = get_entity_type(get_irg_entity(irg));
+	x86_cconv_t *const cconv = amd64_decide_calling_convention(type, NULL);
+	x86_ipra_record_clobbers(irg, cconv->caller_saves, x87_clobbers);
+	x86_free_calling_convention(cconv);
+}
+
 void amd64_cconv_init(void)
 {
+	be_cconv_add_regs(x87_clobbers, x87_regs, ARRAY_SIZE(x87_regs));
 	static const unsigned common_caller_saves[] = {
 		REG_RAX,
 		REG_RCX,
@@ -287,4 +376,19 @@ void amd64_cconv_init(void)
 	n_param_regs = ARRAY_SIZE(param_regs_list) - (amd64_use_x64_abi ? 2 : 0);
 
 	n_float_param_regs = amd64_use_x64_abi ? 4 : ARRAY_SIZE(float_param_regs);
+
+	/* registers of the x64 ABI, which are callee saved but pass parameters
+	 * in the private calling convention, become caller saves as well */
+	unsigned const n_private_callee_saves
+		= MIN((unsigned)MAX(amd64_private_callee_saves, 0),
+		      ARRAY_SIZE(private_callee_saves_gp));
+	rbitset_copy(private_caller_saves, default_caller_saves, N_AMD64_REGISTERS);
+	rbitset_copy(private_callee_saves, default_callee_saves, N_AMD64_REGISTERS);
+	be_cconv_add_regs(private_caller_saves, x64_callee_saves, ARRAY_SIZE(x64_callee_saves));
+	be_cconv_rem_regs(private_callee_saves, x64_callee_saves, ARRAY_SIZE(x64_callee_saves));
+	for (unsigned i = n_private_callee_saves;
+	     i < ARRAY_SIZE(private_callee_saves_gp); ++i) {
+		rbitset_clear(private_callee_saves, private_callee_saves_gp[i]);
+		rbitset_set(private_caller_saves, private_callee_saves_gp[i]);
+	}
 }
@@ -290,6 +290,20 @@ my $x87store = {
 	mode      => "mode_M",
 };
 
+my $prefetchop = {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	in_reqs   => "...",
+	out_reqs  => [ "mem" ],
+	outs      => [ "M" ],
+	attr_type => "amd64_addr_attr_t",
+	attr      => "x86_addr_t addr",
+	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n"
+	            ."x86_insn_size_t size    = X86_SIZE_8;\n",
+	emit      => "{name} %A",
+	latency   => 0,
+};
+
 %nodes = (
 push_am => {
 	op_flags  => [ "uses_memory" ],
@@ -529,6 +543,14 @@ mov_store => {
 	emit      => "mov%M %AM",
 },
 
+prefetcht0  => { template => $prefetchop },
+
+prefetcht1  => { template => $prefetchop },
+
+prefetcht2  => { template => $prefetchop },
+
+prefetchnta => { template => $prefetchop },
+
 jmp_switch => {
 	op_flags  => [ "cfopcode", "forking" ],
 	state     => "pinned",
@@ -549,6 +571,17 @@ call => {
 	emit      => "call %*AM",
 },
 
+tail_call => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	in_reqs   => "...",
+	out_reqs  => [ "exec" ],
+	ins       => [ "mem", "stack" ],
+	attr_type => "amd64_addr_attr_t",
+	attr      => "x86_insn_size_t size, amd64_op_mode_t op_mode, x86_addr_t addr",
+	emit      => "jmp %*AM",
+},
+
 ret => {
 	state    => "pinned",
 	op_flags => [ "cfopcode" ],
@@ -738,6 +771,77 @@ subpd => { template => $binopx },
 
 haddpd => { template => $binopx },
 
+# element-wise operations on packed vectors
+addp => { template => $binopx_commutative },
+
+subp => {
+	template => $binopx,
+	emit     => "subp%MX %AM",
+},
+
+mulp => { template => $binopx_commutative },
+
+paddb => {
+	template => $binopx_commutative,
+	emit     => "paddb %AM",
+},
+
+paddw => {
+	template => $binopx_commutative,
+	emit     => "paddw %AM",
+},
+
+paddd => {
+	template => $binopx_commutative,
+	emit     => "paddd %AM",
+},
+
+paddq => {
+	template => $binopx_commutative,
+	emit     => "paddq %AM",
+},
+
+psubb => { template => $binopx },
+
+psubw => { template => $binopx },
+
+psubd => { template => $binopx },
+
+psubq => { template => $binopx },
+
+pand => {
+	template => $binopx_commutative,
+	emit     => "pand %AM",
+},
+
+por => {
+	template => $binopx_commutative,
+	emit     => "por %AM",
+},
+
+pxor => {
+	template => $binopx_commutative,
+	emit     => "pxor %AM",
+},
+
+pandn => { template => $binopx },
+
+pcmpgtb => { template => $binopx },
+
+pcmpgtw => { template => $binopx },
+
+pcmpgtd => { template => $binopx },
+
+minp => {
+	template => $binopx,
+	emit     => "minp%MX %AM",
+},
+
+maxp => {
+	template => $binopx,
+	emit     => "maxp%MX %AM",
+},
+
 fldz => { template => $x87const },
 
 fld1 => { template => $x87const },
@@ -39,6 +39,7 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
 static x86_cconv_t    *current_cconv = NULL;
 static be_stack_env_t  stack_env;
+static bool            frame_escapes;
 
 /** we don't have a concept of aliasing registers, so enumerate them
  * manually for the asm nodes. */
@@ -918,6 +919,71 @@ static ir_node *gen_binop_xmm(ir_node *node, ir_node *op0, ir_node *op1,
 	return be_new_Proj(new_node, pn_amd64_subs_res);
 }
 
+/**
+ * Creates an element-wise SSE operation on the transformed vector values
+ * @p new_op0 and @p new_op1 of mode @p mode.
+ */
+static ir_node *new_binop_vector(dbg_info *const dbgi, ir_node *const block,
+                                 ir_mode *const mode, ir_node *const new_op0,
+                                 ir_node *const new_op1,
+                                 construct_binop_func const make_node,
+                                 bool const commutative)
+{
+	ir_mode *const el_mode = get_vector_element_mode(mode);
+	amd64_binop_addr_attr_t attr;
+	memset(&attr, 0, sizeof(attr));
+	/* the size selects between the ps and pd forms of float operations */
+	attr.base.base.size = mode_is_float(el_mode)
+	                    ? x86_size_from_mode(el_mode) : X86_SIZE_128;
+
+	ir_node *const in[] = { new_op0, new_op1 };
+	x86_addr_t *const addr = &attr.base.addr;
+	addr->base_input       = 0;
+	addr->variant          = X86_ADDR_REG;
+	attr.u.reg_input       = 1;
+	attr.base.base.op_mode = AMD64_OP_REG_REG;
+
+	ir_node *const new_node = make_node(dbgi, block, ARRAY_SIZE(in), in,
+	                                    amd64_xmm_xmm_reqs, &attr);
+	arch_set_irn_register_req_out(new_node, 0, commutative
+		? &amd64_requirement_xmm_same_0
+		: &amd64_requirement_xmm_same_0_not_1);
+	return be_new_Proj(new_node, pn_amd64_addp_res);
+}
+
+/**
+ * Creates an element-wise SSE operation on vector values.  Memory operands
+ * are not matched, as packed SSE instructions require them to be aligned.
+ */
+static ir_node *gen_binop_vector(ir_node *const node, ir_node *const op0,
+                                 ir_node *const op1,
+                                 construct_binop_func const make_node,
+                                 bool const commutative)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_op0   = be_transform_node(op0);
+	ir_node  *const new_op1   = be_transform_node(op1);
+	return new_binop_vector(dbgi, new_block, get_irn_mode(node), new_op0,
+	                        new_op1, make_node, commutative);
+}
+
+/**
+ * Selects the constructor of an integer vector operation by element size.
+ */
+static construct_binop_func select_int_vector_op(ir_mode *const mode,
+		construct_binop_func const op8, construct_binop_func const op16,
+		construct_binop_func const op32, construct_binop_func const op64)
+{
+	switch (get_mode_size_bits(get_vector_element_mode(mode))) {
+	case  8: return op8;
+	case 16: return op16;
+	case 32: return op32;
+	case 64: return op64;
+	}
+	panic("unexpected vector mode %+F", mode);
+}
+
 typedef ir_node *(*construct_x87_binop_func)(
 		dbg_info *dbgi, ir_node *block, ir_node *op0, ir_node *op1);
 
@@ -1016,7 +1082,15 @@ static ir_node *gen_Add(ir_node *const node)
 	ir_mode *const mode  = get_irn_mode(node);
 	ir_node *const block = get_nodes_block(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		construct_binop_func const cons
+			= mode_is_float(get_vector_element_mode(mode))
+			? &new_bd_amd64_addp
+			: select_int_vector_op(mode, &new_bd_amd64_paddb,
+			                       &new_bd_amd64_paddw, &new_bd_amd64_paddd,
+			                       &new_bd_amd64_paddq);
+		return gen_binop_vector(node, op1, op2, cons, true);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fadd);
 		return gen_binop_am(node, op1, op2, new_bd_amd64_adds,
@@ -1056,7 +1130,15 @@ static ir_node *gen_Sub(ir_node *const node)
 	ir_node *const op2  = get_Sub_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		construct_binop_func const cons
+			= mode_is_float(get_vector_element_mode(mode))
+			? &new_bd_amd64_subp
+			: select_int_vector_op(mode, &new_bd_amd64_psubb,
+			                       &new_bd_amd64_psubw, &new_bd_amd64_psubd,
+			                       &new_bd_amd64_psubq);
+		return gen_binop_vector(node, op1, op2, cons, false);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fsub);
 		return gen_binop_am(node, op1, op2, new_bd_amd64_subs,
@@ -1079,6 +1161,8 @@ static ir_node *gen_And(ir_node *const node)
 {
 	ir_node *const op1 = get_And_left(node);
 	ir_node *const op2 = get_And_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, &new_bd_amd64_pand, true);
 
 	/* Is it a zero extension? */
 	if (is_Const(op2)) {
@@ -1109,6 +1193,8 @@ static ir_node *gen_Eor(ir_node *const node)
 {
 	ir_node *const op1 = get_Eor_left(node);
 	ir_node *const op2 = get_Eor_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, &new_bd_amd64_pxor, true);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_xor, pn_amd64_xor_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1118,6 +1204,8 @@ static ir_node *gen_Or(ir_node *const node)
 {
 	ir_node *const op1 = get_Or_left(node);
 	ir_node *const op2 = get_Or_right(node);
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_binop_vector(node, op1, op2, &new_bd_amd64_por, true);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_or, pn_amd64_or_res,
 	                    match_immediate | match_am | match_mode_neutral
 	                    | match_commutative);
@@ -1129,7 +1217,10 @@ static ir_node *gen_Mul(ir_node *const node)
 	ir_node *const op2  = get_Mul_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (get_mode_size_bits(mode) < 16) {
+	if (mode_is_vector(mode)) {
+		assert(mode_is_float(get_vector_element_mode(mode)));
+		return gen_binop_vector(node, op1, op2, &new_bd_amd64_mulp, true);
+	} else if (get_mode_size_bits(mode) < 16) {
 		/* imulb only supports rax - reg form */
 		ir_node *new_node
 			= gen_binop_rax(node, op1, op2, new_bd_amd64_imul_1op,
@@ -1147,6 +1238,83 @@ static ir_node *gen_Mul(ir_node *const node)
 	}
 }
 
+/**
+ * Transforms a lane-wise select of vectors, whose selector compares vectors.
+ * The loop vectorizer creates these for minimum and maximum.
+ */
+static ir_node *gen_Mux(ir_node *const node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	if (!mode_is_vector(mode))
+		panic("unexpected Mux %+F", node);
+
+	ir_node    *const sel       = get_Mux_sel(node);
+	ir_node    *const mux_false = get_Mux_false(node);
+	ir_node    *const mux_true  = get_Mux_true(node);
+	ir_node    *const cmp_left  = get_Cmp_left(sel);
+	ir_node    *const cmp_right = get_Cmp_right(sel);
+	ir_relation const relation  = get_Cmp_relation(sel);
+	if (mode_is_float(get_vector_element_mode(mode))) {
+		/* minp and maxp select their second operand unless the first one is
+		 * smaller or greater, respectively */
+		assert((mux_true == cmp_left && mux_false == cmp_right)
+		    || (mux_true == cmp_right && mux_false == cmp_left));
+		bool const min = (relation == ir_relation_less) == (mux_true == cmp_left);
+		return gen_binop_vector(node, mux_true, mux_false,
+		                        min ? &new_bd_amd64_minp : &new_bd_amd64_maxp,
+		                        false);
+	}
+
+	/* pcmpgt sets the lanes in which its first operand is greater (signed) to
+	 * all ones, which pick the value to select there */
+	ir_node *greater;
+	ir_node *smaller;
+	ir_node *val_set;
+	ir_node *val_clear;
+	switch (relation) {
+	case ir_relation_less:
+	case ir_relation_greater_equal:
+		greater = cmp_right;
+		smaller = cmp_left;
+		break;
+	case ir_relation_greater:
+	case ir_relation_less_equal:
+		greater = cmp_left;
+		smaller = cmp_right;
+		break;
+	default:
+		panic("unexpected relation in %+F", sel);
+	}
+	if (relation == ir_relation_less || relation == ir_relation_greater) {
+		val_set   = mux_true;
+		val_clear = mux_false;
+	} else {
+		val_set   = mux_false;
+		val_clear = mux_true;
+	}
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	construct_binop_func const cmpgt
+		= select_int_vector_op(mode, &new_bd_amd64_pcmpgtb,
+		                       &new_bd_amd64_pcmpgtw, &new_bd_amd64_pcmpgtd,
+		                       NULL);
+	if (cmpgt == NULL)
+		panic("unexpected vector mode in %+F", node);
+	ir_node *const mask = new_binop_vector(dbgi, new_block, mode,
+	                                       be_transform_node(greater),
+	                                       be_transform_node(smaller),
+	                                       cmpgt, false);
+	ir_node *const set   = new_binop_vector(dbgi, new_block, mode,
+	                                        be_transform_node(val_set), mask,
+	                                        &new_bd_amd64_pand, true);
+	ir_node *const clear = new_binop_vector(dbgi, new_block, mode, mask,
+	                                        be_transform_node(val_clear),
+	                                        &new_bd_amd64_pandn, false);
+	return new_binop_vector(dbgi, new_block, mode, set, clear,
+	                        &new_bd_amd64_por, true);
+}
+
 static ir_node *gen_Mulh(ir_node *const node)
 {
 	ir_node *const op1  = get_Mulh_left(node);
@@ -1684,55 +1852,6 @@ static ir_node *gen_Proj_Start(ir_node *const node)
 	panic("unexpected Start Proj: %u", pn);
 }
 
-static ir_node *gen_Return(ir_node *const node)
-{
-	ir_graph          *const irg       = get_irn_irg(node);
-	ir_node           *const new_block = be_transform_nodes_block(node);
-	dbg_info          *const dbgi      = get_irn_dbg_info(node);
-	ir_node           *const mem       = get_Return_mem(node);
-	ir_node           *const new_mem   = be_transform_node(mem);
-	size_t             const n_res     = get_Return_n_ress(node);
-	x86_cconv_t const *const cconv     = current_cconv;
-
-	/* estimate number of return values */
-	size_t       p              = n_amd64_ret_first_result;
-	size_t const n_callee_saves = rbitset_popcount(cconv->callee_saves, N_AMD64_REGISTERS);
-	size_t const n_ins          = p + n_res + n_callee_saves;
-
-	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
-	ir_node **in = ALLOCAN(ir_node*, n_ins);
-
-	in[n_amd64_ret_mem]   = new_mem;
-	reqs[n_amd64_ret_mem] = arch_memory_req;
-
-	in[n_amd64_ret_stack]   = get_initial_sp(irg);
-	reqs[n_amd64_ret_stack] = amd64_registers[REG_RSP].single_req;
-
-	/* result values */
-	for (size_t i = 0; i < n_res; ++i) {
-		ir_node                  *res_value     = get_Return_res(node, i);
-		ir_node                  *new_res_value = be_transform_node(res_value);
-		const reg_or_stackslot_t *slot          = &current_cconv->results[i];
-		in[p]   = new_res_value;
-		reqs[p] = slot->reg->single_req;
-		++p;
-	}
-	/* callee saves */
-	for (size_t i = 0; i < N_AMD64_REGISTERS; ++i) {
-		if (!rbitset_is_set(cconv->callee_saves, i))
-			continue;
-		arch_register_t const *const reg = &amd64_registers[i];
-		in[p]   = be_get_Start_proj(irg, reg);
-		reqs[p] = reg->single_req;
-		++p;
-	}
-	assert(p == n_ins);
-
-	ir_node *const ret = new_bd_amd64_ret(dbgi, new_block, n_ins, in, reqs);
-	be_stack_record_chain(&stack_env, ret, n_amd64_ret_stack, NULL);
-	return ret;
-}
-
 static int make_store_value(amd64_binop_addr_attr_t *const attr, ir_mode *const mode, ir_node *val, ir_node **const in)
 {
 	int arity = 0;
@@ -1755,7 +1874,10 @@ static ir_node *make_store_for_mode(ir_mode *const mode, dbg_info *const dbgi, i
 {
 	construct_binop_func               cons;
 	arch_register_req_t const **const *reqs;
-	if (!mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		cons = &new_bd_amd64_movdqu_store;
+		reqs = xmm_am_reqs;
+	} else if (!mode_is_float(mode)) {
 		cons = &new_bd_amd64_mov_store;
 		reqs = gp_am_reqs;
 	} else if (mode == x86_mode_E) {
@@ -1798,6 +1920,7 @@ static ir_node *gen_Call(ir_node *const node)
 	ir_graph          *const irg          = get_irn_irg(node);
 	x86_cconv_t       *const cconv
 		= amd64_decide_calling_convention(type, NULL);
+	x86_ipra_restrict_caller_saves(cconv, get_Call_ptr(node));
 	size_t             const n_param_regs = cconv->n_param_regs;
 	/* param-regs + mem + stackpointer + callee(2) + n_sse_regs */
 	unsigned           const max_inputs   = 5 + n_param_regs;
@@ -2026,6 +2149,194 @@ no_call_mem:;
 	return call;
 }
 
+/**
+ * Returns the calling convention of the Call whose results are returned by
+ * @p ret if the call can become a jump to the callee, NULL otherwise.
+ */
+static x86_cconv_t *get_tail_call_cconv(ir_node const *const ret,
+                                        ir_node **const call_out)
+{
+	if (frame_escapes)
+		return NULL;
+	ir_node *const call = x86_get_tail_call(ret);
+	if (call == NULL)
+		return NULL;
+	x86_cconv_t *const cconv
+		= amd64_decide_calling_convention(get_Call_type(call), NULL);
+	/* the stack arguments have to fit into our incoming argument area and the
+	 * callee has to preserve our callee saves */
+	if (cconv->param_stacksize > current_cconv->param_stacksize
+	 || !rbitset_contains(current_cconv->callee_saves, cconv->callee_saves,
+	                      N_AMD64_REGISTERS)) {
+		x86_free_calling_convention(cconv);
+		return NULL;
+	}
+	*call_out = call;
+	return cconv;
+}
+
+/**
+ * Transforms the Return @p node of the results of @p call into a jump to the
+ * callee after the frame is released.  Stack arguments are passed in our
+ * incoming argument area.
+ */
+static ir_node *gen_tail_call(ir_node *const node, ir_node *const call,
+                              x86_cconv_t const *const cconv)
+{
+	ir_graph          *const irg       = get_irn_irg(node);
+	ir_node           *const block     = get_nodes_block(node);
+	ir_node           *const new_block = be_transform_node(block);
+	dbg_info          *const dbgi      = get_irn_dbg_info(call);
+	ir_node           *const callee    = get_Call_ptr(call);
+	ir_type           *const type      = get_Call_type(call);
+	size_t             const n_params  = get_Call_n_params(call);
+	x86_cconv_t const *const caller    = current_cconv;
+
+	/* mem + stack + callee + params + callee saves */
+	size_t const n_callee_saves
+		= rbitset_popcount(caller->callee_saves, N_AMD64_REGISTERS);
+	size_t const max_ins = 3 + cconv->n_param_regs + n_callee_saves;
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, max_ins);
+	ir_node **const in    = ALLOCAN(ir_node*, max_ins);
+	int             arity = n_amd64_tail_call_stack + 1;
+
+	in[n_amd64_tail_call_stack]   = get_initial_sp(irg);
+	reqs[n_amd64_tail_call_stack] = amd64_registers[REG_RSP].single_req;
+
+	x86_addr_t      addr = { .variant = X86_ADDR_REG };
+	amd64_op_mode_t op_mode;
+	if (match_immediate_32(&addr.immediate, callee, true)) {
+		op_mode = AMD64_OP_IMM32;
+	} else {
+		int const input = arity++;
+		addr.base_input = input;
+		in[input]       = be_transform_node(callee);
+		reqs[input]     = &amd64_class_reg_req_gp;
+		op_mode         = AMD64_OP_REG;
+	}
+
+	ir_node  *const mem        = be_transform_node(get_Call_mem(call));
+	ir_node **const sync_ins   = ALLOCAN(ir_node*, n_params);
+	int             sync_arity = 0;
+	for (size_t p = 0; p < n_params; ++p) {
+		ir_node                  *const value = get_Call_param(call, p);
+		reg_or_stackslot_t const *const param = &cconv->parameters[p];
+		if (param->reg != NULL) {
+			in[arity]   = be_transform_node(value);
+			reqs[arity] = param->reg->single_req;
+			++arity;
+			continue;
+		}
+
+		/* store the value into the incoming argument area */
+		ir_mode        *const mode = get_type_mode(get_method_param_type(type, p));
+		x86_insn_size_t       size = x86_size_from_mode(mode);
+		if (size < X86_SIZE_32)
+			size = X86_SIZE_32;
+
+		amd64_binop_addr_attr_t attr = {
+			.base = {
+				.base = {
+					.size = size,
+				},
+				.addr = {
+					.immediate = {
+						.kind   = X86_IMM_FRAMEOFFSET,
+						.offset = param->offset + AMD64_REGISTER_SIZE,
+					},
+					.variant = X86_ADDR_BASE,
+				},
+			},
+		};
+
+		ir_node *store_in[3];
+		int      store_arity = make_store_value(&attr, mode, value, store_in);
+
+		attr.base.addr.base_input = store_arity;
+		store_in[store_arity++]   = get_frame_base(irg);
+		store_in[store_arity++]   = mem;
+		sync_ins[sync_arity++]    = make_store_for_mode(mode, dbgi, new_block, store_arity, store_in, &attr, true);
+	}
+	in[n_amd64_tail_call_mem]   = sync_arity == 0 ? mem
+		: be_make_Sync(new_block, sync_arity, sync_ins);
+	reqs[n_amd64_tail_call_mem] = arch_memory_req;
+
+	/* callee saves */
+	for (size_t i = 0; i < N_AMD64_REGISTERS; ++i) {
+		if (!rbitset_is_set(caller->callee_saves, i))
+			continue;
+		arch_register_t const *const reg = &amd64_registers[i];
+		in[arity]   = be_get_Start_proj(irg, reg);
+		reqs[arity] = reg->single_req;
+		++arity;
+	}
+	assert(arity <= (int)max_ins);
+
+	ir_node *const jmp = new_bd_amd64_tail_call(dbgi, new_block, arity, in,
+	                                            reqs, X86_SIZE_64, op_mode,
+	                                            addr);
+	be_stack_record_chain(&stack_env, jmp, n_amd64_tail_call_stack, NULL);
+	x86_ipra_add_tail_call(cconv, callee);
+	return jmp;
+}
+
+static ir_node *gen_Return(ir_node *const node)
+{
+	ir_node     *call;
+	x86_cconv_t *const callee_cconv = get_tail_call_cconv(node, &call);
+	if (callee_cconv != NULL) {
+		ir_node *const jmp = gen_tail_call(node, call, callee_cconv);
+		x86_free_calling_convention(callee_cconv);
+		return jmp;
+	}
+
+	ir_graph          *const irg       = get_irn_irg(node);
+	ir_node           *const new_block = be_transform_nodes_block(node);
+	dbg_info          *const dbgi      = get_irn_dbg_info(node);
+	ir_node           *const mem       = get_Return_mem(node);
+	ir_node           *const new_mem   = be_transform_node(mem);
+	size_t             const n_res     = get_Return_n_ress(node);
+	x86_cconv_t const *const cconv     = current_cconv;
+
+	/* estimate number of return values */
+	size_t       p              = n_amd64_ret_first_result;
+	size_t const n_callee_saves = rbitset_popcount(cconv->callee_saves, N_AMD64_REGISTERS);
+	size_t const n_ins          = p + n_res + n_callee_saves;
+
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
+	ir_node **in = ALLOCAN(ir_node*, n_ins);
+
+	in[n_amd64_ret_mem]   = new_mem;
+	reqs[n_amd64_ret_mem] = arch_memory_req;
+
+	in[n_amd64_ret_stack]   = get_initial_sp(irg);
+	reqs[n_amd64_ret_stack] = amd64_registers[REG_RSP].single_req;
+
+	/* result values */
+	for (size_t i = 0; i < n_res; ++i) {
+		ir_node                  *res_value     = get_Return_res(node, i);
+		ir_node                  *new_res_value = be_transform_node(res_value);
+		const reg_or_stackslot_t *slot          = &current_cconv->results[i];
+		in[p]   = new_res_value;
+		reqs[p] = slot->reg->single_req;
+		++p;
+	}
+	/* callee saves */
+	for (size_t i = 0; i < N_AMD64_REGISTERS; ++i) {
+		if (!rbitset_is_set(cconv->callee_saves, i))
+			continue;
+		arch_register_t const *const reg = &amd64_registers[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	assert(p == n_ins);
+
+	ir_node *const ret = new_bd_amd64_ret(dbgi, new_block, n_ins, in, reqs);
+	be_stack_record_chain(&stack_env, ret, n_amd64_ret_stack, NULL);
+	return ret;
+}
+
 static ir_node *gen_Proj_Call(ir_node *const node)
 {
 	unsigned const pn       = get_Proj_num(node);
@@ -2161,6 +2472,8 @@ static ir_node *gen_Phi(ir_node *const node)
 		req = mode == x86_mode_E
 		    ? &amd64_class_reg_req_x87
 		    : &amd64_class_reg_req_xmm;
+	} else if (mode_is_vector(mode)) {
+		req = &amd64_class_reg_req_xmm;
 	} else {
 		req = arch_memory_req;
 	}
@@ -2659,11 +2972,11 @@ ir_node *amd64_new_spill(ir_node *const value, ir_node *const after)
 	return store;
 }
 
-static ir_node *create_sse_spill(dbg_info *const dbgi, ir_node *const block,
-                                 int const arity, ir_node *const *const in,
-                                 arch_register_req_t const **const in_reqs,
-                                 x86_insn_size_t const size, amd64_op_mode_t const op_mode,
-                                 x86_addr_t const addr)
+static ir_node *create_movdqu(dbg_info *const dbgi, ir_node *const block,
+                              int const arity, ir_node *const *const in,
+                              arch_register_req_t const **const in_reqs,
+                              x86_insn_size_t const size, amd64_op_mode_t const op_mode,
+                              x86_addr_t const addr)
 {
 	(void)size; /* TODO */
 	return new_bd_amd64_movdqu(dbgi, block, arity, in, in_reqs, op_mode, addr);
@@ -2697,7 +3010,7 @@ ir_node *amd64_new_reload(ir_node *value, ir_node *spill, ir_node *before)
 		pn_res = pn_amd64_fld_res;
 	} else {
 		size   = X86_SIZE_128;
-		cons   = &create_sse_spill;
+		cons   = &create_movdqu;
 		pn_res = pn_amd64_movdqu_res;
 	}
 	ir_node *const load = cons(NULL, block, ARRAY_SIZE(in), in, reg_mem_reqs,
@@ -2732,6 +3045,7 @@ static ir_node *gen_Load(ir_node *const node)
 	assert((size_t)arity <= ARRAY_SIZE(in));
 
 	create_mov_func   const cons      =
+		mode_is_vector(mode)                                  ? &create_movdqu :
 		mode_is_float(mode)                                   ?
 			(mode == x86_mode_E ? new_bd_amd64_fld : &new_bd_amd64_movs_xmm) :
 		get_mode_size_bits(mode) < 64 && mode_is_signed(mode) ? &new_bd_amd64_movs     :
@@ -2747,7 +3061,7 @@ static ir_node *gen_Unknown(ir_node *const node)
 {
 	ir_node *const block = be_transform_nodes_block(node);
 	ir_mode *const mode  = get_irn_mode(node);
-	if (mode_is_float(mode)) {
+	if (mode_is_float(mode) || mode_is_vector(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_xmm);
 	} else if (be_mode_needs_gp_reg(mode)) {
 		return be_new_Unknown(block, &amd64_class_reg_req_gp);
@@ -2786,6 +3100,13 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 			return be_new_Proj(new_load, pn_amd64_movs_xmm_M);
 		}
 		break;
+	case iro_amd64_movdqu:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_M);
+		}
+		break;
 	case iro_amd64_movs:
 	case iro_amd64_mov_gp:
 		assert((unsigned)pn_amd64_movs_res == (unsigned)pn_amd64_mov_gp_res);
@@ -3050,6 +3371,44 @@ static ir_node *gen_compare_swap(ir_node *const node)
 	return new_bd_amd64_cmpxchg(dbgi, block, arity, in, reqs, &attr);
 }
 
+static ir_node *gen_prefetch(ir_node *const node)
+{
+	dbg_info *const dbgi     = get_irn_dbg_info(node);
+	ir_node  *const block    = be_transform_nodes_block(node);
+	ir_node  *const ptr      = get_Builtin_param(node, 0);
+	ir_node  *const mem      = get_Builtin_mem(node);
+	size_t    const n_params = get_Builtin_n_params(node);
+
+	ir_node *in[3];
+	int arity = 0;
+	x86_addr_t addr;
+	perform_address_matching(ptr, &arity, in, &addr);
+	arch_register_req_t const **const reqs = gp_am_reqs[arity];
+	in[arity++] = be_transform_node(mem);
+	assert((size_t)arity <= ARRAY_SIZE(in));
+
+	/* SSE prefetches are always available, the write hint is ignored. */
+	long const locality = n_params > 2
+		? get_Const_long(get_Builtin_param(node, 2)) : 3;
+	ir_node *new_node;
+	switch (locality) {
+	case 0:
+		new_node = new_bd_amd64_prefetchnta(dbgi, block, arity, in, reqs, addr);
+		break;
+	case 1:
+		new_node = new_bd_amd64_prefetcht2(dbgi, block, arity, in, reqs, addr);
+		break;
+	case 2:
+		new_node = new_bd_amd64_prefetcht1(dbgi, block, arity, in, reqs, addr);
+		break;
+	default:
+		new_node = new_bd_amd64_prefetcht0(dbgi, block, arity, in, reqs, addr);
+		break;
+	}
+	set_irn_pinned(new_node, get_irn_pinned(node));
+	return new_node;
+}
+
 static ir_node *gen_saturating_increment(ir_node *const node)
 {
 	dbg_info *const dbgi      = get_irn_dbg_info(node);
@@ -3130,6 +3489,8 @@ static ir_node *gen_Builtin(ir_node *const node)
 		return gen_ffs(node);
 	case ir_bk_compare_swap:
 		return gen_compare_swap(node);
+	case ir_bk_prefetch:
+		return gen_prefetch(node);
 	case ir_bk_saturating_increment:
 		return gen_saturating_increment(node);
 	case ir_bk_va_start:
@@ -3162,6 +3523,7 @@ static ir_node *gen_Proj_Builtin(ir_node *const proj)
 		}
 	case ir_bk_saturating_increment:
 		return be_new_Proj(new_node, pn_amd64_sbb_res);
+	case ir_bk_prefetch:
 	case ir_bk_va_start:
 		assert(get_Proj_num(proj) == pn_Builtin_M);
 		return new_node;
@@ -3245,6 +3607,7 @@ static void amd64_register_transformers(void)
 	be_set_transform_function(op_Mod,               gen_Mod);
 	be_set_transform_function(op_Mul,               gen_Mul);
 	be_set_transform_function(op_Mulh,              gen_Mulh);
+	be_set_transform_function(op_Mux,               gen_Mux);
 	be_set_transform_function(op_Not,               gen_Not);
 	be_set_transform_function(op_Or,                gen_Or);
 	be_set_transform_function(op_Phi,               gen_Phi);
@@ -3282,6 +3645,25 @@ static void amd64_register_transformers(void)
 	be_set_upper_bits_clean_function(op_Shrs, NULL);
 }
 
+/**
+ * Orders the reads of the incoming arguments before tail calls, which
+ * overwrite them with stack arguments.
+ */
+static void prepare_tail_calls(ir_graph *const irg)
+{
+	foreach_irn_in(get_irg_end_block(irg), i, ret) {
+		if (!is_Return(ret))
+			continue;
+		ir_node     *call;
+		x86_cconv_t *const cconv = get_tail_call_cconv(ret, &call);
+		if (cconv == NULL)
+			continue;
+		if (cconv->param_stacksize > 0)
+			x86_order_incoming_arg_reads(call);
+		x86_free_calling_convention(cconv);
+	}
+}
+
 void amd64_transform_graph(ir_graph *irg)
 {
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_TUPLES
@@ -3301,6 +3683,8 @@ void amd64_transform_graph(ir_graph *irg)
 	amd64_set_va_stack_args_param(current_cconv->va_start_addr);
 	be_add_parameter_entity_stores(irg);
 	x86_create_parameter_loads(irg, current_cconv);
+	frame_escapes = x86_frame_address_escapes(irg);
+	prepare_tail_calls(irg);
 
 	heights = heights_new(irg);
 	x86_calculate_non_address_mode_nodes(irg);
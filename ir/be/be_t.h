@@ -41,6 +41,7 @@ struct be_options_t {
 	bool do_verify;            /**< backend verify option */
 	char ilp_solver[128];      /**< the ilp solver name */
 	bool verbose_asm;          /**< dump verbose assembler */
+	bool ipra;                 /**< interprocedural register allocation */
 };
 extern be_options_t be_options;
 
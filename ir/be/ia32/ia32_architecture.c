@@ -153,6 +153,7 @@ static cpu_arch_features arch                 = cpu_generic;
 static cpu_arch_features opt_arch             = 0;
 static int               fpu_arch             = 0;
 static bool              opt_cc               = true;
+static int               opt_cc_saves         = 3;
 static bool              opt_unsafe_floatconv = false;
 
 /* instruction set architectures. */
@@ -246,6 +247,7 @@ static const lc_opt_table_entry_t ia32_architecture_options[] = {
 	LC_OPT_ENT_ENUM_INT("tune",             "optimize for instruction architecture",              &opt_arch_var),
 	LC_OPT_ENT_ENUM_INT("fpmath",           "select the floating point unit",                     &fp_unit_var),
 	LC_OPT_ENT_BOOL    ("optcc",            "optimize calling convention",                        &opt_cc),
+	LC_OPT_ENT_INT     ("private-callee-saves", "callee saved registers besides ebp of local functions", &opt_cc_saves),
 	LC_OPT_ENT_BOOL    ("unsafe_floatconv", "do unsafe floating point controlword optimizations", &opt_unsafe_floatconv),
 	LC_OPT_ENT_BOOL    ("machcode",         "output machine code instead of assembler",           &emit_machcode),
 	LC_OPT_ENT_BOOL    ("soft-float",       "equivalent to fpmath=softfloat",                     &use_softfloat),
@@ -916,6 +918,7 @@ void ia32_setup_cg_config(void)
 	c->use_bswap            = (arch & arch_mask) >= arch_i486;
 	c->use_cmpxchg          = (arch & arch_mask) != arch_i386;
 	c->optimize_cc          = opt_cc;
+	c->private_callee_saves = MAX(opt_cc_saves, 0);
 	c->use_unsafe_floatconv = opt_unsafe_floatconv;
 	c->emit_machcode        = emit_machcode;
 
@@ -83,6 +83,10 @@ typedef struct {
 	/** emit machine code instead of assembler */
 	bool emit_machcode:1;
 
+	/** number of callee saved registers besides ebp in the calling convention
+	 * of local functions */
+	unsigned private_callee_saves;
+
 	/** function alignment (a power of two in bytes) */
 	unsigned function_alignment;
 	/** alignment for labels (which are expected to be frequent jump targets) */
@@ -1047,9 +1047,10 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
  */
 static void introduce_prologue_epilogue(ir_graph *const irg, bool omit_fp)
 {
-	/* introduce epilogue for every return node */
+	/* introduce epilogue for every return node, tail calls have the same
+	 * memory and stack inputs */
 	foreach_irn_in(get_irg_end_block(irg), i, ret) {
-		assert(is_ia32_Return(ret));
+		assert(is_ia32_Return(ret) || is_ia32_TailCall(ret));
 		introduce_epilogue(ret, omit_fp);
 	}
 
@@ -1096,7 +1097,9 @@ static void ia32_before_emit(ir_graph *irg)
 	/* fix stack entity offsets */
 	be_fix_stack_nodes(irg, &ia32_registers[REG_ESP]);
 	be_birg_from_irg(irg)->non_ssa_regs = NULL;
-	unsigned const p2align = ir_platform.ia32_po2_stackalign;
+	unsigned const p2align = x86_needs_aligned_stack(irg)
+		? ir_platform.ia32_po2_stackalign
+		: log2_floor(IA32_REGISTER_SIZE);
 	be_sim_stack_pointer(irg, misalign, p2align, ia32_sp_sim);
 
 	/* fix 2-address code constraints */
@@ -1422,6 +1425,7 @@ static bool lower_for_emit(ir_graph *const irg, unsigned *const sp_is_non_ssa)
 	be_step_regalloc(irg, &ia32_regalloc_if);
 
 	ia32_before_emit(irg);
+	ia32_record_clobbers(irg);
 	return true;
 }
 
@@ -1433,7 +1437,13 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_IA32_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_ESP);
 
-	foreach_irp_irg(i, irg) {
+	if (be_options.ipra)
+		x86_ipra_init(N_IA32_REGISTERS);
+	if (ia32_cg_config.optimize_cc)
+		x86_collect_unaligned_stack_functions(IA32_REGISTER_SIZE);
+	ir_graph **const irgs = x86_get_irg_order();
+	for (size_t i = 0, n = ARR_LEN(irgs); i < n; ++i) {
+		ir_graph *const irg = irgs[i];
 		if (!lower_for_emit(irg, sp_is_non_ssa))
 			continue;
 
@@ -1443,6 +1453,9 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 
 		be_step_last(irg);
 	}
+	DEL_ARR_F(irgs);
+	x86_ipra_free();
+	x86_free_unaligned_stack_functions();
 
 	ia32_emit_thunks();
 
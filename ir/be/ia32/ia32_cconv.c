@@ -32,6 +32,14 @@ static const unsigned ignore_regs[] = {
 static const arch_register_t* const default_param_regs[] = {};
 static const arch_register_t* const float_param_regs[]   = {};
 
+/* the calling convention of local functions, whose address is not taken,
+ * passes parameters in registers */
+static const arch_register_t* const private_param_regs[] = {
+	&ia32_registers[REG_EAX],
+	&ia32_registers[REG_EDX],
+	&ia32_registers[REG_ECX],
+};
+
 static const arch_register_t* const result_regs[] = {
 	&ia32_registers[REG_EAX],
 	&ia32_registers[REG_EDX],
@@ -77,6 +85,29 @@ static const unsigned callee_saves[] = {
 };
 static unsigned default_callee_saves[BITSET_SIZE_ELEMS(N_IA32_REGISTERS)];
 
+/* callee saves of local functions besides ebp, the last ones become caller
+ * saves first */
+static const unsigned private_callee_saves_gp[] = {
+	REG_EBX,
+	REG_ESI,
+	REG_EDI,
+};
+static unsigned private_caller_saves[BITSET_SIZE_ELEMS(N_IA32_REGISTERS)];
+static unsigned private_callee_saves[BITSET_SIZE_ELEMS(N_IA32_REGISTERS)];
+
+/* the x87 stack has to be empty at calls, so it is always clobbered */
+static const unsigned x87_regs[] = {
+	REG_ST0,
+	REG_ST1,
+	REG_ST2,
+	REG_ST3,
+	REG_ST4,
+	REG_ST5,
+	REG_ST6,
+	REG_ST7,
+};
+static unsigned x87_clobbers[BITSET_SIZE_ELEMS(N_IA32_REGISTERS)];
+
 static void check_omit_fp(ir_node *node, void *env)
 {
 	/* omit-fp is not possible if:
@@ -99,15 +130,20 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 		ia32_get_irg_data(irg)->omit_fp = omit_fp;
 	}
 
+	/* all callers of a private function are known, so it may use a faster
+	 * calling convention */
 	mtp_additional_properties mtp
 		= get_method_additional_properties(function_type);
-	(void)mtp;
-	/* TODO: do something with cc_reg_param/cc_this_call */
+	bool const is_private = ia32_cg_config.optimize_cc
+	                     && (mtp & mtp_property_private)
+	                     && !is_method_variadic(function_type);
 
 	unsigned *caller_saves = rbitset_malloc(N_IA32_REGISTERS);
 	unsigned *callee_saves = rbitset_malloc(N_IA32_REGISTERS);
-	rbitset_copy(caller_saves, default_caller_saves, N_IA32_REGISTERS);
-	rbitset_copy(callee_saves, default_callee_saves, N_IA32_REGISTERS);
+	rbitset_copy(caller_saves, is_private ? private_caller_saves
+	                                      : default_caller_saves, N_IA32_REGISTERS);
+	rbitset_copy(callee_saves, is_private ? private_callee_saves
+	                                      : default_callee_saves, N_IA32_REGISTERS);
 
 	/* determine how parameters are passed */
 	unsigned            n_params           = get_method_n_params(function_type);
@@ -116,7 +152,10 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 	reg_or_stackslot_t *params             = XMALLOCNZ(reg_or_stackslot_t,
 	                                                   n_params);
 
-	unsigned n_param_regs       = ARRAY_SIZE(default_param_regs);
+	arch_register_t const *const *gp_regs = is_private ? private_param_regs
+	                                                   : default_param_regs;
+	unsigned n_param_regs       = is_private ? ARRAY_SIZE(private_param_regs)
+	                                         : ARRAY_SIZE(default_param_regs);
 	unsigned n_float_param_regs = ARRAY_SIZE(float_param_regs);
 	unsigned stack_offset       = 0;
 	for (unsigned i = 0; i < n_params; ++i) {
@@ -133,7 +172,7 @@ x86_cconv_t *ia32_decide_calling_convention(ir_type const *const function_type,
 		if (mode_is_float(mode) && float_param_regnum < n_float_param_regs) {
 			param->reg = float_param_regs[float_param_regnum++];
 		} else if (!mode_is_float(mode) && param_regnum < n_param_regs) {
-			param->reg = default_param_regs[param_regnum++];
+			param->reg = gp_regs[param_regnum++];
 		} else {
 			param->type   = param_type;
 			param->offset = stack_offset;
@@ -179,11 +218,13 @@ align_stack:;
 		++n_reg_results;
 	}
 
+	/* the callee pops the hidden pointer to the compound result unless it is
+	 * passed in a register */
 	calling_convention cc = get_method_calling_convention(function_type);
 
 	x86_cconv_t *cconv     = XMALLOCZ(x86_cconv_t);
 	cconv->sp_delta        = (cc & cc_compound_ret) && !(cc & cc_reg_param)
-	                         ? IA32_REGISTER_SIZE : 0;
+	                         && !is_private ? IA32_REGISTER_SIZE : 0;
 	cconv->parameters      = params;
 	cconv->n_parameters    = n_params;
 	cconv->param_stacksize = stack_offset;
@@ -207,12 +248,34 @@ align_stack:;
 	return cconv;
 }
 
+void ia32_record_clobbers(ir_graph *const irg)
+{
+	if (!be_options.ipra)
+		return;
+	ir_type     *const type  = get_entity_type(get_irg_entity(irg));
+	x86_cconv_t *const cconv = ia32_decide_calling_convention(type, NULL);
+	x86_ipra_record_clobbers(irg, cconv->caller_saves, x87_clobbers);
+	x86_free_calling_convention(cconv);
+}
+
 void ia32_cconv_init(void)
 {
+	be_cconv_add_regs(x87_clobbers, x87_regs, ARRAY_SIZE(x87_regs));
 	be_cconv_add_regs(default_caller_saves, caller_saves_gp, ARRAY_SIZE(caller_saves_gp));
 	be_cconv_add_regs(default_callee_saves, callee_saves, ARRAY_SIZE(callee_saves));
 	if (!ia32_cg_config.use_softfloat) {
 		be_cconv_add_regs(default_caller_saves, caller_saves_fp, ARRAY_SIZE(caller_saves_fp));
 		rbitset_set(default_callee_saves, REG_FPCW);
 	}
+
+	unsigned const n_private_callee_saves
+		= MIN(ia32_cg_config.private_callee_saves,
+		      ARRAY_SIZE(private_callee_saves_gp));
+	rbitset_copy(private_caller_saves, default_caller_saves, N_IA32_REGISTERS);
+	rbitset_copy(private_callee_saves, default_callee_saves, N_IA32_REGISTERS);
+	for (unsigned i = n_private_callee_saves;
+	     i < ARRAY_SIZE(private_callee_saves_gp); ++i) {
+		rbitset_clear(private_callee_saves, private_callee_saves_gp[i]);
+		rbitset_set(private_caller_saves, private_callee_saves_gp[i]);
+	}
 }
@@ -911,6 +911,25 @@ static void enc_call(ir_node const *const node)
 	}
 }
 
+static void enc_tail_call(ir_node const *const node)
+{
+	ir_node *const target = get_irn_n(node, n_ia32_TailCall_target);
+	if (is_ia32_Immediate(target)) {
+		x86_imm32_t const *const imm
+			= &get_ia32_immediate_attr_const(target)->imm;
+		assert(imm->kind == X86_IMM_PCREL);
+		be_emit8(0xE9);
+		x86_imm32_t const jmp_imm = {
+			.kind   = X86_IMM_PCREL,
+			.entity = imm->entity,
+			.offset = imm->offset - 4,
+		};
+		enc_relocation(&jmp_imm);
+	} else {
+		ia32_enc_unop(node, 0xFF, 4, n_ia32_TailCall_target);
+	}
+}
+
 static void enc_jmp(ir_node const *const cfop)
 {
 	be_emit8(0xE9);
@@ -1284,6 +1303,7 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_ia32_Bt,            enc_bt);
 	be_set_emitter(op_ia32_CMovcc,        enc_cmovcc);
 	be_set_emitter(op_ia32_Call,          enc_call);
+	be_set_emitter(op_ia32_TailCall,      enc_tail_call);
 	be_set_emitter(op_ia32_Const,         enc_mov_const);
 	be_set_emitter(op_ia32_Conv_I2I,      enc_conv_i2i);
 	be_set_emitter(op_ia32_CopyB_i,       enc_copybi);
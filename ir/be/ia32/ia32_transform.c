@@ -58,6 +58,7 @@ static ir_heights_t         *heights;
 static x86_immediate_kind_t  lconst_imm_kind;
 static x86_addr_variant_t    lconst_variant;
 static ir_node              *initial_va_list;
+static bool                  frame_escapes;
 
 /** we don't have a concept of aliasing registers, so enumerate them
  * manually for the asm nodes. */
@@ -4084,56 +4085,6 @@ static ir_node *gen_Proj_Proj_Start(ir_node *node)
 	return be_get_Start_proj(irg, param->reg);
 }
 
-static ir_node *gen_Return(ir_node *node)
-{
-	ir_graph *irg       = get_irn_irg(node);
-	ir_node  *new_block = be_transform_nodes_block(node);
-	dbg_info *dbgi      = get_irn_dbg_info(node);
-	ir_node  *mem       = get_Return_mem(node);
-	ir_node  *new_mem   = be_transform_node(mem);
-	ir_node  *sp        = get_initial_sp(irg);
-	unsigned  n_res     = get_Return_n_ress(node);
-	x86_cconv_t    *cconv = current_cconv;
-
-	/* estimate number of return values */
-	unsigned       p              = n_ia32_Return_first_result;
-	unsigned const n_callee_saves = rbitset_popcount(cconv->callee_saves, N_IA32_REGISTERS);
-	unsigned const n_ins          = p + n_res + n_callee_saves;
-
-	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
-	ir_node **in = ALLOCAN(ir_node*, n_ins);
-
-	in[n_ia32_Return_mem]   = new_mem;
-	reqs[n_ia32_Return_mem] = arch_memory_req;
-
-	in[n_ia32_Return_stack]   = sp;
-	reqs[n_ia32_Return_stack] = ia32_registers[REG_ESP].single_req;
-
-	/* result values */
-	for (size_t i = 0; i < n_res; ++i) {
-		ir_node                  *res_value     = get_Return_res(node, i);
-		ir_node                  *new_res_value = be_transform_node(res_value);
-		const reg_or_stackslot_t *slot          = &current_cconv->results[i];
-		in[p]   = new_res_value;
-		reqs[p] = slot->reg->single_req;
-		++p;
-	}
-	/* callee saves */
-	for (unsigned i = 0; i < N_IA32_REGISTERS; ++i) {
-		if (!rbitset_is_set(cconv->callee_saves, i))
-			continue;
-		arch_register_t const *const reg = &ia32_registers[i];
-		in[p]   = be_get_Start_proj(irg, reg);
-		reqs[p] = reg->single_req;
-		++p;
-	}
-	assert(p == n_ins);
-
-	ir_node *const ret = new_bd_ia32_Return(dbgi, new_block, n_ins, in, reqs, current_cconv->sp_delta);
-	be_stack_record_chain(&stack_env, ret, n_ia32_Return_stack, NULL);
-	return ret;
-}
-
 static ir_node *gen_Alloc(ir_node *node)
 {
 	dbg_info *const dbgi      = get_irn_dbg_info(node);
@@ -4758,6 +4709,7 @@ static ir_node *gen_Call(ir_node *node)
 	x86_cconv_t                *const cconv    = ia32_decide_calling_convention(type, NULL);
 	ir_graph                   *const irg      = get_irn_irg(node);
 	unsigned                          in_arity = n_ia32_Call_first_argument;
+	x86_ipra_restrict_caller_saves(cconv, callee);
 	bool                        const has_fpcw = !ia32_cg_config.use_softfloat;
 	bool                        const is_plt   = callee_is_plt(callee);
 	unsigned                    const n_ins
@@ -4908,6 +4860,181 @@ static ir_node *gen_Call(ir_node *node)
 	return res;
 }
 
+/**
+ * Returns the calling convention of the Call whose results are returned by
+ * @p ret if the call can become a jump to the callee, NULL otherwise.
+ */
+static x86_cconv_t *get_tail_call_cconv(ir_node const *const ret,
+                                        ir_node **const call_out)
+{
+	if (frame_escapes)
+		return NULL;
+	ir_node *const call = x86_get_tail_call(ret);
+	if (call == NULL)
+		return NULL;
+	/* PLT calls need the GOT address in the callee saved ebx and the JIT
+	 * relocations only support direct calls */
+	ir_node *const callee = get_Call_ptr(call);
+	if (callee_is_plt(callee) || (ia32_cg_config.emit_machcode
+	    && (is_Address(callee) || be_is_Relocation(callee))))
+		return NULL;
+
+	x86_cconv_t *const cconv
+		= ia32_decide_calling_convention(get_Call_type(call), NULL);
+	/* the stack arguments have to fit into our incoming argument area, the
+	 * callee has to pop as much as we do and preserve our callee saves */
+	if (cconv->param_stacksize > current_cconv->param_stacksize
+	 || cconv->sp_delta != current_cconv->sp_delta
+	 || !rbitset_contains(current_cconv->callee_saves, cconv->callee_saves,
+	                      N_IA32_REGISTERS)) {
+		x86_free_calling_convention(cconv);
+		return NULL;
+	}
+	*call_out = call;
+	return cconv;
+}
+
+/**
+ * Transforms the Return @p node of the results of @p call into a jump to the
+ * callee after the frame is released.  Stack arguments are passed in our
+ * incoming argument area.
+ */
+static ir_node *gen_tail_call(ir_node *const node, ir_node *const call,
+                              x86_cconv_t const *const cconv)
+{
+	ir_graph          *const irg       = get_irn_irg(node);
+	ir_node           *const new_block = be_transform_nodes_block(node);
+	dbg_info          *const dbgi      = get_irn_dbg_info(call);
+	ir_node           *const callee    = get_Call_ptr(call);
+	unsigned           const n_params  = get_Call_n_params(call);
+	x86_cconv_t const *const caller    = current_cconv;
+
+	unsigned const n_callee_saves
+		= rbitset_popcount(caller->callee_saves, N_IA32_REGISTERS);
+	unsigned const max_ins
+		= n_ia32_TailCall_first_argument + cconv->n_param_regs + n_callee_saves;
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, max_ins);
+	ir_node **const in    = ALLOCAN(ir_node*, max_ins);
+	unsigned        arity = n_ia32_TailCall_first_argument;
+
+	in[n_ia32_TailCall_stack]   = get_initial_sp(irg);
+	reqs[n_ia32_TailCall_stack] = ia32_registers[REG_ESP].single_req;
+
+	ir_node *target = try_create_Immediate(callee, 'i');
+	if (target != NULL)
+		adjust_pc_relative_relocation(target);
+	else
+		target = be_transform_node(callee);
+	in[n_ia32_TailCall_target]   = target;
+	reqs[n_ia32_TailCall_target] = &ia32_class_reg_req_gp;
+
+	ir_node  *const mem        = be_transform_node(get_Call_mem(call));
+	ir_node  *const frame      = get_irg_frame(irg);
+	ir_node **const sync_ins   = ALLOCAN(ir_node*, n_params);
+	unsigned        sync_arity = 0;
+	for (unsigned p = 0; p < n_params; ++p) {
+		ir_node                  *const value = get_Call_param(call, p);
+		reg_or_stackslot_t const *const param = &cconv->parameters[p];
+		if (param->reg != NULL) {
+			in[arity]   = be_transform_node(value);
+			reqs[arity] = param->reg->single_req;
+			++arity;
+			continue;
+		}
+
+		/* store the value into the incoming argument area */
+		x86_address_t const store_addr = {
+			.variant = X86_ADDR_BASE,
+			.base    = frame,
+			.index   = noreg_GP,
+			.mem     = mem,
+			.imm     = {
+				.kind   = X86_IMM_FRAMEOFFSET,
+				.offset = param->offset + IA32_REGISTER_SIZE,
+			},
+		};
+		ir_node *const store = create_store(dbgi, new_block, value, &store_addr);
+		sync_ins[sync_arity++] = create_proj_for_store(store, pn_Store_M);
+	}
+	in[n_ia32_TailCall_mem]   = sync_arity == 0 ? mem
+		: be_make_Sync(new_block, sync_arity, sync_ins);
+	reqs[n_ia32_TailCall_mem] = arch_memory_req;
+
+	/* callee saves */
+	for (unsigned i = 0; i < N_IA32_REGISTERS; ++i) {
+		if (!rbitset_is_set(caller->callee_saves, i))
+			continue;
+		arch_register_t const *const reg = &ia32_registers[i];
+		in[arity]   = be_get_Start_proj(irg, reg);
+		reqs[arity] = reg->single_req;
+		++arity;
+	}
+	assert(arity <= max_ins);
+
+	ir_node *const jmp = new_bd_ia32_TailCall(dbgi, new_block, arity, in, reqs);
+	be_stack_record_chain(&stack_env, jmp, n_ia32_TailCall_stack, NULL);
+	x86_ipra_add_tail_call(cconv, callee);
+	return jmp;
+}
+
+static ir_node *gen_Return(ir_node *node)
+{
+	ir_node     *call;
+	x86_cconv_t *const callee_cconv = get_tail_call_cconv(node, &call);
+	if (callee_cconv != NULL) {
+		ir_node *const jmp = gen_tail_call(node, call, callee_cconv);
+		x86_free_calling_convention(callee_cconv);
+		return jmp;
+	}
+
+	ir_graph *irg       = get_irn_irg(node);
+	ir_node  *new_block = be_transform_nodes_block(node);
+	dbg_info *dbgi      = get_irn_dbg_info(node);
+	ir_node  *mem       = get_Return_mem(node);
+	ir_node  *new_mem   = be_transform_node(mem);
+	ir_node  *sp        = get_initial_sp(irg);
+	unsigned  n_res     = get_Return_n_ress(node);
+	x86_cconv_t    *cconv = current_cconv;
+
+	/* estimate number of return values */
+	unsigned       p              = n_ia32_Return_first_result;
+	unsigned const n_callee_saves = rbitset_popcount(cconv->callee_saves, N_IA32_REGISTERS);
+	unsigned const n_ins          = p + n_res + n_callee_saves;
+
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
+	ir_node **in = ALLOCAN(ir_node*, n_ins);
+
+	in[n_ia32_Return_mem]   = new_mem;
+	reqs[n_ia32_Return_mem] = arch_memory_req;
+
+	in[n_ia32_Return_stack]   = sp;
+	reqs[n_ia32_Return_stack] = ia32_registers[REG_ESP].single_req;
+
+	/* result values */
+	for (size_t i = 0; i < n_res; ++i) {
+		ir_node                  *res_value     = get_Return_res(node, i);
+		ir_node                  *new_res_value = be_transform_node(res_value);
+		const reg_or_stackslot_t *slot          = &current_cconv->results[i];
+		in[p]   = new_res_value;
+		reqs[p] = slot->reg->single_req;
+		++p;
+	}
+	/* callee saves */
+	for (unsigned i = 0; i < N_IA32_REGISTERS; ++i) {
+		if (!rbitset_is_set(cconv->callee_saves, i))
+			continue;
+		arch_register_t const *const reg = &ia32_registers[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	assert(p == n_ins);
+
+	ir_node *const ret = new_bd_ia32_Return(dbgi, new_block, n_ins, in, reqs, current_cconv->sp_delta);
+	be_stack_record_chain(&stack_env, ret, n_ia32_Return_stack, NULL);
+	return ret;
+}
+
 static ir_node *gen_Proj_Call(ir_node *node)
 {
 	unsigned pn       = get_Proj_num(node);
@@ -5583,6 +5710,25 @@ static void ia32_pretransform_node(ir_graph *irg)
 }
 
 /* do the transformation */
+/**
+ * Orders the reads of the incoming arguments before tail calls, which
+ * overwrite them with stack arguments.
+ */
+static void prepare_tail_calls(ir_graph *const irg)
+{
+	foreach_irn_in(get_irg_end_block(irg), i, ret) {
+		if (!is_Return(ret))
+			continue;
+		ir_node     *call;
+		x86_cconv_t *const cconv = get_tail_call_cconv(ret, &call);
+		if (cconv == NULL)
+			continue;
+		if (cconv->param_stacksize > 0)
+			x86_order_incoming_arg_reads(call);
+		x86_free_calling_convention(cconv);
+	}
+}
+
 void ia32_transform_graph(ir_graph *irg)
 {
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
@@ -5618,6 +5764,8 @@ void ia32_transform_graph(ir_graph *irg)
 	x86_layout_param_entities(irg, current_cconv, IA32_REGISTER_SIZE);
 	be_add_parameter_entity_stores(irg);
 	x86_create_parameter_loads(irg, current_cconv);
+	frame_escapes = x86_frame_address_escapes(irg);
+	prepare_tail_calls(irg);
 
 	be_timer_push(T_HEIGHTS);
 	heights = heights_new(irg);
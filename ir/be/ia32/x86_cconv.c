@@ -10,13 +10,37 @@
  */
 #include "x86_cconv.h"
 
+#include "array.h"
+#include "bearch.h"
+#include "besched.h"
 #include "betranshlp.h"
 #include "bevarargs.h"
+#include "irdom.h"
 #include "iredges_t.h"
 #include "irgmod.h"
+#include "irgwalk.h"
 #include "irnode_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "pmap.h"
+#include "pset.h"
+#include "raw_bitset.h"
+#include "typerep.h"
+#include "util.h"
 #include <stdlib.h>
 
+/** Registers clobbered by compiled local functions, NULL unless
+ * interprocedural register allocation is enabled. */
+static pmap          *ipra_clobbers;
+static struct obstack ipra_obst;
+static unsigned       ipra_n_registers;
+/** Registers clobbered by the tail callees of the current function. */
+static unsigned      *ipra_tail_clobbers;
+
+/** Private functions which need no aligned stack pointer, NULL unless
+ * computed. */
+static pset          *unaligned_stack_entities;
+
 void x86_free_calling_convention(x86_cconv_t *cconv)
 {
 	free(cconv->parameters);
@@ -83,3 +107,400 @@ void x86_layout_param_entities(ir_graph *const irg, x86_cconv_t *const cconv,
 		cconv->va_start_addr = be_make_va_start_entity(frame_type, offset);
 	}
 }
+
+/** Checks whether the address @p addr is used other than for loads and stores. */
+static bool address_escapes(ir_node const *const addr)
+{
+	foreach_out_edge(addr, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		switch (get_irn_opcode(user)) {
+		case iro_Load:
+			break;
+		case iro_Store:
+			if (get_edge_src_pos(edge) != n_Store_ptr)
+				return true;
+			break;
+		case iro_Add:
+		case iro_Sub:
+		case iro_Member:
+		case iro_Sel:
+			if (mode_is_reference(get_irn_mode(user)) && address_escapes(user))
+				return true;
+			break;
+		default:
+			return true;
+		}
+	}
+	return false;
+}
+
+static void check_frame_address(ir_node *const node, void *const env)
+{
+	bool *const escapes = (bool*)env;
+	if (is_Alloc(node)
+	 || (is_Builtin(node) && get_Builtin_kind(node) == ir_bk_frame_address)) {
+		*escapes = true;
+	} else if (is_Member(node)) {
+		ir_node *const frame = get_irg_frame(get_irn_irg(node));
+		if (get_Member_ptr(node) == frame && address_escapes(node))
+			*escapes = true;
+	}
+}
+
+bool x86_frame_address_escapes(ir_graph *const irg)
+{
+	bool escapes = false;
+	irg_walk_graph(irg, NULL, check_frame_address, &escapes);
+	return escapes;
+}
+
+ir_node *x86_get_tail_call(ir_node const *const ret)
+{
+	ir_node *const mem = get_Return_mem(ret);
+	if (!is_Proj(mem) || get_irn_n_edges(mem) != 1)
+		return NULL;
+	ir_node *const call = get_Proj_pred(mem);
+	if (!is_Call(call) || get_nodes_block(call) != get_nodes_block(ret)
+	 || ir_throws_exception(call))
+		return NULL;
+
+	ir_type *const type = get_Call_type(call);
+	if (is_method_variadic(type)
+	 || (get_method_additional_properties(type) & mtp_property_returns_twice))
+		return NULL;
+	for (size_t i = 0, n = get_method_n_params(type); i < n; ++i) {
+		if (is_aggregate_type(get_method_param_type(type, i)))
+			return NULL;
+	}
+
+	/* the results of the call have to be returned unchanged */
+	ir_graph *const irg         = get_irn_irg(ret);
+	ir_type  *const caller_type = get_entity_type(get_irg_entity(irg));
+	size_t    const n_ress      = get_Return_n_ress(ret);
+	if (get_method_n_ress(type) != n_ress)
+		return NULL;
+	for (size_t i = 0; i < n_ress; ++i) {
+		ir_node *const res = get_Return_res(ret, i);
+		if (!is_Proj(res) || get_Proj_num(res) != i
+		 || get_irn_n_edges(res) != 1)
+			return NULL;
+		ir_node *const ress = get_Proj_pred(res);
+		if (!is_Proj(ress) || get_Proj_pred(ress) != call)
+			return NULL;
+		ir_mode *const mode = get_type_mode(get_method_res_type(type, i));
+		if (mode != get_type_mode(get_method_res_type(caller_type, i)))
+			return NULL;
+	}
+	return call;
+}
+
+/** Collects the Loads from the address @p addr. */
+static void collect_loads(ir_node *const addr, ir_node ***const loads)
+{
+	foreach_out_edge(addr, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (is_Load(user))
+			ARR_APP1(ir_node*, *loads, user);
+		else if (mode_is_reference(get_irn_mode(user)))
+			collect_loads(user, loads);
+	}
+}
+
+void x86_order_incoming_arg_reads(ir_node *const call)
+{
+	ir_graph *const irg   = get_irn_irg(call);
+	ir_node  *const frame = get_irg_frame(irg);
+	ir_node **loads       = NEW_ARR_F(ir_node*, 0);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	foreach_out_edge(frame, edge) {
+		ir_node *const member = get_edge_src_irn(edge);
+		if (is_Member(member) && is_parameter_entity(get_Member_entity(member)))
+			collect_loads(member, &loads);
+	}
+
+	ir_node  *const block   = get_nodes_block(call);
+	size_t    const n_loads = ARR_LEN(loads);
+	ir_node **const in      = ALLOCAN(ir_node*, n_loads + 1);
+	int             n_in    = 0;
+	in[n_in++] = get_Call_mem(call);
+	for (size_t i = 0; i < n_loads; ++i) {
+		ir_node *const load = loads[i];
+		/* a floating Load could be rematerialized after the stores */
+		set_irn_pinned(load, op_pin_state_pinned);
+		/* the memory of other Loads is not available at the call, but they
+		 * are executed before its block is entered */
+		if (!block_dominates(get_nodes_block(load), block))
+			continue;
+		ir_node *mem = get_Proj_for_pn(load, pn_Load_M);
+		if (mem == NULL)
+			mem = new_r_Proj(load, mode_M, pn_Load_M);
+		in[n_in++] = mem;
+	}
+	if (n_in > 1)
+		set_Call_mem(call, new_r_Sync(block, n_in, in));
+	DEL_ARR_F(loads);
+}
+
+void x86_ipra_init(unsigned const n_registers)
+{
+	assert(ipra_clobbers == NULL);
+	ipra_clobbers    = pmap_create();
+	ipra_n_registers = n_registers;
+	obstack_init(&ipra_obst);
+	ipra_tail_clobbers = rbitset_obstack_alloc(&ipra_obst, n_registers);
+}
+
+void x86_ipra_free(void)
+{
+	if (ipra_clobbers == NULL)
+		return;
+	pmap_destroy(ipra_clobbers);
+	obstack_free(&ipra_obst, NULL);
+	ipra_clobbers      = NULL;
+	ipra_tail_clobbers = NULL;
+}
+
+static void collect_callees(ir_node *const node, void *const env)
+{
+	if (!is_Call(node))
+		return;
+	ir_node const *const ptr = get_Call_ptr(node);
+	if (!is_Address(ptr))
+		return;
+	ir_graph *const callee = get_entity_irg(get_Address_entity(ptr));
+	if (callee != NULL) {
+		ir_graph ***const callees = (ir_graph***)env;
+		ARR_APP1(ir_graph*, *callees, callee);
+	}
+}
+
+/** Appends @p irg to @p order after the graphs it calls directly. */
+static void append_bottom_up(ir_graph *const irg, pset *const visited,
+                             ir_graph ***const order)
+{
+	if (pset_find_ptr(visited, irg))
+		return;
+	pset_insert_ptr(visited, irg);
+
+	ir_graph **callees = NEW_ARR_F(ir_graph*, 0);
+	irg_walk_graph(irg, NULL, collect_callees, &callees);
+	for (size_t i = 0, n = ARR_LEN(callees); i < n; ++i)
+		append_bottom_up(callees[i], visited, order);
+	DEL_ARR_F(callees);
+	ARR_APP1(ir_graph*, *order, irg);
+}
+
+ir_graph **x86_get_irg_order(void)
+{
+	ir_graph **order = NEW_ARR_F(ir_graph*, 0);
+	if (ipra_clobbers == NULL) {
+		foreach_irp_irg(i, irg) {
+			ARR_APP1(ir_graph*, order, irg);
+		}
+		return order;
+	}
+
+	pset *const visited = pset_new_ptr_default();
+	foreach_irp_irg(i, irg) {
+		append_bottom_up(irg, visited, &order);
+	}
+	del_pset(visited);
+	return order;
+}
+
+/** Returns the registers clobbered by a call of @p callee or NULL if they are
+ * not known. */
+static unsigned const *get_callee_clobbers(ir_node const *const callee)
+{
+	if (ipra_clobbers == NULL || !is_Address(callee))
+		return NULL;
+	return pmap_get(unsigned const, ipra_clobbers, get_Address_entity(callee));
+}
+
+void x86_ipra_restrict_caller_saves(x86_cconv_t *const cconv,
+                                    ir_node const *const callee)
+{
+	unsigned const *const clobbers = get_callee_clobbers(callee);
+	if (clobbers != NULL)
+		rbitset_and(cconv->caller_saves, clobbers, ipra_n_registers);
+}
+
+void x86_ipra_add_tail_call(x86_cconv_t const *const cconv,
+                            ir_node const *const callee)
+{
+	if (ipra_clobbers == NULL)
+		return;
+	unsigned const *const clobbers = get_callee_clobbers(callee);
+	rbitset_or(ipra_tail_clobbers, clobbers != NULL ? clobbers
+	           : cconv->caller_saves, ipra_n_registers);
+}
+
+static void collect_clobbers(ir_node *const block, void *const env)
+{
+	unsigned *const clobbers = (unsigned*)env;
+	sched_foreach(block, node) {
+		be_foreach_out(node, o) {
+			arch_register_t const *const reg = arch_get_irn_register_out(node, o);
+			if (reg != NULL)
+				rbitset_set(clobbers, reg->global_index);
+			/* outputs without a user, e.g. the clobbers of calls, may have no
+			 * register assigned */
+			arch_register_req_t const *const req
+				= arch_get_irn_register_req_out(node, o);
+			if (req->limited != NULL) {
+				arch_register_class_t const *const cls = req->cls;
+				rbitset_foreach(req->limited, cls->n_regs, i) {
+					rbitset_set(clobbers, cls->regs[i].global_index);
+				}
+			}
+		}
+	}
+}
+
+void x86_ipra_record_clobbers(ir_graph *const irg,
+                              unsigned const *const may_clobber,
+                              unsigned const *const fixed)
+{
+	if (ipra_clobbers == NULL)
+		return;
+	ir_entity *const entity = get_irg_entity(irg);
+	if (!entity_is_externally_visible(entity)) {
+		unsigned *const clobbers
+			= rbitset_duplicate_obstack_alloc(&ipra_obst, ipra_tail_clobbers,
+			                                  ipra_n_registers);
+		irg_block_walk_graph(irg, NULL, collect_clobbers, clobbers);
+		rbitset_or(clobbers, fixed, ipra_n_registers);
+		rbitset_and(clobbers, may_clobber, ipra_n_registers);
+		pmap_insert(ipra_clobbers, entity, clobbers);
+	}
+	rbitset_clear_all(ipra_tail_clobbers, ipra_n_registers);
+}
+
+typedef struct stack_align_env_t {
+	bool        needs_alignment;
+	ir_entity **callees;
+} stack_align_env_t;
+
+static void check_stack_alignment(ir_node *const node, void *const data)
+{
+	stack_align_env_t *const env = (stack_align_env_t*)data;
+	switch (get_irn_opcode(node)) {
+	case iro_Alloc:
+	case iro_ASM:
+	case iro_Builtin:
+	case iro_Free:
+		env->needs_alignment = true;
+		return;
+	case iro_Call: {
+		ir_node const *const ptr = get_Call_ptr(node);
+		if (is_Address(ptr))
+			ARR_APP1(ir_entity*, env->callees, get_Address_entity(ptr));
+		else
+			env->needs_alignment = true;
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+/**
+ * Checks whether the frame of @p irg contains an entity which needs more
+ * than @p register_size alignment.
+ */
+static bool has_overaligned_frame_entity(ir_graph *const irg,
+                                         unsigned const register_size)
+{
+	ir_type *const frame = get_irg_frame_type(irg);
+	for (size_t i = 0, n = get_compound_n_members(frame); i < n; ++i) {
+		ir_entity *const member = get_compound_member(frame, i);
+		if (is_parameter_entity(member))
+			continue;
+		unsigned const alignment = MAX(get_entity_alignment(member),
+		                               get_type_alignment(get_entity_type(member)));
+		if (alignment > register_size)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the callees of the private function @p irg if it needs no aligned
+ * stack pointer, assuming its callees do not need one either, NULL
+ * otherwise.
+ */
+static ir_entity **get_unaligned_stack_callees(ir_graph *const irg,
+                                               unsigned const register_size)
+{
+	ir_entity *const entity = get_irg_entity(irg);
+	if (!(get_method_additional_properties(get_entity_type(entity))
+	      & mtp_property_private)
+	 || (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
+	 || has_overaligned_frame_entity(irg, register_size))
+		return NULL;
+
+	stack_align_env_t env = {
+		.needs_alignment = false,
+		.callees         = NEW_ARR_F(ir_entity*, 0),
+	};
+	irg_walk_graph(irg, NULL, check_stack_alignment, &env);
+	if (env.needs_alignment) {
+		DEL_ARR_F(env.callees);
+		return NULL;
+	}
+	return env.callees;
+}
+
+void x86_collect_unaligned_stack_functions(unsigned const register_size)
+{
+	assert(unaligned_stack_entities == NULL);
+	unaligned_stack_entities = pset_new_ptr_default();
+	pmap *const callees = pmap_create();
+	foreach_irp_irg(i, irg) {
+		ir_entity **const irg_callees
+			= get_unaligned_stack_callees(irg, register_size);
+		if (irg_callees == NULL)
+			continue;
+		ir_entity *const entity = get_irg_entity(irg);
+		pset_insert_ptr(unaligned_stack_entities, entity);
+		pmap_insert(callees, entity, irg_callees);
+	}
+
+	/* a function calling a function which needs an aligned stack pointer has
+	 * to align the stack pointer itself */
+	for (bool changed = true; changed;) {
+		changed = false;
+		foreach_pmap(callees, entry) {
+			ir_entity const *const entity = (ir_entity const*)entry->key;
+			if (!pset_find_ptr(unaligned_stack_entities, entity))
+				continue;
+			ir_entity **const irg_callees = (ir_entity**)entry->value;
+			for (size_t i = 0, n = ARR_LEN(irg_callees); i < n; ++i) {
+				if (!pset_find_ptr(unaligned_stack_entities, irg_callees[i])) {
+					pset_remove_ptr(unaligned_stack_entities, entity);
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	foreach_pmap(callees, entry) {
+		DEL_ARR_F((ir_entity**)entry->value);
+	}
+	pmap_destroy(callees);
+}
+
+void x86_free_unaligned_stack_functions(void)
+{
+	if (unaligned_stack_entities == NULL)
+		return;
+	del_pset(unaligned_stack_entities);
+	unaligned_stack_entities = NULL;
+}
+
+bool x86_needs_aligned_stack(ir_graph const *const irg)
+{
+	return unaligned_stack_entities == NULL
+	    || !pset_find_ptr(unaligned_stack_entities, get_irg_entity(irg));
+}
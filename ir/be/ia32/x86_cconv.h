@@ -56,4 +56,82 @@ void x86_create_parameter_loads(ir_graph *irg, const x86_cconv_t *cconv);
 void x86_layout_param_entities(ir_graph *irg, x86_cconv_t *cconv,
                                int params_offset);
 
+/**
+ * Checks whether the address of an entity in the stack frame of @p irg may
+ * escape.  Calls in such a graph must not become tail calls, as the callee
+ * might access the released frame.
+ */
+bool x86_frame_address_escapes(ir_graph *irg);
+
+/**
+ * Returns the Call whose results and memory are returned by the Return
+ * @p ret if it may become a jump to the callee, NULL otherwise.  The backend
+ * still has to check that the stack arguments of the callee fit into the
+ * incoming argument area of the caller.
+ */
+ir_node *x86_get_tail_call(ir_node const *ret);
+
+/**
+ * Makes the memory of the tail call @p call depend on all reads of the
+ * incoming argument area, which is overwritten by its stack arguments.
+ */
+void x86_order_incoming_arg_reads(ir_node *call);
+
+/**
+ * Enables interprocedural register allocation: calls of local functions
+ * compiled before only clobber the registers these functions write.
+ * @p n_registers is the number of registers of the backend.
+ */
+void x86_ipra_init(unsigned n_registers);
+
+/**
+ * Frees the clobber sets recorded for interprocedural register allocation.
+ */
+void x86_ipra_free(void);
+
+/**
+ * Returns the graphs of the program in the order they should be compiled in.
+ * With interprocedural register allocation callees come before their
+ * callers, except in recursions.  The array has to be freed with DEL_ARR_F().
+ */
+ir_graph **x86_get_irg_order(void);
+
+/**
+ * Removes the registers, which the function @p callee is known not to
+ * clobber, from the caller saves of the calling convention @p cconv.
+ */
+void x86_ipra_restrict_caller_saves(x86_cconv_t *cconv, ir_node const *callee);
+
+/**
+ * Adds the registers clobbered by a tail call of @p callee with calling
+ * convention @p cconv to the clobbers of the current function.
+ */
+void x86_ipra_add_tail_call(x86_cconv_t const *cconv, ir_node const *callee);
+
+/**
+ * Records the registers clobbered by the register allocated graph @p irg, if
+ * its entity is local.  Only registers in @p may_clobber are considered,
+ * registers in @p fixed are always assumed to be clobbered.
+ */
+void x86_ipra_record_clobbers(ir_graph *irg, unsigned const *may_clobber,
+                              unsigned const *fixed);
+
+/**
+ * Determines the private functions, which call only such functions directly
+ * and do not need more than @p register_size alignment in their frame.  These
+ * functions need no aligned stack pointer, so they do not pad their frame.
+ * Has to be called before any graph is transformed.
+ */
+void x86_collect_unaligned_stack_functions(unsigned register_size);
+
+/**
+ * Frees the functions determined by x86_collect_unaligned_stack_functions().
+ */
+void x86_free_unaligned_stack_functions(void);
+
+/**
+ * Checks whether the stack pointer has to be aligned at calls in @p irg.
+ */
+bool x86_needs_aligned_stack(ir_graph const *irg);
+
 #endif
@@ -5,6 +5,7 @@
 #include "target_t.h"
 
 #include "be_t.h"
+#include "irmode_t.h"
 #include "iropt_t.h"
 #include "irtools.h"
 #include "isas.h"
@@ -142,6 +143,22 @@ int ir_target_fast_unaligned_memaccess(void)
 	return ir_target.fast_unaligned_memaccess;
 }
 
+unsigned ir_target_vector_size(void)
+{
+	assert(ir_target.isa_initialized);
+	return ir_target.vector_size;
+}
+
+bool ir_target_is_vector_element_mode(ir_mode *const mode)
+{
+	if (!mode_is_int(mode) && !mode_is_float(mode))
+		return false;
+	unsigned const size        = get_mode_size_bytes(mode);
+	unsigned const vector_size = ir_target.vector_size;
+	return size != (unsigned)-1 && size != 0 && vector_size % size == 0
+	    && vector_size / size >= 2;
+}
+
 int ir_target_supports_pic(void)
 {
 	return ir_target.isa->pic_supported;
@@ -21,6 +21,7 @@ typedef struct target_info_t {
 	char const            *experimental;
 	arch_allow_ifconv_func allow_ifconv;
 	ir_mode               *mode_float_arithmetic;
+	unsigned               vector_size;
 	bool isa_initialized          : 1;
 	bool fast_unaligned_memaccess : 1;
 	ENUMBF(float_int_conversion_overflow_style_t) float_int_overflow : 2;
@@ -40,6 +41,12 @@ static inline bool ir_is_cpu_x86_32(char const *const cpu)
 	    && cpu[1] >= '3' && cpu[1] <= '7';
 }
 
+/**
+ * Checks whether values of @p mode can be the elements of vectors of the
+ * target, at least two of them filling a vector register.
+ */
+bool ir_target_is_vector_element_mode(ir_mode *mode);
+
 void finish_target(void);
 
 #endif
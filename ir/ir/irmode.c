@@ -34,6 +34,9 @@ static bool modes_are_equal(const ir_mode *m, const ir_mode *n)
 		return false;
 	if (m->sort == irms_auxiliary || m->sort == irms_data)
 		return streq(m->name, n->name);
+	if (m->sort == irms_vector)
+		return m->element_mode == n->element_mode
+		    && m->n_elements   == n->n_elements;
 	return m->arithmetic        == n->arithmetic
 	    && m->size              == n->size
 	    && m->sign              == n->sign
@@ -206,6 +209,30 @@ ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size)
 	return register_mode(result);
 }
 
+ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                         unsigned n_elements)
+{
+	if (!mode_is_int(element_mode) && !mode_is_float(element_mode))
+		panic("vector elements must have integer or float mode");
+	if (n_elements < 2)
+		panic("vector modes need at least 2 elements");
+
+	unsigned bit_size = get_mode_size_bits(element_mode) * n_elements;
+	ir_mode *result = alloc_mode(name, irms_vector, irma_none, bit_size, 0, 0);
+	result->element_mode = element_mode;
+	result->n_elements   = n_elements;
+	return register_mode(result);
+}
+
+ir_mode *get_vector_mode(ir_mode *const element_mode,
+                         unsigned const n_elements)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "V%u%s", n_elements,
+	         get_mode_name(element_mode));
+	return new_vector_mode(name, element_mode, n_elements);
+}
+
 static ir_mode *new_non_data_mode(const char *name)
 {
 	ir_mode *result = alloc_mode(name, irms_auxiliary, irma_none, 0, 0, 0);
@@ -310,6 +337,11 @@ int (mode_is_data)(const ir_mode *mode)
 	return mode_is_data_(mode);
 }
 
+int (mode_is_vector)(const ir_mode *mode)
+{
+	return mode_is_vector_(mode);
+}
+
 unsigned (get_mode_mantissa_size)(const ir_mode *mode)
 {
 	return get_mode_mantissa_size_(mode);
@@ -358,6 +390,7 @@ int smaller_mode(const ir_mode *sm, const ir_mode *lm)
 
 		case irms_auxiliary:
 		case irms_data:
+		case irms_vector:
 		case irms_internal_boolean:
 		case irms_reference:
 		case irms_float_number:
@@ -373,6 +406,7 @@ int smaller_mode(const ir_mode *sm, const ir_mode *lm)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 	case irms_reference:
 		/* do exist machines out there with different pointer lengths ?*/
@@ -430,6 +464,18 @@ void set_reference_offset_mode(ir_mode *ref_mode, ir_mode *int_mode)
 	ref_mode->offset_mode = int_mode;
 }
 
+ir_mode *get_vector_element_mode(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->element_mode;
+}
+
+unsigned get_vector_n_elements(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return mode->n_elements;
+}
+
 void init_mode(void)
 {
 	obstack_init(&modes);
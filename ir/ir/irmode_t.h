@@ -30,6 +30,7 @@
 #define mode_is_reference(mode)        mode_is_reference_(mode)
 #define mode_is_num(mode)              mode_is_num_(mode)
 #define mode_is_data(mode)             mode_is_data_(mode)
+#define mode_is_vector(mode)           mode_is_vector_(mode)
 #define get_type_for_mode(mode)        get_type_for_mode_(mode)
 #define get_mode_mantissa_size(mode)   get_mode_mantissa_size_(mode)
 #define get_mode_exponent_size(mode)   get_mode_exponent_size_(mode)
@@ -50,6 +51,7 @@ typedef enum ir_mode_sort {
 	irms_reference        = 3 | irmsh_is_data,
 	irms_int_number       = 4 | irmsh_is_data | irmsh_is_num,
 	irms_float_number     = 5 | irmsh_is_data | irmsh_is_num,
+	irms_vector           = 6 | irmsh_is_data,
 } ir_mode_sort;
 
 /**
@@ -92,6 +94,10 @@ struct ir_mode {
 	/** For reference modes, a signed integer mode used to add/subtract
 	 * offsets. */
 	ir_mode            *offset_mode;
+	/** For vector modes, the mode of the elements. */
+	ir_mode            *element_mode;
+	/** For vector modes, the number of elements. */
+	unsigned            n_elements;
 };
 
 static inline ident *get_mode_ident_(const ir_mode *mode)
@@ -156,6 +162,11 @@ static inline int mode_is_data_(const ir_mode *mode)
 	return (get_mode_sort(mode) & irmsh_is_data) != 0;
 }
 
+static inline int mode_is_vector_(const ir_mode *mode)
+{
+	return get_mode_sort(mode) == irms_vector;
+}
+
 static inline ir_type *get_type_for_mode_(const ir_mode *mode)
 {
 	return mode->type;
@@ -171,6 +182,12 @@ static inline unsigned get_mode_exponent_size_(const ir_mode *mode)
 	return mode->float_desc.exponent_size;
 }
 
+/**
+ * Returns the vector mode with @p n_elements elements of @p element_mode,
+ * named after them.
+ */
+ir_mode *get_vector_mode(ir_mode *element_mode, unsigned n_elements);
+
 /** mode module initialization, call once before use of any other function **/
 void init_mode(void);
 
@@ -378,6 +378,26 @@ static int attrs_equal_Confirm(const ir_node *a, const ir_node *b)
 	return attr_a->relation == attr_b->relation;
 }
 
+/** Compares the attributes of two Switch nodes. */
+static int attrs_equal_Switch(const ir_node *a, const ir_node *b)
+{
+	const switch_attr     *attr_a  = &a->attr.switcha;
+	const switch_attr     *attr_b  = &b->attr.switcha;
+	const ir_switch_table *table_a = attr_a->table;
+	const ir_switch_table *table_b = attr_b->table;
+	if (attr_a->n_outs != attr_b->n_outs
+	 || table_a->n_entries != table_b->n_entries)
+		return false;
+	for (size_t i = 0, n = table_a->n_entries; i < n; ++i) {
+		const ir_switch_table_entry *entry_a = &table_a->entries[i];
+		const ir_switch_table_entry *entry_b = &table_b->entries[i];
+		if (entry_a->min != entry_b->min || entry_a->max != entry_b->max
+		 || entry_a->pn != entry_b->pn)
+			return false;
+	}
+	return true;
+}
+
 /** Compares the attributes of two Builtin nodes. */
 static int attrs_equal_Builtin(const ir_node *a, const ir_node *b)
 {
@@ -607,6 +627,7 @@ void firm_init_op(void)
 	set_op_attrs_equal(op_Sel,     attrs_equal_Sel);
 	set_op_attrs_equal(op_Size,    attrs_equal_typeconst);
 	set_op_attrs_equal(op_Store,   attrs_equal_Store);
+	set_op_attrs_equal(op_Switch,  attrs_equal_Switch);
 	set_op_attrs_equal(op_Unknown, attrs_equal_false);
 
 	set_op_hash(op_Address, hash_entconst);
@@ -637,11 +637,16 @@ static int verify_node_Call(const ir_node *n)
 	return fine;
 }
 
+static int mode_is_num_vector(const ir_mode *mode)
+{
+	return mode_is_num(mode) || mode_is_vector(mode);
+}
+
 static int verify_node_Add(const ir_node *n)
 {
 	bool     fine = true;
 	ir_mode *mode = get_irn_mode(n);
-	if (mode_is_num(mode)) {
+	if (mode_is_num_vector(mode)) {
 		fine &= check_mode_same_input(n, n_Add_left, "left");
 		fine &= check_mode_same_input(n, n_Add_right, "right");
 	} else if (mode_is_reference(mode)) {
@@ -659,7 +664,7 @@ static int verify_node_Add(const ir_node *n)
 			fine = false;
 		}
 	} else {
-		warn(n, "mode must be numeric or reference but is %+F", mode);
+		warn(n, "mode must be numeric, vector or reference but is %+F", mode);
 		fine = false;
 	}
 	return fine;
@@ -669,7 +674,7 @@ static int verify_node_Sub(const ir_node *n)
 {
 	bool     fine = true;
 	ir_mode *mode = get_irn_mode(n);
-	if (mode_is_num(mode)) {
+	if (mode_is_num_vector(mode)) {
 		ir_mode *mode_left = get_irn_mode(get_Sub_left(n));
 		if (mode_is_reference(mode_left)) {
 			fine &= check_input_mode(n, n_Sub_right, "right", mode_left);
@@ -696,7 +701,7 @@ static int verify_node_Minus(const ir_node *n)
 
 static int verify_node_Mul(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_num, "numeric");
+	bool fine = check_mode_func(n, mode_is_num_vector, "numeric or vector");
 	fine &= check_mode_same_input(n, n_Mul_left, "left");
 	fine &= check_mode_same_input(n, n_Mul_right, "right");
 	return fine;
@@ -743,9 +748,15 @@ static int mode_is_intb(const ir_mode *mode)
 	return mode_is_int(mode) || mode == mode_b;
 }
 
+static int mode_is_intb_vector(const ir_mode *mode)
+{
+	return mode_is_intb(mode)
+	    || (mode_is_vector(mode) && mode_is_int(get_vector_element_mode(mode)));
+}
+
 static int verify_node_And(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_vector, "int, int vector or mode_b");
 	fine &= check_mode_same_input(n, n_And_left, "left");
 	fine &= check_mode_same_input(n, n_And_right, "right");
 	return fine;
@@ -753,7 +764,7 @@ static int verify_node_And(const ir_node *n)
 
 static int verify_node_Or(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_vector, "int, int vector or mode_b");
 	fine &= check_mode_same_input(n, n_Or_left, "left");
 	fine &= check_mode_same_input(n, n_Or_right, "right");
 	return fine;
@@ -761,7 +772,7 @@ static int verify_node_Or(const ir_node *n)
 
 static int verify_node_Eor(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intb_vector, "int, int vector or mode_b");
 	fine &= check_mode_same_input(n, n_Eor_left, "left");
 	fine &= check_mode_same_input(n, n_Eor_right, "right");
 	return fine;
@@ -0,0 +1,244 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Devirtualization of method calls using the class hierarchy.
+ *
+ * A Call whose address is a Member selecting a method entity is dispatched
+ * dynamically.  The implementations which may be called are the method
+ * itself and all methods overwriting it (transitively) which have a graph,
+ * assuming that all classes of the program are known.
+ *
+ * If the receiver is an entity of class type, its dynamic class is known and
+ * the call is replaced by a direct call of the implementation for this class.
+ * If there is exactly one implementation, the call is replaced by a direct
+ * call, too.  For a small number of implementations the call is speculated:
+ *
+ *   p->m()    =>    if (p->m == A_m) A_m(p); else p->m();
+ *
+ * The direct calls are then visible for the inliner.  The remaining indirect
+ * call keeps the program correct if an implementation is not known.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "pset.h"
+#include "typerep.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Collects @p method and the methods overwriting it which have a graph. */
+static void collect_impls(ir_entity *const method, pset *const set)
+{
+	if (get_entity_irg(method) != NULL)
+		pset_insert_ptr(set, method);
+	for (size_t i = 0, n = get_entity_n_overwrittenby(method); i < n; ++i)
+		collect_impls(get_entity_overwrittenby(method, i), set);
+}
+
+/** Returns the number of nodes of the graph of @p impl. */
+static unsigned get_impl_size(ir_entity const *const impl)
+{
+	return get_irg_last_idx(get_entity_irg(impl));
+}
+
+/**
+ * Returns the implementations which may be called for @p method.  The
+ * implementation of @p method itself comes first, then the others ordered by
+ * size, so the cheapest are speculated.
+ */
+static ir_entity **get_impls(ir_entity *const method)
+{
+	pset *const set = pset_new_ptr_default();
+	collect_impls(method, set);
+	ir_entity **impls = NEW_ARR_F(ir_entity*, 0);
+	foreach_pset(set, ir_entity, impl) {
+		ARR_APP1(ir_entity*, impls, impl);
+	}
+	del_pset(set);
+
+	for (size_t i = 1, n = ARR_LEN(impls); i < n; ++i) {
+		ir_entity *const impl = impls[i];
+		size_t           j    = i;
+		for (; j > 0; --j) {
+			ir_entity *const prev = impls[j - 1];
+			if (prev == method || (impl != method
+			    && get_impl_size(prev) <= get_impl_size(impl)))
+				break;
+			impls[j] = prev;
+		}
+		impls[j] = impl;
+	}
+	return impls;
+}
+
+/**
+ * Returns the dynamic class of the object @p ptr points to if it is known,
+ * i.e. @p ptr is the address of an entity of class type.
+ */
+static ir_type *get_exact_class(ir_node const *const ptr)
+{
+	ir_entity const *entity;
+	if (is_Address(ptr))
+		entity = get_Address_entity(ptr);
+	else if (is_Member(ptr))
+		entity = get_Member_entity(ptr);
+	else
+		return NULL;
+	ir_type *const type = get_entity_type(entity);
+	return is_Class_type(type) ? type : NULL;
+}
+
+/** Moves @p node and its Projs into @p block. */
+static void move_with_projs(ir_node *const node, ir_node *const block)
+{
+	set_nodes_block(node, block);
+	if (get_irn_mode(node) != mode_T)
+		return;
+	foreach_out_edge(node, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (is_Proj(proj))
+			move_with_projs(proj, block);
+	}
+}
+
+/** Merges the value @p old of the indirect call with @p direct in @p block. */
+static void merge_value(ir_node *const block, ir_node *const direct,
+                        ir_node *const old)
+{
+	ir_node *const in[] = { direct, old };
+	ir_node *const phi  = new_r_Phi(block, ARRAY_SIZE(in), in,
+	                                get_irn_mode(old));
+	edges_reroute_except(old, phi, phi);
+}
+
+/**
+ * Calls @p target directly if the address of the indirect call @p call
+ * equals its address.
+ */
+static void speculate_call(ir_node *const call, ir_entity *const target)
+{
+	ir_graph *const irg   = get_irn_irg(call);
+	dbg_info *const dbgi  = get_irn_dbg_info(call);
+	ir_node  *const lower = part_block_edges(call);
+	ir_node  *const upper = get_nodes_block(call);
+	ir_node  *const addr  = new_r_Address(irg, target);
+	ir_node  *const cmp   = new_rd_Cmp(dbgi, upper, get_Call_ptr(call), addr,
+	                                   ir_relation_equal);
+	ir_node  *const cond  = new_rd_Cond(dbgi, upper, cmp);
+
+	ir_node *const proj_true   = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const proj_false  = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node *const true_block  = new_r_Block(irg, 1, &proj_true);
+	ir_node *const false_block = new_r_Block(irg, 1, &proj_false);
+	ir_node *const lower_in[]  = { new_r_Jmp(true_block), new_r_Jmp(false_block) };
+	set_irn_in(lower, ARRAY_SIZE(lower_in), lower_in);
+	move_with_projs(call, false_block);
+
+	ir_node *const direct = new_rd_Call(dbgi, true_block, get_Call_mem(call),
+	                                    addr, get_Call_n_params(call),
+	                                    get_Call_param_arr(call),
+	                                    get_Call_type(call));
+	foreach_out_edge_safe(call, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (!is_Proj(proj))
+			continue;
+		unsigned const pn = get_Proj_num(proj);
+		if (pn == pn_Call_M) {
+			merge_value(lower, new_r_Proj(direct, mode_M, pn_Call_M), proj);
+		} else if (pn == pn_Call_T_result) {
+			ir_node *const ress = new_r_Proj(direct, mode_T, pn_Call_T_result);
+			foreach_out_edge_safe(proj, res_edge) {
+				ir_node *const res = get_edge_src_irn(res_edge);
+				if (!is_Proj(res))
+					continue;
+				ir_node *const direct_res = new_r_Proj(ress, get_irn_mode(res),
+				                                       get_Proj_num(res));
+				merge_value(lower, direct_res, res);
+			}
+		}
+	}
+}
+
+/** Collects the Calls of methods selected by a Member. */
+static void collect_calls(ir_node *const node, void *const ctx)
+{
+	if (!is_Call(node) || ir_throws_exception(node))
+		return;
+	ir_node *const ptr = get_Call_ptr(node);
+	if (is_Member(ptr) && is_method_entity(get_Member_entity(ptr))) {
+		ir_node ***const calls = (ir_node***)ctx;
+		ARR_APP1(ir_node*, *calls, node);
+	}
+}
+
+/** Devirtualizes @p call.  Returns true if the graph was changed. */
+static bool devirtualize_call(ir_node *const call, unsigned const max_guards)
+{
+	ir_graph  *const irg    = get_irn_irg(call);
+	ir_node   *const member = get_Call_ptr(call);
+	ir_entity *const method = get_Member_entity(member);
+	ir_type   *const exact  = get_exact_class(get_Member_ptr(member));
+	ir_type   *const owner  = get_entity_owner(method);
+	if (exact != NULL && is_Class_type(owner) && is_SubClass_of(exact, owner)) {
+		ir_entity *const impl = resolve_ent_polymorphy(exact, method);
+		DB((dbg, LEVEL_1, "%+F: exact call of %+F\n", call, impl));
+		set_Call_ptr(call, new_r_Address(irg, impl));
+		return true;
+	}
+
+	ir_entity **const impls   = get_impls(method);
+	size_t      const n       = ARR_LEN(impls);
+	bool              changed = false;
+	if (n == 1) {
+		DB((dbg, LEVEL_1, "%+F: monomorphic call of %+F\n", call, impls[0]));
+		set_Call_ptr(call, new_r_Address(irg, impls[0]));
+		changed = true;
+	} else if (n > 1 && n <= max_guards + 1) {
+		for (size_t i = 0; i + 1 < n; ++i) {
+			DB((dbg, LEVEL_1, "%+F: speculative call of %+F\n", call,
+			    impls[i]));
+			speculate_call(call, impls[i]);
+		}
+		changed = true;
+	}
+	DEL_ARR_F(impls);
+	return changed;
+}
+
+void devirtualize_calls(unsigned max_guards)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.devirtualize");
+
+	ir_node **calls = NEW_ARR_F(ir_node*, 0);
+	foreach_irp_irg(i, irg) {
+		ARR_SHRINKLEN(calls, 0);
+		irg_walk_graph(irg, NULL, collect_calls, &calls);
+		if (ARR_LEN(calls) == 0)
+			continue;
+
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+		bool changed = false;
+		for (size_t c = 0, n = ARR_LEN(calls); c < n; ++c) {
+			if (devirtualize_call(calls[c], max_guards))
+				changed = true;
+		}
+		if (changed && get_irg_callee_info_state(irg) == irg_callee_info_consistent)
+			set_irg_callee_info_state(irg, irg_callee_info_inconsistent);
+		confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_NONE
+		                                    : IR_GRAPH_PROPERTIES_ALL);
+	}
+	DEL_ARR_F(calls);
+}
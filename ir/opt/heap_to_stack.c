@@ -0,0 +1,224 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Promotion of non-escaping heap allocations to the stack frame.
+ *
+ * A call of the allocation function, which behaves like malloc, with a
+ * constant size allocates an object which lives until it is freed.  If the pointer to the object never leaves
+ * the function, i.e. it is not stored, passed to a call, returned or
+ * converted to an integer, and it is only freed directly, the object may as
+ * well live in the stack frame:
+ *
+ *   p = malloc(16);               p = &frame.heap;
+ *   p->x = ...;          =>       p->x = ...;
+ *   free(p);
+ *
+ * Pointers derived by address arithmetic, Phis and Muxes are followed.  As
+ * the frame provides only one object per invocation, allocations in loops
+ * are not promoted.  The promoted objects are accessed through Member nodes
+ * of the frame, so scalar replacement may put them into registers.
+ */
+#include "debug.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "typerep.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Alignment of the memory returned by malloc-like functions. */
+#define MALLOC_ALIGNMENT 16
+
+typedef struct h2s_env_t {
+	ir_entity *alloc_func; /**< the function allocating memory */
+	ir_entity *free_func;  /**< the function freeing allocated memory */
+	unsigned   max_size;   /**< maximum size of promoted objects */
+	ir_node  **allocs;     /**< candidate allocations */
+	ir_node  **frees;      /**< frees of the current allocation */
+} h2s_env_t;
+
+/** Returns the entity called directly by @p call or NULL. */
+static ir_entity *get_callee(ir_node const *const call)
+{
+	ir_node const *const ptr = get_Call_ptr(call);
+	return is_Address(ptr) ? get_Address_entity(ptr) : NULL;
+}
+
+/** Returns the result Proj of @p call or NULL if the result is unused. */
+static ir_node *get_call_result(ir_node const *const call)
+{
+	foreach_out_edge(call, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (!is_Proj(proj) || get_Proj_num(proj) != pn_Call_T_result)
+			continue;
+		foreach_out_edge(proj, res_edge) {
+			ir_node *const res = get_edge_src_irn(res_edge);
+			if (is_Proj(res) && get_Proj_num(res) == 0)
+				return res;
+		}
+	}
+	return NULL;
+}
+
+/** Collects calls of the allocation function with a small constant size. */
+static void collect_allocs(ir_node *const node, void *const ctx)
+{
+	h2s_env_t *const env = (h2s_env_t*)ctx;
+	if (!is_Call(node) || ir_throws_exception(node)
+	 || get_Call_n_params(node) != 1 || get_callee(node) != env->alloc_func)
+		return;
+	ir_node const *const size = get_Call_param(node, 0);
+	if (!is_Const(size) || !tarval_is_long(get_Const_tarval(size)))
+		return;
+	long const n = get_Const_long(size);
+	if (n <= 0 || (unsigned long)n > env->max_size)
+		return;
+	ir_node *const block = get_nodes_block(node);
+	if (get_irn_loop(block) != get_irg_loop(get_irn_irg(node)))
+		return;
+	ARR_APP1(ir_node*, env->allocs, node);
+}
+
+/** Checks whether @p call frees the allocation @p ptr and nothing else. */
+static bool is_free(h2s_env_t const *const env, ir_node const *const call,
+                    ir_node const *const ptr)
+{
+	return env->free_func != NULL && get_callee(call) == env->free_func
+	    && get_Call_n_params(call) == 1 && get_Call_param(call, 0) == ptr
+	    && !ir_throws_exception(call);
+}
+
+/**
+ * Checks whether the pointer @p ptr derived from the allocation @p res
+ * escapes.  Frees of @p res are collected.
+ */
+static bool escapes(h2s_env_t *const env, ir_node *const ptr,
+                    ir_node const *const res)
+{
+	if (irn_visited_else_mark(ptr))
+		return false;
+
+	foreach_out_edge(ptr, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		int      const pos  = get_edge_src_pos(edge);
+		switch (get_irn_opcode(user)) {
+		case iro_Load:
+		case iro_Cmp:
+		case iro_CopyB:
+		case iro_Anchor:
+		case iro_End:
+			break;
+		case iro_Store:
+			if (pos == n_Store_value)
+				return true;
+			break;
+		case iro_Call:
+			if (ptr != res || !is_free(env, user, res))
+				return true;
+			ARR_APP1(ir_node*, env->frees, user);
+			break;
+		case iro_Add:
+		case iro_Sub:
+		case iro_Confirm:
+		case iro_Member:
+		case iro_Sel:
+		case iro_Mux:
+		case iro_Phi:
+			if (mode_is_reference(get_irn_mode(user))
+			 && escapes(env, user, res))
+				return true;
+			break;
+		default:
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Bypasses the memory of @p call, which is dead afterwards. */
+static void remove_call(ir_node *const call)
+{
+	ir_node *const mem = get_Call_mem(call);
+	foreach_out_edge_safe(call, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (is_Proj(proj) && get_Proj_num(proj) == pn_Call_M)
+			exchange(proj, mem);
+	}
+}
+
+/** Replaces the allocation @p call with result @p res by a frame entity. */
+static void promote(ir_node *const call, ir_node *const res)
+{
+	ir_graph  *const irg    = get_irn_irg(call);
+	long       const size   = get_Const_long(get_Call_param(call, 0));
+	ir_type   *const type   = new_type_array(get_type_for_mode(mode_Bu),
+	                                         (unsigned)size);
+	ir_type   *const frame  = get_irg_frame_type(irg);
+	ir_entity *const entity = new_entity(frame, id_unique("heap"), type);
+	set_entity_alignment(entity, MALLOC_ALIGNMENT);
+
+	ir_node *const member = new_rd_Member(get_irn_dbg_info(call),
+	                                      get_irg_start_block(irg),
+	                                      get_irg_frame(irg), entity);
+	exchange(res, member);
+	remove_call(call);
+}
+
+void promote_heap_allocations(ir_graph *irg, ir_entity *alloc_func,
+                              ir_entity *free_func, unsigned max_size)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.heap_to_stack");
+
+	if (alloc_func == NULL)
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	h2s_env_t env = {
+		.alloc_func = alloc_func,
+		.free_func  = free_func,
+		.max_size   = max_size,
+		.allocs     = NEW_ARR_F(ir_node*, 0),
+		.frees      = NEW_ARR_F(ir_node*, 0),
+	};
+	irg_walk_graph(irg, NULL, collect_allocs, &env);
+
+	bool changed = false;
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	for (size_t i = 0, n = ARR_LEN(env.allocs); i < n; ++i) {
+		ir_node *const call = env.allocs[i];
+		ir_node *const res  = get_call_result(call);
+		if (res == NULL)
+			continue;
+		ARR_SHRINKLEN(env.frees, 0);
+		inc_irg_visited(irg);
+		if (escapes(&env, res, res))
+			continue;
+
+		DB((dbg, LEVEL_1, "%+F: promote %+F with %zu frees\n", irg, call,
+		    ARR_LEN(env.frees)));
+		for (size_t f = 0, n_frees = ARR_LEN(env.frees); f < n_frees; ++f)
+			remove_call(env.frees[f]);
+		promote(call, res);
+		changed = true;
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+	DEL_ARR_F(env.frees);
+	DEL_ARR_F(env.allocs);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+		: IR_GRAPH_PROPERTIES_ALL);
+}
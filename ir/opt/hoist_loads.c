@@ -0,0 +1,800 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Loop-invariant memory motion driven by the loop tree.
+ *
+ * hoist_invariant_loads() visits the loops innermost first.  A Load is moved into the block
+ * entering the loop if its address is invariant and the memory SSA overlay
+ * shows that no Store, CopyB or Call inside the loop may clobber the loaded
+ * memory.  Calls are judged by the mod/ref summaries of their callees, if
+ * those have been computed.
+ *
+ * Loads which are not executed in every iteration are only hoisted if their
+ * address is known to be dereferenceable: it points into a frame or global
+ * entity or the same object is accessed before the loop anyway.
+ *
+ * promote_loop_scalars() visits the loops outermost first and promotes
+ * memory locations with an invariant address, which are stored inside the
+ * loop but not accessed by anything else there, to registers: The location
+ * is loaded in front of the loop, its value is carried by Phis and stored
+ * back on every edge leaving the loop.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "irdom.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irgmod.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "iroptimize.h"
+#include "memssa.h"
+#include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Maximum depth of address computations moved along with a Load. */
+#define MAX_ADDRESS_DEPTH 8
+
+/** A memory location promoted to a register. */
+typedef struct location_t {
+	ir_node *ptr;
+	ir_type *type;
+	ir_mode *mode;
+	ir_node *init; /**< the value loaded in front of the loop */
+} location_t;
+
+/** An edge leaving a loop. */
+typedef struct loop_exit_t {
+	ir_node *block; /**< the block outside of the loop */
+	int      pos;   /**< the predecessor index of the edge */
+	ir_node *mem;   /**< the memory on the edge or NULL if unused */
+} loop_exit_t;
+
+/** A loop with promoted memory locations. */
+typedef struct promoted_loop_t {
+	ir_node     *pre;
+	ir_node     *entry_mem;
+	size_t       first;       /**< index of the first location */
+	size_t       n_locations;
+	loop_exit_t *exits;
+} promoted_loop_t;
+
+typedef struct hoist_env_t {
+	ir_graph         *irg;
+	memssa_t         *memssa;
+	ir_node         **memops;     /**< all nodes accessing memory */
+	ir_loop          *loop;       /**< the current loop */
+	ir_node          *header;     /**< the header of the current loop */
+	ir_node          *pre;        /**< the block entering the current loop */
+	ir_node          *entry_mem;  /**< memory entering the current loop or
+	                                   NULL */
+	bool              header_safe; /**< the header is executed completely
+	                                    whenever the loop is entered */
+	bool              changed;
+	location_t       *locations;  /**< all promoted locations */
+	promoted_loop_t  *promoted;   /**< all loops with promoted locations */
+	ir_nodemap        accesses;   /**< maps accesses to promoted locations */
+} hoist_env_t;
+
+static bool is_in_loop(ir_loop const *const loop, ir_node const *const node)
+{
+	ir_node const *const block = get_block_const(node);
+	unsigned       const depth = get_loop_depth(loop);
+	for (ir_loop *l = get_irn_loop(block); l != NULL; l = get_loop_outer_loop(l)) {
+		if (l == loop)
+			return true;
+		if (get_loop_depth(l) <= depth)
+			break;
+	}
+	return false;
+}
+
+/**
+ * Checks whether @p node has the same value in all iterations of the
+ * current loop and can be computed in front of it.
+ */
+static bool is_invariant(hoist_env_t const *const env, ir_node *const node,
+                         unsigned const depth)
+{
+	if (!is_in_loop(env->loop, node))
+		return true;
+	if (depth >= MAX_ADDRESS_DEPTH || is_Phi(node)
+	 || get_irn_pinned(node) != op_pin_state_floats
+	 || get_irn_mode(node) == mode_M)
+		return false;
+	foreach_irn_in(node, i, pred) {
+		if (!is_invariant(env, pred, depth + 1))
+			return false;
+	}
+	return true;
+}
+
+static void move_invariant(hoist_env_t const *const env, ir_node *const node)
+{
+	if (!is_in_loop(env->loop, node))
+		return;
+	foreach_irn_in(node, i, pred) {
+		move_invariant(env, pred);
+	}
+	set_nodes_block(node, env->pre);
+}
+
+/**
+ * Checks whether @p ptr points into an entity of at least @p size bytes,
+ * which exists during the whole execution of the graph.
+ */
+static bool is_entity_address(ir_graph *const irg, ir_node const *const ptr,
+                              unsigned const size)
+{
+	ir_entity *entity;
+	if (is_Address(ptr)) {
+		entity = get_Address_entity(ptr);
+		if (get_entity_linkage(entity) & IR_LINKAGE_WEAK)
+			return false;
+	} else if (is_Member(ptr)) {
+		ir_node const *const base = get_Member_ptr(ptr);
+		if (base != get_irg_frame(irg) && !is_entity_address(irg, base, 0))
+			return false;
+		entity = get_Member_entity(ptr);
+	} else {
+		return false;
+	}
+	ir_type *const type = get_entity_type(entity);
+	return !is_Method_type(type) && size <= get_type_size(type);
+}
+
+/**
+ * Checks whether the memory at @p ptr is accessed (or written if @p store is
+ * set) with at least @p size bytes on every path to the block entering the
+ * loop.
+ */
+static bool is_accessed_before(hoist_env_t const *const env,
+                               ir_node const *const ptr, unsigned const size,
+                               bool const store)
+{
+	foreach_out_edge(ptr, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		ir_mode       *mode;
+		if (is_Load(user) && get_Load_ptr(user) == ptr && !store) {
+			mode = get_Load_mode(user);
+		} else if (is_Store(user) && get_Store_ptr(user) == ptr) {
+			mode = get_irn_mode(get_Store_value(user));
+		} else {
+			continue;
+		}
+		if (get_mode_size_bytes(mode) < size)
+			continue;
+		ir_node *const block = get_nodes_block(user);
+		if (block_dominates(block, env->pre)
+		 || (block == env->header && env->header_safe))
+			return true;
+	}
+	return false;
+}
+
+static bool is_dereferenceable(hoist_env_t const *const env,
+                               ir_node const *const ptr, unsigned const size)
+{
+	if (is_entity_address(env->irg, ptr, size)
+	 || is_accessed_before(env, ptr, size, false))
+		return true;
+
+	/* Another field of the same compound is accessed before. */
+	if (is_Member(ptr)) {
+		ir_node const *const base  = get_Member_ptr(ptr);
+		ir_type const *const owner = get_entity_owner(get_Member_entity(ptr));
+		if (!is_compound_type(owner) || is_frame_type(owner))
+			return false;
+		foreach_out_edge(base, edge) {
+			ir_node const *const user = get_edge_src_irn(edge);
+			if (user != ptr && is_Member(user)
+			 && get_entity_owner(get_Member_entity(user)) == owner
+			 && is_accessed_before(env, user, 1, false))
+				return true;
+		}
+	}
+	return false;
+}
+
+/** Returns the memory entering the loop, on which @p load can be placed. */
+static ir_node *get_entry_mem(hoist_env_t const *const env, ir_node *const load)
+{
+	ir_node *mem = get_Load_mem(load);
+	if (!is_in_loop(env->loop, mem))
+		return mem;
+	if (env->entry_mem != NULL)
+		return env->entry_mem;
+
+	/* Without a memory Phi, only Loads are on the memory chain. */
+	while (is_in_loop(env->loop, mem)) {
+		if (!is_Proj(mem) || !is_Load(get_Proj_pred(mem)))
+			return NULL;
+		mem = get_Load_mem(get_Proj_pred(mem));
+	}
+	return mem;
+}
+
+static bool try_hoist(hoist_env_t *const env, ir_node *const load)
+{
+	if (!is_in_loop(env->loop, load)
+	 || get_Load_volatility(load) == volatility_is_volatile
+	 || ir_throws_exception(load))
+		return false;
+
+	ir_node *const ptr = get_Load_ptr(load);
+	if (!is_invariant(env, ptr, 0))
+		return false;
+
+	memssa_def const *const clobber = memssa_get_clobber(env->memssa, load);
+	if (clobber == NULL
+	 || is_in_loop(env->loop, memssa_get_node(clobber)))
+		return false;
+
+	bool const guaranteed = get_nodes_block(load) == env->header
+	                     && env->header_safe;
+	if (!guaranteed) {
+		unsigned const size = get_mode_size_bytes(get_Load_mode(load));
+		if (!is_dereferenceable(env, ptr, size))
+			return false;
+	}
+
+	ir_node *const mem = get_entry_mem(env, load);
+	if (mem == NULL)
+		return false;
+
+	DB((dbg, LEVEL_2, "hoisting %+F out of %+F%s\n", load, env->loop,
+	    guaranteed ? "" : " speculatively"));
+	move_invariant(env, ptr);
+	ir_node *const proj_m = get_Proj_for_pn(load, pn_Load_M);
+	if (proj_m != NULL)
+		exchange(proj_m, get_Load_mem(load));
+	set_Load_mem(load, mem);
+	set_nodes_block(load, env->pre);
+	foreach_out_edge(load, edge) {
+		set_nodes_block(get_edge_src_irn(edge), env->pre);
+	}
+	return true;
+}
+
+/**
+ * Finds the header of the loop and the single block entering it.
+ */
+static bool find_entry(hoist_env_t *const env, ir_loop *const loop)
+{
+	ir_node *header = NULL;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node && has_backedges(element.node)) {
+			if (header != NULL)
+				return false;
+			header = element.node;
+		}
+	}
+	if (header == NULL)
+		return false;
+
+	int entry_pos = -1;
+	for (int i = 0, n = get_Block_n_cfgpreds(header); i < n; ++i) {
+		if (is_backedge(header, i) || is_Bad(get_Block_cfgpred(header, i)))
+			continue;
+		if (entry_pos >= 0)
+			return false;
+		entry_pos = i;
+	}
+	if (entry_pos < 0)
+		return false;
+
+	ir_node *const entry = get_Block_cfgpred(header, entry_pos);
+
+	env->loop        = loop;
+	env->header      = header;
+	env->pre         = get_nodes_block(entry);
+	env->entry_mem   = NULL;
+	env->header_safe = is_Jmp(entry);
+	foreach_out_edge(header, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (is_Phi(node) && get_irn_mode(node) == mode_M) {
+			env->entry_mem = get_Phi_pred(node, entry_pos);
+		} else if (is_Call(node)
+		        || (is_fragile_op(node) && ir_throws_exception(node))) {
+			/* The Call might not return. */
+			env->header_safe = false;
+		}
+	}
+	return true;
+}
+
+static void hoist_loop(hoist_env_t *const env, ir_loop *const loop)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			hoist_loop(env, element.son);
+	}
+	if (loop == get_irg_loop(env->irg) || !find_entry(env, loop))
+		return;
+
+	/* Hoisting a Load may make the address of another one invariant. */
+	bool progress;
+	do {
+		progress = false;
+		for (size_t i = 0, n = ARR_LEN(env->memops); i < n; ++i) {
+			ir_node *const node = env->memops[i];
+			if (is_Load(node) && try_hoist(env, node))
+				progress = true;
+		}
+		env->changed |= progress;
+	} while (progress);
+}
+
+static void collect_memops(ir_node *const node, void *const data)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Block:
+	case iro_Div:
+	case iro_End:
+	case iro_Mod:
+	case iro_Phi:
+	case iro_Proj:
+	case iro_Sync:
+		return;
+	default:
+		break;
+	}
+	foreach_irn_in(node, i, pred) {
+		if (get_irn_mode(pred) == mode_M) {
+			ir_node ***const memops = (ir_node***)data;
+			ARR_APP1(ir_node*, *memops, node);
+			return;
+		}
+	}
+}
+
+void hoist_invariant_loads(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.hoist_loads");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
+	if ((get_irg_memory_disambiguator_options(irg) & aa_opt_always_alias) == 0)
+		assure_irp_globals_entity_usage_computed();
+
+	hoist_env_t env = {
+		.irg    = irg,
+		.memssa = memssa_new(irg),
+		.memops = NEW_ARR_F(ir_node*, 0),
+	};
+	irg_walk_graph(irg, NULL, collect_memops, &env.memops);
+	hoist_loop(&env, get_irg_loop(irg));
+	DEL_ARR_F(env.memops);
+	memssa_free(env.memssa);
+
+	confirm_irg_properties(irg, env.changed
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+}
+
+static void collect_blocks(ir_loop *const loop, ir_node ***const blocks)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			collect_blocks(element.son, blocks);
+		else if (*element.kind == k_ir_node)
+			ARR_APP1(ir_node*, *blocks, element.node);
+	}
+}
+
+static bool is_constant_address(ir_node const *ptr)
+{
+	while (is_Member(ptr))
+		ptr = get_Member_ptr(ptr);
+	return is_Address(ptr)
+	    && (get_entity_linkage(get_Address_entity(ptr)) & IR_LINKAGE_CONSTANT);
+}
+
+/**
+ * Checks whether the location at @p ptr may be loaded in front of the loop
+ * and stored after it, even if the loop never accesses it.
+ */
+static bool is_promotion_safe(hoist_env_t const *const env,
+                              ir_node const *const ptr, unsigned const size)
+{
+	if (!is_dereferenceable(env, ptr, size))
+		return false;
+	return (is_entity_address(env->irg, ptr, size) && !is_constant_address(ptr))
+	    || is_accessed_before(env, ptr, size, true);
+}
+
+static bool is_no_alias(ir_node const *const ptr, ir_type const *const type,
+                        unsigned const size, location_t const *const loc)
+{
+	return get_alias_relation(ptr, type, size, loc->ptr, loc->type,
+	                          get_mode_size_bytes(loc->mode)) == ir_no_alias;
+}
+
+/**
+ * Checks whether all accesses of the location inside the loop use its address
+ * directly and nothing else in the loop may access it.
+ */
+static bool is_promotable(hoist_env_t const *const env,
+                          location_t const *const loc)
+{
+	unsigned const size = get_mode_size_bytes(loc->mode);
+	if (!is_promotion_safe(env, loc->ptr, size))
+		return false;
+
+	for (size_t i = 0, n = ARR_LEN(env->memops); i < n; ++i) {
+		ir_node *const node = env->memops[i];
+		if (!is_in_loop(env->loop, node))
+			continue;
+
+		switch (get_irn_opcode(node)) {
+		case iro_Load: {
+			ir_type const *const type = get_Load_type(node);
+			ir_mode       *const mode = get_Load_mode(node);
+			if (get_Load_ptr(node) != loc->ptr) {
+				if (!is_no_alias(get_Load_ptr(node), type,
+				                 get_mode_size_bytes(mode), loc))
+					return false;
+			} else if (mode != loc->mode
+			        || get_Load_volatility(node) == volatility_is_volatile
+			        || ir_throws_exception(node)) {
+				return false;
+			}
+			break;
+		}
+
+		case iro_Store: {
+			ir_type const *const type = get_Store_type(node);
+			ir_mode       *const mode = get_irn_mode(get_Store_value(node));
+			if (get_Store_ptr(node) != loc->ptr) {
+				if (!is_no_alias(get_Store_ptr(node), type,
+				                 get_mode_size_bytes(mode), loc))
+					return false;
+			} else if (mode != loc->mode
+			        || get_Store_volatility(node) == volatility_is_volatile
+			        || ir_throws_exception(node)) {
+				return false;
+			}
+			break;
+		}
+
+		case iro_CopyB: {
+			ir_type const *const type = get_CopyB_type(node);
+			unsigned       const size = get_type_size(type);
+			if (get_CopyB_volatility(node) == volatility_is_volatile
+			 || !is_no_alias(get_CopyB_src(node), type, size, loc)
+			 || !is_no_alias(get_CopyB_dst(node), type, size, loc))
+				return false;
+			break;
+		}
+
+		case iro_Call:
+			if (get_call_modref(node, loc->ptr, loc->type, size)
+			    != ir_modref_none)
+				return false;
+			break;
+
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+static loop_exit_t *find_exit(loop_exit_t *const exits, ir_node const *const block,
+                              int const pos)
+{
+	for (size_t i = 0, n = ARR_LEN(exits); i < n; ++i) {
+		if (exits[i].block == block && exits[i].pos == pos)
+			return &exits[i];
+	}
+	return NULL;
+}
+
+/**
+ * Determines the memory on each edge leaving the loop, such that the memory
+ * after the loop can be rerouted through the Stores of the promoted
+ * locations.  Fails if memory of the loop is used after it in a way not
+ * attributable to a single exit edge.
+ */
+static bool find_exit_memory(hoist_env_t const *const env,
+                             ir_node *const *const blocks,
+                             loop_exit_t *const exits)
+{
+	for (size_t b = 0, n_blocks = ARR_LEN(blocks); b < n_blocks; ++b) {
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const mem = get_edge_src_irn(edge);
+			if (get_irn_mode(mem) != mode_M)
+				continue;
+
+			foreach_out_edge(mem, use_edge) {
+				ir_node *const user = get_edge_src_irn(use_edge);
+				if (is_End(user) || is_in_loop(env->loop, user))
+					continue;
+
+				ir_node     *use_block = get_nodes_block(user);
+				loop_exit_t *exit      = NULL;
+				if (is_Phi(user)) {
+					int      const pos  = get_edge_src_pos(use_edge);
+					ir_node *const pred = get_Block_cfgpred_block(use_block, pos);
+					if (is_in_loop(env->loop, pred))
+						exit = find_exit(exits, use_block, pos);
+					else
+						use_block = pred;
+				}
+				for (size_t i = 0, n = ARR_LEN(exits); exit == NULL && i < n; ++i) {
+					ir_node *const block = exits[i].block;
+					if (get_Block_n_cfgpreds(block) == 1
+					 && block_dominates(block, use_block))
+						exit = &exits[i];
+				}
+				if (exit == NULL || (exit->mem != NULL && exit->mem != mem))
+					return false;
+				exit->mem = mem;
+			}
+		}
+	}
+	return true;
+}
+
+static bool try_promote(hoist_env_t *const env, ir_loop *const loop)
+{
+	if (!find_entry(env, loop) || env->entry_mem == NULL)
+		return false;
+
+	bool          success = false;
+	ir_node     **blocks  = NEW_ARR_F(ir_node*, 0);
+	loop_exit_t  *exits   = NEW_ARR_F(loop_exit_t, 0);
+	size_t const  first   = ARR_LEN(env->locations);
+	collect_blocks(loop, &blocks);
+	for (size_t b = 0, n_blocks = ARR_LEN(blocks); b < n_blocks; ++b) {
+		foreach_block_succ(blocks[b], edge) {
+			ir_node *const succ = get_edge_src_irn(edge);
+			if (is_in_loop(loop, succ))
+				continue;
+			if (succ == get_irg_end_block(env->irg))
+				goto end;
+			loop_exit_t const exit = {
+				.block = succ,
+				.pos   = get_edge_src_pos(edge),
+			};
+			ARR_APP1(loop_exit_t, exits, exit);
+		}
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env->memops); i < n; ++i) {
+		ir_node *const node = env->memops[i];
+		if (!is_Store(node) || !is_in_loop(loop, node)
+		 || is_in_loop(loop, get_Store_ptr(node)))
+			continue;
+
+		ir_node *const ptr = get_Store_ptr(node);
+		for (size_t l = first; l < ARR_LEN(env->locations); ++l) {
+			if (env->locations[l].ptr == ptr)
+				goto next_store;
+		}
+		location_t const loc = {
+			.ptr  = ptr,
+			.type = get_Store_type(node),
+			.mode = get_irn_mode(get_Store_value(node)),
+		};
+		if (is_promotable(env, &loc))
+			ARR_APP1(location_t, env->locations, loc);
+next_store:;
+	}
+	size_t const n_locations = ARR_LEN(env->locations) - first;
+	if (n_locations == 0)
+		goto end;
+	if (!find_exit_memory(env, blocks, exits)) {
+		ARR_SHRINKLEN(env->locations, first);
+		goto end;
+	}
+
+	for (size_t l = first; l < ARR_LEN(env->locations); ++l) {
+		ir_node *const ptr = env->locations[l].ptr;
+		DB((dbg, LEVEL_2, "promoting %+F in %+F\n", ptr, loop));
+		for (size_t i = 0, n = ARR_LEN(env->memops); i < n; ++i) {
+			ir_node *const node = env->memops[i];
+			if (is_in_loop(loop, node) && ((is_Load(node) && get_Load_ptr(node) == ptr)
+			 || (is_Store(node) && get_Store_ptr(node) == ptr)))
+				ir_nodemap_insert(&env->accesses, node, INT_TO_PTR(l + 1));
+		}
+	}
+	promoted_loop_t const promoted = {
+		.pre         = env->pre,
+		.entry_mem   = env->entry_mem,
+		.first       = first,
+		.n_locations = n_locations,
+		.exits       = exits,
+	};
+	ARR_APP1(promoted_loop_t, env->promoted, promoted);
+	exits   = NULL;
+	success = true;
+
+end:
+	if (exits != NULL)
+		DEL_ARR_F(exits);
+	DEL_ARR_F(blocks);
+	return success;
+}
+
+static void promote_loop(hoist_env_t *const env, ir_loop *const loop)
+{
+	if (loop != get_irg_loop(env->irg) && try_promote(env, loop))
+		return;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			promote_loop(env, element.son);
+	}
+}
+
+/** Replaces the accesses of promoted locations by their values. */
+static void replace_access(ir_node *const node, void *const data)
+{
+	hoist_env_t *const env = (hoist_env_t*)data;
+	size_t       const idx = PTR_TO_INT(ir_nodemap_get(void, &env->accesses, node));
+	if (idx == 0)
+		return;
+
+	ir_graph         *const irg = env->irg;
+	location_t const *const loc = &env->locations[idx - 1];
+	set_r_cur_block(irg, get_nodes_block(node));
+	if (is_Load(node)) {
+		ir_node *const in[] = {
+			[pn_Load_M]   = get_Load_mem(node),
+			[pn_Load_res] = get_r_value(irg, idx - 1, loc->mode),
+		};
+		turn_into_tuple(node, ARRAY_SIZE(in), in);
+	} else {
+		set_r_value(irg, idx - 1, get_Store_value(node));
+		ir_node *const in[] = { [pn_Store_M] = get_Store_mem(node) };
+		turn_into_tuple(node, ARRAY_SIZE(in), in);
+	}
+}
+
+/**
+ * Lets all users of the memory @p old after the exit @p exit use @p mem
+ * instead.
+ */
+static void reroute_exit_memory(loop_exit_t const *const exit,
+                                ir_node *const old, ir_node *const mem,
+                                ir_node *const store)
+{
+	ir_node *const block = exit->block;
+	bool     const split = get_Block_n_cfgpreds(block) > 1;
+	foreach_out_edge_safe(old, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user == store || is_End(user))
+			continue;
+
+		int      const pos       = get_edge_src_pos(edge);
+		ir_node       *use_block = get_nodes_block(user);
+		if (is_Phi(user)) {
+			if (use_block == block && pos == exit->pos) {
+				set_irn_n(user, pos, mem);
+				continue;
+			}
+			use_block = get_Block_cfgpred_block(use_block, pos);
+		}
+		if (!split && block_dominates(block, use_block))
+			set_irn_n(user, pos, mem);
+	}
+}
+
+static void promote_locations(hoist_env_t *const env)
+{
+	ir_graph *const irg = env->irg;
+
+	/* Load the locations in front of the loops and create blocks for the
+	 * Stores on critical exit edges. */
+	ir_node **store_blocks = NEW_ARR_F(ir_node*, 0);
+	for (size_t p = 0, n = ARR_LEN(env->promoted); p < n; ++p) {
+		promoted_loop_t const *const promoted = &env->promoted[p];
+		for (size_t l = promoted->first, end = l + promoted->n_locations; l < end; ++l) {
+			location_t *const loc  = &env->locations[l];
+			ir_node    *const load = new_r_Load(promoted->pre, promoted->entry_mem,
+			                                    loc->ptr, loc->mode, loc->type,
+			                                    cons_none);
+			loc->init = new_r_Proj(load, loc->mode, pn_Load_res);
+		}
+		for (size_t e = 0, n_exits = ARR_LEN(promoted->exits); e < n_exits; ++e) {
+			loop_exit_t const *const exit  = &promoted->exits[e];
+			ir_node           *const block = exit->block;
+			ir_node                 *store_block = block;
+			if (exit->mem != NULL && get_Block_n_cfgpreds(block) > 1) {
+				ir_node *const cfop = get_Block_cfgpred(block, exit->pos);
+				store_block = new_r_Block(irg, 1, &cfop);
+				set_Block_cfgpred(block, exit->pos, new_r_Jmp(store_block));
+			}
+			ARR_APP1(ir_node*, store_blocks, store_block);
+		}
+	}
+
+	ssa_cons_start(irg, (int)ARR_LEN(env->locations));
+	for (size_t p = 0, n = ARR_LEN(env->promoted); p < n; ++p) {
+		promoted_loop_t const *const promoted = &env->promoted[p];
+		set_r_cur_block(irg, promoted->pre);
+		for (size_t l = promoted->first, end = l + promoted->n_locations; l < end; ++l)
+			set_r_value(irg, l, env->locations[l].init);
+	}
+	irg_walk_blkwise_graph(irg, NULL, replace_access, env);
+
+	/* Store the values on the exit edges. */
+	size_t s = 0;
+	for (size_t p = 0, n = ARR_LEN(env->promoted); p < n; ++p) {
+		promoted_loop_t const *const promoted = &env->promoted[p];
+		for (size_t e = 0, n_exits = ARR_LEN(promoted->exits); e < n_exits; ++e) {
+			loop_exit_t const *const exit  = &promoted->exits[e];
+			ir_node           *const block = store_blocks[s++];
+			if (exit->mem == NULL)
+				continue;
+
+			set_r_cur_block(irg, block);
+			ir_node *mem   = exit->mem;
+			ir_node *first = NULL;
+			for (size_t l = promoted->first, end = l + promoted->n_locations; l < end; ++l) {
+				location_t const *const loc   = &env->locations[l];
+				ir_node          *const value = get_r_value(irg, l, loc->mode);
+				ir_node          *const store = new_r_Store(block, mem, loc->ptr,
+				                                            value, loc->type,
+				                                            cons_none);
+				if (first == NULL)
+					first = store;
+				mem = new_r_Proj(store, mode_M, pn_Store_M);
+			}
+			reroute_exit_memory(exit, exit->mem, mem, first);
+		}
+	}
+	ssa_cons_finish(irg);
+	DEL_ARR_F(store_blocks);
+}
+
+void promote_loop_scalars(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.hoist_loads");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
+	if ((get_irg_memory_disambiguator_options(irg) & aa_opt_always_alias) == 0)
+		assure_irp_globals_entity_usage_computed();
+
+	hoist_env_t env = {
+		.irg       = irg,
+		.memops    = NEW_ARR_F(ir_node*, 0),
+		.locations = NEW_ARR_F(location_t, 0),
+		.promoted  = NEW_ARR_F(promoted_loop_t, 0),
+	};
+	ir_nodemap_init(&env.accesses, irg);
+	irg_walk_graph(irg, NULL, collect_memops, &env.memops);
+	promote_loop(&env, get_irg_loop(irg));
+
+	bool const changed = ARR_LEN(env.promoted) > 0;
+	if (changed)
+		promote_locations(&env);
+
+	for (size_t p = 0, n = ARR_LEN(env.promoted); p < n; ++p)
+		DEL_ARR_F(env.promoted[p].exits);
+	DEL_ARR_F(env.promoted);
+	DEL_ARR_F(env.locations);
+	DEL_ARR_F(env.memops);
+	ir_nodemap_destroy(&env.accesses);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,602 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural constant propagation and function specialization.
+ *
+ * The values of the parameters and results of all functions are described
+ * by a lattice: unknown yet (top), an integer range (a constant if both
+ * bounds are equal), the address of an entity or any value (bottom).  The
+ * argument of a direct call contributes to the parameter of its callee if
+ * it is a constant, an address, a parameter of the caller or a result of
+ * another direct call, the operands of a Return contribute to the results.
+ * The values are propagated over the callgraph in SCC order until nothing
+ * changes.  Functions whose address is taken may be called from unknown
+ * places, so their parameters are bottom.
+ *
+ * Parameters which are constant in all calls are replaced by the constant,
+ * ranges are attached to the parameter by Confirm nodes.  Constant results
+ * replace the results of the calls.  Afterwards calls passing constants to
+ * parameters which vary between the call sites are grouped by these
+ * constants and redirected to a specialized copy of the callee, as long as
+ * the copies stay within the size budget.
+ */
+#include "array.h"
+#include "callgraph.h"
+#include "cgana.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgopt.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "opt_inline_t.h"
+#include "pmap.h"
+#include "pset.h"
+#include "tv_t.h"
+#include "typerep.h"
+#include "util.h"
+#include "xmalloc.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+typedef enum value_kind {
+	VALUE_TOP,     /**< no value known yet */
+	VALUE_RANGE,   /**< a value in [lo, hi], a constant if lo == hi */
+	VALUE_ADDRESS, /**< the address of an entity */
+	VALUE_BOTTOM,  /**< any value */
+} value_kind;
+
+/** A lattice value. */
+typedef struct lattice_t {
+	value_kind  kind;
+	ir_tarval  *lo;
+	ir_tarval  *hi;
+	ir_entity  *entity;
+} lattice_t;
+
+typedef struct func_info_t {
+	ir_graph  *irg;
+	size_t     n_params;
+	size_t     n_results;
+	lattice_t *params;    /**< values of the parameters */
+	lattice_t *results;   /**< values of the results */
+	ir_node  **args;      /**< Projs of the parameters */
+	ir_node  **calls;     /**< direct Calls of analysed functions */
+	ir_node  **returns;   /**< Returns of the function */
+	bool       changed;   /**< the graph was changed */
+} func_info_t;
+
+/** Calls passing the same constants to a callee. */
+typedef struct specialization_t {
+	func_info_t *callee;
+	lattice_t   *values;  /**< constant parameters, top for the others */
+	ir_node    **calls;   /**< the Calls to redirect */
+	unsigned     benefit; /**< number of users of the constant parameters */
+	unsigned     cost;    /**< size of the copy */
+} specialization_t;
+
+static pmap *infos;
+
+static lattice_t const bottom = { .kind = VALUE_BOTTOM };
+
+/** Returns the info of the analysed function @p ent or NULL. */
+static func_info_t *get_info(ir_entity const *const ent)
+{
+	return pmap_get(func_info_t, infos, ent);
+}
+
+/** Returns the info of the function called directly by @p call or NULL. */
+static func_info_t *get_callee_info(ir_node const *const call)
+{
+	ir_node const *const ptr = get_Call_ptr(call);
+	return is_Address(ptr) ? get_info(get_Address_entity(ptr)) : NULL;
+}
+
+static bool is_constant(lattice_t const *const value)
+{
+	return value->kind == VALUE_ADDRESS
+	    || (value->kind == VALUE_RANGE && value->lo == value->hi);
+}
+
+static bool lattice_equal(lattice_t const *const a, lattice_t const *const b)
+{
+	return a->kind == b->kind && a->lo == b->lo && a->hi == b->hi
+	    && a->entity == b->entity;
+}
+
+/**
+ * Joins @p value into @p dst, which has the mode @p mode.  Returns true if
+ * @p dst changed.
+ */
+static bool join(lattice_t *const dst, lattice_t const *const value,
+                 ir_mode *const mode)
+{
+	lattice_t res = *dst;
+	if (value->kind == VALUE_TOP || res.kind == VALUE_BOTTOM) {
+		return false;
+	} else if (value->kind == VALUE_RANGE && get_tarval_mode(value->lo) != mode) {
+		res = bottom;
+	} else if (value->kind == VALUE_ADDRESS && !mode_is_reference(mode)) {
+		res = bottom;
+	} else if (res.kind == VALUE_TOP) {
+		res = *value;
+	} else if (res.kind != value->kind) {
+		res = bottom;
+	} else if (res.kind == VALUE_ADDRESS) {
+		if (res.entity != value->entity)
+			res = bottom;
+	} else if (res.kind == VALUE_RANGE) {
+		if (mode_is_int(mode)) {
+			if (tarval_cmp(value->lo, res.lo) == ir_relation_less)
+				res.lo = value->lo;
+			if (tarval_cmp(value->hi, res.hi) == ir_relation_greater)
+				res.hi = value->hi;
+		} else if (res.lo != value->lo) {
+			res = bottom;
+		}
+	} else {
+		res = bottom;
+	}
+
+	if (lattice_equal(&res, dst))
+		return false;
+	*dst = res;
+	return true;
+}
+
+/** Returns the lattice value of @p node in the graph of @p info. */
+static lattice_t get_lattice(func_info_t const *const info, ir_node *node)
+{
+	node = skip_Id(node);
+	if (is_Const(node)) {
+		ir_tarval *const tv = get_Const_tarval(node);
+		return (lattice_t){ .kind = VALUE_RANGE, .lo = tv, .hi = tv };
+	} else if (is_Address(node)) {
+		return (lattice_t){ .kind = VALUE_ADDRESS,
+		                    .entity = get_Address_entity(node) };
+	} else if (!is_Proj(node)) {
+		return bottom;
+	}
+
+	ir_node  *const pred = get_Proj_pred(node);
+	unsigned  const pn   = get_Proj_num(node);
+	if (pred == get_irg_args(info->irg)) {
+		if (pn < info->n_params)
+			return info->params[pn];
+	} else if (is_Proj(pred) && get_Proj_num(pred) == pn_Call_T_result) {
+		ir_node     *const call   = get_Proj_pred(pred);
+		func_info_t *const callee = is_Call(call) ? get_callee_info(call) : NULL;
+		if (callee != NULL && pn < callee->n_results)
+			return callee->results[pn];
+	}
+	return bottom;
+}
+
+/** Collects the argument Projs, direct Calls and Returns of a graph. */
+static void collect_nodes(ir_node *const node, void *const ctx)
+{
+	func_info_t *const info = (func_info_t*)ctx;
+	if (is_Proj(node) && get_Proj_pred(node) == get_irg_args(info->irg)) {
+		ARR_APP1(ir_node*, info->args, node);
+	} else if (is_Return(node)) {
+		ARR_APP1(ir_node*, info->returns, node);
+	} else if (is_Call(node)) {
+		func_info_t *const callee = get_callee_info(node);
+		if (callee == NULL)
+			return;
+		if ((size_t)get_Call_n_params(node) != callee->n_params) {
+			/* unprototyped call, do not guess the parameters */
+			for (size_t i = 0; i < callee->n_params; ++i)
+				callee->params[i] = bottom;
+		}
+		ARR_APP1(ir_node*, info->calls, node);
+	}
+}
+
+/** Checks whether values of type @p type are tracked. */
+static bool is_tracked_type(ir_type const *const type)
+{
+	ir_mode const *const mode = get_type_mode(type);
+	return mode != NULL && mode_is_data(mode);
+}
+
+static func_info_t *new_info(ir_graph *const irg, bool const is_free)
+{
+	ir_entity *const ent       = get_irg_entity(irg);
+	ir_type   *const mtp       = get_entity_type(ent);
+	bool       const weak      = get_entity_linkage(ent) & IR_LINKAGE_WEAK;
+	size_t     const n_params  = get_method_n_params(mtp);
+	size_t     const n_results = get_method_n_ress(mtp);
+
+	func_info_t *const info = XMALLOCZ(func_info_t);
+	info->irg       = irg;
+	info->n_params  = n_params;
+	info->n_results = n_results;
+	info->params    = XMALLOCNZ(lattice_t, n_params);
+	info->results   = XMALLOCNZ(lattice_t, n_results);
+	info->args      = NEW_ARR_F(ir_node*, 0);
+	info->calls     = NEW_ARR_F(ir_node*, 0);
+	info->returns   = NEW_ARR_F(ir_node*, 0);
+
+	bool const unknown_callers = is_free || weak || is_method_variadic(mtp);
+	for (size_t i = 0; i < n_params; ++i) {
+		if (unknown_callers || !is_tracked_type(get_method_param_type(mtp, i)))
+			info->params[i] = bottom;
+	}
+	for (size_t i = 0; i < n_results; ++i) {
+		if (weak || !is_tracked_type(get_method_res_type(mtp, i)))
+			info->results[i] = bottom;
+	}
+	return info;
+}
+
+static void free_info(func_info_t *const info)
+{
+	DEL_ARR_F(info->returns);
+	DEL_ARR_F(info->calls);
+	DEL_ARR_F(info->args);
+	free(info->results);
+	free(info->params);
+	free(info);
+}
+
+/** Propagates the arguments of the direct calls in @p info to the callees. */
+static bool propagate_args(func_info_t const *const info)
+{
+	bool changed = false;
+	for (size_t c = 0, n = ARR_LEN(info->calls); c < n; ++c) {
+		ir_node     *const call   = info->calls[c];
+		func_info_t *const callee = get_callee_info(call);
+		ir_type     *const mtp    = get_entity_type(get_irg_entity(callee->irg));
+		if ((size_t)get_Call_n_params(call) != callee->n_params)
+			continue;
+		for (size_t i = 0; i < callee->n_params; ++i) {
+			ir_mode  *const mode  = get_type_mode(get_method_param_type(mtp, i));
+			lattice_t const value = get_lattice(info, get_Call_param(call, i));
+			if (mode != NULL && join(&callee->params[i], &value, mode))
+				changed = true;
+		}
+	}
+	return changed;
+}
+
+/** Propagates the operands of the Returns in @p info to its results. */
+static bool propagate_results(func_info_t *const info)
+{
+	ir_type *const mtp     = get_entity_type(get_irg_entity(info->irg));
+	bool           changed = false;
+	for (size_t r = 0, n = ARR_LEN(info->returns); r < n; ++r) {
+		ir_node *const ret = info->returns[r];
+		if ((size_t)get_Return_n_ress(ret) != info->n_results)
+			continue;
+		for (size_t i = 0; i < info->n_results; ++i) {
+			ir_mode  *const mode  = get_type_mode(get_method_res_type(mtp, i));
+			lattice_t const value = get_lattice(info, get_Return_res(ret, i));
+			if (mode != NULL && join(&info->results[i], &value, mode))
+				changed = true;
+		}
+	}
+	return changed;
+}
+
+/** Creates a node for the constant @p value in @p irg or returns NULL. */
+static ir_node *new_constant(ir_graph *const irg, lattice_t const *const value,
+                             ir_mode *const mode)
+{
+	if (value->kind == VALUE_ADDRESS) {
+		ir_node *const addr = new_r_Address(irg, value->entity);
+		return get_irn_mode(addr) == mode ? addr : NULL;
+	}
+	return get_tarval_mode(value->lo) == mode ? new_r_Const(irg, value->lo)
+	                                          : NULL;
+}
+
+/** Attaches the range @p value to the parameter @p arg with Confirms. */
+static void confirm_range(ir_node *const arg, lattice_t const *const value)
+{
+	ir_mode *const mode = get_irn_mode(arg);
+	if (value->lo == get_mode_min(mode) && value->hi == get_mode_max(mode))
+		return;
+	ir_graph *const irg   = get_irn_irg(arg);
+	ir_node  *const block = get_irg_start_block(irg);
+	ir_node  *const lo    = new_r_Confirm(block, arg, new_r_Const(irg, value->lo),
+	                                      ir_relation_greater_equal);
+	ir_node  *const hi    = new_r_Confirm(block, lo, new_r_Const(irg, value->hi),
+	                                      ir_relation_less_equal);
+	edges_reroute_except(arg, hi, lo);
+}
+
+/** Replaces constant parameters and results of calls in @p info. */
+static void specialize_in_place(func_info_t *const info)
+{
+	ir_graph *const irg = info->irg;
+	for (size_t a = 0, n = ARR_LEN(info->args); a < n; ++a) {
+		ir_node         *const arg   = info->args[a];
+		unsigned         const pn    = get_Proj_num(arg);
+		lattice_t const *const value = &info->params[pn];
+		ir_mode         *const mode  = get_irn_mode(arg);
+		if (is_constant(value)) {
+			ir_node *const cnst = new_constant(irg, value, mode);
+			if (cnst != NULL) {
+				DB((dbg, LEVEL_1, "%+F: parameter %u is %+F\n", irg, pn, cnst));
+				exchange(arg, cnst);
+				info->args[a] = cnst;
+				info->changed = true;
+			}
+		} else if (value->kind == VALUE_RANGE && mode_is_int(mode)
+		        && get_tarval_mode(value->lo) == mode) {
+			DB((dbg, LEVEL_1, "%+F: parameter %u in [%T, %T]\n", irg, pn,
+			    value->lo, value->hi));
+			confirm_range(arg, value);
+			info->changed = true;
+		}
+	}
+
+	for (size_t c = 0, n = ARR_LEN(info->calls); c < n; ++c) {
+		ir_node     *const call   = info->calls[c];
+		func_info_t *const callee = get_callee_info(call);
+		foreach_out_edge(call, edge) {
+			ir_node *const ress = get_edge_src_irn(edge);
+			if (!is_Proj(ress) || get_Proj_num(ress) != pn_Call_T_result)
+				continue;
+			foreach_out_edge_safe(ress, res_edge) {
+				ir_node  *const res = get_edge_src_irn(res_edge);
+				unsigned  const pn  = get_Proj_num(res);
+				if (pn >= callee->n_results
+				 || !is_constant(&callee->results[pn]))
+					continue;
+				ir_node *const cnst = new_constant(irg, &callee->results[pn],
+				                                   get_irn_mode(res));
+				if (cnst != NULL) {
+					DB((dbg, LEVEL_1, "%+F: result %u is %+F\n", call, pn, cnst));
+					exchange(res, cnst);
+					info->changed = true;
+				}
+			}
+		}
+	}
+}
+
+/** Counts the users of @p node, looking through Confirms. */
+static unsigned get_n_users(ir_node const *const node)
+{
+	unsigned n_users = 0;
+	foreach_out_edge(node, edge) {
+		ir_node const *const user = get_edge_src_irn(edge);
+		n_users += is_Confirm(user) ? get_n_users(user) : 1;
+	}
+	return n_users;
+}
+
+/** Counts the users of the parameter @p pn in @p info. */
+static unsigned get_n_param_users(func_info_t const *const info,
+                                  unsigned const pn)
+{
+	unsigned n_users = 0;
+	for (size_t a = 0, n = ARR_LEN(info->args); a < n; ++a) {
+		ir_node *const arg = info->args[a];
+		if (is_Proj(arg) && get_Proj_num(arg) == pn)
+			n_users += get_n_users(arg);
+	}
+	return n_users;
+}
+
+/** Adds @p call to the specialization for its constant arguments. */
+static void add_specialization(specialization_t **const specs,
+                               ir_node *const call)
+{
+	func_info_t *const callee = get_callee_info(call);
+	if (callee == NULL || (size_t)get_Call_n_params(call) != callee->n_params)
+		return;
+
+	size_t    const n_params = callee->n_params;
+	lattice_t      *values   = XMALLOCNZ(lattice_t, n_params);
+	unsigned        benefit  = 0;
+	for (size_t i = 0; i < n_params; ++i) {
+		if (is_constant(&callee->params[i]))
+			continue;
+		ir_node *const param = skip_Id(get_Call_param(call, i));
+		if (!is_Const(param) && !is_Address(param))
+			continue;
+		unsigned const n_users = get_n_param_users(callee, i);
+		if (n_users == 0)
+			continue;
+		if (is_Const(param)) {
+			ir_tarval *const tv = get_Const_tarval(param);
+			values[i] = (lattice_t){ .kind = VALUE_RANGE, .lo = tv, .hi = tv };
+		} else {
+			values[i] = (lattice_t){ .kind = VALUE_ADDRESS,
+			                         .entity = get_Address_entity(param) };
+		}
+		benefit += n_users;
+	}
+	if (benefit == 0) {
+		free(values);
+		return;
+	}
+
+	for (size_t s = 0, n = ARR_LEN(*specs); s < n; ++s) {
+		specialization_t *const spec = &(*specs)[s];
+		if (spec->callee != callee)
+			continue;
+		bool same = true;
+		for (size_t i = 0; i < n_params; ++i) {
+			if (!lattice_equal(&spec->values[i], &values[i]))
+				same = false;
+		}
+		if (same) {
+			ARR_APP1(ir_node*, spec->calls, call);
+			spec->benefit += benefit;
+			free(values);
+			return;
+		}
+	}
+
+	specialization_t const spec = {
+		.callee  = callee,
+		.values  = values,
+		.calls   = NEW_ARR_F(ir_node*, 1),
+		.benefit = benefit,
+		.cost    = get_irg_last_idx(callee->irg),
+	};
+	spec.calls[0] = call;
+	ARR_APP1(specialization_t, *specs, spec);
+}
+
+/** Compares specializations by decreasing benefit per cost. */
+static int cmp_specialization(void const *const a, void const *const b)
+{
+	specialization_t const *const sa = (specialization_t const*)a;
+	specialization_t const *const sb = (specialization_t const*)b;
+	double const ra = (double)sa->benefit / sa->cost;
+	double const rb = (double)sb->benefit / sb->cost;
+	return ra < rb ? 1 : ra > rb ? -1 : 0;
+}
+
+/** Replaces the parameters of a graph by the constants in @p ctx. */
+static void set_constant_param(ir_node *const node, void *const ctx)
+{
+	if (!is_Proj(node) || get_Proj_pred(node) != get_irg_args(get_irn_irg(node)))
+		return;
+	lattice_t const *const values = (lattice_t const*)ctx;
+	lattice_t const *const value  = &values[get_Proj_num(node)];
+	if (value->kind == VALUE_TOP)
+		return;
+	ir_node *const cnst = new_constant(get_irn_irg(node), value,
+	                                   get_irn_mode(node));
+	if (cnst != NULL)
+		exchange(node, cnst);
+}
+
+/** Creates the specialized copy for @p spec and redirects its calls. */
+static bool specialize(specialization_t const *const spec)
+{
+	ir_graph  *const irg   = spec->callee->irg;
+	ir_entity *const ent   = get_irg_entity(irg);
+	ident     *const id    = id_unique(get_entity_name(ent));
+	ir_entity *const clone = clone_entity(ent, id, get_entity_owner(ent));
+	set_entity_visibility(clone, ir_visibility_local);
+	set_entity_linkage(clone, IR_LINKAGE_DEFAULT);
+
+	ir_graph *const copy = copy_irg(clone, irg);
+	if (copy == NULL) {
+		free_entity(clone);
+		return false;
+	}
+	remove_tuples(copy);
+	irg_walk_graph(copy, NULL, set_constant_param, spec->values);
+	confirm_irg_properties(copy, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
+
+	DB((dbg, LEVEL_1, "specialized %+F as %+F for %zu calls\n", ent, clone,
+	    ARR_LEN(spec->calls)));
+	for (size_t c = 0, n = ARR_LEN(spec->calls); c < n; ++c) {
+		ir_node *const call = spec->calls[c];
+		set_Call_ptr(call, new_r_Address(get_irn_irg(call), clone));
+	}
+	return true;
+}
+
+/** Clones callees for the constant arguments of calls within @p budget. */
+static void clone_functions(func_info_t *const *const order, unsigned budget)
+{
+	specialization_t *specs = NEW_ARR_F(specialization_t, 0);
+	for (size_t f = 0, n = ARR_LEN(order); f < n; ++f) {
+		func_info_t *const info = order[f];
+		for (size_t c = 0, n_calls = ARR_LEN(info->calls); c < n_calls; ++c)
+			add_specialization(&specs, info->calls[c]);
+	}
+	QSORT_ARR(specs, cmp_specialization);
+
+	for (size_t s = 0, n = ARR_LEN(specs); s < n; ++s) {
+		specialization_t const *const spec = &specs[s];
+		if (spec->cost <= budget && specialize(spec)) {
+			budget -= spec->cost;
+			for (size_t c = 0, n_calls = ARR_LEN(spec->calls); c < n_calls; ++c)
+				get_info(get_irg_entity(get_irn_irg(spec->calls[c])))->changed = true;
+		}
+		DEL_ARR_F(spec->calls);
+		free(spec->values);
+	}
+	DEL_ARR_F(specs);
+}
+
+static void collect_order(ir_graph *const irg, void *const ctx)
+{
+	func_info_t ***const order = (func_info_t***)ctx;
+	func_info_t   *const info  = get_info(get_irg_entity(irg));
+	if (info != NULL)
+		ARR_APP1(func_info_t*, *order, info);
+}
+
+void interprocedural_sccp(unsigned max_growth)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.ipa_sccp");
+
+	ir_entity **free_methods;
+	size_t const n_free = cgana(&free_methods);
+	pset *const free_set = pset_new_ptr(n_free);
+	for (size_t i = 0; i < n_free; ++i)
+		pset_insert_ptr(free_set, free_methods[i]);
+	free(free_methods);
+
+	infos = pmap_create();
+	unsigned program_size = 0;
+	foreach_irp_irg(i, irg) {
+		ir_entity *const ent = get_irg_entity(irg);
+		pmap_insert(infos, ent, new_info(irg, pset_find_ptr(free_set, ent)));
+		program_size += get_irg_last_idx(irg);
+	}
+	del_pset(free_set);
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, NULL, collect_nodes, get_info(get_irg_entity(irg)));
+	}
+
+	/* callees come before their callers */
+	compute_callgraph();
+	func_info_t **order = NEW_ARR_F(func_info_t*, 0);
+	callgraph_walk(NULL, collect_order, &order);
+	free_callgraph();
+
+	size_t const n_funcs = ARR_LEN(order);
+	bool         changed;
+	do {
+		changed = false;
+		for (size_t f = n_funcs; f-- > 0;) {
+			if (propagate_args(order[f]))
+				changed = true;
+		}
+		for (size_t f = 0; f < n_funcs; ++f) {
+			if (propagate_results(order[f]))
+				changed = true;
+		}
+	} while (changed);
+
+	for (size_t f = 0; f < n_funcs; ++f) {
+		func_info_t *const info = order[f];
+		assure_irg_properties(info->irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+		specialize_in_place(info);
+	}
+	clone_functions(order, (unsigned)((unsigned long)program_size * max_growth / 100));
+
+	for (size_t f = 0; f < n_funcs; ++f) {
+		func_info_t *const info = order[f];
+		confirm_irg_properties(info->irg, info->changed
+			? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+	}
+	DEL_ARR_F(order);
+	foreach_pmap(infos, entry) {
+		free_info((func_info_t*)entry->value);
+	}
+	pmap_destroy(infos);
+	free_irp_callee_info();
+}
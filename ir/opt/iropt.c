@@ -715,7 +715,13 @@ ir_relation ir_get_possible_cmp_relations(const ir_node *left,
 		ir_tarval *const l_z   = bl->z;
 		ir_tarval *const r_o   = br->o;
 		ir_tarval *const r_z   = br->z;
-		if (get_mode_arithmetic(mode) == irma_twos_complement) {
+		if (bitinfo_has_range(bl) && bitinfo_has_range(br)) {
+			/* The value ranges already include the bit information. */
+			if (!(tarval_cmp(bl->max, br->min) & ir_relation_greater))
+				possible &= ~ir_relation_greater;
+			if (!(tarval_cmp(bl->min, br->max) & ir_relation_less))
+				possible &= ~ir_relation_less;
+		} else if (get_mode_arithmetic(mode) == irma_twos_complement) {
 			/* Compute min/max values of operands. */
 			ir_tarval *l_max = tarval_and(l_z, tarval_ornot(l_o, min));
 			ir_tarval *l_min = tarval_or(l_o, tarval_and(l_z, min));
@@ -4210,7 +4216,60 @@ static ir_node *transform_node_Switch(ir_node *n)
 		}
 		return new_r_Tuple(block, (int)n_outs, in);
 	}
-	return n;
+
+	/* remove entries outside of the value range of the selector */
+	const bitinfo *const b = get_bitinfo(op);
+	if (b == NULL || !bitinfo_has_range(b))
+		return n;
+
+	const ir_switch_table *table     = get_Switch_table(n);
+	size_t                 n_entries = ir_switch_table_get_n_entries(table);
+	size_t                 n_keep    = 0;
+	for (size_t i = 0; i < n_entries; ++i) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, i);
+		if (entry->pn != 0
+		 && !(tarval_cmp(entry->max, b->min) & ir_relation_less)
+		 && !(tarval_cmp(b->max, entry->min) & ir_relation_less))
+			++n_keep;
+	}
+	if (n_keep == n_entries)
+		return n;
+
+	ir_graph        *irg       = get_irn_irg(n);
+	ir_switch_table *new_table = n_keep > 0 ? ir_new_switch_table(irg, n_keep) : NULL;
+	bool            *reachable = XMALLOCNZ(bool, n_outs);
+	reachable[pn_Switch_default] = true;
+	for (size_t i = 0, e = 0; i < n_entries; ++i) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, i);
+		if (entry->pn != 0
+		 && !(tarval_cmp(entry->max, b->min) & ir_relation_less)
+		 && !(tarval_cmp(b->max, entry->min) & ir_relation_less)) {
+			ir_switch_table_set(new_table, e++, entry->min, entry->max,
+			                    entry->pn);
+			reachable[entry->pn] = true;
+		}
+	}
+
+	dbg_info  *dbgi   = get_irn_dbg_info(n);
+	ir_node   *block  = get_nodes_block(n);
+	ir_node   *bad    = new_r_Bad(irg, mode_X);
+	ir_node  **in     = XMALLOCN(ir_node*, n_outs);
+	if (n_keep == 0) {
+		/* only the default case remains */
+		for (unsigned o = 0; o < n_outs; ++o)
+			in[o] = bad;
+		in[pn_Switch_default] = new_rd_Jmp(dbgi, block);
+	} else {
+		ir_node *sw = new_rd_Switch(dbgi, block, op, n_outs, new_table);
+		for (unsigned o = 0; o < n_outs; ++o)
+			in[o] = reachable[o] ? new_r_Proj(sw, mode_X, o) : bad;
+	}
+	ir_node *tuple = new_r_Tuple(block, (int)n_outs, in);
+	free(in);
+	free(reachable);
+	return tuple;
 }
 
 /**
@@ -7608,6 +7667,10 @@ restart:;
 			goto restart;
 	}
 
+	/* the algebraic rules do not apply to element-wise vector operations */
+	if (mode_is_vector(get_irn_mode(n)))
+		return n;
+
 	/* Some more constant expression evaluation. */
 	if (get_opt_algebraic_simplification() ||
 		(iro == iro_Cond) ||
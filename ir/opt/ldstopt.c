@@ -24,10 +24,12 @@
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "irnodehashmap.h"
+#include "irnodeset.h"
 #include "iropt_dbg.h"
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irtools.h"
+#include "memssa.h"
 #include "panic.h"
 #include "set.h"
 #include "target_t.h"
@@ -378,6 +380,8 @@ static bool is_contained_in(ir_mode *const load_mode, const base_offset_t *const
 	/* simple case: previous value has the same mode */
 	if (load_mode == prev_mode)
 		return true;
+	if (mode_is_vector(load_mode) || mode_is_vector(prev_mode))
+		return false;
 
 	ir_mode_arithmetic prev_arithmetic = get_mode_arithmetic(prev_mode);
 	ir_mode_arithmetic load_arithmetic = get_mode_arithmetic(load_mode);
@@ -699,6 +703,13 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 			node = skip_Proj(get_CopyB_mem(node));
 		} else if (is_irn_const_memory(node)) {
 			node = skip_Proj(get_memop_mem(node));
+		} else if (is_Call(node)) {
+			/* check whether the callees may write the loaded memory */
+			ir_modref modref = get_call_modref(node, env->ptr, load_type,
+			                                   load_size);
+			if (modref & ir_modref_mod)
+				break;
+			node = skip_Proj(get_Call_mem(node));
 		} else {
 			/* be conservative about any other node and assume aliasing
 			 * that changes the loaded value */
@@ -1580,6 +1591,7 @@ typedef struct loop_env {
 	size_t           tos;          /**< tos index */
 	unsigned         nextDFSnum;   /**< the current DFS number */
 	unsigned         POnum;        /**< current post order number */
+	memssa_t        *memssa;       /**< memory SSA, created on demand */
 
 	changes_t        changes;      /**< a bitmask of graph changes */
 } loop_env;
@@ -1680,6 +1692,93 @@ static unsigned hash_cache_entry(const avail_entry_t *entry)
 	return get_irn_idx(entry->ptr)*9 + hash_ptr(entry->mode);
 }
 
+/**
+ * Checks whether a Store or Call of the SCC @p pscc may write the memory
+ * accessed with @p ptr.
+ */
+static bool is_written_in_scc(scc *pscc, loop_env *env, ir_node *ptr,
+                              ir_type *type, unsigned size)
+{
+	for (ir_node *other = pscc->head, *next; other != NULL; other = next) {
+		node_entry *ne = get_irn_ne(other, env);
+		next = ne->next;
+
+		if (is_Store(other)) {
+			ir_node *store_ptr   = get_Store_ptr(other);
+			ir_node *store_value = get_Store_value(other);
+			ir_type *store_type  = get_Store_type(other);
+			unsigned store_size  = get_mode_size_bytes(get_irn_mode(store_value));
+
+			ir_alias_relation rel = get_alias_relation(
+				store_ptr, store_type, store_size, ptr, type, size);
+			/* if the might be an alias, we cannot pass this Store */
+			if (rel != ir_no_alias)
+				return true;
+		} else if (is_Call(other)) {
+			ir_modref modref = get_call_modref(other, ptr, type, size);
+			if (modref & ir_modref_mod)
+				return true;
+		}
+		/* only Phis are left here, so ignore them */
+	}
+	return false;
+}
+
+/**
+ * Checks whether a definition of the memory SSA reaching @p load from
+ * inside the SCC @p pscc may write the loaded memory.  Only writers of the
+ * alias class of the Load are visited.
+ */
+static bool is_clobbered_in_loop(scc *pscc, loop_env *env,
+                                 memssa_def const *def, ir_node *load,
+                                 ir_nodeset_t *visited)
+{
+	ir_node  *ptr   = get_Load_ptr(load);
+	ir_type  *type  = get_Load_type(load);
+	unsigned  size  = get_mode_size_bytes(get_Load_mode(load));
+	unsigned  cls   = memssa_get_class(env->memssa, load);
+	for (;;) {
+		ir_node *node = memssa_get_node(def);
+		if (get_irn_ne(node, env)->pscc != pscc)
+			return false;
+
+		ir_node *mem;
+		switch (memssa_get_kind(def)) {
+		case MEMSSA_ENTRY:
+			return false;
+		case MEMSSA_PHI:
+		case MEMSSA_SYNC:
+			if (!ir_nodeset_insert(visited, node))
+				return false;
+			for (unsigned i = 0, n = memssa_get_n_preds(def); i < n; ++i) {
+				memssa_def const *pred = memssa_get_pred(def, i);
+				if (is_clobbered_in_loop(pscc, env, pred, load, visited))
+					return true;
+			}
+			return false;
+		case MEMSSA_DEF:
+			if (is_Store(node)) {
+				ir_node *value = get_Store_value(node);
+				ir_alias_relation rel = get_alias_relation(
+					get_Store_ptr(node), get_Store_type(node),
+					get_mode_size_bytes(get_irn_mode(value)), ptr, type, size);
+				if (rel != ir_no_alias)
+					return true;
+				mem = get_Store_mem(node);
+			} else if (is_Call(node)) {
+				ir_modref modref = get_call_modref(node, ptr, type, size);
+				if (modref & ir_modref_mod)
+					return true;
+				mem = get_Call_mem(node);
+			} else {
+				return true;
+			}
+			def = memssa_get_reaching_def(env->memssa, cls, mem);
+			break;
+		}
+	}
+}
+
 /**
  * Move loops out of loops if possible.
  *
@@ -1721,6 +1820,9 @@ static void move_loads_out_of_loops(scc *pscc, loop_env *env)
 	if (phi_list->next != NULL)
 		return;
 
+	if (env->memssa == NULL)
+		env->memssa = memssa_new(get_irn_irg(pscc->head));
+
 	set *avail = new_set(cmp_avail_entry, 8);
 
 	for (ir_node *load = pscc->head, *next; load != NULL; load = next) {
@@ -1743,28 +1845,22 @@ static void move_loads_out_of_loops(scc *pscc, loop_env *env)
 			ir_type  *load_type  = get_Load_type(load);
 			ir_mode  *load_mode  = get_Load_mode(load);
 			unsigned  load_size  = get_mode_size_bytes(load_mode);
-			ir_node  *other;
-			ir_node  *next_other;
-			for (other = pscc->head; other != NULL; other = next_other) {
-				node_entry *ne = get_irn_ne(other, env);
-				next_other = ne->next;
-
-				if (is_Store(other)) {
-					ir_node *store_ptr   = get_Store_ptr(other);
-					ir_node *store_value = get_Store_value(other);
-					ir_type *store_type  = get_Store_type(other);
-					unsigned store_size  = get_mode_size_bytes(get_irn_mode(store_value));
-
-					ir_alias_relation rel = get_alias_relation(
-						store_ptr, store_type, store_size,
-						ptr, load_type, load_size);
-					/* if the might be an alias, we cannot pass this Store */
-					if (rel != ir_no_alias)
-						break;
-				}
-				/* only Phis and pure Calls are allowed here, so ignore them */
+			/* only the writers of the alias class of the Load can change
+			 * the loaded value */
+			memssa_def const *const clobber
+				= memssa_get_clobber(env->memssa, load);
+			bool clobbered;
+			if (clobber != NULL) {
+				ir_nodeset_t visited;
+				ir_nodeset_init(&visited);
+				clobbered = is_clobbered_in_loop(pscc, env, clobber, load,
+				                                 &visited);
+				ir_nodeset_destroy(&visited);
+			} else {
+				clobbered = is_written_in_scc(pscc, env, ptr, load_type,
+				                              load_size);
 			}
-			if (other == NULL) {
+			if (!clobbered) {
 				ldst_info_t *ninfo = NULL;
 
 				/* yep, no aliasing Store found, Load can be moved */
@@ -1855,13 +1951,10 @@ static void process_loop(scc *pscc, loop_env *env)
 
 		switch (get_irn_opcode(irn)) {
 		case iro_Call:
-			if (is_irn_const_memory(irn)) {
-				/* pure calls can be treated like loads */
-				only_phi = false;
-				break;
-			}
-			/* non-pure calls must be handle like may-alias Stores */
-			goto fail;
+			/* Calls are checked with their mod/ref information like
+			 * may-alias Stores */
+			only_phi = false;
+			break;
 		case iro_CopyB:
 			/* cannot handle CopyB yet */
 			goto fail;
@@ -2085,6 +2178,8 @@ static changes_t optimize_loops(ir_graph *irg)
 	/* calculate the SCC's and drive loop optimization. */
 	do_dfs(irg, &env);
 
+	if (env.memssa != NULL)
+		memssa_free(env.memssa);
 	DEL_ARR_F(env.stack);
 	obstack_free(&env.obst, NULL);
 	ir_nodehashmap_destroy(&env.map);
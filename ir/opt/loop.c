@@ -12,6 +12,7 @@
 
 #include "array.h"
 #include "debug.h"
+#include "execfreq.h"
 #include "irbackedge_t.h"
 #include "ircons_t.h"
 #include "irdom.h"
@@ -27,6 +28,7 @@
 #include "irtools.h"
 #include "opt_init.h"
 #include "panic.h"
+#include "scev.h"
 #include "util.h"
 #include <math.h>
 #include <stdbool.h>
@@ -90,6 +92,8 @@ typedef struct loop_stats_t {
 	unsigned constant_unroll;
 	unsigned invariant_unroll;
 
+	unsigned unswitched;
+
 	unsigned unhandled;
 } loop_stats_t;
 
@@ -114,6 +118,7 @@ static void print_stats(void)
 	DB((dbg, LEVEL_2, "u_simple_counting :   %d\n", stats.u_simple_counting_loop));
 	DB((dbg, LEVEL_2, "constant_unroll   :   %d\n", stats.constant_unroll));
 	DB((dbg, LEVEL_2, "invariant_unroll  :   %d\n", stats.invariant_unroll));
+	DB((dbg, LEVEL_2, "unswitched        :   %d\n", stats.unswitched));
 	DB((dbg, LEVEL_2, "=======================================\n"));
 }
 
@@ -131,6 +136,11 @@ typedef struct loop_opt_params_t {
 	bool     allow_const_unrolling;
 	bool     allow_invar_unrolling;
 	unsigned invar_unrolling_min_size;  /* [nodes] */
+
+	unsigned max_unswitch_growth;   /* Maximum code growth [nodes] */
+	unsigned max_unswitch_versions; /* Maximum number of loop copies */
+	unsigned max_unswitch_weight;   /* Maximum execfreq weight of the growth */
+	unsigned max_invariant_depth;   /* Maximum depth of invariant selectors */
 } loop_opt_params_t;
 
 static loop_opt_params_t opt_params;
@@ -188,7 +198,8 @@ static struct obstack obst;
 typedef enum loop_op_t {
 	loop_op_inversion,
 	loop_op_unrolling,
-	loop_op_peeling
+	loop_op_peeling,
+	loop_op_unswitching
 } loop_op_t;
 
 /* Returns the maximum nodes for the given nest depth */
@@ -1705,47 +1716,6 @@ static unsigned get_const_pred(ir_node *const node, ir_node **const const_pred,
 		return 1;
 }
 
-/* Returns 1 if loop exits within 2 steps of the iv.
- * Norm_proj means we do not exit the loop.*/
-static unsigned simulate_next(ir_tarval **const count_tar, ir_tarval *const stepped, ir_tarval *const step_tar, ir_tarval *const end_tar, ir_relation const norm_proj)
-{
-	DB((dbg, LEVEL_4, "Loop taken if (stepped)%ld %s (end)%ld ",
-	    get_tarval_long(stepped),
-	    get_relation_string((norm_proj)),
-	    get_tarval_long(end_tar)));
-	DB((dbg, LEVEL_4, "comparing latest value %d\n", loop_info.latest_value));
-
-	/* If current iv does not stay in the loop,
-	 * this run satisfied the exit condition. */
-	if (!(tarval_cmp(stepped, end_tar) & norm_proj))
-		return 1;
-
-	DB((dbg, LEVEL_4, "Result: (stepped)%ld IS %s (end)%ld\n",
-	    get_tarval_long(stepped),
-	    get_relation_string(tarval_cmp(stepped, end_tar)),
-	    get_tarval_long(end_tar)));
-
-	/* next step */
-	ir_tarval *const next = is_Add(loop_info.add) ?
-		tarval_add(stepped, step_tar) :
-		tarval_sub(stepped, step_tar);
-
-	DB((dbg, LEVEL_4, "Loop taken if %ld %s %ld ",
-	    get_tarval_long(next),
-	    get_relation_string(norm_proj),
-	    get_tarval_long(end_tar)));
-	DB((dbg, LEVEL_4, "comparing latest value %d\n", loop_info.latest_value));
-
-	/* Increase steps. */
-	*count_tar = tarval_add(*count_tar, get_mode_one(get_tarval_mode(*count_tar)));
-
-	/* Next has to fail the loop condition, or we will never exit. */
-	if (!(tarval_cmp(next, end_tar) & norm_proj))
-		return 1;
-	else
-		return 0;
-}
-
 /* Check if loop meets requirements for a 'simple loop':
  * - Exactly one cf out
  * - Allowed calls
@@ -1944,7 +1914,7 @@ static unsigned get_preferred_factor_constant(ir_tarval *const count_tar)
 	 *           |   `--'      |      `--'
 	 */
 	/* loop passes % {6, 5, 4, 3, 2} == 0  */
-	ir_mode *const mode = get_irn_mode(loop_info.end_val);
+	ir_mode *const mode = get_tarval_mode(count_tar);
 	for (unsigned prefer = MIN(loop_info.max_unroll, 6); prefer != 1; --prefer) {
 		ir_tarval *const prefer_tv = new_tarval_from_long(prefer, mode);
 		if (tarval_is_null(tarval_mod(count_tar, prefer_tv))) {
@@ -1971,179 +1941,33 @@ static unsigned get_preferred_factor_constant(ir_tarval *const count_tar)
 	return b;
 }
 
-/* Check if cur_loop is a simple counting loop.
- * Start, step and end are constants.
- * TODO The whole constant case should use procedures similar to
- * the invariant case, as they are more versatile. */
-/* TODO split. */
-static unsigned get_unroll_decision_constant(void)
+/* Check if cur_loop is a simple counting loop,
+ * i.e. scalar evolution yields a constant trip count. */
+static unsigned get_unroll_decision_constant(ir_graph *const irg)
 {
 	/* RETURN if loop is not 'simple' */
 	ir_node *const cmp = is_simple_loop();
 	if (cmp == NULL)
 		return 0;
 
-	/* One in of the loop condition needs to be loop invariant. => end_val
-	 * The other in is assigned by an add. => add
-	 * The add uses a loop invariant value => step
-	 * and a phi with a loop invariant start_val and the add node as ins.
-	 *
-	 *  ^   ^
-	 *  |   | .-,
-	 *  |   Phi |
-	 *   \  |   |
-	 * ^  Add   |
-	 *  \  | \__|
-	 *   cond
-	 *    /\
-	*/
-
-	ir_node *iteration_path;
-	if (!get_const_pred(cmp, &loop_info.end_val, &iteration_path))
-		return 0;
-
-	DB((dbg, LEVEL_4, "End_val %N, other %N\n", loop_info.end_val, iteration_path));
-
-	/* We may find the add or the phi first.
-	 * Until now we only have end_val. */
-	unsigned is_latest_val;
-	if (is_Add(iteration_path) || is_Sub(iteration_path)) {
-		/* We test against the latest value of the iv. */
-		is_latest_val = 1;
-
-		loop_info.add = iteration_path;
-		DB((dbg, LEVEL_4, "Case 2: Got add %N (maybe not sane)\n", loop_info.add));
-
-		/* Preds of the add should be step and the iteration_phi */
-		if (!get_const_pred(loop_info.add, &loop_info.step, &loop_info.iteration_phi))
-			return 0;
-
-		DB((dbg, LEVEL_4, "Got step %N\n", loop_info.step));
-
-		if (!is_Phi(loop_info.iteration_phi))
-			return 0;
-
-		DB((dbg, LEVEL_4, "Got phi %N\n", loop_info.iteration_phi));
-
-		/* Find start_val.
-		 * Does necessary sanity check of add, if it is already set.  */
-		if (!get_start_and_add(constant))
-			return 0;
-
-		DB((dbg, LEVEL_4, "Got start %N\n", loop_info.start_val));
-	} else if (is_Phi(iteration_path)) {
-		/* We compare with the value the iv had entering this run. */
-		is_latest_val = 0;
-
-		loop_info.iteration_phi = iteration_path;
-		DB((dbg, LEVEL_4, "Case 1: Got phi %N \n", loop_info.iteration_phi));
-
-		/* Find start_val and add-node.
-		 * Does necessary sanity check of add, if it is already set.  */
-		if (!get_start_and_add(constant))
-			return 0;
-
-		DB((dbg, LEVEL_4, "Got start %N\n", loop_info.start_val));
-		DB((dbg, LEVEL_4, "Got add or sub %N\n", loop_info.add));
-
-		ir_node *new_iteration_phi;
-		if (!get_const_pred(loop_info.add, &loop_info.step, &new_iteration_phi))
-			return 0;
-
-		DB((dbg, LEVEL_4, "Got step %N\n", loop_info.step));
-
-		if (loop_info.iteration_phi != new_iteration_phi)
-			return 0;
-	} else {
-		return 0;
-	}
-
-	DB((dbg, LEVEL_4, "start %N, end %N, step %N\n", loop_info.start_val, loop_info.end_val, loop_info.step));
-
-	ir_mode *const mode = get_irn_mode(loop_info.end_val);
-	if (mode != mode_Is && mode != mode_Iu)
-		return 0;
-
-	/* TODO necessary? */
-	if (!are_mode_I(loop_info.start_val, loop_info.step, loop_info.end_val))
-		return 0;
-
-	DB((dbg, LEVEL_4, "mode integer\n"));
-
-	ir_tarval *const end_tar   = get_Const_tarval(loop_info.end_val);
-	ir_tarval *const start_tar = get_Const_tarval(loop_info.start_val);
-	ir_tarval *const step_tar  = get_Const_tarval(loop_info.step);
-
-	if (tarval_is_null(step_tar))
-		/* TODO Might be worth a warning. */
-		return 0;
-
-	DB((dbg, LEVEL_4, "step is not 0\n"));
-
-	if (!tarval_is_negative(step_tar) ^ !is_Sub(loop_info.add))
-		loop_info.decreasing = 1;
-
-	ir_tarval *const diff_tar = tarval_sub(end_tar, start_tar);
-
-	/* We need at least count_tar steps to be close to end_val, maybe more.
-	 * No way, that we have gone too many steps.
-	 * This represents the 'latest value'.
-	 * (If condition checks against latest value, is checked later) */
-	ir_tarval *count_tar = tarval_div(diff_tar, step_tar);
-
-	/* Iv will not pass end_val (except overflows).
-	 * Nothing done, as it would yield to no advantage. */
-	if (tarval_is_negative(count_tar)) {
-		DB((dbg, LEVEL_4, "Loop is endless or never taken."));
-		/* TODO Might be worth a warning. */
-		return 0;
-	}
-
-	++stats.u_simple_counting_loop;
-
-	loop_info.latest_value = is_latest_val;
-
-	/* stepped can be negative, if step < 0 */
-	ir_tarval *stepped = tarval_mul(count_tar, step_tar);
-
-	/* step as close to end_val as possible, */
-	/* |stepped| <= |end_tar|, and dist(stepped, end_tar) is smaller than a step. */
-	stepped = is_Add(loop_info.add) ? tarval_add(start_tar, stepped)
-	                                : tarval_sub(start_tar, stepped);
-
-	DB((dbg, LEVEL_4, "stepped to %ld\n", get_tarval_long(stepped)));
-
-	ir_relation const relation      = get_Cmp_relation(cmp);
-	/* Assure that norm_relation is the stay-in-loop case. */
-	ir_relation const norm_relation = loop_info.exit_cond == 1 ?
-		get_negated_relation(relation) : relation;
-
-	DB((dbg, LEVEL_4, "normalized projection %s\n", get_relation_string(norm_relation)));
-	/* Executed at most once (stay in counting loop if a Eq b) */
-	if (norm_relation == ir_relation_equal)
-		/* TODO Might be worth a warning. */
-		return 0;
-
-	/* calculates next values and increases count_tar according to it */
-	if (!simulate_next(&count_tar, stepped, step_tar, end_tar, norm_relation))
-		return 0;
-
-	/* We run loop once more, if we compare to the
-	 * not yet in-/decreased iv. */
-	if (is_latest_val == 0) {
-		DB((dbg, LEVEL_4, "condition uses not latest iv value\n"));
-		count_tar = tarval_add(count_tar, get_mode_one(mode));
-	}
-
-	DB((dbg, LEVEL_4, "loop taken %ld times\n", get_tarval_long(count_tar)));
-
-	/* Assure the loop is taken at least 1 time. */
-	if (tarval_is_null(count_tar)) {
-		/* TODO Might be worth a warning. */
-		return 0;
+	scev_info_t *const scev_info = scev_new(irg);
+	bool               may_be_zero;
+	scev const  *const backedges = scev_get_backedge_count(scev_info, cur_loop, &may_be_zero);
+	unsigned           res       = 0;
+	if (backedges != NULL && scev_is_constant(backedges) && !may_be_zero) {
+		/* The loop is tail-controlled, so the body runs once more than the
+		 * backedges are taken. */
+		ir_tarval *const count_tar = tarval_add(backedges->offset, get_mode_one(get_tarval_mode(backedges->offset)));
+		DB((dbg, LEVEL_4, "loop taken %T times\n", count_tar));
+
+		/* Assure the loop is taken at least 1 time. */
+		if (!tarval_is_null(count_tar) && tarval_is_long(count_tar)) {
+			++stats.u_simple_counting_loop;
+			res = get_preferred_factor_constant(count_tar);
+		}
 	}
-
-	return get_preferred_factor_constant(count_tar);
+	scev_free(scev_info);
+	return res;
 }
 
 /**
@@ -2175,7 +1999,7 @@ static void unroll_loop(ir_graph *const irg)
 
 	/* constant case? */
 	if (opt_params.allow_const_unrolling)
-		unroll_nr = get_unroll_decision_constant();
+		unroll_nr = get_unroll_decision_constant(irg);
 	if (unroll_nr > 1) {
 		loop_info.unroll_kind = constant;
 	} else {
@@ -2223,6 +2047,212 @@ static void unroll_loop(ir_graph *const irg)
 	}
 }
 
+/***** Unswitching *****/
+
+/* Returns true if node can be computed in front of the loop.
+ * Such nodes are either defined outside of the loop or floating
+ * computations of loop invariant values. */
+static bool is_invariant_value(ir_node *const node, unsigned const depth)
+{
+	if (!is_in_loop(node))
+		return true;
+	if (depth == 0 || is_Phi(node) || get_irn_pinned(node)
+	 || get_irn_mode(node) == mode_M || get_irn_mode(node) == mode_T)
+		return false;
+	foreach_irn_in(node, i, pred) {
+		if (!is_invariant_value(pred, depth - 1))
+			return false;
+	}
+	return true;
+}
+
+/* Copies the loop invariant computation node into block. */
+static ir_node *copy_invariant_value(ir_node *const node, ir_node *const block)
+{
+	if (!is_in_loop(node))
+		return node;
+
+	ir_node *const cp = exact_copy(node);
+	set_nodes_block(cp, block);
+	foreach_irn_in(node, i, pred) {
+		set_irn_n(cp, i, copy_invariant_value(pred, block));
+	}
+	return cp;
+}
+
+/* Walker searching the loop for the most frequently executed Cond or Switch
+ * with a loop invariant selector. */
+static void find_unswitch_candidate(ir_node *const node, void *const env)
+{
+	ir_node **const best = (ir_node**)env;
+	if (!(is_Cond(node) || is_Switch(node)) || !is_in_loop(node))
+		return;
+	if (!is_invariant_value(get_irn_n(node, 0), opt_params.max_invariant_depth))
+		return;
+
+	/* Unswitching a loop exit would leave an endless loop. */
+	unsigned n_projs = 0;
+	foreach_out_edge(node, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		foreach_out_edge(proj, succ_edge) {
+			if (!is_in_loop(get_edge_src_irn(succ_edge)))
+				return;
+		}
+		++n_projs;
+	}
+	if (n_projs < 2 || n_projs > opt_params.max_unswitch_versions)
+		return;
+
+	if (*best == NULL || get_block_execfreq(get_nodes_block(node))
+	                     > get_block_execfreq(get_nodes_block(*best)))
+		*best = node;
+}
+
+/* Makes the copy nr of the loop always take the control flow edge taken.
+ * Copy 0 is the original loop. */
+static void specialize_unswitch_copy(ir_node *const *const projs,
+                                     int const n_projs, int const nr,
+                                     ir_node *const taken)
+{
+	for (int i = 0; i < n_projs; ++i) {
+		ir_node *const proj = nr == 0 ? projs[i] : get_unroll_copy(projs[i], nr);
+		if (proj == NULL)
+			continue;
+		ir_node  *const block = get_nodes_block(proj);
+		ir_graph *const irg   = get_irn_irg(block);
+		if (projs[i] == taken)
+			exchange(proj, new_r_Jmp(block));
+		else
+			exchange(proj, new_r_Bad(irg, mode_X));
+	}
+}
+
+/* Unswitching: Duplicates the loop for every outcome of a Cond or Switch
+ * with a loop invariant selector. The selector is evaluated once in front of
+ * the loop, each copy of the loop always follows its outcome. */
+static void unswitch_loop(ir_graph *const irg)
+{
+	ir_node *cfop = NULL;
+	irg_walk_graph(irg, find_unswitch_candidate, NULL, &cfop);
+	if (cfop == NULL)
+		return;
+
+	/* Only loops with a single entry and a single exit are handled, so that
+	 * the copies need only be merged in one block. */
+	int entry_pos = -1;
+	foreach_irn_in(loop_head, i, pred) {
+		if (is_in_loop(pred))
+			continue;
+		if (entry_pos >= 0)
+			return;
+		entry_pos = i;
+	}
+	if (entry_pos < 0 || loop_info.cf_outs != 1)
+		return;
+
+	ir_node **const projs   = ALLOCAN(ir_node*, opt_params.max_unswitch_versions);
+	int             n_projs = 0;
+	foreach_out_edge(cfop, edge) {
+		projs[n_projs++] = get_edge_src_irn(edge);
+	}
+
+	/* The code growth is weighted with the execution frequency of the
+	 * condition relative to one execution of the function. */
+	double         budget = opt_params.max_unswitch_growth;
+	ir_node *const start  = get_irg_start_block(irg);
+	double   const freq   = get_block_execfreq(start);
+	if (freq > 0.0) {
+		double const weight = get_block_execfreq(get_nodes_block(cfop)) / freq;
+		budget *= MIN(weight, (double)opt_params.max_unswitch_weight);
+	}
+	unsigned const growth = loop_info.nodes * (unsigned)(n_projs - 1);
+	if (growth > budget) {
+		DB((dbg, LEVEL_2, "Unswitching %N would grow by %u > %f nodes\n",
+		    cfop, growth, budget));
+		++stats.too_large;
+		return;
+	}
+
+	DB((dbg, LEVEL_2, " *** Unswitching %N into %d loops ***\n", cfop, n_projs));
+
+	loop_entries = NEW_ARR_F(entry_edge, 0);
+	irg_walk_graph(irg, get_loop_entries, NULL, NULL);
+
+	/* Split the exit edge, the new block merges the copies. */
+	ir_node *exit = NULL;
+	for (size_t i = 0; i < ARR_LEN(loop_entries); ++i) {
+		entry_edge *const entry = &loop_entries[i];
+		if (!is_Block(entry->node))
+			continue;
+		exit = new_r_Block(irg, 1, &entry->pred);
+		set_irn_n(entry->node, entry->pos, new_r_Jmp(exit));
+		entry->node = exit;
+		entry->pos  = 0;
+	}
+	assert(exit != NULL);
+
+	unroll_nr = n_projs;
+	ir_nodemap_init(&map, irg);
+	obstack_init(&obst);
+
+	copy_loop(irg, loop_entries, n_projs - 1);
+
+	/* Merge the copies in the exit block. */
+	ir_node  *const end    = get_irg_end(irg);
+	ir_node **const in     = ALLOCAN(ir_node*, n_projs);
+	ir_node  *const exit_x = get_Block_cfgpred(exit, 0);
+	for (int c = 0; c < n_projs; ++c)
+		in[c] = c == 0 ? exit_x : get_unroll_copy(exit_x, c);
+	set_irn_in(exit, n_projs, in);
+
+	ir_nodemap exit_phis;
+	ir_nodemap_init(&exit_phis, irg);
+	for (size_t i = 0; i < ARR_LEN(loop_entries); ++i) {
+		entry_edge const entry = loop_entries[i];
+		if (is_Block(entry.node))
+			continue;
+		if (entry.node == end) {
+			for (int c = 1; c < n_projs; ++c)
+				add_End_keepalive(end, get_unroll_copy(entry.pred, c));
+			continue;
+		}
+
+		ir_node *phi = ir_nodemap_get(ir_node, &exit_phis, entry.pred);
+		if (phi == NULL) {
+			for (int c = 0; c < n_projs; ++c)
+				in[c] = c == 0 ? entry.pred : get_unroll_copy(entry.pred, c);
+			phi = new_r_Phi(exit, n_projs, in, get_irn_mode(entry.pred));
+			ir_nodemap_insert(&exit_phis, entry.pred, phi);
+		}
+		set_irn_n(entry.node, entry.pos, phi);
+	}
+	ir_nodemap_destroy(&exit_phis);
+
+	/* Evaluate the condition once and enter the matching copy. */
+	ir_node *const entry_x  = get_Block_cfgpred(loop_head, entry_pos);
+	ir_node *const pre      = new_r_Block(irg, 1, &entry_x);
+	ir_node *const dispatch = exact_copy(cfop);
+	set_nodes_block(dispatch, pre);
+	set_irn_n(dispatch, 0, copy_invariant_value(get_irn_n(cfop, 0), pre));
+	for (int c = 0; c < n_projs; ++c) {
+		unsigned const pn   = get_Proj_num(projs[c]);
+		ir_node  *const head = c == 0 ? loop_head : get_unroll_copy(loop_head, c);
+		set_irn_n(head, entry_pos, new_r_Proj(dispatch, mode_X, pn));
+	}
+
+	/* Specialize the copies, the original is done last, as the copies are
+	 * looked up through its nodes. */
+	for (int c = n_projs; c-- > 0;)
+		specialize_unswitch_copy(projs, n_projs, c, projs[c]);
+
+	++stats.unswitched;
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+
+	DEL_ARR_F(loop_entries);
+	obstack_free(&obst, NULL);
+	ir_nodemap_destroy(&map);
+}
+
 /* Analyzes the loop, and checks if size is within allowed range.
  * Decides if loop will be processed. */
 static void init_analyze(ir_graph *const irg, ir_loop *const loop, loop_op_t const loop_op)
@@ -2254,8 +2284,9 @@ static void init_analyze(ir_graph *const irg, ir_loop *const loop, loop_op_t con
 	}
 
 	switch (loop_op) {
-		case loop_op_inversion: loop_inversion(irg); break;
-		case loop_op_unrolling: unroll_loop(irg);    break;
+		case loop_op_inversion:   loop_inversion(irg); break;
+		case loop_op_unrolling:   unroll_loop(irg);    break;
+		case loop_op_unswitching: unswitch_loop(irg);  break;
 		default: panic("loop optimization not implemented");
 	}
 	DB((dbg, LEVEL_1, "       <<<< end of loop with node %ld >>>>\n", get_loop_loop_nr(loop)));
@@ -2290,6 +2321,10 @@ static void set_loop_params(void)
 	opt_params.invar_unrolling_min_size =   20;
 	opt_params.max_unrolled_loop_size   =  400;
 	opt_params.max_branches             = 9999;
+	opt_params.max_unswitch_growth      =  200;
+	opt_params.max_unswitch_versions    =    4;
+	opt_params.max_unswitch_weight      =    4;
+	opt_params.max_invariant_depth      =    8;
 }
 
 /**
@@ -2371,6 +2406,15 @@ void do_loop_peeling(ir_graph *const irg)
 	loop_optimization(irg, loop_op_peeling);
 }
 
+void do_loop_unswitching(ir_graph *const irg)
+{
+	/* The candidates and the growth budget depend on the execution
+	 * frequencies. */
+	if (get_block_execfreq(get_irg_start_block(irg)) <= 0.0)
+		ir_estimate_execfreq(irg);
+	loop_optimization(irg, loop_op_unswitching);
+}
+
 void firm_init_loop_opt(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.opt.loop");
@@ -0,0 +1,562 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Replacement of memory filling and copying loops by library calls.
+ *
+ * Innermost counted loops consisting of the header and at most one further
+ * block, whose only memory access is a store to consecutive addresses, are
+ * replaced by a single operation in front of the loop:
+ *
+ *   for (i = 0; i < n; ++i) a[i] = c;     becomes  memset(a, c, n * size)
+ *   for (i = 0; i < n; ++i) a[i] = b[i];  becomes  memcpy(a, b, n * size)
+ *
+ * The stored value must be loop invariant and consist of equal bytes, or it
+ * must be loaded in the same iteration from consecutive addresses with the
+ * same stride.  Copies become memcpy calls only if the dependence test or
+ * the alias relation of the base addresses shows that the copied ranges do
+ * not overlap in any iteration.  Copies between memory which may overlap
+ * are turned into memmove calls if the destination lies in front of the
+ * source by a constant distance, so the loop reads every element before it
+ * is overwritten, other overlapping copies are kept.  Copies of a small constant number of bytes become CopyB
+ * nodes, other loops with a small constant trip count are left to the
+ * unroller.
+ */
+#include "debug.h"
+#include "depend.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "scev.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Maximum number of bytes copied by a CopyB node instead of memcpy. */
+#define MAX_COPYB_SIZE 64
+
+typedef enum idiom_kind {
+	IDIOM_MEMSET,
+	IDIOM_MEMCPY,
+	IDIOM_MEMMOVE,
+} idiom_kind;
+
+typedef struct idiom_env_t {
+	ir_graph     *irg;
+	ir_loop      *loop;
+	scev_info_t  *scev;
+	dep_info_t   *dep;
+	loop_shape_t  shape;
+	scev const   *count;        /**< backedge count */
+	bool          may_be_zero;  /**< count is only valid if the first test
+	                                 stays in the loop */
+	ir_node      *mem_phi;      /**< the memory Phi of the header */
+	ir_node      *store;        /**< the only Store of the loop */
+	ir_node      *load;         /**< the Load of the stored value or NULL */
+	scev const   *dst;          /**< evolution of the Store address */
+	scev const   *src;          /**< evolution of the Load address */
+	idiom_kind    kind;
+	ir_nodemap    exit_values;  /**< values used after the loop */
+} idiom_env_t;
+
+/**
+ * Checks that the loop contains no side effects besides a single Store and
+ * possibly the Load of the stored value and finds them.
+ */
+static bool check_loop_nodes(idiom_env_t *const env)
+{
+	ir_node *const blocks[] = { env->shape.header, env->shape.latch };
+	ir_node *const cond     = get_Proj_pred(env->shape.exit);
+	for (size_t b = 0; b < ARRAY_SIZE(blocks); ++b) {
+		if (b > 0 && blocks[b] == blocks[0])
+			break;
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			ir_mode *const mode = get_irn_mode(node);
+			if (is_Phi(node)) {
+				if (get_nodes_block(node) != env->shape.header)
+					return false;
+				if (mode == mode_M) {
+					if (env->mem_phi != NULL)
+						return false;
+					env->mem_phi = node;
+				}
+			} else if (mode == mode_X || is_cfop(node)) {
+				if (node != cond && get_nodes_block(node) != env->shape.latch
+				 && (!is_Proj(node) || get_Proj_pred(node) != cond))
+					return false;
+			} else if (is_Store(node)) {
+				if (env->store != NULL || get_Store_volatility(node) == volatility_is_volatile
+				 || ir_throws_exception(node))
+					return false;
+				env->store = node;
+			} else if (is_Load(node)) {
+				if (env->load != NULL || get_Load_volatility(node) == volatility_is_volatile
+				 || ir_throws_exception(node))
+					return false;
+				env->load = node;
+			} else if (is_Proj(node)) {
+				ir_node *const pred = get_Proj_pred(node);
+				if (!is_Load(pred) && !is_Store(pred))
+					return false;
+			} else if (mode == mode_M || mode == mode_T || get_irn_pinned(node)) {
+				return false;
+			}
+		}
+	}
+	return env->mem_phi != NULL && env->store != NULL;
+}
+
+/**
+ * Checks that the memory of the loop flows from the memory Phi through the
+ * Load, if any, to the Store and back and that the Load result is only
+ * stored.
+ */
+static bool check_memory(idiom_env_t const *const env)
+{
+	ir_node *const store = env->store;
+	ir_node *const load  = env->load;
+	ir_node *const back  = get_irn_n(env->mem_phi, 1 - env->shape.entry_pos);
+	if (!is_Proj(back) || get_Proj_pred(back) != store)
+		return false;
+
+	ir_node *const mem = get_Store_mem(store);
+	if (load == NULL)
+		return mem == env->mem_phi;
+
+	if (!is_Proj(mem) || get_Proj_pred(mem) != load
+	 || get_Load_mem(load) != env->mem_phi)
+		return false;
+	ir_node *const value = get_Store_value(store);
+	if (!is_Proj(value) || get_Proj_pred(value) != load
+	 || get_Proj_num(value) != pn_Load_res || get_irn_n_edges(value) != 1
+	 || get_Load_mode(load) != get_irn_mode(value))
+		return false;
+	foreach_out_edge(load, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (proj != value && proj != mem)
+			return false;
+	}
+	return get_irn_n_edges(mem) == 1;
+}
+
+/**
+ * Returns the evolution of the address @p ptr if it increases by @p size
+ * bytes per iteration and starts at a value computable before the loop.
+ */
+static scev const *get_address(idiom_env_t const *const env,
+                               ir_node *const ptr, unsigned const size)
+{
+	scev const *const s = scev_get(env->scev, ptr);
+	if (s->kind != SCEV_ADDREC || s->loop != env->loop
+	 || !scev_is_constant(s->step) || !tarval_is_long(s->step->offset)
+	 || get_tarval_long(s->step->offset) != (long)size
+	 || !scev_is_buildable(s->start))
+		return NULL;
+	return s;
+}
+
+/** Checks whether @p node can be computed in front of the loop. */
+static bool is_invariant(idiom_env_t const *const env, ir_node *const node)
+{
+	if (!is_in_loop_shape(&env->shape, node))
+		return true;
+	if (is_Phi(node) || get_irn_pinned(node) || get_irn_mode(node) == mode_M
+	 || get_irn_mode(node) == mode_T)
+		return false;
+	foreach_irn_in(node, i, pred) {
+		if (!is_invariant(env, pred))
+			return false;
+	}
+	return true;
+}
+
+/** Moves the loop invariant @p node and its operands into @p block. */
+static void move_invariant(idiom_env_t const *const env, ir_node *const node,
+                           ir_node *const block)
+{
+	if (!is_in_loop_shape(&env->shape, node))
+		return;
+	set_nodes_block(node, block);
+	foreach_irn_in(node, i, pred) {
+		move_invariant(env, pred, block);
+	}
+}
+
+/**
+ * Returns the byte which is repeated in the stored value or -1 if the value
+ * consists of different bytes.
+ */
+static int get_fill_byte(ir_node *const value)
+{
+	if (!is_Const(value))
+		return -1;
+	ir_tarval *const tv   = get_Const_tarval(value);
+	unsigned   const size = get_mode_size_bytes(get_tarval_mode(tv));
+	unsigned char const byte = get_tarval_sub_bits(tv, 0);
+	for (unsigned i = 1; i < size; ++i) {
+		if (get_tarval_sub_bits(tv, i) != byte)
+			return -1;
+	}
+	return byte;
+}
+
+/**
+ * Returns the only symbol of the decomposed address @p ptr if it is a
+ * pointer, i.e. the base address, or NULL.
+ */
+static ir_node *get_base(idiom_env_t const *const env, ir_node *const ptr)
+{
+	dep_affine affine;
+	if (!dep_decompose(env->dep, ptr, get_nodes_block(ptr), &affine)
+	 || affine.n_symbols != 1 || affine.symbols[0].coeff != 1)
+		return NULL;
+	ir_node *const base = affine.symbols[0].node;
+	return mode_is_reference(get_irn_mode(base)) ? base : NULL;
+}
+
+/**
+ * Checks that the Store never overwrites memory read by the Load, in the
+ * same or any other iteration.  The alias relation of the addresses of a
+ * single iteration does not suffice, e.g. for a copy to src + 1.
+ */
+static bool is_disjoint_copy(idiom_env_t const *const env)
+{
+	ir_node   *const store = env->store;
+	ir_node   *const load  = env->load;
+	dep_result result;
+	if (!dep_test_memops(env->dep, store, load, &result))
+		return true;
+
+	/* The dependence test does not distinguish objects.  Different base
+	 * addresses, which do not alias, point into different objects. */
+	ir_node *const dst_base = get_base(env, get_Store_ptr(store));
+	ir_node *const src_base = get_base(env, get_Load_ptr(load));
+	if (dst_base == NULL || src_base == NULL || dst_base == src_base)
+		return false;
+	unsigned const size = get_mode_size_bytes(get_Load_mode(load));
+	return get_alias_relation(dst_base, get_Store_type(store), size,
+	                          src_base, get_Load_type(load), size)
+	    == ir_no_alias;
+}
+
+/** Determines which library function implements the loop. */
+static bool find_idiom(idiom_env_t *const env)
+{
+	ir_node *const store = env->store;
+	ir_node *const value = get_Store_value(store);
+	ir_mode *const mode  = get_irn_mode(value);
+	unsigned const size  = get_mode_size_bytes(mode);
+	if (size == 0 || get_mode_size_bits(mode) != size * 8)
+		return false;
+	env->dst = get_address(env, get_Store_ptr(store), size);
+	if (env->dst == NULL)
+		return false;
+
+	ir_node *const load = env->load;
+	if (load == NULL) {
+		env->kind = IDIOM_MEMSET;
+		return is_invariant(env, value)
+		    && (size == 1 ? mode_is_int(mode) : get_fill_byte(value) >= 0);
+	}
+
+	env->src = get_address(env, get_Load_ptr(load), size);
+	if (env->src == NULL)
+		return false;
+	/* The addresses differ by the same amount in every iteration.  Copying
+	 * front to back is correct if no element is overwritten before it is
+	 * read. */
+	long distance;
+	if (scev_get_distance(env->src->start, env->dst->start, &distance)) {
+		if (distance >= 0)
+			return false;
+		env->kind = IDIOM_MEMMOVE;
+		return true;
+	}
+	env->kind = IDIOM_MEMCPY;
+	return is_disjoint_copy(env);
+}
+
+/**
+ * Computes the values of the loop used after it.  Only values of the exit
+ * iteration, which are known to the scalar evolution analysis, are allowed.
+ */
+static bool find_exit_values(idiom_env_t *const env)
+{
+	ir_node *const blocks[] = { env->shape.header, env->shape.latch };
+	for (size_t b = 0; b < ARRAY_SIZE(blocks); ++b) {
+		if (b > 0 && blocks[b] == blocks[0])
+			break;
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			ir_mode *const mode = get_irn_mode(node);
+			if (mode == mode_X || mode == mode_M || mode == mode_T)
+				continue;
+			bool used = false;
+			foreach_out_edge(node, use) {
+				ir_node *const user = get_edge_src_irn(use);
+				if (!is_in_loop_shape(&env->shape, user) && !is_End(user))
+					used = true;
+			}
+			if (!used)
+				continue;
+			if (get_nodes_block(node) != env->shape.header)
+				return false;
+			scev const *const s = scev_get_exit_value(env->scev, node, env->loop);
+			if (s == NULL || !scev_is_buildable(s))
+				return false;
+			ir_nodemap_insert(&env->exit_values, node, (void*)s);
+		}
+	}
+	return true;
+}
+
+/** Returns the evolution of @p node in the first iteration or NULL. */
+static scev const *get_first_value(idiom_env_t const *const env,
+                                   ir_node *const node)
+{
+	scev const *s = scev_get(env->scev, node);
+	if (s->kind == SCEV_ADDREC && s->loop == env->loop)
+		s = s->start;
+	if (!scev_is_invariant(s, env->loop) || !scev_is_buildable(s))
+		return NULL;
+	return s;
+}
+
+/** Checks whether the first exit test can be evaluated before the loop. */
+static bool is_first_test_known(idiom_env_t const *const env)
+{
+	return !env->may_be_zero
+	    || (get_first_value(env, get_Cmp_left(env->shape.cmp)) != NULL
+	     && get_first_value(env, get_Cmp_right(env->shape.cmp)) != NULL);
+}
+
+/**
+ * Builds the number of executions of the Store.  If the count is only valid
+ * if the loop is entered, the first exit test selects it in a new block,
+ * which replaces @p block.
+ */
+static ir_node *build_count(idiom_env_t const *const env, ir_node **const block,
+                            ir_mode *const umode)
+{
+	ir_graph *const irg = env->irg;
+	ir_node  *const pre = *block;
+	/* A store in the header is executed in the exit iteration, too.  The
+	 * count is widened first, so adding this iteration cannot overflow. */
+	bool     const in_header = get_nodes_block(env->store) == env->shape.header;
+	ir_node *const count     = scev_build_count(env->count, in_header, pre,
+	                                            umode);
+	if (!env->may_be_zero)
+		return count;
+
+	ir_node    *const cmp      = env->shape.cmp;
+	ir_relation       relation = get_Cmp_relation(cmp);
+	if (env->shape.exit_on_true)
+		relation = get_negated_relation(relation);
+	ir_node *const left  = scev_build(get_first_value(env, get_Cmp_left(cmp)), pre);
+	ir_node *const right = scev_build(get_first_value(env, get_Cmp_right(cmp)), pre);
+	ir_node *const stays = new_r_Cmp(pre, left, right, relation);
+	ir_node *const cond  = new_r_Cond(pre, stays);
+	ir_node *const join_in[] = {
+		new_r_Proj(cond, mode_X, pn_Cond_true),
+		new_r_Proj(cond, mode_X, pn_Cond_false),
+	};
+	ir_node *const join = new_r_Block(irg, ARRAY_SIZE(join_in), join_in);
+	ir_node *const in[] = { count, new_r_Const_long(irg, umode, in_header) };
+	*block = join;
+	return new_r_Phi(join, ARRAY_SIZE(in), in, umode);
+}
+
+static ir_type *get_method_type(idiom_kind const kind, ir_mode *const umode)
+{
+	ir_type *const tp = new_type_method(3, 1, false, cc_cdecl_set,
+	                                    mtp_no_property);
+	ir_mode *const value_mode = kind == IDIOM_MEMSET ? mode_Is : mode_P;
+	set_method_param_type(tp, 0, get_type_for_mode(mode_P));
+	set_method_param_type(tp, 1, get_type_for_mode(value_mode));
+	set_method_param_type(tp, 2, get_type_for_mode(umode));
+	set_method_res_type  (tp, 0, get_type_for_mode(mode_P));
+	return tp;
+}
+
+/** Builds the operation replacing the loop and returns its memory. */
+static ir_node *build_idiom(idiom_env_t const *const env, ir_node *const block,
+                            ir_node *const count, ir_mode *const umode)
+{
+	ir_graph *const irg   = env->irg;
+	ir_node  *const store = env->store;
+	dbg_info *const dbgi  = get_irn_dbg_info(store);
+	ir_node  *const mem   = get_irn_n(env->mem_phi, env->shape.entry_pos);
+	ir_node  *const value = get_Store_value(store);
+	ir_mode  *const mode  = get_irn_mode(value);
+	unsigned  const size  = get_mode_size_bytes(mode);
+	ir_node  *const dst   = scev_build(env->dst->start, block);
+
+	ir_node *arg;
+	if (env->kind == IDIOM_MEMSET) {
+		if (size == 1) {
+			move_invariant(env, value, block);
+			arg = new_r_Conv(block, value, mode_Is);
+		}
+		else
+			arg = new_r_Const_long(irg, mode_Is, get_fill_byte(value));
+	} else {
+		arg = scev_build(env->src->start, block);
+		if (is_Const(count) && env->kind == IDIOM_MEMCPY) {
+			ir_tarval *const n = get_Const_tarval(count);
+			if (tarval_is_long(n)
+			 && get_tarval_long(n) * size <= MAX_COPYB_SIZE) {
+				ir_type *const type = new_type_array(get_Store_type(store),
+				                                     get_tarval_long(n));
+				return new_rd_CopyB(dbgi, block, mem, dst, arg, type, cons_none);
+			}
+		}
+	}
+
+	static char const *const names[] = {
+		[IDIOM_MEMSET]  = "memset",
+		[IDIOM_MEMCPY]  = "memcpy",
+		[IDIOM_MEMMOVE] = "memmove",
+	};
+	ir_type   *const mtp    = get_method_type(env->kind, umode);
+	ir_entity *const ent    = create_compilerlib_entity(names[env->kind], mtp);
+	ir_node   *const callee = new_r_Address(irg, ent);
+	ir_node   *const bytes  = new_r_Mul(block, count,
+	                                    new_r_Const_long(irg, umode, size));
+	ir_node   *const in[]   = { dst, arg, bytes };
+	ir_node   *const call   = new_rd_Call(dbgi, block, mem, callee,
+	                                      ARRAY_SIZE(in), in, mtp);
+	return new_r_Proj(call, mode_M, pn_Call_M);
+}
+
+static bool replace_loop(idiom_env_t *const env)
+{
+	env->count = scev_get_backedge_count(env->scev, env->loop,
+	                                     &env->may_be_zero);
+	if (env->count == NULL || !scev_is_buildable(env->count)
+	 || !check_loop_nodes(env) || !check_memory(env) || !find_idiom(env)
+	 || !find_exit_values(env) || !is_first_test_known(env))
+		return false;
+
+	/* Short constant loops are better unrolled, unless they become a
+	 * CopyB. */
+	unsigned const size = get_mode_size_bytes(get_irn_mode(get_Store_value(env->store)));
+	if (scev_is_constant(env->count) && !env->may_be_zero) {
+		ir_tarval *const count = env->count->offset;
+		if (!tarval_is_long(count))
+			return false;
+		long const n = get_tarval_long(count)
+		             + (get_nodes_block(env->store) == env->shape.header);
+		if (n <= 0 || (env->kind != IDIOM_MEMCPY && n * size <= MAX_COPYB_SIZE))
+			return false;
+	}
+
+	ir_graph *const irg    = env->irg;
+	ir_node  *const header = env->shape.header;
+	ir_node  *const entry  = get_Block_cfgpred(header, env->shape.entry_pos);
+	ir_node        *block  = new_r_Block(irg, 1, &entry);
+	ir_mode  *const umode  = find_unsigned_mode(get_reference_offset_mode(mode_P));
+	ir_node  *const count  = build_count(env, &block, umode);
+	ir_node  *const mem    = build_idiom(env, block, count, umode);
+
+	/* Replace the values of the loop used after it. */
+	ir_node *const blocks[] = { env->shape.header, env->shape.latch };
+	for (size_t b = 0; b < ARRAY_SIZE(blocks); ++b) {
+		if (b > 0 && blocks[b] == blocks[0])
+			break;
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			ir_mode *const mode = get_irn_mode(node);
+			if (mode == mode_X || mode == mode_T)
+				continue;
+			ir_node *value = mem;
+			if (mode != mode_M) {
+				scev const *const s = ir_nodemap_get(scev const, &env->exit_values, node);
+				if (s == NULL)
+					continue;
+				value = scev_build(s, block);
+			}
+			foreach_out_edge_safe(node, use) {
+				ir_node *const user = get_edge_src_irn(use);
+				if (!is_in_loop_shape(&env->shape, user) && !is_End(user))
+					set_irn_n(user, get_edge_src_pos(use), value);
+			}
+		}
+	}
+
+	/* Leave the new block instead of the loop. */
+	foreach_out_edge_safe(env->shape.exit, edge) {
+		ir_node *const succ = get_edge_src_irn(edge);
+		if (is_Block(succ))
+			set_Block_cfgpred(succ, get_edge_src_pos(edge), new_r_Jmp(block));
+	}
+	ir_node *const bad = new_r_Bad(irg, mode_X);
+	set_Block_cfgpred(header, 0, bad);
+	set_Block_cfgpred(header, 1, bad);
+	foreach_out_edge(header, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (is_Phi(node))
+			remove_keep_alive(node);
+	}
+	remove_keep_alive(header);
+	remove_keep_alive(env->shape.latch);
+
+	DB((dbg, LEVEL_1, "replaced %+F by %s\n", header,
+	    env->kind == IDIOM_MEMSET ? "memset" :
+	    env->kind == IDIOM_MEMCPY ? "memcpy" : "memmove"));
+	return true;
+}
+
+static bool replace_innermost(ir_graph *const irg, scev_info_t *const scev,
+                              dep_info_t *const dep, ir_loop *const loop)
+{
+	idiom_env_t env;
+	memset(&env, 0, sizeof(env));
+	env.irg  = irg;
+	env.loop = loop;
+	env.scev = scev;
+	env.dep  = dep;
+	if (!get_loop_shape(loop, &env.shape))
+		return false;
+
+	ir_nodemap_init(&env.exit_values, irg);
+	bool const changed = replace_loop(&env);
+	ir_nodemap_destroy(&env.exit_values);
+	return changed;
+}
+
+void replace_loop_idioms(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_idiom");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **const loops = get_innermost_loops(irg);
+
+	scev_info_t *const scev    = scev_new(irg);
+	dep_info_t  *const dep     = dep_new(irg);
+	bool               changed = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		if (replace_innermost(irg, scev, dep, loops[i]))
+			changed = true;
+	}
+	dep_free(dep);
+	scev_free(scev);
+	DEL_ARR_F(loops);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,712 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interchange and tiling of perfectly nested counted loops.
+ *
+ * A counted loop, whose body consists of a single innermost counted loop
+ * and the update of its own induction variable, forms a perfect nest with
+ * this loop.  If the bounds of both loops are invariant in the nest, the
+ * nest iterates over a rectangle and the loops can be exchanged by swapping
+ * the roles of the two induction variables.  This is legal if no dependence
+ * between the memory accesses of the inner loop is reversed and is done if
+ * the accesses of the new inner loop have smaller strides, measured in
+ * cache lines.
+ *
+ * If an access in the inner loop touches the same or neighbouring memory in
+ * consecutive iterations of the outer loop, but the inner loop walks away
+ * from it, the iterations of the inner loop are additionally split into
+ * tiles by a new loop around the nest:
+ *
+ *   for (jj = j0; ; jj += T) {
+ *     for (i = i0; i < n; ++i)
+ *       for (j = jj; j < m && j - jj < T; ++j)
+ *         ...
+ *     if (!(jj < m && m - jj > T))
+ *       break;
+ *   }
+ */
+#include "array.h"
+#include "debug.h"
+#include "depend.h"
+#include "ircons_t.h"
+#include "irdom.h"
+#include "irgmod.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irnodeset.h"
+#include "iroptimize.h"
+#include "scev.h"
+#include "tv_t.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Assumed size of a cache line in bytes. */
+#define CACHE_LINE_SIZE 64
+
+/** An induction variable controlling a loop of the nest. */
+typedef struct li_iv_t {
+	ir_loop     *loop;
+	ir_node     *header;
+	int          entry_pos;    /**< position of the loop entry in header */
+	ir_node     *phi;          /**< the induction variable */
+	ir_node     *inc;          /**< phi + step */
+	ir_node     *start;        /**< initial value */
+	ir_tarval   *step;
+	ir_node     *cond;         /**< the exit test */
+	ir_node     *cmp;
+	ir_node     *bound;        /**< operand of cmp compared with phi */
+	bool         exit_on_true; /**< the loop is left if cmp holds */
+	ir_relation  stay;         /**< relation of phi to bound in the loop */
+	ir_node     *mem;          /**< memory Phi of the header or NULL */
+} li_iv_t;
+
+typedef struct li_env_t {
+	ir_graph    *irg;
+	scev_info_t *scev;
+	dep_info_t  *dep;
+	li_iv_t      outer;
+	li_iv_t      inner;
+	ir_node    **accesses; /**< Loads and Stores of the inner loop */
+	ir_nodeset_t moved;    /**< nodes to move into the inner loop header */
+} li_env_t;
+
+static bool loop_contains(ir_loop const *const loop, ir_loop const *inner)
+{
+	if (inner == NULL)
+		return false;
+	unsigned const depth = get_loop_depth(loop);
+	while (get_loop_depth(inner) > depth)
+		inner = get_loop_outer_loop(inner);
+	return inner == loop;
+}
+
+static bool is_in(ir_loop const *const loop, ir_node const *const node)
+{
+	return loop_contains(loop, get_irn_loop(get_block_const(node)));
+}
+
+/** Checks whether the Proj @p proj leaves @p loop. */
+static bool leaves(ir_loop const *const loop, ir_node const *const proj)
+{
+	foreach_out_edge(proj, edge) {
+		ir_node const *const succ = get_edge_src_irn(edge);
+		if (is_Block(succ) && !is_in(loop, succ))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the relation between the induction variable and the bound, which
+ * holds as long as the loop of @p iv is executed.
+ */
+static ir_relation get_stay_relation(li_iv_t const *const iv)
+{
+	ir_relation relation = get_Cmp_relation(iv->cmp);
+	if (get_Cmp_right(iv->cmp) == iv->phi)
+		relation = get_inversed_relation(relation);
+	if (iv->exit_on_true)
+		relation = get_negated_relation(relation);
+	return relation;
+}
+
+/**
+ * Recognizes the induction variable of a loop, which is tested in the loop
+ * header against a bound invariant in @p nest.
+ */
+static bool find_iv(li_env_t *const env, ir_loop *const loop,
+                    ir_loop const *const nest, li_iv_t *const iv)
+{
+	iv->loop = loop;
+	ir_node *header = NULL;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node && has_backedges(element.node)) {
+			if (header != NULL)
+				return false;
+			header = element.node;
+		}
+	}
+	if (header == NULL || get_Block_n_cfgpreds(header) != 2)
+		return false;
+	int const entry_pos = is_backedge(header, 0) ? 1 : 0;
+	if (is_backedge(header, entry_pos) || !is_backedge(header, 1 - entry_pos))
+		return false;
+	iv->header    = header;
+	iv->entry_pos = entry_pos;
+
+	bool         may_be_zero;
+	scev const *const count = scev_get_backedge_count(env->scev, loop,
+	                                                  &may_be_zero);
+	if (count == NULL)
+		return false;
+
+	ir_node *cond = NULL;
+	foreach_out_edge(header, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (is_Cond(node))
+			cond = node;
+	}
+	if (cond == NULL || !is_Cmp(get_Cond_selector(cond)))
+		return false;
+	ir_node *const proj_true  = get_Proj_for_pn(cond, pn_Cond_true);
+	ir_node *const proj_false = get_Proj_for_pn(cond, pn_Cond_false);
+	if (proj_true == NULL || proj_false == NULL)
+		return false;
+	bool const exit_on_true = leaves(loop, proj_true);
+	if (exit_on_true == leaves(loop, proj_false))
+		return false;
+	iv->cond         = cond;
+	iv->cmp          = get_Cond_selector(cond);
+	iv->exit_on_true = exit_on_true;
+
+	ir_node *const left  = get_Cmp_left(iv->cmp);
+	ir_node *const right = get_Cmp_right(iv->cmp);
+	ir_node *const phi   = is_Phi(left) && get_nodes_block(left) == header
+	                     ? left : right;
+	iv->phi   = phi;
+	iv->bound = phi == left ? right : left;
+	if (!is_Phi(phi) || get_nodes_block(phi) != header
+	 || !mode_is_int(get_irn_mode(phi)) || is_in(nest, iv->bound))
+		return false;
+	/* The Cmp is rewritten by the interchange, so the relation is fixed
+	 * now. */
+	iv->stay = get_stay_relation(iv);
+
+	ir_node *const inc = get_irn_n(phi, 1 - entry_pos);
+	if (!is_Add(inc) || get_Add_left(inc) != phi
+	 || !is_Const(get_Add_right(inc)))
+		return false;
+	iv->inc   = inc;
+	iv->step  = get_Const_tarval(get_Add_right(inc));
+	iv->start = get_irn_n(phi, entry_pos);
+	if (is_in(nest, iv->start))
+		return false;
+
+	/* Besides the induction variable only memory may be carried. */
+	iv->mem = NULL;
+	foreach_out_edge(header, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (!is_Phi(node) || node == phi)
+			continue;
+		if (get_irn_mode(node) != mode_M || iv->mem != NULL)
+			return false;
+		iv->mem = node;
+	}
+	return true;
+}
+
+static void collect_blocks(ir_loop *const loop, ir_node ***const blocks)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			collect_blocks(element.son, blocks);
+		else
+			ARR_APP1(ir_node*, *blocks, element.node);
+	}
+}
+
+/**
+ * Checks that every iteration of the outer loop executes the inner loop
+ * exactly once and that the loops are only left by their exit tests.
+ */
+static bool check_blocks(li_env_t const *const env, ir_node **const blocks)
+{
+	li_iv_t const *const outer = &env->outer;
+	li_iv_t const *const inner = &env->inner;
+	for (size_t i = 0, n = ARR_LEN(blocks); i < n; ++i) {
+		ir_node *const block    = blocks[i];
+		bool     const in_inner = is_in(inner->loop, block);
+		unsigned       n_succs  = 0;
+		foreach_block_succ(block, edge) {
+			ir_node *const succ = get_edge_src_irn(edge);
+			++n_succs;
+			if (!is_in(outer->loop, succ)) {
+				if (block != outer->header)
+					return false;
+			} else if (in_inner && !is_in(inner->loop, succ)) {
+				if (block != inner->header)
+					return false;
+			}
+		}
+		if (!in_inner && block != outer->header
+		 && (n_succs != 1 || get_Block_n_cfgpreds(block) != 1))
+			return false;
+	}
+	return true;
+}
+
+/** Checks whether @p node is only used by @p user. */
+static bool has_single_user(ir_node const *const node, ir_node const *const user)
+{
+	foreach_out_edge(node, edge) {
+		if (get_edge_src_irn(edge) != user)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Checks the nodes of the nest and collects the memory accesses of the
+ * inner loop.  The headers also execute the exit test after the last
+ * iteration, so accesses in them do not iterate over the same rectangle as
+ * the bodies and are rejected.
+ */
+static bool check_nodes(li_env_t *const env, ir_node **const blocks)
+{
+	li_iv_t const *const outer = &env->outer;
+	li_iv_t const *const inner = &env->inner;
+	for (size_t i = 0, n = ARR_LEN(blocks); i < n; ++i) {
+		ir_node *const block    = blocks[i];
+		bool     const in_inner = is_in(inner->loop, block);
+		foreach_out_edge(block, edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			ir_mode *const mode = get_irn_mode(node);
+			if (is_Phi(node) || is_Proj(node) || is_cfop(node)
+			 || mode == mode_X)
+				continue;
+			if (in_inner && block != inner->header
+			 && (is_Load(node) || is_Store(node))) {
+				ir_volatility const volatility = is_Load(node)
+					? get_Load_volatility(node) : get_Store_volatility(node);
+				if (volatility == volatility_is_volatile
+				 || ir_throws_exception(node))
+					return false;
+				ARR_APP1(ir_node*, env->accesses, node);
+				continue;
+			}
+			if (get_irn_pinned(node) || mode == mode_M || mode == mode_T)
+				return false;
+		}
+	}
+
+	/* The induction variables are only used inside the nest. */
+	if (!has_single_user(outer->inc, outer->phi)
+	 || !has_single_user(outer->cmp, outer->cond)
+	 || !has_single_user(inner->cmp, inner->cond))
+		return false;
+	foreach_out_edge(inner->phi, edge) {
+		if (!is_in(inner->loop, get_edge_src_irn(edge)))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Collects the nodes computed from the outer induction variable between the
+ * headers, which have to be moved into the inner loop header, when it
+ * computes the outer induction variable.
+ */
+static bool collect_moved(li_env_t *const env, ir_node *const node)
+{
+	li_iv_t const *const outer = &env->outer;
+	li_iv_t const *const inner = &env->inner;
+	foreach_out_edge(node, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user == outer->inc || user == outer->cmp
+		 || is_in(inner->loop, user)
+		 || ir_nodeset_contains(&env->moved, user))
+			continue;
+		if (is_Phi(user) || is_End(user)
+		 || !block_dominates(get_nodes_block(user), inner->header))
+			return false;
+		ir_nodeset_insert(&env->moved, user);
+		if (!collect_moved(env, user))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Returns the base address of the decomposed address of @p access, i.e. its
+ * only symbol with reference mode, or NULL.
+ */
+static ir_node *get_base(li_env_t const *const env, ir_node *const access)
+{
+	ir_node *const ptr = is_Load(access) ? get_Load_ptr(access)
+	                                     : get_Store_ptr(access);
+	dep_affine affine;
+	if (!dep_decompose(env->dep, ptr, get_nodes_block(access), &affine))
+		return NULL;
+	ir_node *base = NULL;
+	for (unsigned i = 0; i < affine.n_symbols; ++i) {
+		dep_symbol const *const symbol = &affine.symbols[i];
+		if (!mode_is_reference(get_irn_mode(symbol->node)))
+			continue;
+		if (base != NULL || symbol->coeff != 1)
+			return NULL;
+		base = symbol->node;
+	}
+	return base;
+}
+
+/**
+ * Checks whether @p a and @p b access different objects in all iterations.
+ * The dependence test cannot tell, while the alias relation of the accesses
+ * themselves only holds in the same iteration, so the alias analysis is
+ * asked about the base addresses.
+ */
+static bool are_distinct_objects(li_env_t const *const env, ir_node *const a,
+                                 ir_node *const b)
+{
+	ir_node *const base_a = get_base(env, a);
+	ir_node *const base_b = get_base(env, b);
+	if (base_a == NULL || base_b == NULL || base_a == base_b)
+		return false;
+	ir_type const *const type_a = is_Load(a) ? get_Load_type(a) : get_Store_type(a);
+	ir_type const *const type_b = is_Load(b) ? get_Load_type(b) : get_Store_type(b);
+	ir_mode       *const mode_a = is_Load(a) ? get_Load_mode(a) : get_irn_mode(get_Store_value(a));
+	ir_mode       *const mode_b = is_Load(b) ? get_Load_mode(b) : get_irn_mode(get_Store_value(b));
+	return get_alias_relation(base_a, type_a, get_mode_size_bytes(mode_a),
+	                          base_b, type_b, get_mode_size_bytes(mode_b))
+	    == ir_no_alias;
+}
+
+/**
+ * Checks that no dependence between two iterations of the nest in the same
+ * iteration of the surrounding loops is reversed by executing the nest in
+ * the other order.
+ */
+static bool check_dependences(li_env_t const *const env)
+{
+	ir_node **const accesses = env->accesses;
+	for (size_t i = 0, n = ARR_LEN(accesses); i < n; ++i) {
+		for (size_t j = i; j < n; ++j) {
+			ir_node *const a = accesses[i];
+			ir_node *const b = accesses[j];
+			if (!is_Store(a) && !is_Store(b))
+				continue;
+			if (are_distinct_objects(env, a, b))
+				continue;
+
+			dep_result result;
+			if (!dep_test_memops(env->dep, a, b, &result))
+				continue;
+			unsigned k = 0;
+			while (k < result.n_loops && result.loops[k] != env->outer.loop) {
+				if (!(result.directions[k] & DEP_DIR_EQ))
+					break;
+				++k;
+			}
+			if (k < result.n_loops && result.loops[k] != env->outer.loop)
+				continue;
+			if (k + 1 >= result.n_loops) {
+				DB((dbg, LEVEL_2, "unknown dependence of %+F and %+F\n", a, b));
+				return false;
+			}
+			unsigned const d_outer = result.directions[k];
+			unsigned const d_inner = result.directions[k + 1];
+			if (((d_outer & DEP_DIR_LT) && (d_inner & DEP_DIR_GT))
+			 || ((d_outer & DEP_DIR_GT) && (d_inner & DEP_DIR_LT))) {
+				DB((dbg, LEVEL_2, "dependence of %+F and %+F prevents interchange\n",
+				    a, b));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Returns the distance in bytes of the addresses accessed by @p access in
+ * consecutive iterations of @p loop or a cache line if it is unknown.
+ */
+static long get_stride(li_env_t const *const env, ir_node *const access,
+                       ir_loop const *const loop)
+{
+	ir_node *const ptr = is_Load(access) ? get_Load_ptr(access)
+	                                     : get_Store_ptr(access);
+	dep_affine affine;
+	if (!dep_decompose(env->dep, ptr, get_nodes_block(access), &affine))
+		return CACHE_LINE_SIZE;
+	for (unsigned k = 0; k < affine.depth; ++k) {
+		if (affine.loops[k] == loop)
+			return labs(affine.coeffs[k]);
+	}
+	return 0;
+}
+
+/**
+ * Returns the number of cache lines touched per iteration if @p loop is the
+ * inner loop of the nest.
+ */
+static long get_cost(li_env_t const *const env, ir_loop const *const loop)
+{
+	long cost = 0;
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i)
+		cost += MIN(get_stride(env, env->accesses[i], loop), CACHE_LINE_SIZE);
+	return cost;
+}
+
+/**
+ * Checks whether some access in the new inner loop @p inner touches memory
+ * close to the one of the previous iteration of the new outer loop @p outer.
+ */
+static bool has_outer_reuse(li_env_t const *const env,
+                            ir_loop const *const outer,
+                            ir_loop const *const inner)
+{
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i) {
+		ir_node *const access = env->accesses[i];
+		if (get_stride(env, access, outer) < CACHE_LINE_SIZE
+		 && get_stride(env, access, inner) != 0)
+			return true;
+	}
+	return false;
+}
+
+/** Checks whether the iterations of @p iv can be split into tiles. */
+static bool can_tile(li_env_t const *const env, li_iv_t const *const iv,
+                     unsigned const tile_size)
+{
+	if (tile_size < 2 || env->outer.mem == NULL)
+		return false;
+	ir_relation const relation = iv->stay;
+	if ((relation != ir_relation_less && relation != ir_relation_less_equal)
+	 || tarval_is_negative(iv->step) || tarval_is_null(iv->step))
+		return false;
+
+	/* Tiling does not pay off if all iterations fit into one tile. */
+	bool              may_be_zero;
+	scev const *const count = scev_get_backedge_count(env->scev, iv->loop,
+	                                                  &may_be_zero);
+	if (scev_is_constant(count) && tarval_is_long(count->offset)
+	 && get_tarval_long(count->offset) < (long)tile_size)
+		return false;
+	return true;
+}
+
+/**
+ * Creates a Phi in the header of @p target, which iterates over the values
+ * of @p iv, and replaces the exit test of @p target by the one of @p iv.
+ */
+static ir_node *new_iv(li_env_t const *const env, li_iv_t const *const iv,
+                       li_iv_t const *const target)
+{
+	ir_graph *const irg       = env->irg;
+	ir_node  *const header    = target->header;
+	int       const entry_pos = target->entry_pos;
+	ir_mode  *const mode      = get_irn_mode(iv->phi);
+
+	ir_node *in[2];
+	in[entry_pos]     = iv->start;
+	in[1 - entry_pos] = new_r_Dummy(irg, mode);
+	ir_node *const phi  = new_r_Phi(header, ARRAY_SIZE(in), in, mode);
+	ir_node *const step = new_r_Const(irg, iv->step);
+	set_irn_n(phi, 1 - entry_pos, new_r_Add(header, phi, step));
+
+	ir_node *const cmp   = iv->cmp;
+	ir_node       *left  = get_Cmp_left(cmp);
+	ir_node       *right = get_Cmp_right(cmp);
+	if (left == iv->phi)
+		left = phi;
+	else
+		right = phi;
+	ir_relation relation = get_Cmp_relation(cmp);
+	if (iv->exit_on_true != target->exit_on_true)
+		relation = get_negated_relation(relation);
+	set_Cond_selector(target->cond, new_r_Cmp(header, left, right, relation));
+	return phi;
+}
+
+/**
+ * Exchanges the loops of the nest.  Returns the induction variable of the
+ * new inner loop.
+ */
+static ir_node *interchange(li_env_t *const env)
+{
+	li_iv_t const *const outer     = &env->outer;
+	li_iv_t const *const inner     = &env->inner;
+	ir_node       *const outer_phi = new_iv(env, inner, outer);
+	ir_node       *const inner_phi = new_iv(env, outer, inner);
+	foreach_ir_nodeset(&env->moved, node, iter) {
+		set_nodes_block(node, inner->header);
+	}
+	exchange(outer->phi, inner_phi);
+	exchange(inner->phi, outer_phi);
+
+	DB((dbg, LEVEL_1, "interchanged loops %+F and %+F\n", outer->header,
+	    inner->header));
+	return inner_phi;
+}
+
+/**
+ * Splits the iterations of the inner loop, which iterates over the values
+ * of @p iv in @p phi, into tiles of @p tile_size iterations.
+ */
+static void tile(li_env_t const *const env, li_iv_t const *const iv,
+                 ir_node *const phi, unsigned const tile_size)
+{
+	ir_graph      *const irg       = env->irg;
+	li_iv_t const *const outer     = &env->outer;
+	li_iv_t const *const inner     = &env->inner;
+	int            const entry_pos = outer->entry_pos;
+	ir_mode       *const mode      = get_irn_mode(phi);
+	ir_mode       *const umode     = mode_is_signed(mode)
+	                                 ? find_unsigned_mode(mode) : mode;
+	ir_relation    const relation  = iv->stay;
+
+	ir_tarval *const n_tile = new_tarval_from_long(tile_size, mode);
+	ir_tarval *const size   = tarval_convert_to(tarval_mul(iv->step, n_tile),
+	                                            umode);
+	ir_node   *const span   = new_r_Const(irg, size);
+
+	/* The tile loop: executes the nest once per tile. */
+	ir_node *const exit = get_Proj_for_pn(outer->cond, outer->exit_on_true
+	                                      ? pn_Cond_true : pn_Cond_false);
+	ir_node *succ = NULL;
+	int      pos  = -1;
+	foreach_out_edge(exit, edge) {
+		if (is_Block(get_edge_src_irn(edge))) {
+			succ = get_edge_src_irn(edge);
+			pos  = get_edge_src_pos(edge);
+		}
+	}
+
+	ir_node *const header_in[] = {
+		get_Block_cfgpred(outer->header, entry_pos), new_r_Dummy(irg, mode_X)
+	};
+	ir_node *const header = new_r_Block(irg, ARRAY_SIZE(header_in), header_in);
+	ir_node *const tile_in[] = { iv->start, new_r_Dummy(irg, mode) };
+	ir_node *const first = new_r_Phi(header, ARRAY_SIZE(tile_in), tile_in, mode);
+	ir_node *const mem_in[] = {
+		get_irn_n(outer->mem, entry_pos), outer->mem
+	};
+	ir_node *const mem = new_r_Phi(header, ARRAY_SIZE(mem_in), mem_in, mode_M);
+	set_irn_n(outer->mem, entry_pos, mem);
+	set_Block_cfgpred(outer->header, entry_pos, new_r_Jmp(header));
+
+	/* Continue while another tile starts before the bound.  The distance
+	 * to the bound is computed unsigned, so it does not overflow. */
+	ir_node *const latch = new_r_Block(irg, 1, &exit);
+	ir_node       *rest  = new_r_Sub(latch, iv->bound, first);
+	if (umode != mode)
+		rest = new_r_Conv(latch, rest, umode);
+	ir_relation const more = relation == ir_relation_less
+	                         ? ir_relation_greater : ir_relation_greater_equal;
+	ir_node *const again = new_r_And(latch,
+		new_r_Cmp(latch, first, iv->bound, relation),
+		new_r_Cmp(latch, rest, span, more));
+	ir_node *const cond = new_r_Cond(latch, again);
+	set_Block_cfgpred(header, 1, new_r_Proj(cond, mode_X, pn_Cond_true));
+	set_Block_cfgpred(succ, pos, new_r_Proj(cond, mode_X, pn_Cond_false));
+	ir_node *const step = new_r_Const(irg, tarval_convert_to(size, mode));
+	set_irn_n(first, 1, new_r_Add(latch, first, step));
+
+	/* The inner loop starts at the tile and leaves it at its end. */
+	set_irn_n(phi, inner->entry_pos, first);
+	ir_node *const block  = inner->header;
+	ir_node       *offset = new_r_Sub(block, phi, first);
+	if (umode != mode)
+		offset = new_r_Conv(block, offset, umode);
+	ir_node *const selector = get_Cond_selector(inner->cond);
+	if (inner->exit_on_true) {
+		ir_node *const end = new_r_Cmp(block, offset, span,
+		                               ir_relation_greater_equal);
+		set_Cond_selector(inner->cond, new_r_Or(block, selector, end));
+	} else {
+		ir_node *const in_tile = new_r_Cmp(block, offset, span,
+		                                   ir_relation_less);
+		set_Cond_selector(inner->cond, new_r_And(block, selector, in_tile));
+	}
+
+	DB((dbg, LEVEL_1, "tiled loop %+F by %u\n", inner->header, tile_size));
+}
+
+static bool optimize_nest(li_env_t *const env, ir_loop *const loop,
+                          unsigned const tile_size)
+{
+	ir_loop *inner_loop = NULL;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			if (inner_loop != NULL)
+				return false;
+			inner_loop = element.son;
+		}
+	}
+	if (inner_loop == NULL || !is_innermost_loop(inner_loop)
+	 || !find_iv(env, loop, loop, &env->outer)
+	 || !find_iv(env, inner_loop, loop, &env->inner))
+		return false;
+
+	ir_node **blocks = NEW_ARR_F(ir_node*, 0);
+	collect_blocks(loop, &blocks);
+	bool const ok = check_blocks(env, blocks) && check_nodes(env, blocks);
+	DEL_ARR_F(blocks);
+	if (!ok || ARR_LEN(env->accesses) == 0 || !check_dependences(env))
+		return false;
+
+	li_iv_t const *const outer = &env->outer;
+	li_iv_t const *const inner = &env->inner;
+	bool const swap = get_cost(env, outer->loop) < get_cost(env, inner->loop)
+	               && collect_moved(env, outer->phi);
+	li_iv_t const *const new_outer = swap ? inner : outer;
+	li_iv_t const *const new_inner = swap ? outer : inner;
+	bool const split = can_tile(env, new_inner, tile_size)
+	                && has_outer_reuse(env, new_outer->loop, new_inner->loop);
+	if (!swap && !split)
+		return false;
+
+	ir_node *const phi = swap ? interchange(env) : inner->phi;
+	if (split)
+		tile(env, new_inner, phi, tile_size);
+	return true;
+}
+
+static void collect_nests(ir_loop *const loop, ir_loop ***const loops)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			if (!is_innermost_loop(element.son))
+				ARR_APP1(ir_loop*, *loops, element.son);
+			collect_nests(element.son, loops);
+		}
+	}
+}
+
+void interchange_loops(ir_graph *irg, unsigned tile_size)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_interchange");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **loops = NEW_ARR_F(ir_loop*, 0);
+	collect_nests(get_irg_loop(irg), &loops);
+
+	li_env_t env;
+	memset(&env, 0, sizeof(env));
+	env.irg      = irg;
+	env.scev     = scev_new(irg);
+	env.dep      = dep_new(irg);
+	env.accesses = NEW_ARR_F(ir_node*, 0);
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		ARR_SHRINKLEN(env.accesses, 0);
+		ir_nodeset_init(&env.moved);
+		if (optimize_nest(&env, loops[i], tile_size))
+			changed = true;
+		ir_nodeset_destroy(&env.moved);
+	}
+	DEL_ARR_F(env.accesses);
+	dep_free(env.dep);
+	scev_free(env.scev);
+	DEL_ARR_F(loops);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,271 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Software prefetching of strided loads in innermost loops.
+ *
+ * A Load in an innermost loop whose address advances by a constant stride
+ * per iteration reads memory which is known in advance.  A prefetch of the
+ * address some iterations ahead is inserted in front of it, so the memory
+ * latency overlaps with the computation of the iterations in between:
+ *
+ *   for (i = 0; i < n; ++i)            for (i = 0; i < n; ++i) {
+ *     s += a[i * 16];           =>       prefetch(&a[(i + d) * 16]);
+ *                                        s += a[i * 16];
+ *                                      }
+ *
+ * The distance d is the memory latency divided by the size of the loop body,
+ * but at least one cache line ahead.  It is limited to half the expected
+ * number of iterations per entry of the loop, so most prefetched lines are
+ * still used by the loop.  The iterations are given by a constant trip count
+ * or estimated from the block execution frequencies, which also restrict
+ * the prefetches to loops executed more often than the function.
+ *
+ * Loads touching the same cache line as an already prefetched one share its
+ * prefetch.  Loads with small strides are left to the hardware prefetcher,
+ * which recognizes such streams, and a prefetch in every iteration would
+ * mostly hit lines already requested.
+ */
+#include "array.h"
+#include "debug.h"
+#include "execfreq.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "scev.h"
+#include "tv_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Assumed size of a cache line in bytes. */
+#define CACHE_LINE_SIZE 64
+
+/** Minimum stride in bytes, denser accesses are left to the hardware. */
+#define MIN_STRIDE (CACHE_LINE_SIZE / 4)
+
+/** Maximum prefetch distance in iterations. */
+#define MAX_DISTANCE 32
+
+/** A prefetched address, offset + sum(terms) + i * step. */
+typedef struct prefetch_t {
+	scev const *start;
+	long        step;
+} prefetch_t;
+
+typedef struct lp_env_t {
+	ir_graph    *irg;
+	ir_loop     *loop;
+	scev_info_t *scev;
+	ir_node     *header;     /**< block with backedges */
+	ir_node    **loads;      /**< candidate Loads of the loop */
+	prefetch_t  *prefetches; /**< addresses prefetched so far */
+	unsigned     n_nodes;    /**< number of nodes executed per iteration */
+	double       n_iters;    /**< expected iterations per entry */
+} lp_env_t;
+
+/** Collects the strided Loads of the loop and counts its nodes. */
+static void collect_loads(lp_env_t *const env)
+{
+	for (size_t i = 0, n = get_loop_n_elements(env->loop); i < n; ++i) {
+		loop_element const element = get_loop_element(env->loop, i);
+		if (*element.kind != k_ir_node)
+			continue;
+		if (has_backedges(element.node))
+			env->header = element.node;
+		foreach_out_edge(element.node, edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			if (is_Phi(node) || is_Proj(node) || is_irn_constlike(node))
+				continue;
+			++env->n_nodes;
+			if (is_Load(node)
+			 && get_Load_volatility(node) != volatility_is_volatile)
+				ARR_APP1(ir_node*, env->loads, node);
+		}
+	}
+}
+
+/**
+ * Returns the constant stride of the address @p ptr in the loop and its
+ * start address or 0 if it is not strided.
+ */
+static long get_stride(lp_env_t const *const env, ir_node *const ptr,
+                       scev const **const start)
+{
+	scev const *const s = scev_get(env->scev, ptr);
+	if (s->kind != SCEV_ADDREC || s->loop != env->loop
+	 || !scev_is_constant(s->step) || !tarval_is_long(s->step->offset)
+	 || s->start->kind != SCEV_AFFINE || !tarval_is_long(s->start->offset))
+		return 0;
+	*start = s->start;
+	return get_tarval_long(s->step->offset);
+}
+
+/**
+ * Checks whether an address with the same stride in the same cache line as
+ * @p start is already prefetched.
+ */
+static bool is_prefetched(lp_env_t const *const env, scev const *const start,
+                          long const step)
+{
+	for (size_t i = 0, n = ARR_LEN(env->prefetches); i < n; ++i) {
+		prefetch_t const *const p = &env->prefetches[i];
+		if (p->step != step || p->start->n_terms != start->n_terms)
+			continue;
+		bool same = true;
+		for (unsigned t = 0; t < start->n_terms; ++t) {
+			if (p->start->terms[t].node != start->terms[t].node
+			 || p->start->terms[t].coeff != start->terms[t].coeff)
+				same = false;
+		}
+		long const diff = get_tarval_long(start->offset)
+		                - get_tarval_long(p->start->offset);
+		if (same && diff > -CACHE_LINE_SIZE && diff < CACHE_LINE_SIZE)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Checks whether the loop is executed more often than the function and
+ * estimates its number of iterations per entry.  Blocks without execution
+ * frequency were created after the estimation and are not considered hot.
+ */
+static bool is_hot(lp_env_t *const env)
+{
+	ir_node *const header = env->header;
+	double   const freq   = get_block_execfreq(header);
+	ir_node *const start  = get_irg_start_block(env->irg);
+	if (freq <= 0.0 || freq <= get_block_execfreq(start))
+		return false;
+	double entry_freq = 0.0;
+	for (int i = 0, n = get_Block_n_cfgpreds(header); i < n; ++i) {
+		if (!is_backedge(header, i))
+			entry_freq += get_block_execfreq(get_Block_cfgpred_block(header, i));
+	}
+	if (entry_freq <= 0.0)
+		return false;
+	env->n_iters = freq / entry_freq;
+
+	bool              may_be_zero;
+	scev const *const count = scev_get_backedge_count(env->scev, env->loop,
+	                                                  &may_be_zero);
+	if (count != NULL && scev_is_constant(count) && !may_be_zero) {
+		ir_tarval *const n = count->offset;
+		if (tarval_is_long(n) && get_tarval_long(n) >= 0)
+			env->n_iters = get_tarval_long(n) + 1.0;
+	}
+	return true;
+}
+
+/**
+ * Computes the prefetch distance in iterations for accesses with @p step.
+ * Returns 0 if the loop is too short for prefetches.
+ */
+static unsigned get_distance(lp_env_t const *const env, unsigned const latency,
+                             long const step)
+{
+	unsigned      distance = (latency + env->n_nodes - 1) / env->n_nodes;
+	unsigned long const size = step < 0 ? -(unsigned long)step : (unsigned long)step;
+	if (distance * size < CACHE_LINE_SIZE)
+		distance = (CACHE_LINE_SIZE + size - 1) / size;
+	distance = MIN(distance, MAX_DISTANCE);
+
+	/* Lines prefetched in the last iterations are not used by the loop. */
+	double const max_distance = env->n_iters / 2.0;
+	if (distance > max_distance)
+		distance = (unsigned)max_distance;
+	return distance;
+}
+
+/** Inserts a prefetch of the address of @p load @p distance iterations ahead. */
+static void insert_prefetch(lp_env_t const *const env, ir_node *const load,
+                            long const ahead)
+{
+	ir_graph *const irg   = env->irg;
+	dbg_info *const dbgi  = get_irn_dbg_info(load);
+	ir_node  *const block = get_nodes_block(load);
+	ir_node  *const ptr   = get_Load_ptr(load);
+	ir_mode  *const omode = get_reference_offset_mode(get_irn_mode(ptr));
+	ir_node  *const addr  = new_rd_Add(dbgi, block, ptr,
+	                                   new_r_Const_long(irg, omode, ahead));
+	ir_node  *const in[]  = {
+		addr,
+		new_r_Const_long(irg, mode_Is, 0),
+		new_r_Const_long(irg, mode_Is, 3),
+	};
+	ir_node  *const mem      = get_Load_mem(load);
+	ir_node  *const prefetch = new_rd_Builtin(dbgi, block, mem, ARRAY_SIZE(in),
+	                                          in, ir_bk_prefetch,
+	                                          get_unknown_type());
+	set_Load_mem(load, new_r_Proj(prefetch, mode_M, pn_Builtin_M));
+}
+
+static bool prefetch_loop(lp_env_t *const env, unsigned const latency)
+{
+	collect_loads(env);
+	if (env->header == NULL || env->n_nodes == 0 || !is_hot(env))
+		return false;
+
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(env->loads); i < n; ++i) {
+		ir_node    *const load = env->loads[i];
+		scev const       *start;
+		long        const step = get_stride(env, get_Load_ptr(load), &start);
+		if (step > -MIN_STRIDE && step < MIN_STRIDE)
+			continue;
+		if (is_prefetched(env, start, step))
+			continue;
+		unsigned const distance = get_distance(env, latency, step);
+		if (distance == 0)
+			continue;
+		prefetch_t const prefetch = { start, step };
+		ARR_APP1(prefetch_t, env->prefetches, prefetch);
+		insert_prefetch(env, load, (long)distance * step);
+		DB((dbg, LEVEL_1, "prefetch for %+F %u iterations ahead\n", load,
+		    distance));
+		changed = true;
+	}
+	return changed;
+}
+
+void insert_prefetches(ir_graph *irg, unsigned latency)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_prefetch");
+
+	if (get_block_execfreq(get_irg_start_block(irg)) <= 0.0)
+		ir_estimate_execfreq(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **const loops = get_innermost_loops(irg);
+
+	scev_info_t *const scev    = scev_new(irg);
+	bool               changed = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		lp_env_t env = {
+			.irg        = irg,
+			.loop       = loops[i],
+			.scev       = scev,
+			.loads      = NEW_ARR_F(ir_node*, 0),
+			.prefetches = NEW_ARR_F(prefetch_t, 0),
+		};
+		if (prefetch_loop(&env, latency))
+			changed = true;
+		DEL_ARR_F(env.prefetches);
+		DEL_ARR_F(env.loads);
+	}
+	scev_free(scev);
+	DEL_ARR_F(loops);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+		: IR_GRAPH_PROPERTIES_ALL);
+}
@@ -0,0 +1,439 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Unrolling of counted loops with runtime trip counts.
+ *
+ * Innermost loops consisting of the header and at most one further block,
+ * whose number of iterations is known to the scalar evolution analysis, are
+ * unrolled:
+ *
+ * If the trip count is a small constant, the loop is replaced by the
+ * straight-line code of all its iterations.  Otherwise an unrolled loop,
+ * executing several iterations per pass without testing the exit condition
+ * in between, is put in front of the loop.  It is entered if enough
+ * iterations are left and the original loop executes the remaining ones.
+ *
+ * The unroll factor is limited by the size of the loop body, the number of
+ * registers available for the values live across it and the expected number
+ * of iterations according to the block execution frequencies, which are
+ * estimated if no profile provided them.
+ */
+#include "array.h"
+#include "debug.h"
+#include "execfreq.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "irnodeset.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "scev.h"
+#include "tv_t.h"
+#include "util.h"
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Maximum unroll factor of the runtime unrolled loop. */
+#define MAX_FACTOR 8
+
+typedef struct lu_env_t {
+	ir_graph     *irg;
+	ir_loop      *loop;
+	scev_info_t  *scev;
+	loop_shape_t  shape;
+	scev const   *count;        /**< backedge count */
+	bool          may_be_zero;  /**< count is only valid if the first test
+	                                 stays in the loop */
+	ir_node     **phis;         /**< Phis of the header */
+	unsigned      n_nodes;      /**< number of nodes executed per iteration */
+	unsigned      n_live;       /**< values live across the loop body */
+	ir_nodemap    copies;       /**< copies in the current iteration */
+	ir_node      *block;        /**< block receiving the copies */
+} lu_env_t;
+
+/**
+ * Checks whether the nodes of the loop can be copied and counts them and the
+ * values live across the loop body.
+ */
+static bool check_loop_nodes(lu_env_t *const env)
+{
+	ir_node     *const blocks[] = { env->shape.header, env->shape.latch };
+	ir_node     *const cond     = get_Proj_pred(env->shape.exit);
+	ir_nodeset_t       live;
+	ir_nodeset_init(&live);
+	bool ok = true;
+	for (size_t b = 0; ok && b < ARRAY_SIZE(blocks); ++b) {
+		if (b > 0 && blocks[b] == blocks[0])
+			break;
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			ir_mode *const mode = get_irn_mode(node);
+			if (is_Phi(node)) {
+				if (get_nodes_block(node) != env->shape.header) {
+					ok = false;
+					break;
+				}
+				ARR_APP1(ir_node*, env->phis, node);
+				if (mode != mode_M)
+					ir_nodeset_insert(&live, node);
+				continue;
+			}
+			if (mode == mode_X || is_cfop(node)) {
+				if (node == cond || get_nodes_block(node) == env->shape.latch
+				 || (is_Proj(node) && get_Proj_pred(node) == cond))
+					continue;
+				ok = false;
+				break;
+			}
+			if (is_fragile_op(node) && ir_throws_exception(node)) {
+				ok = false;
+				break;
+			}
+			++env->n_nodes;
+			foreach_irn_in(node, i, pred) {
+				if (!is_in_loop_shape(&env->shape, pred)
+				 && !is_irn_constlike(pred) && get_irn_mode(pred) != mode_M
+				 && !is_Block(pred))
+					ir_nodeset_insert(&live, pred);
+			}
+		}
+	}
+	env->n_live = ir_nodeset_size(&live);
+	ir_nodeset_destroy(&live);
+	return ok && env->n_nodes > 0;
+}
+
+/** Checks whether @p node can be computed in front of the loop. */
+static bool is_pure(lu_env_t const *const env, ir_node *const node)
+{
+	if (!is_in_loop_shape(&env->shape, node) || is_Phi(node))
+		return true;
+	if (get_irn_pinned(node) || get_irn_mode(node) == mode_M || get_irn_mode(node) == mode_T)
+		return false;
+	foreach_irn_in(node, i, pred) {
+		if (!is_pure(env, pred))
+			return false;
+	}
+	return true;
+}
+
+/** Returns the copy of @p node in the current iteration. */
+static ir_node *clone(lu_env_t *const env, ir_node *const node)
+{
+	if (!is_in_loop_shape(&env->shape, node))
+		return node;
+	ir_node *copy = ir_nodemap_get(ir_node, &env->copies, node);
+	if (copy != NULL)
+		return copy;
+
+	assert(!is_Phi(node));
+	copy = exact_copy(node);
+	set_nodes_block(copy, env->block);
+	ir_nodemap_insert(&env->copies, node, copy);
+	foreach_irn_in(node, i, pred) {
+		set_irn_n(copy, i, clone(env, pred));
+	}
+	return copy;
+}
+
+/** Starts a new iteration with the values @p values of the header Phis. */
+static void start_iteration(lu_env_t *const env, ir_node *const *const values)
+{
+	ir_nodemap_destroy(&env->copies);
+	ir_nodemap_init(&env->copies, env->irg);
+	for (size_t i = 0, n = ARR_LEN(env->phis); i < n; ++i)
+		ir_nodemap_insert(&env->copies, env->phis[i], values[i]);
+}
+
+/**
+ * Copies one iteration of the loop body into the current block and replaces
+ * @p values by the values of the header Phis in the next iteration.
+ */
+static void copy_iteration(lu_env_t *const env, ir_node **const values)
+{
+	int    const back_pos = 1 - env->shape.entry_pos;
+	size_t const n_phis   = ARR_LEN(env->phis);
+	start_iteration(env, values);
+	for (size_t i = 0; i < n_phis; ++i)
+		values[i] = clone(env, get_irn_n(env->phis[i], back_pos));
+}
+
+/** Returns the number of iterations of the loop body before the loop. */
+static ir_node *build_count(lu_env_t *const env, ir_node *const block,
+                            ir_mode **const umode)
+{
+	ir_mode *const mode = env->count->mode;
+	*umode = mode_is_signed(mode) ? find_unsigned_mode(mode) : mode;
+	return scev_build_count(env->count,
+	                        env->shape.latch == env->shape.header, block,
+	                        *umode);
+}
+
+static void unroll_runtime(lu_env_t *const env, unsigned const factor)
+{
+	ir_graph *const irg       = env->irg;
+	ir_node  *const header    = env->shape.header;
+	int       const entry_pos = env->shape.entry_pos;
+	size_t    const n_phis    = ARR_LEN(env->phis);
+
+	/* The block deciding whether the unrolled loop is executed. */
+	ir_node *const entry = get_Block_cfgpred(header, entry_pos);
+	ir_node *const pre   = new_r_Block(irg, 1, &entry);
+
+	ir_mode       *umode;
+	ir_node *const count    = build_count(env, pre, &umode);
+	unsigned const min_rest = env->shape.latch == env->shape.header;
+	ir_node *const min      = new_r_Const_long(irg, umode, factor + min_rest);
+	ir_node       *ok       = new_r_Cmp(pre, count, min,
+	                                    ir_relation_greater_equal);
+	ir_node **const values  = ALLOCAN(ir_node*, n_phis);
+	for (size_t i = 0; i < n_phis; ++i)
+		values[i] = get_irn_n(env->phis[i], entry_pos);
+	if (env->may_be_zero) {
+		ir_relation relation = get_Cmp_relation(env->shape.cmp);
+		if (env->shape.exit_on_true)
+			relation = get_negated_relation(relation);
+		env->block = pre;
+		start_iteration(env, values);
+		ir_node *const left  = clone(env, get_Cmp_left(env->shape.cmp));
+		ir_node *const right = clone(env, get_Cmp_right(env->shape.cmp));
+		ok = new_r_And(pre, ok, new_r_Cmp(pre, left, right, relation));
+	}
+	ir_node *const cond = new_r_Cond(pre, ok);
+	ir_node *const skip = new_r_Proj(cond, mode_X, pn_Cond_false);
+
+	/* The unrolled loop. */
+	ir_node *const body_in[] = {
+		new_r_Proj(cond, mode_X, pn_Cond_true), new_r_Dummy(irg, mode_X)
+	};
+	ir_node  *const body = new_r_Block(irg, ARRAY_SIZE(body_in), body_in);
+	ir_node **const phis = ALLOCAN(ir_node*, n_phis);
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_mode *const mode = get_irn_mode(env->phis[i]);
+		ir_node *const in[] = { values[i], new_r_Dummy(irg, mode) };
+		phis[i]   = new_r_Phi(body, ARRAY_SIZE(in), in, mode);
+		values[i] = phis[i];
+	}
+	env->block = body;
+	for (unsigned f = 0; f < factor; ++f)
+		copy_iteration(env, values);
+	for (size_t i = 0; i < n_phis; ++i)
+		set_irn_n(phis[i], 1, values[i]);
+
+	ir_node *const zero         = new_r_Const(irg, get_mode_null(umode));
+	ir_node *const counter_in[] = { zero, new_r_Dummy(irg, umode) };
+	ir_node *const counter      = new_r_Phi(body, ARRAY_SIZE(counter_in),
+	                                        counter_in, umode);
+	ir_node *const step         = new_r_Const_long(irg, umode, factor);
+	ir_node *const done         = new_r_Add(body, counter, step);
+	set_irn_n(counter, 1, done);
+	ir_node *const rest         = new_r_Sub(body, count, done);
+	ir_node *const again        = new_r_Cmp(body, rest, min,
+	                                        ir_relation_greater_equal);
+	ir_node *const body_cond    = new_r_Cond(body, again);
+	set_Block_cfgpred(body, 1, new_r_Proj(body_cond, mode_X, pn_Cond_true));
+
+	/* Continue with the original loop. */
+	ir_node *const join_in[] = {
+		skip, new_r_Proj(body_cond, mode_X, pn_Cond_false)
+	};
+	ir_node *const join = new_r_Block(irg, ARRAY_SIZE(join_in), join_in);
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node *const phi  = env->phis[i];
+		ir_node *const in[] = { get_irn_n(phi, entry_pos), values[i] };
+		set_irn_n(phi, entry_pos,
+		          new_r_Phi(join, ARRAY_SIZE(in), in, get_irn_mode(phi)));
+	}
+	set_Block_cfgpred(header, entry_pos, new_r_Jmp(join));
+
+	DB((dbg, LEVEL_1, "unrolled %+F %u times\n", header, factor));
+}
+
+static void unroll_fully(lu_env_t *const env, unsigned const n_iterations)
+{
+	ir_graph *const irg       = env->irg;
+	ir_node  *const header    = env->shape.header;
+	int       const entry_pos = env->shape.entry_pos;
+	size_t    const n_phis    = ARR_LEN(env->phis);
+
+	ir_node  *const entry  = get_Block_cfgpred(header, entry_pos);
+	ir_node  *const block  = new_r_Block(irg, 1, &entry);
+	ir_node **const values = ALLOCAN(ir_node*, n_phis);
+	for (size_t i = 0; i < n_phis; ++i)
+		values[i] = get_irn_n(env->phis[i], entry_pos);
+
+	/* A loop tested at its end leaves in the last iteration of its body,
+	 * otherwise the header is executed once more. */
+	bool     const single = env->shape.latch == env->shape.header;
+	unsigned const n_full = n_iterations - single;
+	env->block = block;
+	for (unsigned i = 0; i < n_full; ++i)
+		copy_iteration(env, values);
+	start_iteration(env, values);
+	if (single) {
+		int const back_pos = 1 - entry_pos;
+		for (size_t i = 0; i < n_phis; ++i)
+			clone(env, get_irn_n(env->phis[i], back_pos));
+	}
+	foreach_out_edge(header, edge) {
+		ir_node *const node = get_edge_src_irn(edge);
+		if (get_irn_mode(node) == mode_M && !is_Phi(node))
+			clone(env, node);
+	}
+
+	/* Values of the last iteration replace the loop values after it. */
+	ir_node *const blocks[] = { env->shape.header, env->shape.latch };
+	for (size_t b = 0; b < ARRAY_SIZE(blocks); ++b) {
+		if (b > 0 && blocks[b] == blocks[0])
+			break;
+		foreach_out_edge(blocks[b], edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			if (get_irn_mode(node) == mode_X)
+				continue;
+			foreach_out_edge_safe(node, use) {
+				ir_node *const user = get_edge_src_irn(use);
+				if (!is_in_loop_shape(&env->shape, user) && !is_End(user))
+					set_irn_n(user, get_edge_src_pos(use), clone(env, node));
+			}
+		}
+	}
+
+	/* Leave the copied iterations instead of the loop. */
+	foreach_out_edge_safe(env->shape.exit, edge) {
+		ir_node *const succ = get_edge_src_irn(edge);
+		if (is_Block(succ))
+			set_Block_cfgpred(succ, get_edge_src_pos(edge), new_r_Jmp(block));
+	}
+	ir_node *const bad = new_r_Bad(irg, mode_X);
+	set_Block_cfgpred(header, 0, bad);
+	set_Block_cfgpred(header, 1, bad);
+	for (size_t i = 0; i < n_phis; ++i)
+		remove_keep_alive(env->phis[i]);
+	remove_keep_alive(header);
+	remove_keep_alive(env->shape.latch);
+
+	DB((dbg, LEVEL_1, "unrolled %+F completely, %u iterations\n", header,
+	    n_iterations));
+}
+
+/** Chooses the unroll factor of the runtime unrolled loop. */
+static unsigned choose_factor(lu_env_t const *const env,
+                              unsigned const max_size,
+                              unsigned const n_registers)
+{
+	unsigned factor = MAX_FACTOR;
+	while (factor > 1 && factor * env->n_nodes > max_size)
+		factor /= 2;
+
+	/* Every copy keeps at least one further value alive. */
+	while (factor > 1 && env->n_live + factor > n_registers)
+		factor /= 2;
+
+	/* Use the execution frequencies to estimate the number of iterations,
+	 * the unrolled loop should be executed at least twice on average. */
+	ir_node *const header     = env->shape.header;
+	ir_node *const entry      = get_Block_cfgpred_block(header, env->shape.entry_pos);
+	double   const freq       = get_block_execfreq(header);
+	double   const entry_freq = get_block_execfreq(entry);
+	if (freq > 0.0 && entry_freq > 0.0) {
+		double const trips = freq / entry_freq;
+		while (factor > 1 && 2.0 * factor > trips)
+			factor /= 2;
+		ir_node *const start = get_irg_start_block(env->irg);
+		if (freq < get_block_execfreq(start))
+			factor = 1;
+	}
+
+	if (scev_is_constant(env->count)) {
+		ir_tarval *const count = env->count->offset;
+		long       const min   = factor + (env->shape.latch == header);
+		while (factor > 1 && (!tarval_is_long(count)
+		                      || get_tarval_long(count) < min))
+			factor /= 2;
+	}
+	return factor;
+}
+
+static bool unroll_loop(lu_env_t *const env, unsigned const max_size,
+                        unsigned const n_registers)
+{
+	env->count = scev_get_backedge_count(env->scev, env->loop,
+	                                     &env->may_be_zero);
+	if (env->count == NULL || !scev_is_buildable(env->count)
+	 || !check_loop_nodes(env))
+		return false;
+
+	if (scev_is_constant(env->count) && !env->may_be_zero) {
+		ir_tarval *const count = env->count->offset;
+		if (tarval_is_long(count)) {
+			long const n = get_tarval_long(count)
+			             + (env->shape.latch == env->shape.header);
+			if (n >= 1 && (unsigned long)n * env->n_nodes <= max_size) {
+				unroll_fully(env, (unsigned)n);
+				return true;
+			}
+		}
+	}
+
+	if (env->may_be_zero && (!is_pure(env, get_Cmp_left(env->shape.cmp))
+	                      || !is_pure(env, get_Cmp_right(env->shape.cmp))))
+		return false;
+	unsigned const factor = choose_factor(env, max_size, n_registers);
+	if (factor < 2)
+		return false;
+	unroll_runtime(env, factor);
+	return true;
+}
+
+static bool unroll_innermost(ir_graph *const irg, scev_info_t *const scev,
+                             ir_loop *const loop, unsigned const max_size,
+                             unsigned const n_registers)
+{
+	lu_env_t env;
+	memset(&env, 0, sizeof(env));
+	env.irg  = irg;
+	env.loop = loop;
+	env.scev = scev;
+	if (!get_loop_shape(loop, &env.shape))
+		return false;
+
+	ir_nodemap_init(&env.copies, irg);
+	env.phis = NEW_ARR_F(ir_node*, 0);
+	bool const changed = unroll_loop(&env, max_size, n_registers);
+	DEL_ARR_F(env.phis);
+	ir_nodemap_destroy(&env.copies);
+	return changed;
+}
+
+void unroll_counted_loops(ir_graph *irg, unsigned max_size,
+                          unsigned n_registers)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_unroll");
+
+	if (get_block_execfreq(get_irg_start_block(irg)) <= 0.0)
+		ir_estimate_execfreq(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_loop **const loops = get_innermost_loops(irg);
+
+	scev_info_t *const scev    = scev_new(irg);
+	bool               changed = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		if (unroll_innermost(irg, scev, loops[i], max_size, n_registers))
+			changed = true;
+	}
+	scev_free(scev);
+	DEL_ARR_F(loops);
+
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+}
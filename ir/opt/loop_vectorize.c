@@ -0,0 +1,1185 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Vectorizer for innermost counted loops.
+ *
+ * Innermost loops consisting of a chain of blocks from the header to the
+ * latch, whose number of iterations is known to the scalar evolution
+ * analysis, get a vector loop in front of them: It executes as many iterations at once as
+ * fit into a vector register.  Loads and Stores of consecutive elements
+ * become vector accesses, arithmetic on their values becomes vector
+ * arithmetic, induction variables advance by the vector factor and
+ * reductions are accumulated lane-wise and combined when the vector loop is
+ * left.  The original loop executes the remaining iterations.
+ *
+ * The chain may be split by control flow selecting the minimum or maximum,
+ * which becomes a lane-wise Mux in the vector loop, while the original loop
+ * keeps its control flow.  Scalar Muxes combining the lanes of such
+ * reductions are lowered to control flow if the target does not support
+ * them.
+ *
+ * The vector loop is only entered if enough iterations are left and, if
+ * alias analysis cannot prove the accessed memory independent, if the
+ * memory ranges accessed by the whole loop do not overlap.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "iropt.h"
+#include "iroptimize.h"
+#include "irtools.h"
+#include "lowering.h"
+#include "obst.h"
+#include "scev.h"
+#include "target_t.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Maximum number of nodes in a loop body. */
+#define MAX_LOOP_NODES 256
+
+/** Maximum number of runtime overlap checks per loop. */
+#define MAX_CHECKS 8
+
+typedef enum lv_kind {
+	LV_INVARIANT, /**< defined outside of the loop */
+	LV_SCALAR,    /**< the same for all lanes, like addresses */
+	LV_VECTOR,    /**< one value per lane */
+	LV_MEMORY,    /**< a memory value */
+} lv_kind;
+
+typedef struct lv_node_t {
+	lv_kind  kind;
+	ir_node *copy;    /**< copy in the vector loop, broadcast of invariants */
+	ir_node *initial; /**< value in the first iteration */
+} lv_node_t;
+
+/** A pair of accesses whose memory ranges are checked at runtime. */
+typedef struct lv_check_t {
+	ir_node *store;
+	ir_node *other;
+} lv_check_t;
+
+typedef struct lv_env_t {
+	ir_graph      *irg;
+	ir_loop       *loop;
+	scev_info_t   *scev;
+	loop_shape_t   shape;
+	scev const    *count;        /**< backedge count */
+	bool           may_be_zero;  /**< count is only valid if the first test
+	                                  stays in the loop */
+	ir_nodemap     nodes;        /**< lv_node_t of the analysed nodes */
+	struct obstack obst;
+	ir_node      **phis;         /**< Phis of the header */
+	ir_node      **accesses;     /**< Loads and Stores */
+	ir_node      **operations;   /**< vector arithmetic and Stores */
+	lv_check_t    *checks;
+	unsigned       n_nodes;
+	unsigned       elem_size;    /**< size of the vector elements in bytes */
+	unsigned       n_lanes;
+	ir_node       *pre;          /**< block deciding about the vector loop */
+	ir_node       *pre_mem;      /**< memory at the end of pre */
+	ir_node       *body;         /**< block of the vector loop */
+	bool           scalar_muxes; /**< scalar Muxes combine the lanes */
+} lv_env_t;
+
+/** A selection of one of two values by a Mux or by control flow. */
+typedef struct lv_select_t {
+	ir_node *sel;
+	ir_node *mux_false;
+	ir_node *mux_true;
+} lv_select_t;
+
+static ir_node *get_access_ptr(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_ptr(node) : get_Store_ptr(node);
+}
+
+static ir_alias_relation get_access_alias_relation(ir_node const *const a,
+                                                   ir_node const *const b)
+{
+	ir_type const *const type_a = is_Load(a) ? get_Load_type(a) : get_Store_type(a);
+	ir_type const *const type_b = is_Load(b) ? get_Load_type(b) : get_Store_type(b);
+	ir_mode       *const mode_a = is_Load(a) ? get_Load_mode(a) : get_irn_mode(get_Store_value(a));
+	ir_mode       *const mode_b = is_Load(b) ? get_Load_mode(b) : get_irn_mode(get_Store_value(b));
+	return get_alias_relation(get_access_ptr(a), type_a, get_mode_size_bytes(mode_a),
+	                          get_access_ptr(b), type_b, get_mode_size_bytes(mode_b));
+}
+
+static lv_node_t *get_info(lv_env_t const *const env, ir_node const *const node)
+{
+	return ir_nodemap_get(lv_node_t, &env->nodes, node);
+}
+
+static lv_node_t *set_kind(lv_env_t *const env, ir_node *const node,
+                           lv_kind const kind)
+{
+	lv_node_t *const info = OALLOCZ(&env->obst, lv_node_t);
+	info->kind = kind;
+	ir_nodemap_insert(&env->nodes, node, info);
+	return info;
+}
+
+/** Checks that vector values of mode @p mode have the common element size. */
+static bool check_element_mode(lv_env_t *const env, ir_mode *const mode)
+{
+	if (!ir_target_is_vector_element_mode(mode))
+		return false;
+	unsigned const size = get_mode_size_bytes(mode);
+	if (env->elem_size == 0)
+		env->elem_size = size;
+	return env->elem_size == size;
+}
+
+/**
+ * Checks whether @p ptr addresses consecutive elements of mode @p mode in
+ * consecutive iterations.
+ */
+static bool is_consecutive(lv_env_t *const env, ir_node *const ptr,
+                           ir_mode *const mode)
+{
+	if (!check_element_mode(env, mode))
+		return false;
+	scev const *const s = scev_get(env->scev, ptr);
+	return s->kind == SCEV_ADDREC && s->loop == env->loop
+	    && scev_is_constant(s->step) && tarval_is_long(s->step->offset)
+	    && get_tarval_long(s->step->offset) == (long)get_mode_size_bytes(mode);
+}
+
+/**
+ * Checks whether a Mux selecting @p mux_true if @p sel holds and @p mux_false
+ * otherwise is the minimum or maximum of the values compared by @p sel, which
+ * can be selected lane-wise.  Integers are only compared signed and with at
+ * most 32 bits, like common vector instruction sets do.
+ */
+static int is_min_max(ir_node const *const sel, ir_node const *const mux_false,
+                      ir_node const *const mux_true)
+{
+	if (!is_Cmp(sel))
+		return false;
+	ir_node const *const left  = get_Cmp_left(sel);
+	ir_node const *const right = get_Cmp_right(sel);
+	if ((mux_true != left || mux_false != right)
+	 && (mux_true != right || mux_false != left))
+		return false;
+
+	ir_mode    *const mode     = get_irn_mode(mux_true);
+	ir_relation const relation = get_Cmp_relation(sel);
+	if (!ir_target_is_vector_element_mode(mode))
+		return false;
+	if (mode_is_float(mode))
+		return relation == ir_relation_less || relation == ir_relation_greater;
+	return mode_is_signed(mode) && get_mode_size_bytes(mode) <= 4
+	    && (relation == ir_relation_less || relation == ir_relation_less_equal
+	     || relation == ir_relation_greater
+	     || relation == ir_relation_greater_equal);
+}
+
+/**
+ * Checks whether both control flow predecessors of @p join come from the
+ * Projs of a Cond, directly or through empty blocks, so the Phis of @p join
+ * select values like Muxes.  Returns the Cond and sets @p true_pos to the
+ * predecessor reached if its selector holds.
+ */
+static ir_node *get_select_cond(ir_node const *const join, int *const true_pos)
+{
+	if (get_Block_n_cfgpreds(join) != 2)
+		return NULL;
+	ir_node *projs[2];
+	for (int i = 0; i < 2; ++i) {
+		ir_node *pred = get_Block_cfgpred(join, i);
+		if (is_Jmp(pred)) {
+			ir_node *const arm = get_nodes_block(pred);
+			if (get_Block_n_cfgpreds(arm) != 1 || get_irn_n_edges(arm) != 1)
+				return NULL;
+			pred = get_Block_cfgpred(arm, 0);
+		}
+		if (!is_Proj(pred))
+			return NULL;
+		projs[i] = pred;
+	}
+	ir_node *const cond = get_Proj_pred(projs[0]);
+	if (!is_Cond(cond) || get_Proj_pred(projs[1]) != cond
+	 || projs[0] == projs[1])
+		return NULL;
+	*true_pos = get_Proj_num(projs[0]) == pn_Cond_true ? 0 : 1;
+	return cond;
+}
+
+/**
+ * Checks whether the Mux or Phi @p node selects the minimum or maximum and
+ * fills @p select.
+ */
+static bool get_min_max(ir_node const *const node, lv_select_t *const select)
+{
+	if (is_Mux(node)) {
+		select->sel       = get_Mux_sel(node);
+		select->mux_false = get_Mux_false(node);
+		select->mux_true  = get_Mux_true(node);
+	} else if (is_Phi(node)) {
+		int            true_pos;
+		ir_node *const cond = get_select_cond(get_nodes_block(node), &true_pos);
+		if (cond == NULL)
+			return false;
+		select->sel       = get_Cond_selector(cond);
+		select->mux_false = get_Phi_pred(node, 1 - true_pos);
+		select->mux_true  = get_Phi_pred(node, true_pos);
+	} else {
+		return false;
+	}
+	return is_min_max(select->sel, select->mux_false, select->mux_true);
+}
+
+static bool is_in_loop(lv_env_t const *const env, ir_node const *const node)
+{
+	return get_irn_loop(get_block_const(node)) == env->loop;
+}
+
+static bool is_vector_op(lv_env_t const *const env, ir_node const *const node)
+{
+	lv_select_t select;
+	ir_mode *const mode = get_irn_mode(node);
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+	case iro_Sub:
+		return true;
+	case iro_Mul:
+		return mode_is_float(mode);
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+		return mode_is_int(mode);
+	case iro_Mux:
+	case iro_Phi:
+		return get_min_max(node, &select);
+	case iro_Cmp:
+		/* Compares of vectors only select the lanes of Muxes, or of Phis
+		 * behind a Cond other than the exit test. */
+		foreach_out_edge(node, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (is_Cond(user)) {
+				if (user == get_Proj_pred(env->shape.exit)
+				 || !is_in_loop(env, user))
+					return false;
+			} else if (!is_Mux(user) || !get_min_max(user, &select)
+			        || get_edge_src_pos(edge) != n_Mux_sel) {
+				return false;
+			}
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+static lv_node_t const *classify(lv_env_t *env, ir_node *node);
+
+static bool has_kind(lv_env_t *const env, ir_node *const node,
+                     lv_kind const kind)
+{
+	lv_node_t const *const info = classify(env, node);
+	return info != NULL && info->kind == kind;
+}
+
+static bool is_memory(lv_env_t *const env, ir_node *const node)
+{
+	lv_node_t const *const info = classify(env, node);
+	return info != NULL
+	    && (info->kind == LV_MEMORY || info->kind == LV_INVARIANT);
+}
+
+static bool analyze_node(lv_env_t *const env, ir_node *const node,
+                         lv_kind *const kind)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Load: {
+		ir_node *const ptr = get_Load_ptr(node);
+		if (get_Load_volatility(node) != volatility_non_volatile
+		 || ir_throws_exception(node)
+		 || !is_consecutive(env, ptr, get_Load_mode(node))
+		 || !has_kind(env, ptr, LV_SCALAR)
+		 || !is_memory(env, get_Load_mem(node)))
+			return false;
+		ARR_APP1(ir_node*, env->accesses, node);
+		*kind = LV_VECTOR;
+		return true;
+	}
+
+	case iro_Store: {
+		ir_node *const ptr   = get_Store_ptr(node);
+		ir_node *const value = get_Store_value(node);
+		if (get_Store_volatility(node) != volatility_non_volatile
+		 || ir_throws_exception(node)
+		 || !is_consecutive(env, ptr, get_irn_mode(value))
+		 || !has_kind(env, ptr, LV_SCALAR)
+		 || !is_memory(env, get_Store_mem(node)))
+			return false;
+		lv_node_t const *const info = classify(env, value);
+		if (info == NULL
+		 || (info->kind != LV_VECTOR && info->kind != LV_INVARIANT))
+			return false;
+		ARR_APP1(ir_node*, env->accesses, node);
+		ARR_APP1(ir_node*, env->operations, node);
+		*kind = LV_VECTOR;
+		return true;
+	}
+
+	case iro_Proj: {
+		ir_node *const pred = get_Proj_pred(node);
+		unsigned const pn   = get_Proj_num(node);
+		if (is_Load(pred)) {
+			if (pn == pn_Load_res)
+				*kind = LV_VECTOR;
+			else if (pn == pn_Load_M)
+				*kind = LV_MEMORY;
+			else
+				return false;
+		} else if (is_Store(pred) && pn == pn_Store_M) {
+			*kind = LV_MEMORY;
+		} else {
+			return false;
+		}
+		return classify(env, pred) != NULL;
+	}
+
+	case iro_Sync:
+		foreach_irn_in(node, i, pred) {
+			if (!is_memory(env, pred))
+				return false;
+		}
+		*kind = LV_MEMORY;
+		return true;
+
+	default:
+		break;
+	}
+
+	ir_mode *const mode = get_irn_mode(node);
+	if (mode == mode_M || mode == mode_T || mode == mode_X || is_cfop(node))
+		return false;
+
+	/* The Phis of the header are classified beforehand, the others select
+	 * the minimum or maximum like Muxes. */
+	ir_node *const *ins   = get_irn_in(node);
+	int             n_ins = get_irn_arity(node);
+	ir_node        *select_ins[3];
+	if (is_Phi(node)) {
+		lv_select_t select;
+		if (!get_min_max(node, &select))
+			return false;
+		select_ins[0] = select.sel;
+		select_ins[1] = select.mux_false;
+		select_ins[2] = select.mux_true;
+		ins   = select_ins;
+		n_ins = ARRAY_SIZE(select_ins);
+	}
+
+	bool vector = false;
+	for (int i = 0; i < n_ins; ++i) {
+		lv_node_t const *const info = classify(env, ins[i]);
+		if (info == NULL || info->kind == LV_MEMORY)
+			return false;
+		if (info->kind == LV_VECTOR)
+			vector = true;
+	}
+	if (!vector) {
+		/* The vector loop has no control flow to select scalars. */
+		if (is_Phi(node))
+			return false;
+		*kind = LV_SCALAR;
+		return true;
+	}
+
+	/* Values which differ per lane are only supported by few operations. */
+	ir_mode *const el_mode = is_Cmp(node) ? get_irn_mode(get_Cmp_left(node))
+	                                      : mode;
+	if (!is_vector_op(env, node) || !check_element_mode(env, el_mode))
+		return false;
+	for (int i = 0; i < n_ins; ++i) {
+		if (get_info(env, ins[i])->kind == LV_SCALAR)
+			return false;
+	}
+	ARR_APP1(ir_node*, env->operations, node);
+	*kind = LV_VECTOR;
+	return true;
+}
+
+/** Classifies @p node and its operands, returns NULL if not vectorizable. */
+static lv_node_t const *classify(lv_env_t *const env, ir_node *const node)
+{
+	lv_node_t const *const info = get_info(env, node);
+	if (info != NULL)
+		return info;
+	if (!is_in_loop(env, node))
+		return set_kind(env, node, LV_INVARIANT);
+	if (++env->n_nodes > MAX_LOOP_NODES)
+		return NULL;
+
+	lv_kind kind;
+	if (!analyze_node(env, node, &kind))
+		return NULL;
+	return set_kind(env, node, kind);
+}
+
+/**
+ * Checks whether @p phi accumulates the values of another vectorizable node
+ * with the operation @p next, which is not used otherwise in the loop.
+ */
+static bool is_reduction(lv_env_t const *const env, ir_node *const phi,
+                         ir_node *const next)
+{
+	ir_mode *const mode = get_irn_mode(phi);
+	ir_node       *cmp  = NULL;
+	lv_select_t    select;
+	switch (get_irn_opcode(next)) {
+	case iro_Add:
+		if (mode_is_float(mode) && !ir_imprecise_float_transforms_allowed())
+			return false;
+		break;
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+		break;
+	case iro_Mux:
+	case iro_Phi:
+		/* The minimum or maximum of the phi and another value. */
+		if (!get_min_max(next, &select)
+		 || (mode_is_float(mode) && !ir_imprecise_float_transforms_allowed()))
+			return false;
+		cmp = select.sel;
+		if ((select.mux_false == phi) == (select.mux_true == phi))
+			return false;
+		break;
+	default:
+		return false;
+	}
+	if (cmp == NULL
+	 && (get_binop_left(next) == phi) == (get_binop_right(next) == phi))
+		return false;
+
+	foreach_out_edge(phi, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user != next && user != cmp && is_in_loop(env, user))
+			return false;
+	}
+	foreach_out_edge(next, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user != phi && is_in_loop(env, user))
+			return false;
+	}
+	return true;
+}
+
+static bool classify_phis(lv_env_t *const env)
+{
+	bool has_memory = false;
+	foreach_out_edge(env->shape.header, edge) {
+		ir_node *const phi = get_edge_src_irn(edge);
+		if (!is_Phi(phi))
+			continue;
+		ARR_APP1(ir_node*, env->phis, phi);
+
+		ir_mode *const mode = get_irn_mode(phi);
+		lv_kind        kind = LV_VECTOR;
+		if (mode == mode_M) {
+			if (has_memory)
+				return false;
+			has_memory = true;
+			kind       = LV_MEMORY;
+		} else if (mode_is_int(mode) || mode_is_reference(mode)) {
+			scev const *const s = scev_get(env->scev, phi);
+			if (s->kind == SCEV_ADDREC && s->loop == env->loop
+			 && scev_is_constant(s->step))
+				kind = LV_SCALAR;
+		}
+		set_kind(env, phi, kind);
+	}
+
+	int const back_pos = 1 - env->shape.entry_pos;
+	for (size_t i = 0, n = ARR_LEN(env->phis); i < n; ++i) {
+		ir_node         *const phi  = env->phis[i];
+		ir_node         *const next = get_irn_n(phi, back_pos);
+		lv_node_t const *const info = classify(env, next);
+		lv_kind          const kind = get_info(env, phi)->kind;
+		if (info == NULL || info->kind != kind)
+			return false;
+		if (kind == LV_VECTOR && !is_reduction(env, phi, next))
+			return false;
+	}
+	return true;
+}
+
+/** Returns whether all blocks of the loop are executed equally often. */
+static bool is_tested_at_end(loop_shape_t const *const shape)
+{
+	return get_nodes_block(shape->exit) == shape->latch;
+}
+
+/**
+ * Checks whether the blocks of @p loop form a chain from the header to the
+ * latch, which may be split by selects of two values, and fills @p shape.
+ * The loop must be tested in the header or the latch.
+ */
+static bool get_chain_shape(ir_loop *const loop, loop_shape_t *const shape)
+{
+	size_t const n_blocks = get_loop_n_elements(loop);
+	ir_node     *header   = NULL;
+	for (size_t i = 0; i < n_blocks; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind != k_ir_node)
+			return false;
+		if (has_backedges(element.node)) {
+			if (header != NULL)
+				return false;
+			header = element.node;
+		}
+	}
+	if (header == NULL || get_Block_n_cfgpreds(header) != 2)
+		return false;
+
+	int const entry_pos = is_backedge(header, 0) ? 1 : 0;
+	int const back_pos  = 1 - entry_pos;
+	if (is_backedge(header, entry_pos) || !is_backedge(header, back_pos)
+	 || is_Bad(get_Block_cfgpred(header, entry_pos)))
+		return false;
+
+	/* Walk from the latch back to the header.  Each block is left by a Jmp,
+	 * the exit test or a Cond, whose Projs join in the next block. */
+	ir_node *const latch     = get_Block_cfgpred_block(header, back_pos);
+	ir_node       *block     = latch;
+	ir_node       *out       = get_Block_cfgpred(header, back_pos);
+	ir_node       *stay      = NULL;
+	size_t         n_visited = 0;
+	for (;;) {
+		if (get_irn_loop(block) != loop || ++n_visited > n_blocks)
+			return false;
+		if (is_Proj(out)) {
+			if (stay != NULL)
+				return false;
+			stay = out;
+		} else if (!is_Jmp(out) && !is_Cond(out)) {
+			return false;
+		}
+		if (block == header)
+			break;
+		if (get_Block_n_cfgpreds(block) == 1) {
+			out = get_Block_cfgpred(block, 0);
+		} else {
+			int true_pos;
+			out = get_select_cond(block, &true_pos);
+			if (out == NULL)
+				return false;
+			/* count the empty blocks between the Cond and the join */
+			for (int i = 0; i < 2; ++i)
+				n_visited += is_Jmp(get_Block_cfgpred(block, i));
+		}
+		block = get_nodes_block(out);
+	}
+	if (stay == NULL || n_visited != n_blocks)
+		return false;
+
+	ir_node *const cond = get_Proj_pred(stay);
+	if (!is_Cond(cond) || !is_Cmp(get_Cond_selector(cond)))
+		return false;
+	ir_node *const exiting = get_nodes_block(cond);
+	if (exiting != header && exiting != latch)
+		return false;
+	bool     const exit_on_true = get_Proj_num(stay) == pn_Cond_false;
+	unsigned const exit_pn      = exit_on_true ? pn_Cond_true : pn_Cond_false;
+	ir_node *const exit         = get_Proj_for_pn(cond, exit_pn);
+	if (exit == NULL)
+		return false;
+
+	shape->header       = header;
+	shape->latch        = latch;
+	shape->entry_pos    = entry_pos;
+	shape->cmp          = get_Cond_selector(cond);
+	shape->exit_on_true = exit_on_true;
+	shape->exit         = exit;
+	return true;
+}
+
+/**
+ * Checks that all memory operations of the loop are handled and are executed
+ * once per iteration, and that all Phis besides the ones of the header select
+ * the minimum or maximum.
+ */
+static bool check_loop_nodes(lv_env_t const *const env)
+{
+	ir_node *const header = env->shape.header;
+	for (size_t i = 0, n = get_loop_n_elements(env->loop); i < n; ++i) {
+		ir_node *const block = get_loop_element(env->loop, i).node;
+		foreach_out_edge(block, edge) {
+			ir_node *const node = get_edge_src_irn(edge);
+			if (is_Cond(node))
+				continue;
+			if (is_Phi(node) && block != header) {
+				lv_select_t select;
+				if (!get_min_max(node, &select))
+					return false;
+				continue;
+			}
+			ir_mode *const mode = get_irn_mode(node);
+			if (mode != mode_M && mode != mode_T)
+				continue;
+			if (get_info(env, node) == NULL)
+				return false;
+			/* The header of a loop tested in the header is executed once more
+			 * than the other blocks. */
+			if (block == header && !is_tested_at_end(&env->shape)
+			 && !is_Phi(node))
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Checks that executing the accesses of several iterations at once does not
+ * change the result.  Pairs of accesses, which might overlap, are recorded
+ * for a runtime check.
+ */
+static bool check_dependences(lv_env_t *const env)
+{
+	long const width = (long)(env->n_lanes * env->elem_size);
+	for (size_t i = 0, n = ARR_LEN(env->accesses); i < n; ++i) {
+		ir_node *const store = env->accesses[i];
+		if (!is_Store(store))
+			continue;
+		scev const *const s = scev_get(env->scev, get_Store_ptr(store));
+		for (size_t j = 0; j < n; ++j) {
+			ir_node *const other = env->accesses[j];
+			if (j == i || (is_Store(other) && j < i))
+				continue;
+
+			scev const *const o = scev_get(env->scev, get_access_ptr(other));
+			long              dist;
+			if (scev_get_distance(s->start, o->start, &dist)) {
+				/* Accesses of the same iteration are kept in order, accesses
+				 * further apart are in different vector iterations. */
+				if (dist != 0 && labs(dist) < width)
+					return false;
+				continue;
+			}
+			if (get_access_alias_relation(store, other) == ir_no_alias)
+				continue;
+			if (ARR_LEN(env->checks) == MAX_CHECKS
+			 || !scev_is_buildable(s->start) || !scev_is_buildable(o->start))
+				return false;
+			lv_check_t const check = { store, other };
+			ARR_APP1(lv_check_t, env->checks, check);
+		}
+	}
+	return true;
+}
+
+static bool analyze_loop(lv_env_t *const env)
+{
+	env->count = scev_get_backedge_count(env->scev, env->loop,
+	                                     &env->may_be_zero);
+	if (env->count == NULL || !scev_is_buildable(env->count))
+		return false;
+
+	if (!classify_phis(env) || !check_loop_nodes(env)
+	 || ARR_LEN(env->operations) == 0 || env->elem_size == 0)
+		return false;
+	env->n_lanes = ir_target.vector_size / env->elem_size;
+
+	/* The vector loop is entered if at least n_lanes iterations are left to
+	 * it and the remaining ones to the original loop, which executes the
+	 * body at least once if it is tested at its end.  Both hold if the
+	 * backedges are taken at least n_lanes times. */
+	if (scev_is_constant(env->count)) {
+		ir_tarval *const count = env->count->offset;
+		if (!tarval_is_long(count)
+		 || get_tarval_long(count) < (long)env->n_lanes)
+			return false;
+	}
+	if (env->may_be_zero) {
+		lv_node_t const *const l = classify(env, get_Cmp_left(env->shape.cmp));
+		lv_node_t const *const r = classify(env, get_Cmp_right(env->shape.cmp));
+		if (l == NULL || r == NULL || l->kind == LV_VECTOR
+		 || r->kind == LV_VECTOR)
+			return false;
+	}
+	return check_dependences(env);
+}
+
+static ir_node *new_temporary(lv_env_t const *const env, ir_node *const block,
+                              ir_mode *const element_mode)
+{
+	ir_type   *const type   = new_type_array(get_type_for_mode(element_mode),
+	                                         env->n_lanes);
+	ir_type   *const frame  = get_irg_frame_type(env->irg);
+	ir_entity *const entity = new_entity(frame, id_unique("vector"), type);
+	return new_r_Member(block, get_irg_frame(env->irg), entity);
+}
+
+static ir_node *get_lane_address(lv_env_t const *const env,
+                                 ir_node *const block, ir_node *const base,
+                                 unsigned const lane)
+{
+	if (lane == 0)
+		return base;
+	ir_mode *const mode   = get_reference_offset_mode(get_irn_mode(base));
+	ir_node *const offset = new_r_Const_long(env->irg, mode,
+	                                         lane * env->elem_size);
+	return new_r_Add(block, base, offset);
+}
+
+/** Builds a vector from the scalar values @p lanes via a temporary. */
+static ir_node *build_vector(lv_env_t const *const env, ir_node *const block,
+                             ir_node **const mem, ir_node *const *const lanes)
+{
+	ir_mode *const mode  = get_irn_mode(lanes[0]);
+	ir_type *const type  = get_type_for_mode(mode);
+	ir_node *const addr  = new_temporary(env, block, mode);
+	for (unsigned l = 0; l < env->n_lanes; ++l) {
+		ir_node *const ptr   = get_lane_address(env, block, addr, l);
+		ir_node *const store = new_r_Store(block, *mem, ptr, lanes[l], type,
+		                                   cons_none);
+		*mem = new_r_Proj(store, mode_M, pn_Store_M);
+	}
+	ir_mode *const vmode = get_vector_mode(mode, env->n_lanes);
+	ir_node *const load  = new_r_Load(block, *mem, addr, vmode, type,
+	                                  cons_none);
+	*mem = new_r_Proj(load, mode_M, pn_Load_M);
+	return new_r_Proj(load, vmode, pn_Load_res);
+}
+
+/**
+ * Creates the reduction operation @p op of @p phi for the accumulated value
+ * @p acc and the next value @p value.
+ */
+static ir_node *new_reduction_op(ir_node const *const op,
+                                 ir_node const *const phi, ir_node *const block,
+                                 ir_node *const acc, ir_node *const value)
+{
+	switch (get_irn_opcode(op)) {
+	case iro_Add: return new_r_Add(block, acc, value);
+	case iro_And: return new_r_And(block, acc, value);
+	case iro_Or:  return new_r_Or(block, acc, value);
+	case iro_Eor: return new_r_Eor(block, acc, value);
+	case iro_Mux:
+	case iro_Phi: {
+		lv_select_t select;
+		if (!get_min_max(op, &select))
+			panic("unexpected reduction %+F", op);
+		ir_node *const sel   = select.sel;
+		bool     const left  = get_Cmp_left(sel) == phi;
+		bool     const f     = select.mux_false == phi;
+		ir_node *const cmp   = new_r_Cmp(block, left ? acc : value,
+		                                 left ? value : acc,
+		                                 get_Cmp_relation(sel));
+		return new_r_Mux(block, cmp, f ? acc : value, f ? value : acc);
+	}
+	default:      panic("unexpected reduction %+F", op);
+	}
+}
+
+/** Combines the lanes of @p vector with the reduction @p op of @p phi. */
+static ir_node *combine_lanes(lv_env_t const *const env, ir_node *const block,
+                              ir_node **const mem, ir_node *const vector,
+                              ir_node const *const op, ir_node const *const phi)
+{
+	ir_mode *const mode  = get_irn_mode(op);
+	ir_type *const type  = get_type_for_mode(mode);
+	ir_node *const addr  = new_temporary(env, block, mode);
+	ir_node *const store = new_r_Store(block, *mem, addr, vector, type,
+	                                   cons_none);
+	*mem = new_r_Proj(store, mode_M, pn_Store_M);
+
+	ir_node *res = NULL;
+	for (unsigned l = 0; l < env->n_lanes; ++l) {
+		ir_node *const ptr  = get_lane_address(env, block, addr, l);
+		ir_node *const load = new_r_Load(block, *mem, ptr, mode, type,
+		                                 cons_none);
+		ir_node *const val  = new_r_Proj(load, mode, pn_Load_res);
+		*mem = new_r_Proj(load, mode_M, pn_Load_M);
+		res  = res == NULL ? val : new_reduction_op(op, phi, block, res, val);
+	}
+	return res;
+}
+
+static ir_node *get_broadcast(lv_env_t *const env, ir_node *const value)
+{
+	lv_node_t *const info = get_info(env, value);
+	if (info->copy == NULL) {
+		ir_node **const lanes = ALLOCAN(ir_node*, env->n_lanes);
+		for (unsigned l = 0; l < env->n_lanes; ++l)
+			lanes[l] = value;
+		info->copy = build_vector(env, env->pre, &env->pre_mem, lanes);
+	}
+	return info->copy;
+}
+
+static ir_node *clone(lv_env_t *env, ir_node *node);
+
+static ir_node *clone_vector_operand(lv_env_t *const env, ir_node *const node)
+{
+	lv_node_t const *const info = get_info(env, node);
+	if (info->kind == LV_INVARIANT)
+		return info->copy;
+	return clone(env, node);
+}
+
+/** Returns the copy of @p node in the vector loop. */
+static ir_node *clone(lv_env_t *const env, ir_node *const node)
+{
+	lv_node_t *const info = get_info(env, node);
+	if (info->kind == LV_INVARIANT)
+		return node;
+	if (info->copy != NULL)
+		return info->copy;
+
+	bool     const vector = info->kind == LV_VECTOR;
+	ir_mode       *mode   = get_irn_mode(node);
+	if (vector && mode != mode_T && mode != mode_b)
+		mode = get_vector_mode(mode, env->n_lanes);
+
+	ir_node *copy;
+	lv_select_t select;
+	if (is_Proj(node)) {
+		ir_node *const pred = clone(env, get_Proj_pred(node));
+		copy = new_r_Proj(pred, mode, get_Proj_num(node));
+	} else if (is_Phi(node) && get_min_max(node, &select)) {
+		/* The vector loop selects the lanes without control flow. */
+		ir_node *const sel       = clone(env, select.sel);
+		ir_node *const mux_false = clone_vector_operand(env, select.mux_false);
+		ir_node *const mux_true  = clone_vector_operand(env, select.mux_true);
+		copy = new_r_Mux(env->body, sel, mux_false, mux_true);
+	} else {
+		copy = exact_copy(node);
+		set_nodes_block(copy, env->body);
+		foreach_irn_in(node, i, pred) {
+			bool const value = vector && !is_Load(node)
+			                && (!is_Store(node) || i == n_Store_value);
+			set_irn_n(copy, i, value ? clone_vector_operand(env, pred)
+			                         : clone(env, pred));
+		}
+		if (is_Load(node) && vector) {
+			set_Load_mode(copy, get_vector_mode(get_Load_mode(node),
+			                                    env->n_lanes));
+			set_Load_unaligned(copy, align_non_aligned);
+		} else if (is_Store(node) && vector) {
+			set_Store_unaligned(copy, align_non_aligned);
+		} else {
+			set_irn_mode(copy, mode);
+		}
+	}
+	info->copy = copy;
+	return copy;
+}
+
+/**
+ * Returns a copy of the scalar @p node in the block in front of the loop,
+ * which computes its value in the first iteration.
+ */
+static ir_node *clone_initial(lv_env_t *const env, ir_node *const node)
+{
+	lv_node_t *const info = get_info(env, node);
+	if (info->kind == LV_INVARIANT)
+		return node;
+	if (info->initial == NULL) {
+		if (is_Phi(node)) {
+			info->initial = get_irn_n(node, env->shape.entry_pos);
+		} else {
+			ir_node *const copy = exact_copy(node);
+			set_nodes_block(copy, env->pre);
+			foreach_irn_in(node, i, pred) {
+				set_irn_n(copy, i, clone_initial(env, pred));
+			}
+			info->initial = copy;
+		}
+	}
+	return info->initial;
+}
+
+/** Builds a test whether the memory accessed by a check pair is disjoint. */
+static ir_node *build_overlap_check(lv_env_t *const env,
+                                    lv_check_t const *const check,
+                                    ir_node *const count)
+{
+	ir_node    *const block = env->pre;
+	scev const *const a     = scev_get(env->scev, get_access_ptr(check->store));
+	scev const *const b     = scev_get(env->scev, get_access_ptr(check->other));
+	ir_node    *const start_a = scev_build(a->start, block);
+	ir_node    *const start_b = scev_build(b->start, block);
+	ir_mode    *const mode    = get_reference_offset_mode(get_irn_mode(start_a));
+	ir_node    *const size    = new_r_Const_long(env->irg, mode, env->elem_size);
+	ir_node    *const bytes   = new_r_Mul(block, new_r_Conv(block, count, mode),
+	                                      size);
+	ir_node    *const end_a   = new_r_Add(block, start_a, bytes);
+	ir_node    *const end_b   = new_r_Add(block, start_b, bytes);
+	ir_node    *const before  = new_r_Cmp(block, end_a, start_b,
+	                                      ir_relation_less_equal);
+	ir_node    *const after   = new_r_Cmp(block, end_b, start_a,
+	                                      ir_relation_less_equal);
+	return new_r_Or(block, before, after);
+}
+
+/** Returns the neutral element of the reduction @p op. */
+static ir_node *get_neutral(ir_graph *const irg, ir_node const *const op)
+{
+	ir_mode *const mode = get_irn_mode(op);
+	return new_r_Const(irg, is_And(op) ? get_mode_all_one(mode)
+	                                   : get_mode_null(mode));
+}
+
+static void vectorize(lv_env_t *const env)
+{
+	ir_graph *const irg       = env->irg;
+	ir_node  *const header    = env->shape.header;
+	int       const entry_pos = env->shape.entry_pos;
+	int       const back_pos  = 1 - entry_pos;
+	size_t    const n_phis    = ARR_LEN(env->phis);
+
+	/* The block deciding whether the vector loop is executed. */
+	ir_node *const entry = get_Block_cfgpred(header, entry_pos);
+	ir_node *const pre   = new_r_Block(irg, 1, &entry);
+	env->pre = pre;
+
+	ir_node *mem_phi = NULL;
+	for (size_t i = 0; i < n_phis; ++i) {
+		if (get_irn_mode(env->phis[i]) == mode_M)
+			mem_phi = env->phis[i];
+	}
+	env->pre_mem = mem_phi != NULL ? get_irn_n(mem_phi, entry_pos)
+	             : is_Load(env->accesses[0]) ? get_Load_mem(env->accesses[0])
+	             : get_Store_mem(env->accesses[0]);
+
+	/* Number of executions of the body. */
+	ir_mode *const count_mode = env->count->mode;
+	ir_mode *const umode      = mode_is_signed(count_mode)
+		? find_unsigned_mode(count_mode) : count_mode;
+	ir_node       *count      = scev_build(env->count, pre);
+	unsigned const min_rest   = is_tested_at_end(&env->shape);
+	if (min_rest > 0)
+		count = new_r_Add(pre, count, new_r_Const(irg, get_mode_one(count_mode)));
+	if (umode != count_mode)
+		count = new_r_Conv(pre, count, umode);
+
+	ir_node *const min = new_r_Const_long(irg, umode, env->n_lanes + min_rest);
+	ir_node       *ok  = new_r_Cmp(pre, count, min, ir_relation_greater_equal);
+	if (env->may_be_zero) {
+		ir_relation relation = get_Cmp_relation(env->shape.cmp);
+		if (env->shape.exit_on_true)
+			relation = get_negated_relation(relation);
+		ir_node *const left  = clone_initial(env, get_Cmp_left(env->shape.cmp));
+		ir_node *const right = clone_initial(env, get_Cmp_right(env->shape.cmp));
+		ok = new_r_And(pre, ok, new_r_Cmp(pre, left, right, relation));
+	}
+	for (size_t i = 0, n = ARR_LEN(env->checks); i < n; ++i) {
+		ir_node *const check = build_overlap_check(env, &env->checks[i], count);
+		ok = new_r_And(pre, ok, check);
+	}
+	ir_node *const cond = new_r_Cond(pre, ok);
+	ir_node *const skip = new_r_Proj(cond, mode_X, pn_Cond_false);
+
+	/* Broadcast the invariant operands in front of the loop. */
+	for (size_t i = 0, n = ARR_LEN(env->operations); i < n; ++i) {
+		ir_node *const op = env->operations[i];
+		foreach_irn_in(op, p, pred) {
+			if ((!is_Store(op) || p == n_Store_value)
+			 && get_info(env, pred)->kind == LV_INVARIANT)
+				get_broadcast(env, pred);
+		}
+	}
+
+	/* Start values of the vector loop, reductions start with their initial
+	 * value in the first lane, minimum and maximum in all lanes. */
+	ir_node **const starts = ALLOCAN(ir_node*, n_phis);
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node *const phi  = env->phis[i];
+		ir_node *const init = get_irn_n(phi, entry_pos);
+		if (get_info(env, phi)->kind != LV_VECTOR) {
+			starts[i] = init;
+			continue;
+		}
+		ir_node  *const op    = get_irn_n(phi, back_pos);
+		ir_node **const lanes = ALLOCAN(ir_node*, env->n_lanes);
+		lanes[0] = init;
+		for (unsigned l = 1; l < env->n_lanes; ++l)
+			lanes[l] = is_Mux(op) || is_Phi(op) ? init : get_neutral(irg, op);
+		starts[i] = build_vector(env, pre, &env->pre_mem, lanes);
+	}
+
+	/* The vector loop. */
+	ir_node *const body_in[] = {
+		new_r_Proj(cond, mode_X, pn_Cond_true), new_r_Dummy(irg, mode_X)
+	};
+	ir_node *const body = new_r_Block(irg, ARRAY_SIZE(body_in), body_in);
+	env->body = body;
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node   *const phi   = env->phis[i];
+		lv_node_t *const info  = get_info(env, phi);
+		ir_mode         *mode  = get_irn_mode(phi);
+		if (info->kind == LV_VECTOR)
+			mode = get_vector_mode(mode, env->n_lanes);
+		ir_node   *const start = info->kind == LV_MEMORY ? env->pre_mem
+		                                                 : starts[i];
+		ir_node   *const in[]  = { start, new_r_Dummy(irg, mode) };
+		info->copy = new_r_Phi(body, ARRAY_SIZE(in), in, mode);
+	}
+
+	ir_node **const nexts = ALLOCAN(ir_node*, n_phis);
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node   *const phi  = env->phis[i];
+		lv_node_t *const info = get_info(env, phi);
+		if (info->kind == LV_SCALAR) {
+			/* Induction variables advance by the vector factor. */
+			scev const *const s     = scev_get(env->scev, phi);
+			ir_tarval  *const step  = s->step->offset;
+			ir_tarval  *const lanes = new_tarval_from_long(env->n_lanes,
+			                                               get_tarval_mode(step));
+			ir_node    *const inc   = new_r_Const(irg, tarval_mul(step, lanes));
+			nexts[i] = new_r_Add(body, info->copy, inc);
+		} else {
+			nexts[i] = clone(env, get_irn_n(phi, back_pos));
+		}
+	}
+	for (size_t i = 0; i < n_phis; ++i)
+		set_irn_n(get_info(env, env->phis[i])->copy, 1, nexts[i]);
+
+	ir_node *const zero      = new_r_Const(irg, get_mode_null(umode));
+	ir_node *const counter_in[] = { zero, new_r_Dummy(irg, umode) };
+	ir_node *const counter   = new_r_Phi(body, ARRAY_SIZE(counter_in),
+	                                     counter_in, umode);
+	ir_node *const n_lanes   = new_r_Const_long(irg, umode, env->n_lanes);
+	ir_node *const done      = new_r_Add(body, counter, n_lanes);
+	set_irn_n(counter, 1, done);
+	ir_node *const rest      = new_r_Sub(body, count, done);
+	ir_node *const again     = new_r_Cmp(body, rest, min,
+	                                     ir_relation_greater_equal);
+	ir_node *const body_cond = new_r_Cond(body, again);
+	set_Block_cfgpred(body, 1, new_r_Proj(body_cond, mode_X, pn_Cond_true));
+
+	/* Combine the reductions after the vector loop. */
+	ir_node *const leave_in  = new_r_Proj(body_cond, mode_X, pn_Cond_false);
+	ir_node *const leave     = new_r_Block(irg, 1, &leave_in);
+	ir_node       *leave_mem = env->pre_mem;
+	for (size_t i = 0; i < n_phis; ++i) {
+		if (env->phis[i] == mem_phi)
+			leave_mem = nexts[i];
+	}
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node *const phi = env->phis[i];
+		if (get_info(env, phi)->kind == LV_VECTOR) {
+			ir_node *const op = get_irn_n(phi, back_pos);
+			nexts[i] = combine_lanes(env, leave, &leave_mem, nexts[i], op,
+			                         phi);
+			if (is_Mux(op) || is_Phi(op))
+				env->scalar_muxes = true;
+		} else if (phi == mem_phi) {
+			nexts[i] = leave_mem;
+		}
+	}
+
+	/* Continue with the original loop. */
+	ir_node *const join_in[] = { skip, new_r_Jmp(leave) };
+	ir_node *const join      = new_r_Block(irg, ARRAY_SIZE(join_in), join_in);
+	for (size_t i = 0; i < n_phis; ++i) {
+		ir_node *const phi   = env->phis[i];
+		ir_node *const start = phi == mem_phi ? env->pre_mem
+		                                      : get_irn_n(phi, entry_pos);
+		ir_node *const in[]  = { start, nexts[i] };
+		set_irn_n(phi, entry_pos,
+		          new_r_Phi(join, ARRAY_SIZE(in), in, get_irn_mode(phi)));
+	}
+	set_Block_cfgpred(header, entry_pos, new_r_Jmp(join));
+
+	DB((dbg, LEVEL_1, "vectorized %+F with %u lanes, %zu runtime checks\n",
+	    header, env->n_lanes, ARR_LEN(env->checks)));
+}
+
+/**
+ * Vectorizes @p loop if possible and sets @p scalar_muxes if Muxes were
+ * created, which the target might not support.
+ */
+static bool vectorize_loop(ir_graph *const irg, scev_info_t *const scev,
+                           ir_loop *const loop, bool *const scalar_muxes)
+{
+	lv_env_t env;
+	memset(&env, 0, sizeof(env));
+	env.irg  = irg;
+	env.loop = loop;
+	env.scev = scev;
+	if (!get_chain_shape(loop, &env.shape))
+		return false;
+
+	ir_nodemap_init(&env.nodes, irg);
+	obstack_init(&env.obst);
+	env.phis       = NEW_ARR_F(ir_node*, 0);
+	env.accesses   = NEW_ARR_F(ir_node*, 0);
+	env.operations = NEW_ARR_F(ir_node*, 0);
+	env.checks     = NEW_ARR_F(lv_check_t, 0);
+
+	bool const vectorizable = analyze_loop(&env);
+	if (vectorizable)
+		vectorize(&env);
+	*scalar_muxes |= env.scalar_muxes;
+
+	DEL_ARR_F(env.checks);
+	DEL_ARR_F(env.operations);
+	DEL_ARR_F(env.accesses);
+	DEL_ARR_F(env.phis);
+	obstack_free(&env.obst, NULL);
+	ir_nodemap_destroy(&env.nodes);
+	return vectorizable;
+}
+
+/** Lowers the scalar Muxes not allowed by the target. */
+static int lower_unsupported_mux(ir_node *const mux)
+{
+	return !mode_is_vector(get_irn_mode(mux))
+	    && !ir_target.allow_ifconv(get_Mux_sel(mux), get_Mux_false(mux),
+	                               get_Mux_true(mux));
+}
+
+void loop_vectorize(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop_vectorize");
+
+	if (ir_target.vector_size == 0)
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
+	if ((get_irg_memory_disambiguator_options(irg) & aa_opt_always_alias) == 0)
+		assure_irp_globals_entity_usage_computed();
+
+	ir_loop **const loops = get_innermost_loops(irg);
+
+	scev_info_t *const scev         = scev_new(irg);
+	bool               changed      = false;
+	bool               scalar_muxes = false;
+	for (size_t i = 0, n = ARR_LEN(loops); i < n; ++i) {
+		if (vectorize_loop(irg, scev, loops[i], &scalar_muxes))
+			changed = true;
+	}
+	scev_free(scev);
+	DEL_ARR_F(loops);
+
+	if (scalar_muxes)
+		lower_mux(irg, lower_unsupported_mux);
+	confirm_irg_properties(irg, changed
+		? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -9,13 +9,24 @@
  * @date    15.03.2006
  * @author  Michael Beck
  * @brief
- *   Optimize the frame type by removing unused type members.
+ *   Optimize the frame type by removing unused type members and by
+ *   overlapping entities with disjoint lifetimes.
  */
+#include "array.h"
+#include "debug.h"
+#include "ircons.h"
 #include "iredges_t.h"
+#include "irgmod.h"
 #include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
 #include "iroptimize.h"
 #include "irouts_t.h"
+#include "raw_bitset.h"
 #include "type_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 /*
  * Optimize the frame type of an irg by removing
@@ -81,3 +92,289 @@ void opt_frame_irg(ir_graph *irg)
 		| IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE
 		| IR_GRAPH_PROPERTY_MANY_RETURNS);
 }
+
+/** A frame entity whose memory may be shared with other entities. */
+typedef struct slot_user_t {
+	ir_entity *entity;
+	ir_node  **members;  /**< the Members of the frame selecting the entity */
+	ir_node  **accesses; /**< the Loads and Stores of the entity */
+	unsigned  *live;     /**< blocks in which the entity is live */
+	unsigned   color;    /**< index of the shared slot */
+} slot_user_t;
+
+typedef struct color_env_t {
+	ir_node    **blocks;   /**< all blocks, indexed by their link */
+	slot_user_t *users;
+	unsigned    *accessed; /**< blocks accessing the current entity */
+} color_env_t;
+
+static unsigned get_block_nr(ir_node const *const block)
+{
+	return (unsigned)PTR_TO_INT(get_irn_link(block));
+}
+
+static void number_block(ir_node *const block, void *const ctx)
+{
+	ir_node ***const blocks = (ir_node***)ctx;
+	set_irn_link(block, INT_TO_PTR(ARR_LEN(*blocks)));
+	ARR_APP1(ir_node*, *blocks, block);
+}
+
+/**
+ * Collects the Loads and Stores of the memory at address @p addr and marks
+ * their blocks in @p accessed.  Returns false if the address escapes, so the
+ * accesses are unknown.
+ */
+static bool collect_accesses(ir_node const *const addr, ir_node ***const accesses,
+                             unsigned *const accessed)
+{
+	foreach_irn_out_r(addr, i, user) {
+		switch (get_irn_opcode(user)) {
+		case iro_Load:
+			break;
+		case iro_Store:
+			if (get_Store_value(user) == addr)
+				return false;
+			break;
+		case iro_Member:
+		case iro_Sel:
+		case iro_Add:
+		case iro_Sub:
+			if (!mode_is_reference(get_irn_mode(user))
+			 || !collect_accesses(user, accesses, accessed))
+				return false;
+			continue;
+		case iro_End:
+			continue;
+		default:
+			/* CopyB and other floating operations may move into blocks in
+			 * which the memory is used otherwise. */
+			return false;
+		}
+		ARR_APP1(ir_node*, *accesses, user);
+		rbitset_set(accessed, get_block_nr(get_nodes_block(user)));
+	}
+	return true;
+}
+
+/**
+ * Computes the blocks in which the entity accessed in @p accessed is live,
+ * i.e. which are reachable from an access and reach an access.
+ */
+static void compute_lifetime(color_env_t const *const env,
+                             unsigned *const live)
+{
+	size_t    const n_blocks = ARR_LEN(env->blocks);
+	unsigned *const reached  = rbitset_alloca(n_blocks);
+	ir_node **worklist       = NEW_ARR_F(ir_node*, 0);
+
+	/* forward from the accesses */
+	for (size_t b = 0; b < n_blocks; ++b) {
+		if (rbitset_is_set(env->accessed, b)) {
+			rbitset_set(reached, b);
+			ARR_APP1(ir_node*, worklist, env->blocks[b]);
+		}
+	}
+	while (ARR_LEN(worklist) > 0) {
+		ir_node *const block = worklist[ARR_LEN(worklist) - 1];
+		ARR_SHRINKLEN(worklist, ARR_LEN(worklist) - 1);
+		for (unsigned i = 0, n = get_Block_n_cfg_outs(block); i < n; ++i) {
+			ir_node  *const succ = get_Block_cfg_out(block, i);
+			unsigned  const nr   = get_block_nr(succ);
+			if (!rbitset_is_set(reached, nr)) {
+				rbitset_set(reached, nr);
+				ARR_APP1(ir_node*, worklist, succ);
+			}
+		}
+	}
+
+	/* backward from the accesses */
+	for (size_t b = 0; b < n_blocks; ++b) {
+		if (rbitset_is_set(env->accessed, b)) {
+			rbitset_set(live, b);
+			ARR_APP1(ir_node*, worklist, env->blocks[b]);
+		}
+	}
+	while (ARR_LEN(worklist) > 0) {
+		ir_node *const block = worklist[ARR_LEN(worklist) - 1];
+		ARR_SHRINKLEN(worklist, ARR_LEN(worklist) - 1);
+		for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			unsigned const nr = get_block_nr(pred);
+			if (!rbitset_is_set(live, nr)) {
+				rbitset_set(live, nr);
+				ARR_APP1(ir_node*, worklist, pred);
+			}
+		}
+	}
+	DEL_ARR_F(worklist);
+
+	rbitset_and(live, reached, n_blocks);
+}
+
+/** Collects the frame entities whose accesses are known. */
+static void collect_slot_users(color_env_t *const env, ir_graph *const irg)
+{
+	ir_type *const frame_tp = get_irg_frame_type(irg);
+	ir_node *const frame    = get_irg_frame(irg);
+	size_t   const n_blocks = ARR_LEN(env->blocks);
+
+	foreach_irn_out_r(frame, i, member) {
+		if (!is_Member(member))
+			continue;
+		ir_entity *const entity = get_Member_entity(member);
+		if (get_entity_owner(entity) != frame_tp
+		 || get_entity_link(entity) != NULL)
+			continue;
+		set_entity_link(entity, entity);
+
+		ir_type *const type = get_entity_type(entity);
+		if (is_parameter_entity(entity) || get_type_state(type) != layout_fixed
+		 || get_type_size(type) == 0)
+			continue;
+		slot_user_t const user = {
+			.entity   = entity,
+			.members  = NEW_ARR_F(ir_node*, 0),
+			.accesses = NEW_ARR_F(ir_node*, 0),
+			.live     = rbitset_malloc(n_blocks),
+		};
+		ARR_APP1(slot_user_t, env->users, user);
+	}
+
+	/* an entity with unknown accesses is live everywhere */
+	for (size_t u = 0; u < ARR_LEN(env->users); ++u) {
+		slot_user_t *const user = &env->users[u];
+		rbitset_clear_all(env->accessed, n_blocks);
+		bool known = true;
+		foreach_irn_out_r(frame, i, member) {
+			if (!is_Member(member) || get_Member_entity(member) != user->entity)
+				continue;
+			ARR_APP1(ir_node*, user->members, member);
+			if (!collect_accesses(member, &user->accesses, env->accessed))
+				known = false;
+		}
+		if (known)
+			compute_lifetime(env, user->live);
+		else
+			rbitset_set_all(user->live, n_blocks);
+	}
+}
+
+/** Compares slot users by decreasing size. */
+static int cmp_slot_user(void const *const a, void const *const b)
+{
+	slot_user_t const *const ua = (slot_user_t const*)a;
+	slot_user_t const *const ub = (slot_user_t const*)b;
+	unsigned const sa = get_type_size(get_entity_type(ua->entity));
+	unsigned const sb = get_type_size(get_entity_type(ub->entity));
+	return QSORT_CMP(sb, sa);
+}
+
+/** Replaces the entities with color @p color by fields of one union. */
+static void share_slot(color_env_t const *const env, ir_graph *const irg,
+                       unsigned const color)
+{
+	ir_type   *const frame_tp  = get_irg_frame_type(irg);
+	ir_type   *const slot_tp   = new_type_union(id_unique("slot"));
+	ir_entity *const slot      = new_entity(frame_tp, id_unique("slot"), slot_tp);
+	unsigned         alignment = 1;
+	for (size_t u = 0, n = ARR_LEN(env->users); u < n; ++u) {
+		slot_user_t const *const user = &env->users[u];
+		if (user->color != color)
+			continue;
+		ir_entity *const entity = user->entity;
+		ir_entity *const field  = new_entity(slot_tp, get_entity_ident(entity),
+		                                     get_entity_type(entity));
+		alignment = MAX(alignment, get_entity_alignment(entity));
+		DB((dbg, LEVEL_1, "%+F: %+F shares %+F\n", irg, entity, slot));
+		for (size_t m = 0, n_members = ARR_LEN(user->members); m < n_members; ++m) {
+			ir_node *const member = user->members[m];
+			ir_node *const block  = get_nodes_block(member);
+			ir_node *const base   = new_r_Member(block, get_irg_frame(irg), slot);
+			exchange(member, new_r_Member(block, base, field));
+		}
+		/* the lifetimes are only valid if the accesses stay in their blocks */
+		for (size_t a = 0, n_accesses = ARR_LEN(user->accesses); a < n_accesses; ++a)
+			set_irn_pinned(user->accesses[a], op_pin_state_pinned);
+		free_entity(entity);
+	}
+	default_layout_compound_type(slot_tp);
+	set_entity_alignment(slot, alignment);
+}
+
+void color_frame_entities(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.frame");
+
+	ir_type *const frame_tp = get_irg_frame_type(irg);
+	if (get_compound_n_members(frame_tp) < 2)
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irp_reserve_resources(irp, IRP_RESOURCE_ENTITY_LINK);
+
+	for (size_t i = get_compound_n_members(frame_tp); i-- > 0;)
+		set_entity_link(get_compound_member(frame_tp, i), NULL);
+
+	color_env_t env = {
+		.blocks = NEW_ARR_F(ir_node*, 0),
+		.users  = NEW_ARR_F(slot_user_t, 0),
+	};
+	irg_block_walk_graph(irg, number_block, NULL, &env.blocks);
+	size_t const n_blocks = ARR_LEN(env.blocks);
+	env.accessed = rbitset_malloc(n_blocks);
+	collect_slot_users(&env, irg);
+
+	/* greedy coloring, the largest entities first */
+	QSORT_ARR(env.users, cmp_slot_user);
+	size_t    const n_users  = ARR_LEN(env.users);
+	unsigned *const n_shared = XMALLOCNZ(unsigned, n_users);
+	unsigned        n_colors = 0;
+	for (size_t u = 0; u < n_users; ++u) {
+		slot_user_t *const user  = &env.users[u];
+		unsigned           color = 0;
+		for (; color < n_colors; ++color) {
+			bool interferes = false;
+			for (size_t o = 0; o < u && !interferes; ++o) {
+				slot_user_t const *const other = &env.users[o];
+				interferes = other->color == color
+				          && rbitsets_have_common(other->live, user->live, n_blocks);
+			}
+			if (!interferes)
+				break;
+		}
+		if (color == n_colors)
+			++n_colors;
+		user->color = color;
+		++n_shared[color];
+	}
+
+	bool changed = false;
+	for (unsigned c = 0; c < n_colors; ++c) {
+		if (n_shared[c] > 1) {
+			share_slot(&env, irg, c);
+			changed = true;
+		}
+	}
+	if (changed)
+		set_type_state(frame_tp, layout_undefined);
+
+	free(n_shared);
+	for (size_t u = 0; u < n_users; ++u) {
+		DEL_ARR_F(env.users[u].accesses);
+		DEL_ARR_F(env.users[u].members);
+		free(env.users[u].live);
+	}
+	DEL_ARR_F(env.users);
+	DEL_ARR_F(env.blocks);
+	free(env.accessed);
+	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_CONTROL_FLOW
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+}
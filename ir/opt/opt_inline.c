@@ -13,6 +13,7 @@
 #include "cgana.h"
 #include "debug.h"
 #include "entity_t.h"
+#include "execfreq.h"
 #include "irbackedge_t.h"
 #include "ircons_t.h"
 #include "iredges_t.h"
@@ -26,6 +27,7 @@
 #include "irmemory_t.h"
 #include "irnode_t.h"
 #include "irnodemap.h"
+#include "irnodeset.h"
 #include "iropt_dbg.h"
 #include "iropt_t.h"
 #include "iroptimize.h"
@@ -34,11 +36,14 @@
 #include "irtools.h"
 #include "list.h"
 #include "opt_init.h"
+#include "opt_inline_t.h"
 #include "pmap.h"
 #include "pqueue.h"
+#include "pset.h"
 #include "xmalloc.h"
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
@@ -623,13 +628,24 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 
 static struct obstack  temp_obst;
 
+/** Default code growth of the whole program by inlining in percent. */
+static unsigned growth_budget = 100;
+
+/** Estimated number of nodes of all graphs during inlining. */
+static unsigned long program_size;
+/** Maximum number of nodes of all graphs. */
+static unsigned long program_size_limit;
+
 /** Represents a possible inlinable call in a graph. */
 typedef struct call_entry {
 	ir_node    *call;       /**< The Call node. */
 	ir_graph   *callee;     /**< The callee IR-graph. */
 	list_head  list;        /**< List head for linking the next one. */
 	int        loop_depth;  /**< The loop depth of this call. */
+	double     freq;        /**< Execution frequency of the call relative to
+	                             its graph, 0 if unknown. */
 	int        benefice;    /**< The calculated benefice of this call. */
+	unsigned   growth;      /**< Estimated nodes added by inlining. */
 	bool       all_const:1; /**< Set if this call has only constant parameters. */
 } call_entry;
 
@@ -701,6 +717,19 @@ static bool is_nop(const ir_node *node)
 	}
 }
 
+/**
+ * Returns the execution frequency of @p call relative to the entry of its
+ * graph or 0 if no execution frequencies are known.
+ */
+static double get_call_freq(ir_node const *const call)
+{
+	ir_graph *const irg        = get_irn_irg(call);
+	double    const start_freq = get_block_execfreq(get_irg_start_block(irg));
+	if (start_freq <= 0.0)
+		return 0.0;
+	return get_block_execfreq(get_nodes_block(call)) / start_freq;
+}
+
 /**
  * post-walker: collect all calls in the inline-environment
  * of a graph and sum some statistics.
@@ -746,7 +775,9 @@ static void collect_calls2(ir_node *node, void *ctx)
 		entry->call       = node;
 		entry->callee     = callee;
 		entry->loop_depth = get_irn_loop(get_nodes_block(node))->depth;
+		entry->freq       = get_call_freq(node);
 		entry->benefice   = 0;
+		entry->growth     = 0;
 		entry->all_const  = false;
 
 		list_add_tail(&entry->list, &x->calls);
@@ -760,15 +791,19 @@ static void collect_calls2(ir_node *node, void *ctx)
  * @param new_call  the new call node
  * @param loop_depth_delta
  *                  delta value for the loop depth
+ * @param freq      execution frequency of the inlined call
  */
 static call_entry *duplicate_call_entry(const call_entry *entry,
-                                        ir_node *new_call, int loop_depth_delta)
+                                        ir_node *new_call, int loop_depth_delta,
+                                        double freq)
 {
 	call_entry *nentry = OALLOC(&temp_obst, call_entry);
 	nentry->call       = new_call;
 	nentry->callee     = entry->callee;
 	nentry->benefice   = entry->benefice;
+	nentry->growth     = entry->growth;
 	nentry->loop_depth = entry->loop_depth + loop_depth_delta;
+	nentry->freq       = entry->freq * freq;
 	nentry->all_const  = entry->all_const;
 
 	return nentry;
@@ -869,6 +904,73 @@ static unsigned get_method_local_adress_weight(ir_graph *callee, size_t pos)
 	return env->local_weights[pos];
 }
 
+/** Checks whether @p node is computed from constants only. */
+static bool has_known_operands(ir_node const *const node,
+                               ir_nodeset_t const *const known)
+{
+	foreach_irn_in(node, i, pred) {
+		if (!is_irn_constlike(pred)
+		 && !ir_nodeset_contains(known, pred))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Counts the nodes of @p callee which become constant if the constant
+ * arguments of @p call are propagated into it.  The outs of @p callee must
+ * be consistent.
+ */
+static unsigned count_folded_nodes(ir_node *const call, ir_graph *const callee)
+{
+	assert(irg_has_properties(callee, IR_GRAPH_PROPERTY_CONSISTENT_OUTS));
+	ir_nodeset_t known;
+	ir_nodeset_init(&known);
+	ir_node **worklist = NEW_ARR_F(ir_node*, 0);
+	size_t const n_params = get_Call_n_params(call);
+	foreach_irn_out_r(get_irg_args(callee), i, arg) {
+		unsigned const pn = get_Proj_num(arg);
+		if (pn < n_params && is_irn_constlike(get_Call_param(call, pn))) {
+			ir_nodeset_insert(&known, arg);
+			ARR_APP1(ir_node*, worklist, arg);
+		}
+	}
+
+	unsigned folded = 0;
+	for (size_t n; (n = ARR_LEN(worklist)) > 0;) {
+		ir_node *const node = worklist[n - 1];
+		ARR_SHRINKLEN(worklist, n - 1);
+		foreach_irn_out_r(node, i, succ) {
+			ir_mode *const mode = get_irn_mode(succ);
+			if (is_Phi(succ) || is_Proj(succ) || get_irn_pinned(succ)
+			 || mode == mode_M || mode == mode_T || mode == mode_X
+			 || ir_nodeset_contains(&known, succ)
+			 || !has_known_operands(succ, &known))
+				continue;
+			ir_nodeset_insert(&known, succ);
+			ARR_APP1(ir_node*, worklist, succ);
+			++folded;
+		}
+	}
+	DEL_ARR_F(worklist);
+	ir_nodeset_destroy(&known);
+	return folded;
+}
+
+/**
+ * Estimates the number of nodes added to the caller by inlining @p call,
+ * taking the constant arguments and the removed call into account.
+ */
+static unsigned estimate_growth(call_entry *entry, ir_graph *callee)
+{
+	inline_irg_env *callee_env = (inline_irg_env*)get_irg_link(callee);
+	ir_node        *call       = entry->call;
+	/* the Call, its memory and result Projs and the parameters vanish */
+	unsigned        removed    = get_Call_n_params(call) + 3
+	                           + count_folded_nodes(call, callee);
+	return callee_env->n_nodes > removed ? callee_env->n_nodes - removed : 0;
+}
+
 /**
  * Calculate a benefice value for inlining the given call.
  *
@@ -934,6 +1036,7 @@ static int calc_inline_benefice(call_entry *entry, ir_graph *callee)
 		}
 	}
 	entry->all_const = all_const;
+	entry->growth    = estimate_growth(entry, callee);
 
 	inline_irg_env *callee_env = (inline_irg_env*)get_irg_link(callee);
 	if (callee_env->n_callers == 1 &&
@@ -955,11 +1058,17 @@ static int calc_inline_benefice(call_entry *entry, ir_graph *callee)
 	if (callee_env->n_call_nodes == 0)
 		weight += 400;
 
-	/** it's important to inline inner loops first */
-	if (entry->loop_depth > 30)
+	/* it's important to inline hot calls first.  With execution frequencies
+	 * calls in cold paths get a penalty, otherwise inner loops are
+	 * preferred. */
+	if (entry->freq > 0.0) {
+		double const hotness = 1024.0 * log2(entry->freq);
+		weight += (int64_t)MAX(-8.0 * 1024, MIN(hotness, 30.0 * 1024));
+	} else if (entry->loop_depth > 30) {
 		weight += 30 * 1024;
-	else
+	} else {
 		weight += entry->loop_depth * 1024;
+	}
 
 	/*
 	 * All arguments constant is probably a good sign, give an extra bonus
@@ -1045,11 +1154,16 @@ static void maybe_push_call(pqueue_t *pqueue, call_entry *call,
 	DB((dbg, LEVEL_2, "In %+F Call %+F to %+F has benefice %d\n",
 	    get_irn_irg(call->call), call->call, callee, benefice));
 
-	if (!(callee_props & mtp_property_always_inline) && benefice < inline_threshold) {
+	if (callee_props & mtp_property_always_inline) {
+		pqueue_put(pqueue, call, INT_MAX);
 		return;
 	}
+	if (benefice < inline_threshold)
+		return;
 
-	pqueue_put(pqueue, call, benefice);
+	/* prefer the calls with the highest benefice per added node */
+	double const per_node = benefice * 16.0 / (call->growth + 1);
+	pqueue_put(pqueue, call, (int)MAX(MIN(per_node, INT_MAX - 1.0), INT_MIN));
 }
 
 /**
@@ -1101,6 +1215,12 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			    env->n_nodes, callee, callee_env->n_nodes));
 			continue;
 		}
+		if (!(props & mtp_property_always_inline)
+		    && program_size + curr_call->growth > program_size_limit) {
+			DB((dbg, LEVEL_2, "%+F: growth budget exhausted for %+F (%u)\n",
+			    irg, callee, curr_call->growth));
+			continue;
+		}
 
 		ir_graph *calleee = pmap_get(ir_graph, copied_graphs, callee);
 		if (calleee != NULL) {
@@ -1156,7 +1276,8 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			callee_env = alloc_inline_irg_env();
 			set_irg_link(copy, callee_env);
 
-			assure_irg_properties(copy, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+			assure_irg_properties(copy, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+			                          | IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
 			wenv_t wenv = { .x = callee_env, .ignore_callers = true };
 			irg_walk_graph(copy, NULL, collect_calls2, &wenv);
 
@@ -1196,7 +1317,8 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 		--env->n_call_nodes;
 
 		/* we just generate a bunch of new calls */
-		int loop_depth = curr_call->loop_depth;
+		int    loop_depth = curr_call->loop_depth;
+		double freq       = curr_call->freq;
 		list_for_each_entry(call_entry, centry, &callee_env->calls, list) {
 			inline_irg_env *penv = (inline_irg_env*)get_irg_link(centry->callee);
 
@@ -1218,7 +1340,7 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			assert(is_Call(new_call));
 
 			call_entry *new_entry
-				= duplicate_call_entry(centry, new_call, loop_depth);
+				= duplicate_call_entry(centry, new_call, loop_depth, freq);
 			list_add_tail(&new_entry->list, &env->calls);
 			maybe_push_call(pqueue, new_entry, inline_threshold);
 		}
@@ -1226,10 +1348,19 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 
 		env->n_call_nodes += callee_env->n_call_nodes;
 		env->n_nodes += callee_env->n_nodes;
+		program_size += curr_call->growth;
 		--callee_env->n_callers;
+		/* the last call of a local function is gone, it will be removed */
+		if (callee_env->n_callers == 0
+		    && !entity_is_externally_visible(get_irg_entity(callee)))
+			program_size -= MIN(program_size, callee_env->n_nodes);
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
 	del_pqueue(pqueue);
+
+	/* the graph may be inlined into its callers later */
+	if (env->got_inline)
+		assure_irg_outs(irg);
 }
 
 /*
@@ -1252,18 +1383,26 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 	for (size_t i = 0; i < n_irgs; ++i)
 		set_irg_link(irgs[i], alloc_inline_irg_env());
 
-	/* Precompute information in temporary data structure. */
+	/* Precompute information in temporary data structure.  Execution
+	 * frequencies are estimated, unless they are known from a profile. */
 	wenv_t wenv;
 	wenv.ignore_callers = false;
+	program_size = 0;
 	for (size_t i = 0; i < n_irgs; ++i) {
 		ir_graph *irg = irgs[i];
 
 		free_callee_info(irg);
+		if (get_block_execfreq(get_irg_start_block(irg)) <= 0.0)
+			ir_estimate_execfreq(irg);
 
 		wenv.x = (inline_irg_env*)get_irg_link(irg);
 		assure_loopinfo(irg);
+		/* the outs are needed to estimate the growth of calls to irg */
+		assure_irg_outs(irg);
 		irg_walk_graph(irg, NULL, collect_calls2, &wenv);
+		program_size += wenv.x->n_nodes;
 	}
+	program_size_limit = program_size + program_size * growth_budget / 100;
 
 	/* -- and now inline. -- */
 	for (size_t i = 0; i < n_irgs; ++i) {
@@ -1287,6 +1426,9 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 		}
 	}
 
+	DB((dbg, LEVEL_1, "Program size: %lu nodes, limit %lu\n", program_size,
+	    program_size_limit));
+
 	/* kill the copied graphs: we don't need them anymore */
 	foreach_pmap(copied_graphs, pm_entry) {
 		ir_graph *copy = (ir_graph*)pm_entry->value;
@@ -1303,6 +1445,408 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 	current_ir_graph = rem;
 }
 
+/** Maximum number of nodes of the entry and fast path of a split function. */
+#define MAX_ENTRY_SIZE 32
+
+/** Minimum part of the executions of a function taking the fast path. */
+#define MIN_FAST_PATH_FREQ 0.25
+
+/** The early exit at the entry of a function. */
+typedef struct entry_split_t {
+	ir_node  *cond;      /**< the Cond ending the entry */
+	ir_node  *fast_proj; /**< the control flow to the fast path */
+	ir_node  *cold_proj; /**< the control flow to the body */
+	ir_node **mems;      /**< the memory at the end of the entry: its last
+	                          Loads or the initial memory */
+} entry_split_t;
+
+/**
+ * Checks whether @p node may be executed again in front of the outlined
+ * body, i.e. it has no side effects.
+ */
+static bool is_repeatable(ir_node const *const node)
+{
+	if (is_Load(node))
+		return get_Load_volatility(node) != volatility_is_volatile;
+	if (is_Proj(node)) {
+		ir_node const *const pred = get_Proj_pred(node);
+		return is_Start(pred) || is_Load(pred) || is_Proj(pred)
+		    || is_Cond(pred);
+	}
+	if (is_Start(node) || is_Jmp(node) || is_Cond(node))
+		return true;
+	ir_mode *const mode = get_irn_mode(node);
+	return !get_irn_pinned(node) && mode != mode_M && mode != mode_T;
+}
+
+/**
+ * Finds the entry of @p irg: the blocks from the start block to the first
+ * Cond, which must be repeatable.  Returns the Cond or NULL, adds the
+ * number of entry nodes to @p size and the Loads not followed by other
+ * Loads, or the initial memory, to @p mems.  No nodes are created.
+ */
+static ir_node *find_entry_cond(ir_graph *const irg, unsigned *const size,
+                                ir_node ***const mems)
+{
+	ir_node *cond  = NULL;
+	ir_node *block = get_irg_start_block(irg);
+	ARR_APP1(ir_node*, *mems, get_irg_initial_mem(irg));
+	for (;;) {
+		ir_node *next = NULL;
+		foreach_irn_out_r(block, i, node) {
+			if (is_Block(node) || is_End(node) || is_irn_constlike(node))
+				continue;
+			if (!is_repeatable(node) || *size > MAX_ENTRY_SIZE)
+				return NULL;
+			if (!is_Proj(node))
+				++*size;
+			if (is_Load(node)) {
+				ir_node *const load_mem = get_Load_mem(node);
+				ir_node *const pred     = is_Proj(load_mem)
+				                        ? get_Proj_pred(load_mem) : NULL;
+				for (size_t m = 0, n = ARR_LEN(*mems); m < n; ++m) {
+					if ((*mems)[m] == load_mem || (*mems)[m] == pred)
+						(*mems)[m] = NULL;
+				}
+				ARR_APP1(ir_node*, *mems, node);
+			} else if (is_Jmp(node) || is_Cond(node)) {
+				if (next != NULL || cond != NULL)
+					return NULL;
+				if (is_Cond(node)) {
+					cond = node;
+				} else if (get_irn_n_outs(node) == 1) {
+					next = get_irn_out(node, 0);
+					if (get_Block_n_cfgpreds(next) != 1)
+						return NULL;
+				} else {
+					return NULL;
+				}
+			}
+		}
+		if (next == NULL)
+			break;
+		block = next;
+	}
+	return cond;
+}
+
+/**
+ * Builds the memory at the end of the entry of @p split, which is left by
+ * all its Loads.
+ */
+static ir_node *build_entry_mem(entry_split_t const *const split)
+{
+	size_t    const n_mems = ARR_LEN(split->mems);
+	ir_node **const in     = ALLOCAN(ir_node*, n_mems);
+	int             n_in   = 0;
+	for (size_t m = 0; m < n_mems; ++m) {
+		ir_node *const mem = split->mems[m];
+		if (mem != NULL)
+			in[n_in++] = is_Load(mem) ? new_r_Proj(mem, mode_M, pn_Load_M) : mem;
+	}
+	return n_in == 1 ? in[0]
+	     : new_r_Sync(get_nodes_block(split->cond), n_in, in);
+}
+
+/**
+ * Checks whether @p proj leads to a small block ending in a Return and adds
+ * its number of nodes to @p size.
+ */
+static bool is_fast_path(ir_node *const proj, unsigned *const size)
+{
+	if (get_irn_n_outs(proj) != 1)
+		return false;
+	ir_node *const block = get_irn_out(proj, 0);
+	if (!is_Block(block) || get_Block_n_cfgpreds(block) != 1)
+		return false;
+	bool returns = false;
+	foreach_irn_out_r(block, i, node) {
+		if (is_Block(node) || is_End(node))
+			continue;
+		if (is_Return(node))
+			returns = true;
+		else if (get_irn_mode(node) == mode_X)
+			return false;
+		if (!is_Proj(node))
+			++*size;
+	}
+	return returns;
+}
+
+/**
+ * Finds an early exit at the entry of @p irg, whose fast path is hot and
+ * small enough for inlining.
+ */
+static bool find_entry_split(ir_graph *const irg, entry_split_t *const split)
+{
+	ir_type *const mtp = get_entity_type(get_irg_entity(irg));
+	if (is_method_variadic(mtp))
+		return false;
+	for (size_t i = 0, n = get_method_n_params(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_param_type(mtp, i)) == NULL)
+			return false;
+	}
+	for (size_t i = 0, n = get_method_n_ress(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_res_type(mtp, i)) == NULL)
+			return false;
+	}
+
+	assure_irg_outs(irg);
+	unsigned       size = 0;
+	ir_node *const cond = find_entry_cond(irg, &size, &split->mems);
+	if (cond == NULL || get_irn_n_outs(cond) != 2)
+		return false;
+
+	ir_node *const start_block = get_irg_start_block(irg);
+	double   const start_freq  = get_block_execfreq(start_block);
+	double         best_freq   = 0.0;
+	split->cond = cond;
+	foreach_irn_out_r(cond, i, proj) {
+		unsigned fast_size = size;
+		if (!is_fast_path(proj, &fast_size) || fast_size > MAX_ENTRY_SIZE)
+			continue;
+		double const freq = get_block_execfreq(get_irn_out(proj, 0));
+		if (freq < MIN_FAST_PATH_FREQ * start_freq || freq <= best_freq)
+			continue;
+		best_freq        = freq;
+		split->fast_proj = proj;
+		split->cold_proj = get_irn_out(cond, get_irn_out(cond, 0) == proj);
+	}
+	return best_freq > 0.0;
+}
+
+/** Builds a Call of @p callee with the arguments of the graph of @p block. */
+static ir_node *new_forwarding_call(ir_node *const block, ir_node *const mem,
+                                    ir_entity *const callee)
+{
+	ir_graph *const irg      = get_irn_irg(block);
+	ir_type  *const mtp      = get_entity_type(callee);
+	size_t    const n_params = get_method_n_params(mtp);
+	ir_node **const in       = ALLOCAN(ir_node*, n_params);
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_param_type(mtp, i));
+		in[i] = new_r_Proj(get_irg_args(irg), mode, i);
+	}
+	ir_node *const addr = new_r_Address(irg, callee);
+	return new_r_Call(block, mem, addr, n_params, in, mtp);
+}
+
+/** Builds a Return of the results of @p call. */
+static ir_node *new_forwarding_return(ir_node *const call)
+{
+	ir_node  *const block  = get_nodes_block(call);
+	ir_type  *const mtp    = get_Call_type(call);
+	size_t    const n_ress = get_method_n_ress(mtp);
+	ir_node **const in     = ALLOCAN(ir_node*, n_ress);
+	ir_node  *const ress   = new_r_Proj(call, mode_T, pn_Call_T_result);
+	for (size_t i = 0; i < n_ress; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_res_type(mtp, i));
+		in[i] = new_r_Proj(ress, mode, i);
+	}
+	ir_node *const mem = new_r_Proj(call, mode_M, pn_Call_M);
+	return new_r_Return(block, mem, n_ress, in);
+}
+
+/** Adds the Return @p ret to the predecessors of the matured end block. */
+static void add_return(ir_node *const ret)
+{
+	ir_graph *const irg       = get_irn_irg(ret);
+	ir_node  *const end_block = get_irg_end_block(irg);
+	int       const n_preds   = get_Block_n_cfgpreds(end_block);
+	ir_node **const preds     = ALLOCAN(ir_node*, n_preds + 1);
+	for (int i = 0; i < n_preds; ++i)
+		preds[i] = get_Block_cfgpred(end_block, i);
+	preds[n_preds] = ret;
+	set_irn_in(end_block, n_preds + 1, preds);
+}
+
+ir_graph *copy_irg(ir_entity *const clone, ir_graph *const irg)
+{
+	ir_entity *const ent  = get_irg_entity(irg);
+	ir_graph  *const copy = new_ir_graph(clone, 0);
+	ir_node   *const call = new_forwarding_call(get_irg_start_block(copy),
+	                                            get_irg_initial_mem(copy), ent);
+	add_immBlock_pred(get_irg_end_block(copy), new_forwarding_return(call));
+	irg_finalize_cons(copy);
+
+	ir_graph *const rem = current_ir_graph;
+	current_ir_graph = copy;
+	ir_reserve_resources(copy, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
+	collect_phiprojs_and_start_block_nodes(copy);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	bool const inlined = inline_method(call, irg);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_free_resources(copy, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
+	current_ir_graph = rem;
+	if (!inlined) {
+		free_ir_graph(copy);
+		return NULL;
+	}
+	return copy;
+}
+
+/**
+ * Copies the body of @p irg behind the entry split into a new local function.
+ * Returns its entity or NULL if the body cannot be copied.
+ */
+static ir_entity *outline_body(ir_graph *const irg,
+                               entry_split_t const *const split)
+{
+	ir_entity *const ent   = get_irg_entity(irg);
+	ident     *const id    = id_unique(get_entity_name(ent));
+	ir_entity *const clone = clone_entity(ent, id, get_entity_owner(ent));
+	set_entity_visibility(clone, ir_visibility_local);
+	set_entity_linkage(clone, IR_LINKAGE_DEFAULT);
+
+	ir_graph *const body = copy_irg(clone, irg);
+	if (body == NULL) {
+		free_entity(clone);
+		return NULL;
+	}
+
+	/* the copied entry always continues with the body */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_node *const fast_proj = get_new_node(split->fast_proj);
+	ir_node *const cold_proj = get_new_node(split->cold_proj);
+	ir_node *const cond      = get_new_node(split->cond);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	exchange(fast_proj, new_r_Bad(body, mode_X));
+	exchange(cold_proj, new_r_Jmp(get_nodes_block(cond)));
+
+	remove_tuples(body);
+	remove_unreachable_code(body);
+	remove_bads(body);
+	return clone;
+}
+
+/**
+ * Splits @p irg into its entry with the fast path and a call to a copy of the
+ * rest of the function.
+ */
+static bool split_entry(ir_graph *const irg)
+{
+	if (get_block_execfreq(get_irg_start_block(irg)) <= 0.0)
+		ir_estimate_execfreq(irg);
+	entry_split_t split = { .mems = NEW_ARR_F(ir_node*, 0) };
+	ir_entity    *clone = NULL;
+	if (find_entry_split(irg, &split))
+		clone = outline_body(irg, &split);
+	if (clone == NULL) {
+		DEL_ARR_F(split.mems);
+		return false;
+	}
+	DB((dbg, LEVEL_1, "outlined body of %+F into %+F\n", irg, clone));
+
+	/* continue with a call of the outlined body instead of the body */
+	ir_node *const cold_proj  = split.cold_proj;
+	ir_node *const cold_block = get_irn_out(cold_proj, 0);
+	for (int i = 0, n = get_Block_n_cfgpreds(cold_block); i < n; ++i) {
+		if (get_Block_cfgpred(cold_block, i) == cold_proj)
+			set_Block_cfgpred(cold_block, i, new_r_Bad(irg, mode_X));
+	}
+	ir_node *const block = new_r_Block(irg, 1, &cold_proj);
+	ir_node *const mem   = build_entry_mem(&split);
+	ir_node *const call  = new_forwarding_call(block, mem, clone);
+	add_return(new_forwarding_return(call));
+	DEL_ARR_F(split.mems);
+
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+	remove_unreachable_code(irg);
+	remove_bads(irg);
+	return true;
+}
+
+/** Counts the nodes of a graph. */
+static void count_nodes(ir_node *const node, void *const env)
+{
+	(void)node;
+	++*(unsigned*)env;
+}
+
+typedef struct split_calls_env {
+	pset     *split; /**< entities of the split functions */
+	ir_node **calls; /**< calls of split functions */
+} split_calls_env;
+
+/** Collects the calls of split functions. */
+static void collect_split_calls(ir_node *const node, void *const ctx)
+{
+	if (!is_Call(node))
+		return;
+	split_calls_env *const env    = (split_calls_env*)ctx;
+	ir_entity       *const callee = get_Call_callee(node);
+	if (callee != NULL && pset_find_ptr(env->split, callee)
+	 && get_irn_irg(node) != get_entity_irg(callee))
+		ARR_APP1(ir_node*, env->calls, node);
+}
+
+/** Marks the direct callees with a graph. */
+static void collect_callees(ir_node *const node, void *const env)
+{
+	if (!is_Call(node))
+		return;
+	ir_entity *const callee = get_Call_callee(node);
+	if (callee != NULL && get_entity_irg(callee) != NULL
+	 && get_entity_irg(callee) != get_irn_irg(node))
+		pset_insert_ptr((pset*)env, callee);
+}
+
+void partial_inline_functions(unsigned maxsize)
+{
+	ir_graph *rem = current_ir_graph;
+
+	/* split the called functions too big for inlining */
+	pset *callees = pset_new_ptr_default();
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, NULL, collect_callees, callees);
+	}
+	pset *split = pset_new_ptr_default();
+	size_t const n_irgs = get_irp_n_irgs();
+	for (size_t i = 0; i < n_irgs; ++i) {
+		ir_graph  *const irg = get_irp_irg(i);
+		ir_entity *const ent = get_irg_entity(irg);
+		mtp_additional_properties const props
+			= get_entity_additional_properties(ent);
+		if (!pset_find_ptr(callees, ent)
+		 || (props & (mtp_property_noinline | mtp_property_always_inline)))
+			continue;
+		unsigned n_nodes = 0;
+		irg_walk_graph(irg, NULL, count_nodes, &n_nodes);
+		if (n_nodes > maxsize && split_entry(irg))
+			pset_insert_ptr(split, ent);
+	}
+	del_pset(callees);
+
+	/* inline the entries of the split functions */
+	split_calls_env env = { .split = split, .calls = NEW_ARR_F(ir_node*, 0) };
+	foreach_irp_irg(i, irg) {
+		ARR_SHRINKLEN(env.calls, 0);
+		irg_walk_graph(irg, NULL, collect_split_calls, &env);
+		bool changed = false;
+		for (size_t c = 0, n = ARR_LEN(env.calls); c < n; ++c) {
+			ir_node  *const call   = env.calls[c];
+			ir_graph *const callee = get_entity_irg(get_Call_callee(call));
+			ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
+			collect_phiprojs_and_start_block_nodes(irg);
+			ir_reserve_resources(callee, IR_RESOURCE_IRN_LINK);
+			if (inline_method(call, callee))
+				changed = true;
+			ir_free_resources(callee, IR_RESOURCE_IRN_LINK);
+			ir_free_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
+		}
+		if (changed)
+			remove_tuples(irg);
+	}
+	DEL_ARR_F(env.calls);
+	del_pset(split);
+	current_ir_graph = rem;
+}
+
+void set_inline_growth_budget(unsigned percent)
+{
+	growth_budget = percent;
+}
+
 void firm_init_inline(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.opt.inline");
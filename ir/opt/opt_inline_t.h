@@ -0,0 +1,23 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Graph copying with the inliner.
+ */
+#ifndef FIRM_OPT_INLINE_T_H
+#define FIRM_OPT_INLINE_T_H
+
+#include "firm_types.h"
+
+/**
+ * Creates the graph of the method entity @p clone as a copy of @p irg.  The
+ * copy is built by inlining @p irg into an empty graph, so it may contain
+ * Tuples.  Afterwards the links of the nodes of @p irg point to their copies.
+ * Returns NULL if @p irg cannot be inlined.
+ */
+ir_graph *copy_irg(ir_entity *clone, ir_graph *irg);
+
+#endif
@@ -936,6 +936,35 @@ static void kill_memops(const value_t *value)
 	}
 }
 
+/**
+ * Kill memops that might be modified by a Call from the current set.
+ * Stores are killed as well if the Call might read their address, so
+ * they are not removed as dead by a later Store to the same address.
+ *
+ * @param call  the Call
+ */
+static void kill_call_memops(const ir_node *call)
+{
+	size_t end = env.rbs_size - 1;
+	size_t pos;
+
+	for (pos = rbitset_next(env.curr_set, 0, 1); pos < end; pos = rbitset_next(env.curr_set, pos + 1, 1)) {
+		memop_t *op = env.curr_id_2_memop[pos];
+
+		ir_type *op_type = get_type_for_mode(op->value.mode);
+		unsigned op_size = get_type_size(op_type);
+
+		ir_modref modref   = get_call_modref(call, op->value.address, op_type, op_size);
+		ir_modref kill_for = is_Store(op->node) ? ir_modref_modref : ir_modref_mod;
+
+		if (modref & kill_for) {
+			rbitset_clear(env.curr_set, pos);
+			env.curr_id_2_memop[pos] = NULL;
+			DB((dbg, LEVEL_2, "KILLING %+F because of %+F\n", op->node, call));
+		}
+	}
+}
+
 /**
  * Add the value of a memop to the current set.
  *
@@ -1100,6 +1129,10 @@ static void calc_gen_kill_avail(block_t *bl)
 				add_memop(op);
 			}
 			break;
+		case iro_Call:
+			if (op->flags & FLAG_KILL_ALL)
+				kill_call_memops(op->node);
+			break;
 		default:
 			if (op->flags & FLAG_KILL_ALL)
 				kill_all();
@@ -1231,6 +1264,10 @@ static int backward_antic(block_t *bl)
 				kill_memops(&op->value);
 			}
 			break;
+		case iro_Call:
+			if (op->flags & FLAG_KILL_ALL)
+				kill_call_memops(op->node);
+			break;
 		default:
 			if (op->flags & FLAG_KILL_ALL)
 				kill_all();
@@ -1784,7 +1821,7 @@ void opt_ldst(ir_graph *irg)
 	env.id_2_address  = NEW_ARR_F(ir_node *, 0);
 #endif
 
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK | IR_RESOURCE_PHI_LIST);
 
 	/* first step: allocate block entries. Note that some blocks might be
 	   unreachable here. Using the normal walk ensures that ALL blocks are initialized. */
@@ -1876,7 +1913,7 @@ no_changes:
 		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_ALL);
 	}
 
-	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK | IR_RESOURCE_PHI_LIST);
 	ir_nodehashmap_destroy(&env.adr_map);
 	obstack_free(&env.obst, NULL);
 
@@ -7,6 +7,14 @@
  * @file
  * @brief   Scalar replacement of compounds.
  * @author  Beyhan Veliev, Michael Beck
+ *
+ * Every scalar part of a frame entity, described by its access path of
+ * members and constant array indices, becomes an SSA value.  Arrays selected
+ * with a variable index and parts accessed otherwise than as a scalar stay
+ * in memory, while the other parts are replaced.  If the address of any
+ * part escapes, pointer arithmetic over the enclosing arrays and
+ * container_of-style accesses of the enclosing members may reach every
+ * part, so the whole entity stays in memory.
  */
 #include "scalar_replace.h"
 
@@ -140,7 +148,7 @@ static ir_type *get_addr_type(const ir_node *addr)
 		return get_entity_type(entity);
 	} else {
 		assert(is_Sel(addr));
-		return get_Sel_type(addr);
+		return get_array_element_type(get_Sel_type(addr));
 	}
 }
 
@@ -208,79 +216,183 @@ bool is_address_taken(ir_node *node)
 	return false;
 }
 
-/* we need a special address that serves as an address taken marker */
-static char _x;
-static void *ADDRESS_TAKEN = &_x;
-
-typedef enum leaf_state_t {
-	POSSIBLE_LEAF        = 0,
-	HAS_CHILD_LOAD_STORE = (1u << 0),
-	HAS_CHILD_SELS       = (1u << 1),
-} leaf_state_t;
-
 /**
- * Link all leaf Members with the entity.
+ * Return a path from the Sel node "sel" to its root.
  *
- * @param ent  the entity that will be scalar replaced
- * @param sel  a Sel node that selects some fields of this entity
+ * @param sel  the Sel node
+ * @param len  the length of the path so far
  */
-static leaf_state_t link_all_leaf_members(ir_entity *ent, ir_node *sel)
+static path_t *find_path(ir_node *node, size_t len)
 {
-	/** A leaf Sel is a Sel that is used directly by a Load or Store. */
-	leaf_state_t state = POSSIBLE_LEAF;
-	foreach_irn_out_r(sel, i, succ) {
-		if (is_Load(succ) || is_Store(succ)) {
-			state |= HAS_CHILD_LOAD_STORE;
-			continue;
-		}
-		if (is_Member(succ)) {
-			link_all_leaf_members(ent, succ);
-			state |= HAS_CHILD_SELS;
-		} else if (is_Id(succ)) {
-			state |= link_all_leaf_members(ent, succ);
-		} else {
-			assert(is_End(succ));
-		}
+	/* the current Sel/Member node will add some path elements */
+	path_t *res;
+	if (is_Sel(node)) {
+		ir_node *index = get_Sel_index(node);
+		if (!is_Const(index) || !tarval_is_long(get_Const_tarval(index)))
+			goto found_root;
+		ir_node *pred = get_Sel_ptr(node);
+		res = find_path(pred, len+1);
+		size_t pos   = res->path_len - len - 1;
+		/* indices of different modes select the same element */
+		long const n = get_tarval_long(get_Const_tarval(index));
+		res->path[pos].tv = new_tarval_from_long(n, mode_Ls);
+	} else if (is_Member(node)) {
+		ir_node *pred = get_Member_ptr(node);
+		res = find_path(pred, len+1);
+		size_t pos = res->path_len - len - 1;
+		res->path[pos].ent = get_Member_entity(node);
+	} else {
+		/* we found the root */
+found_root:
+		res = XMALLOCF(path_t, path, len);
+		res->path_len = len;
 	}
-	if (state & HAS_CHILD_SELS) {
-		/* Sel is not a leaf, if it has load/stores bail out */
-		if (state & HAS_CHILD_LOAD_STORE) {
-			set_entity_link(ent, ADDRESS_TAKEN);
-		}
-		return state;
+	return res;
+}
+
+/**
+ * Checks whether the Load or Store @p access of the address @p addr accesses
+ * a scalar which may be replaced by a value.
+ */
+static bool is_scalar_access(ir_node const *const addr,
+                             ir_node const *const access)
+{
+	ir_mode *const emode = get_type_mode(get_addr_type(addr));
+	if (emode == NULL)
+		return false;
+	if (is_Load(access)) {
+		return get_Load_volatility(access) != volatility_is_volatile
+		    && conv_is_bitcast(emode, get_Load_mode(access));
 	}
+	ir_node const *const value = get_Store_value(access);
+	return value != addr
+	    && get_Store_volatility(access) != volatility_is_volatile
+	    && conv_is_bitcast(get_irn_mode(value), emode);
+}
 
-	/* if we are here, then we have found a leaf Sel */
+/** Checks whether the Sel @p sel selects an element with a constant index
+ * within the bounds of the array. */
+static bool is_constant_index(ir_node const *const sel)
+{
+	ir_node const *const index = get_Sel_index(sel);
+	if (!is_Const(index) || !tarval_is_long(get_Const_tarval(index)))
+		return false;
+	long     const n    = get_Const_long(index);
+	unsigned const size = get_array_size(get_Sel_type(sel));
+	return n >= 0 && (unsigned long)n < size;
+}
 
-	/* beware of Id's */
-	sel = skip_Id(sel);
+/**
+ * Checks whether the Load or Store @p access of the address @p addr stays
+ * within the part of the entity @p addr points to.
+ */
+static bool is_access_within(ir_node const *const addr,
+                             ir_node const *const access)
+{
+	if (is_Store(access) && get_Store_value(access) == addr)
+		return false;
+	ir_mode *const mode = is_Load(access) ? get_Load_mode(access)
+	                                      : get_irn_mode(get_Store_value(access));
+	return get_mode_size_bytes(mode) <= get_type_size(get_addr_type(addr));
+}
 
-	void *link = get_entity_link(ent);
-	if (link == ADDRESS_TAKEN)
-		return HAS_CHILD_LOAD_STORE | HAS_CHILD_SELS;
+/** Returns the access path of the whole entity @p ent. */
+static path_t *new_entity_path(ir_entity *const ent)
+{
+	path_t *const path = XMALLOCF(path_t, path, 1);
+	path->path_len    = 1;
+	path->path[0].ent = ent;
+	return path;
+}
 
-	/* we know we are at a leaf, because this function is only called if
-	 * the address is NOT taken, so sel's successor(s) must be Loads or
-	 * Stores */
-	set_irn_link(sel, link);
-	set_entity_link(ent, sel);
-	return state;
+/**
+ * Links the leaf addresses below @p node, i.e. the addresses of scalars used
+ * by Loads and Stores, with the entity @p ent.  The access paths of parts of
+ * the entity which stay in memory are added to @p escaped.  If the address
+ * of a part escapes, this is the path of the whole entity.
+ */
+static void link_leaf_addresses(ir_entity *const ent, ir_node *const node,
+                                path_t ***const escaped)
+{
+	bool in_memory    = false;
+	bool escapes      = false;
+	bool has_access   = false;
+	bool has_children = false;
+	foreach_irn_out_r(node, i, succ) {
+		switch (get_irn_opcode(succ)) {
+		case iro_Load:
+		case iro_Store:
+			if (is_scalar_access(node, succ))
+				has_access = true;
+			else if (is_access_within(node, succ))
+				in_memory = true;
+			else
+				escapes = true;
+			break;
+
+		case iro_Member:
+			/* we can't handle unions correctly yet -> address taken */
+			if (is_Union_type(get_entity_owner(get_Member_entity(succ)))) {
+				if (is_address_taken(succ))
+					escapes = true;
+				else
+					in_memory = true;
+			} else {
+				link_leaf_addresses(ent, succ, escaped);
+				has_children = true;
+			}
+			break;
+
+		case iro_Sel:
+			/* any element may be accessed with a variable index */
+			if (is_constant_index(succ)) {
+				link_leaf_addresses(ent, succ, escaped);
+				has_children = true;
+			} else if (is_address_taken(succ)) {
+				escapes = true;
+			} else {
+				in_memory = true;
+			}
+			break;
+
+		case iro_End:
+			break;
+
+		default:
+			/* another op, the address is taken */
+			escapes = true;
+			break;
+		}
+	}
+
+	if (escapes) {
+		ARR_APP1(path_t*, *escaped, new_entity_path(ent));
+	} else if (in_memory || (has_access && has_children)) {
+		/* a scalar has no parts */
+		path_t *const path = find_path(node, 0);
+		ARR_APP1(path_t*, *escaped, path);
+	}
+	if (has_access) {
+		set_irn_link(node, get_entity_link(ent));
+		set_entity_link(ent, node);
+	}
 }
 
 /**
  * Find possible scalar replacements.
  *
- * @param irg  an IR graph
+ * @param irg      an IR graph
+ * @param escaped  receives the access paths of escaping entity parts
  *
  * This function finds variables on the (members of the) frame type
- * that can be scalar replaced, because their address is never taken.
- * If such a variable is found, its entity link will hold a list of all
- * Sel nodes, that selects the atomic fields of this entity.
- * Otherwise, the link will be ADDRESS_TAKEN or NULL.
+ * that can be scalar replaced, at least partially.  If such a variable is
+ * found, its entity link will hold a list of all Member and Sel nodes that
+ * select its scalar fields, including those within escaping parts.
+ * Otherwise, the link will be NULL.
  *
  * @return  true if at least one entity could be replaced potentially
  */
-static bool find_possible_replacements(ir_graph *irg)
+static bool find_possible_replacements(ir_graph *irg, path_t ***escaped)
 {
 	/* First, clear the link field of all interesting entities. */
 	ir_type *frame_tp = get_irg_frame_type(irg);
@@ -289,10 +401,7 @@ static bool find_possible_replacements(ir_graph *irg)
 		set_entity_link(ent, NULL);
 	}
 
-	/* Check the ir_graph for Member nodes. If the entity of Member isn't a
-	 * scalar replacement set the link of this entity to ADDRESS_TAKEN. */
 	ir_node *irg_frame = get_irg_frame(irg);
-	int      res       = 0;
 	foreach_irn_out_r(irg_frame, i, succ) {
 		if (!is_Member(succ))
 			continue;
@@ -302,76 +411,61 @@ static bool find_possible_replacements(ir_graph *irg)
 		ir_entity *ent = get_Member_entity(succ);
 		if (get_entity_owner(ent) != frame_tp)
 			continue;
-		if (get_entity_link(ent) == ADDRESS_TAKEN)
-			continue;
 
 		/* we can handle arrays, structs and atomic types yet */
 		ir_type *ent_type = get_entity_type(ent);
-		if (is_aggregate_type(ent_type) || is_atomic_type(ent_type)) {
-			if (is_address_taken(succ)) {
-				 /* killing one */
-				if (get_entity_link(ent))
-					--res;
-				set_entity_link(ent, ADDRESS_TAKEN);
-			} else {
-				/* possible found one */
-				if (get_entity_link(ent) == NULL)
-					++res;
-				link_all_leaf_members(ent, succ);
-			}
-		}
+		if (is_aggregate_type(ent_type) || is_atomic_type(ent_type))
+			link_leaf_addresses(ent, succ, escaped);
 	}
 
-	return res != 0;
+	for (size_t i = get_compound_n_members(frame_tp); i-- > 0;) {
+		if (get_entity_link(get_compound_member(frame_tp, i)) != NULL)
+			return true;
+	}
+	return false;
 }
 
-/**
- * Return a path from the Sel node "sel" to its root.
- *
- * @param sel  the Sel node
- * @param len  the length of the path so far
- */
-static path_t *find_path(ir_node *node, size_t len)
+/** Checks whether one of the paths @p a and @p b is a prefix of the other. */
+static bool paths_overlap(path_t const *const a, path_t const *const b)
 {
-	/* the current Sel/Member node will add some path elements */
-	path_t *res;
-	if (is_Sel(node)) {
-		ir_node *index = get_Sel_index(node);
-		if (!is_Const(index))
-			goto found_root;
-		ir_node *pred = get_Sel_ptr(node);
-		res = find_path(pred, len+1);
-		size_t pos   = res->path_len - len - 1;
-		res->path[pos].tv = get_Const_tarval(index);
-	} else if (is_Member(node)) {
-		ir_node *pred = get_Member_ptr(node);
-		res = find_path(pred, len+1);
-		size_t pos = res->path_len - len - 1;
-		res->path[pos].ent = get_Member_entity(node);
-	} else {
-		/* we found the root */
-found_root:
-		res = XMALLOCF(path_t, path, len);
-		res->path_len = len;
+	size_t const len = MIN(a->path_len, b->path_len);
+	return memcmp(a->path, b->path, len * sizeof(a->path[0])) == 0;
+}
+
+/** Checks whether @p path lies in an escaping part of its entity. */
+static bool is_escaping(path_t const *const path, path_t *const *const escaped)
+{
+	for (size_t i = 0, n = ARR_LEN(escaped); i < n; ++i) {
+		if (paths_overlap(path, escaped[i]))
+			return true;
 	}
-	return res;
+	return false;
 }
 
 /**
- * Allocate value numbers for the leafs in our found entities.
+ * Allocate value numbers for the leafs in our found entities.  Leafs in
+ * escaping parts of the entity keep their memory accesses.
  *
- * @param sels  a set that will contain all Sels that have a value number
- * @param ent   the entity that will be scalar replaced
- * @param vnum  the first value number we can assign
- * @param modes a flexible array, containing all the modes of
- *              the value numbers.
+ * @param sels     a set that will contain all Sels that have a value number
+ * @param ent      the entity that will be scalar replaced
+ * @param vnum     the first value number we can assign
+ * @param modes    a flexible array, containing all the modes of
+ *                 the value numbers.
+ * @param escaped  the access paths of escaping entity parts
+ * @param complete set to false if some leafs keep their memory accesses
  *
  * @return the next free value number
  */
 static unsigned allocate_value_numbers(pset *members, ir_entity *ent,
-                                       unsigned vnum, ir_mode ***modes)
+                                       unsigned vnum, ir_mode ***modes,
+                                       path_t *const *escaped, bool *complete)
 {
 	set *pathes = new_set(path_cmp, 8);
+	*complete = true;
+	for (size_t i = 0, n = ARR_LEN(escaped); i < n; ++i) {
+		if (escaped[i]->path[0].ent == ent)
+			*complete = false;
+	}
 
 	DB((dbg, SET_LEVEL_3, "  Visiting Sel nodes of entity %+F\n", ent));
 	/* visit all Member nodes in the chain of the entity */
@@ -379,10 +473,17 @@ static unsigned allocate_value_numbers(pset *members, ir_entity *ent,
 	     member != NULL; member = next) {
 		next = (ir_node*)get_irn_link(member);
 
+		path_t *key  = find_path(member, 0);
+		if (is_escaping(key, escaped)) {
+			DB((dbg, SET_LEVEL_3, "  %+F escapes\n", member));
+			*complete = false;
+			free(key);
+			continue;
+		}
+
 		/* we must mark this member for later */
 		pset_insert_ptr(members, member);
 
-		path_t *key  = find_path(member, 0);
 		path_t *path = set_find(path_t, pathes, key, path_size(key), path_hash(key));
 
 		if (path != NULL) {
@@ -400,8 +501,7 @@ static unsigned allocate_value_numbers(pset *members, ir_entity *ent,
 
 			ARR_EXTO(ir_mode *, *modes, (key->vnum + 15) & ~15);
 
-			ir_entity *entity = get_Member_entity(member);
-			(*modes)[key->vnum] = get_type_mode(get_entity_type(entity));
+			(*modes)[key->vnum] = get_type_mode(get_addr_type(member));
 
 			assert((*modes)[key->vnum] && "Value is not atomic");
 
@@ -444,8 +544,6 @@ static void walker(ir_node *node, void *ctx)
 	if (is_Load(node)) {
 		/* a load, check if we can resolve it */
 		ir_node *addr = get_Load_ptr(node);
-		if (!is_Member(addr))
-			return;
 		if (!pset_find_ptr(env->members, addr))
 			return;
 
@@ -490,8 +588,6 @@ static void walker(ir_node *node, void *ctx)
 	} else if (is_Store(node)) {
 		/* a Store always can be replaced */
 		ir_node *addr = get_Store_ptr(node);
-		if (!is_Member(addr))
-			return;
 		if (!pset_find_ptr(env->members, addr))
 			return;
 
@@ -571,8 +667,9 @@ void scalar_replacement_opt(ir_graph *irg)
 	irp_reserve_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 
 	/* Find possible scalar replacements */
-	bool changed = false;
-	if (find_possible_replacements(irg)) {
+	bool     changed = false;
+	path_t **escaped = NEW_ARR_F(path_t*, 0);
+	if (find_possible_replacements(irg, &escaped)) {
 		DB((dbg, SET_LEVEL_1, "Scalar Replacement: %+F\n", irg));
 
 		/* Insert in set the scalar replacements. */
@@ -593,14 +690,9 @@ void scalar_replacement_opt(ir_graph *irg)
 			if (get_entity_owner(ent) != frame_tp || is_parameter_entity(ent))
 				continue;
 
-			if (get_entity_link(ent) == NULL
-				|| get_entity_link(ent) == ADDRESS_TAKEN)
+			if (get_entity_link(ent) == NULL)
 				continue;
 
-			scalars_t key;
-			key.ent = ent;
-			(void)set_insert(scalars_t, set_ent, &key, sizeof(key), hash_ptr(key.ent));
-
 #ifdef DEBUG_libfirm
 			ir_type *ent_type = get_entity_type(ent);
 
@@ -615,7 +707,16 @@ void scalar_replacement_opt(ir_graph *irg)
 			}
 #endif
 
-			nvals = allocate_value_numbers(sels, ent, nvals, &modes);
+			bool complete;
+			nvals = allocate_value_numbers(sels, ent, nvals, &modes, escaped,
+			                               &complete);
+
+			/* the entity stays if some of its parts are accessed in memory */
+			if (complete) {
+				scalars_t key;
+				key.ent = ent;
+				(void)set_insert(scalars_t, set_ent, &key, sizeof(key), hash_ptr(key.ent));
+			}
 		}
 
 		DB((dbg, SET_LEVEL_1, "  %u values will be needed\n", nvals));
@@ -634,6 +735,9 @@ void scalar_replacement_opt(ir_graph *irg)
 		del_set(set_ent);
 		DEL_ARR_F(modes);
 	}
+	for (size_t i = 0, n = ARR_LEN(escaped); i < n; ++i)
+		free(escaped[i]);
+	DEL_ARR_F(escaped);
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
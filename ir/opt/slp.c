@@ -0,0 +1,518 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Superword level parallelism vectorizer.
+ *
+ * Stores to adjacent memory locations in a chain of Stores within a block
+ * are seeds: If as many of them as fit into a vector register write
+ * consecutive elements, their values are packed bottom-up.  Isomorphic
+ * operations of the lanes become one operation on vector mode, adjacent
+ * Loads become a vector Load.  Finally the scalar Stores are replaced by a
+ * single vector Store, the scalar operations die if they have no other
+ * users.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmemory.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "obst.h"
+#include "target_t.h"
+#include "type_t.h"
+#include "util.h"
+#include <string.h>
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Maximum number of memory nodes skipped when moving a Load. */
+#define MAX_MEM_WALK 64
+
+/** Maximum number of Stores in a chain considered together. */
+#define MAX_CHAIN_LENGTH 256
+
+/** A packed group of lanes and the vector node computing it. */
+typedef struct pack_t {
+	ir_node **lanes;
+	ir_node  *vector;
+} pack_t;
+
+typedef struct slp_env_t {
+	struct obstack obst;
+	ir_node      **stores;   /**< candidate Stores of the graph */
+	unsigned       n_lanes;  /**< lanes of the window being packed */
+	ir_node       *block;    /**< block of the window being packed */
+	ir_node       *mem;      /**< memory the vector Loads read */
+	ir_mode       *mode;     /**< vector mode of the window */
+	pack_t        *packs;    /**< packs created for the window */
+	ir_node      **loads;    /**< vector Loads created for the window */
+	bool           changed;
+} slp_env_t;
+
+/** Splits an address into a base address and a constant offset. */
+static ir_node *get_base_and_offset(ir_node *ptr, long *offset)
+{
+	long res = 0;
+	for (;;) {
+		if (is_Add(ptr) && is_Const(get_Add_right(ptr))
+		 && mode_is_reference(get_irn_mode(get_Add_left(ptr)))) {
+			res += get_Const_long(get_Add_right(ptr));
+			ptr  = get_Add_left(ptr);
+		} else if (is_Sub(ptr) && is_Const(get_Sub_right(ptr))
+		        && mode_is_reference(get_irn_mode(get_Sub_left(ptr)))) {
+			res -= get_Const_long(get_Sub_right(ptr));
+			ptr  = get_Sub_left(ptr);
+		} else if (is_Member(ptr)) {
+			ir_entity *entity = get_Member_entity(ptr);
+			if (get_type_state(get_entity_owner(entity)) != layout_fixed)
+				break;
+			res += get_entity_offset(entity);
+			ptr  = get_Member_ptr(ptr);
+		} else {
+			break;
+		}
+	}
+	*offset = res;
+	return ptr;
+}
+
+static bool is_candidate_store(ir_node const *const node)
+{
+	return is_Store(node)
+	    && get_Store_volatility(node) == volatility_non_volatile
+	    && !ir_throws_exception(node)
+	    && ir_target_is_vector_element_mode(get_irn_mode(get_Store_value(node)));
+}
+
+static void collect_stores(ir_node *node, void *data)
+{
+	slp_env_t *env = (slp_env_t*)data;
+	if (is_candidate_store(node))
+		ARR_APP1(ir_node*, env->stores, node);
+}
+
+/**
+ * Returns the next Store in the chain of @p store: the only Store using its
+ * memory, which must otherwise only be read by Loads.
+ */
+static ir_node *get_next_store(ir_node *const store)
+{
+	ir_node *const proj = get_Proj_for_pn(store, pn_Store_M);
+	if (proj == NULL)
+		return NULL;
+	ir_node *next = NULL;
+	foreach_out_edge(proj, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (is_Load(user))
+			continue;
+		if (next != NULL || !is_candidate_store(user)
+		 || get_nodes_block(user) != get_nodes_block(store))
+			return NULL;
+		next = user;
+	}
+	return next;
+}
+
+static ir_node *get_prev_store(ir_node *const store)
+{
+	ir_node *const mem = get_Store_mem(store);
+	if (!is_Proj(mem))
+		return NULL;
+	ir_node *const pred = get_Proj_pred(mem);
+	if (!is_candidate_store(pred) || get_next_store(pred) != store)
+		return NULL;
+	return pred;
+}
+
+static unsigned get_access_size(ir_node const *const node)
+{
+	ir_mode *const mode = is_Load(node) ? get_Load_mode(node)
+	                                    : get_irn_mode(get_Store_value(node));
+	return get_mode_size_bytes(mode);
+}
+
+static ir_alias_relation get_access_alias_relation(ir_node const *const a,
+                                                   ir_node const *const b)
+{
+	ir_node const *const ptr_a  = is_Load(a) ? get_Load_ptr(a)  : get_Store_ptr(a);
+	ir_type const *const type_a = is_Load(a) ? get_Load_type(a) : get_Store_type(a);
+	ir_node const *const ptr_b  = is_Load(b) ? get_Load_ptr(b)  : get_Store_ptr(b);
+	ir_type const *const type_b = is_Load(b) ? get_Load_type(b) : get_Store_type(b);
+	return get_alias_relation(ptr_a, type_a, get_access_size(a),
+	                          ptr_b, type_b, get_access_size(b));
+}
+
+/**
+ * Checks whether the memory value @p to can be reached from @p from by only
+ * skipping Loads and Stores which do not write the memory read by @p load.
+ */
+static bool mem_reaches(ir_node *from, ir_node const *const to,
+                        ir_node const *const load)
+{
+	for (unsigned i = 0; i < MAX_MEM_WALK; ++i) {
+		if (from == to)
+			return true;
+		if (!is_Proj(from))
+			return false;
+		ir_node *const pred = get_Proj_pred(from);
+		if (is_Load(pred)) {
+			from = get_Load_mem(pred);
+		} else if (is_Store(pred)
+		        && get_Store_volatility(pred) == volatility_non_volatile
+		        && get_access_alias_relation(pred, load) == ir_no_alias) {
+			from = get_Store_mem(pred);
+		} else {
+			return false;
+		}
+	}
+	return false;
+}
+
+static ir_node *pack_lanes(slp_env_t *env, ir_node **lanes);
+
+/** Packs Loads of adjacent elements into a vector Load. */
+static ir_node *pack_loads(slp_env_t *const env, ir_node **const lanes)
+{
+	ir_node *const first   = get_Proj_pred(lanes[0]);
+	ir_mode *const mode    = get_Load_mode(first);
+	long           size    = get_mode_size_bytes(mode);
+	long           offset0;
+	ir_node *const base    = get_base_and_offset(get_Load_ptr(first), &offset0);
+	for (unsigned i = 0; i < env->n_lanes; ++i) {
+		ir_node *const lane = lanes[i];
+		if (!is_Proj(lane) || get_Proj_num(lane) != pn_Load_res)
+			return NULL;
+		ir_node *const load = get_Proj_pred(lane);
+		if (!is_Load(load) || get_Load_mode(load) != mode
+		 || get_Load_volatility(load) != volatility_non_volatile
+		 || ir_throws_exception(load))
+			return NULL;
+		long offset;
+		if (get_base_and_offset(get_Load_ptr(load), &offset) != base
+		 || offset != offset0 + (long)i * size)
+			return NULL;
+		ir_node *const mem = get_Load_mem(load);
+		if (!mem_reaches(mem, env->mem, load)
+		 && !mem_reaches(env->mem, mem, load))
+			return NULL;
+	}
+
+	dbg_info *const dbgi  = get_irn_dbg_info(first);
+	ir_node  *const vload = new_rd_Load(dbgi, env->block, env->mem,
+	                                    get_Load_ptr(first), env->mode,
+	                                    get_Load_type(first), cons_unaligned);
+	ARR_APP1(ir_node*, env->loads, vload);
+	return new_r_Proj(vload, env->mode, pn_Load_res);
+}
+
+/** Packs isomorphic binary operations into a vector operation. */
+static ir_node *pack_binop(slp_env_t *const env, ir_node **const lanes)
+{
+	ir_node *const first = lanes[0];
+	ir_op   *const op    = get_irn_op(first);
+	ir_mode *const mode  = get_irn_mode(first);
+	switch (get_irn_opcode(first)) {
+	case iro_Add:
+	case iro_Sub:
+		break;
+	case iro_Mul:
+		if (!mode_is_float(mode))
+			return NULL;
+		break;
+	case iro_And:
+	case iro_Or:
+	case iro_Eor:
+		if (!mode_is_int(mode))
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+
+	unsigned const n_lanes = env->n_lanes;
+	ir_node **const left   = OALLOCN(&env->obst, ir_node*, n_lanes);
+	ir_node **const right  = OALLOCN(&env->obst, ir_node*, n_lanes);
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		ir_node *const lane = lanes[i];
+		if (get_irn_op(lane) != op || get_irn_mode(lane) != mode)
+			return NULL;
+		left[i]  = get_binop_left(lane);
+		right[i] = get_binop_right(lane);
+		if (get_irn_mode(left[i]) != mode || get_irn_mode(right[i]) != mode)
+			return NULL;
+	}
+
+	ir_node *const vleft = pack_lanes(env, left);
+	if (vleft == NULL)
+		return NULL;
+	ir_node *const vright = pack_lanes(env, right);
+	if (vright == NULL)
+		return NULL;
+
+	dbg_info *const dbgi  = get_irn_dbg_info(first);
+	ir_node  *const block = env->block;
+	switch (get_irn_opcode(first)) {
+	case iro_Add: return new_rd_Add(dbgi, block, vleft, vright);
+	case iro_Sub: return new_rd_Sub(dbgi, block, vleft, vright);
+	case iro_Mul: return new_rd_Mul(dbgi, block, vleft, vright);
+	case iro_And: return new_rd_And(dbgi, block, vleft, vright);
+	case iro_Or:  return new_rd_Or(dbgi, block, vleft, vright);
+	case iro_Eor: return new_rd_Eor(dbgi, block, vleft, vright);
+	default:      panic("unexpected operation %+F", first);
+	}
+}
+
+/** Returns a vector node computing the values @p lanes or NULL. */
+static ir_node *pack_lanes(slp_env_t *const env, ir_node **const lanes)
+{
+	size_t const lanes_size = env->n_lanes * sizeof(*lanes);
+	for (size_t i = 0, n = ARR_LEN(env->packs); i < n; ++i) {
+		if (memcmp(env->packs[i].lanes, lanes, lanes_size) == 0)
+			return env->packs[i].vector;
+	}
+
+	ir_node *const first = lanes[0];
+	ir_node       *vector;
+	if (is_Proj(first) && is_Load(get_Proj_pred(first))) {
+		vector = pack_loads(env, lanes);
+	} else if (is_binop(first)) {
+		vector = pack_binop(env, lanes);
+	} else {
+		vector = NULL;
+	}
+	if (vector == NULL)
+		return NULL;
+
+	pack_t const pack = { lanes, vector };
+	ARR_APP1(pack_t, env->packs, pack);
+	return vector;
+}
+
+/** Removes the unused vector nodes created for a window that failed. */
+static void discard_packs(slp_env_t *const env)
+{
+	for (size_t i = ARR_LEN(env->packs); i-- > 0; ) {
+		ir_node *const vector = env->packs[i].vector;
+		if (get_irn_n_edges(vector) == 0)
+			kill_node(vector);
+	}
+	for (size_t i = 0, n = ARR_LEN(env->loads); i < n; ++i) {
+		ir_node *const load = env->loads[i];
+		if (get_irn_n_edges(load) == 0)
+			kill_node(load);
+	}
+}
+
+/**
+ * Checks whether the memory operations between the first and the other
+ * Stores of a window do not access the memory written by the latter, so
+ * the window can be replaced by a vector Store in place of the first one.
+ */
+static bool can_move_up(ir_node **const chain, size_t const first,
+                        ir_node **const window, unsigned const n_lanes)
+{
+	for (unsigned l = 0; l < n_lanes; ++l) {
+		ir_node *const store = window[l];
+		for (size_t pos = first; chain[pos] != store; ++pos) {
+			ir_node *const node = chain[pos];
+			if (node == NULL)
+				continue;
+			bool in_window = false;
+			for (unsigned k = 0; k < n_lanes; ++k)
+				in_window |= window[k] == node;
+			if (!in_window
+			 && get_access_alias_relation(node, store) != ir_no_alias)
+				return false;
+			ir_node *const proj = get_Proj_for_pn(node, pn_Store_M);
+			foreach_out_edge(proj, edge) {
+				ir_node *const user = get_edge_src_irn(edge);
+				if (is_Load(user)
+				 && get_access_alias_relation(user, store) != ir_no_alias)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** Tries to replace the Stores of a window by a vector Store. */
+static bool vectorize_window(slp_env_t *const env, ir_node **const chain,
+                             size_t const n, ir_node **const window)
+{
+	unsigned const n_lanes = env->n_lanes;
+	size_t         first   = n;
+	for (unsigned l = 0; l < n_lanes; ++l) {
+		for (size_t pos = 0; pos < first; ++pos) {
+			if (chain[pos] == window[l]) {
+				first = pos;
+				break;
+			}
+		}
+	}
+	if (!can_move_up(chain, first, window, n_lanes))
+		return false;
+
+	ir_node  *const first_store = chain[first];
+	ir_mode  *const el_mode     = get_irn_mode(get_Store_value(window[0]));
+	env->block = get_nodes_block(first_store);
+	env->mem   = get_Store_mem(first_store);
+	env->mode  = get_vector_mode(el_mode, n_lanes);
+	ARR_RESIZE(pack_t, env->packs, 0);
+	ARR_RESIZE(ir_node*, env->loads, 0);
+
+	ir_node **const values = OALLOCN(&env->obst, ir_node*, n_lanes);
+	for (unsigned l = 0; l < n_lanes; ++l)
+		values[l] = get_Store_value(window[l]);
+	ir_node *const vector = pack_lanes(env, values);
+	if (vector == NULL) {
+		discard_packs(env);
+		return false;
+	}
+
+	/* the vector Store must not overwrite memory before the vector Loads
+	 * have read it */
+	ir_node *mem     = env->mem;
+	size_t   n_loads = ARR_LEN(env->loads);
+	if (n_loads > 0) {
+		ir_node **const in = ALLOCAN(ir_node*, n_loads);
+		for (size_t i = 0; i < n_loads; ++i)
+			in[i] = new_r_Proj(env->loads[i], mode_M, pn_Load_M);
+		mem = n_loads == 1 ? in[0] : new_r_Sync(env->block, n_loads, in);
+	}
+	dbg_info *const dbgi   = get_irn_dbg_info(first_store);
+	ir_node  *const vstore = new_rd_Store(dbgi, env->block, mem,
+	                                      get_Store_ptr(window[0]), vector,
+	                                      get_Store_type(window[0]),
+	                                      cons_unaligned);
+	ir_node  *const vmem   = new_r_Proj(vstore, mode_M, pn_Store_M);
+	DB((dbg, LEVEL_2, "replaced %u Stores starting at %+F by %+F\n", n_lanes,
+	    window[0], vstore));
+
+	/* remove the scalar Stores from the memory chain */
+	for (size_t pos = n; pos-- > first; ) {
+		ir_node *const store = chain[pos];
+		bool in_window = false;
+		for (unsigned l = 0; l < n_lanes; ++l)
+			in_window |= window[l] == store;
+		if (!in_window)
+			continue;
+		ir_node *const proj = get_Proj_for_pn(store, pn_Store_M);
+		if (store == first_store) {
+			exchange(proj, vmem);
+			chain[pos] = vstore;
+		} else {
+			if (proj != NULL)
+				exchange(proj, get_Store_mem(store));
+			chain[pos] = NULL;
+		}
+		kill_node(store);
+	}
+	return true;
+}
+
+/** Finds windows of adjacent Stores in a chain and vectorizes them. */
+static void vectorize_chain(slp_env_t *const env, ir_node **const chain,
+                            size_t const n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *const store = chain[i];
+		if (store == NULL || !is_candidate_store(store))
+			continue;
+		ir_mode *const mode    = get_irn_mode(get_Store_value(store));
+		long     const size    = get_mode_size_bytes(mode);
+		unsigned const n_lanes = ir_target.vector_size / size;
+		long           offset0;
+		ir_node *const base    = get_base_and_offset(get_Store_ptr(store),
+		                                             &offset0);
+
+		/* collect the Stores of the window starting at this one */
+		ir_node **const window = OALLOCNZ(&env->obst, ir_node*, n_lanes);
+		bool            valid  = true;
+		for (size_t j = 0; j < n && valid; ++j) {
+			ir_node *const other = chain[j];
+			if (other == NULL || !is_candidate_store(other)
+			 || get_irn_mode(get_Store_value(other)) != mode)
+				continue;
+			long offset;
+			if (get_base_and_offset(get_Store_ptr(other), &offset) != base)
+				continue;
+			long const delta = offset - offset0;
+			if (delta < 0 || delta % size != 0
+			 || delta / size >= (long)n_lanes)
+				continue;
+			/* two Stores to the same element are not handled */
+			if (window[delta / size] != NULL)
+				valid = false;
+			window[delta / size] = other;
+		}
+		for (unsigned l = 0; l < n_lanes && valid; ++l)
+			valid = window[l] != NULL;
+		if (!valid)
+			continue;
+
+		env->n_lanes = n_lanes;
+		if (vectorize_window(env, chain, n, window))
+			env->changed = true;
+	}
+}
+
+void slp_vectorize(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.slp");
+
+	if (ir_target.vector_size == 0)
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
+	if ((get_irg_memory_disambiguator_options(irg) & aa_opt_always_alias) == 0)
+		assure_irp_globals_entity_usage_computed();
+
+	slp_env_t env;
+	memset(&env, 0, sizeof(env));
+	obstack_init(&env.obst);
+	env.stores = NEW_ARR_F(ir_node*, 0);
+	env.packs  = NEW_ARR_F(pack_t, 0);
+	env.loads  = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_stores, &env);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	inc_irg_visited(irg);
+	ir_node **chain = NEW_ARR_F(ir_node*, 0);
+	for (size_t i = 0, n = ARR_LEN(env.stores); i < n; ++i) {
+		ir_node *store = env.stores[i];
+		if (irn_visited(store) || get_prev_store(store) != NULL
+		 || get_next_store(store) == NULL)
+			continue;
+
+		ARR_RESIZE(ir_node*, chain, 0);
+		for (; store != NULL; store = get_next_store(store)) {
+			mark_irn_visited(store);
+			ARR_APP1(ir_node*, chain, store);
+		}
+		for (size_t c = 0, n_chain = ARR_LEN(chain); c < n_chain;
+		     c += MAX_CHAIN_LENGTH) {
+			size_t const len = MIN(n_chain - c, MAX_CHAIN_LENGTH);
+			vectorize_chain(&env, chain + c, len);
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+
+	DEL_ARR_F(chain);
+	DEL_ARR_F(env.loads);
+	DEL_ARR_F(env.packs);
+	DEL_ARR_F(env.stores);
+	obstack_free(&env.obst, NULL);
+
+	confirm_irg_properties(irg, env.changed
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+}
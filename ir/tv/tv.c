@@ -217,6 +217,7 @@ ir_tarval *new_tarval_from_str(const char *str, size_t len, ir_mode *mode)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		break;
 	}
@@ -475,6 +476,7 @@ void init_mode_values(ir_mode* mode)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 		mode->all_one   = tarval_bad;
 		mode->min       = tarval_bad;
 		mode->max       = tarval_bad;
@@ -502,6 +504,7 @@ int tarval_is_negative(ir_tarval const *const a)
 	case irms_auxiliary:
 	case irms_internal_boolean:
 	case irms_data:
+	case irms_vector:
 		break;
 	}
 	panic("invalid mode sort");
@@ -566,6 +569,7 @@ ir_relation tarval_cmp(ir_tarval const *const a, ir_tarval const *const b)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 		break;
 	}
 	panic("invalid mode sort");
@@ -617,6 +621,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 		case irms_internal_boolean:
 		case irms_auxiliary:
 		case irms_data:
+		case irms_vector:
 			break;
 		}
 		/* the rest can't be converted */
@@ -650,6 +655,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 		}
 		case irms_auxiliary:
 		case irms_data:
+		case irms_vector:
 		case irms_internal_boolean:
 			break;
 		}
@@ -671,6 +677,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		return tarval_bad;
 	}
@@ -723,6 +730,7 @@ ir_tarval *tarval_neg(ir_tarval const *const a)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		break;
 	}
@@ -758,6 +766,7 @@ ir_tarval *tarval_add(ir_tarval const *a, ir_tarval const *b)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		return tarval_bad;
 	}
@@ -799,6 +808,7 @@ ir_tarval *tarval_sub(ir_tarval const *a, ir_tarval const *b)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		return tarval_bad;
 	}
@@ -827,6 +837,7 @@ ir_tarval *tarval_mul(ir_tarval const *const a, ir_tarval const *const b)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		return tarval_bad;
 	}
@@ -858,6 +869,7 @@ ir_tarval *tarval_div(ir_tarval const *const a, ir_tarval const *const b)
 
 	case irms_auxiliary:
 	case irms_data:
+	case irms_vector:
 	case irms_internal_boolean:
 		panic("operation not defined on mode");
 	}
@@ -1148,6 +1160,7 @@ const char *ir_tarval_to_ascii(char *buf, size_t len, ir_tarval const *tv)
 		return buf;
 	}
 	case irms_data:
+	case irms_vector:
 	case irms_auxiliary:
 		if (tv == tarval_bad)
 			return "bad";
@@ -1178,6 +1191,7 @@ ir_tarval *ir_tarval_from_ascii(const char *buf, ir_mode *mode)
 		return get_fp_tarval(buffer, mode);
 	}
 	case irms_data:
+	case irms_vector:
 	case irms_auxiliary:
 		if (streq(buf, "bad"))
 			return tarval_bad;
@@ -0,0 +1,210 @@
+#include "depend.h"
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Builds loop nests for (i[k] = 0; i[k] < bound[k]; ++i[k]) with two memory
+ * accesses in the innermost body and tests their dependence. */
+
+typedef ir_node *(*address_func)(ir_node *base, ir_node *const *ivs);
+
+static ir_type *int_type;
+static ir_type *row_type;
+static ir_type *matrix_type;
+static ir_node *src_node;
+static ir_node *dst_node;
+
+static ir_node *new_long(long const value)
+{
+	return new_Const_long(mode_Ls, value);
+}
+
+/* Returns base + 4 * (scale * iv + offset). */
+static ir_node *element(ir_node *const base, ir_node *const iv,
+                        long const scale, long const offset)
+{
+	ir_node *index = iv != NULL ? new_Mul(iv, new_long(scale)) : new_long(0);
+	index = new_Add(index, new_long(offset));
+	return new_Add(base, new_Mul(index, new_long(4)));
+}
+
+static ir_graph *build(unsigned const depth, long const *const bounds,
+                       address_func const src, address_func const dst)
+{
+	static unsigned n_graphs;
+	char name[16];
+	snprintf(name, sizeof(name), "f%u", n_graphs++);
+
+	ir_type *const ptr_type = new_type_pointer(int_type);
+	ir_type *const mtp = new_type_method(3, 0, false, cc_cdecl_set,
+	                                     mtp_no_property);
+	set_method_param_type(mtp, 0, ptr_type);
+	set_method_param_type(mtp, 1, ptr_type);
+	set_method_param_type(mtp, 2, new_type_primitive(mode_Ls));
+	ir_entity *const ent = new_global_entity(get_glob_type(),
+	                                         new_id_from_str(name), mtp,
+	                                         ir_visibility_external,
+	                                         IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(ent, depth);
+	set_current_ir_graph(irg);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const a    = new_Proj(args, mode_P, 0);
+	ir_node *const b    = new_Proj(args, mode_P, 1);
+	ir_node *const n    = new_Proj(args, mode_Ls, 2);
+
+	ir_node *heads[2];
+	ir_node *exits[2];
+	for (unsigned k = 0; k < depth; ++k) {
+		set_value(k, new_long(0));
+		ir_node *const jmp = new_Jmp();
+		heads[k] = new_immBlock();
+		add_immBlock_pred(heads[k], jmp);
+		set_cur_block(heads[k]);
+		ir_node *const bound = bounds[k] < 0 ? n : new_long(bounds[k]);
+		ir_node *const cmp   = new_Cmp(get_value(k, mode_Ls), bound,
+		                               ir_relation_less);
+		ir_node *const cond  = new_Cond(cmp);
+		exits[k] = new_immBlock();
+		add_immBlock_pred(exits[k], new_Proj(cond, mode_X, pn_Cond_false));
+		ir_node *const body = new_immBlock();
+		add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+		mature_immBlock(body);
+		set_cur_block(body);
+	}
+
+	ir_node *ivs[2];
+	for (unsigned k = 0; k < depth; ++k)
+		ivs[k] = get_value(k, mode_Ls);
+	/* The Load comes first, so it is not replaced by the stored value. */
+	ir_node *const load_ptr = dst != NULL ? dst(a, ivs) : src(b, ivs);
+	dst_node = new_Load(get_store(), load_ptr, mode_Is, int_type, cons_none);
+	set_store(new_Proj(dst_node, mode_M, pn_Load_M));
+	src_node = new_Store(get_store(), src(a, ivs), new_Const_long(mode_Is, 1),
+	                     int_type, cons_none);
+	set_store(new_Proj(src_node, mode_M, pn_Store_M));
+
+	for (unsigned k = depth; k-- > 0;) {
+		set_value(k, new_Add(get_value(k, mode_Ls), new_long(1)));
+		add_immBlock_pred(heads[k], new_Jmp());
+		mature_immBlock(heads[k]);
+		mature_immBlock(exits[k]);
+		set_cur_block(exits[k]);
+	}
+	ir_node *const ret = new_Return(get_store(), 0, NULL);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	return irg;
+}
+
+static bool test(unsigned const depth, long const *const bounds,
+                 address_func const src, address_func const dst,
+                 dep_result *const result)
+{
+	ir_graph   *const irg  = build(depth, bounds, src, dst);
+	dep_info_t *const info = dep_new(irg);
+	bool const dependent = dep_test_memops(info, src_node, dst_node, result);
+	dep_free(info);
+	assert(result->n_loops == depth);
+	return dependent;
+}
+
+static ir_node *a_i(ir_node *b, ir_node *const *i)       { return element(b, i[0], 1, 0); }
+static ir_node *a_i1(ir_node *b, ir_node *const *i)      { return element(b, i[0], 1, 1); }
+static ir_node *a_2i(ir_node *b, ir_node *const *i)      { return element(b, i[0], 2, 0); }
+static ir_node *a_2i1(ir_node *b, ir_node *const *i)     { return element(b, i[0], 2, 1); }
+static ir_node *a_i200(ir_node *b, ir_node *const *i)    { return element(b, i[0], 1, 200); }
+static ir_node *a_3(ir_node *b, ir_node *const *i)       { (void)i; return element(b, NULL, 0, 3); }
+static ir_node *a_5(ir_node *b, ir_node *const *i)       { (void)i; return element(b, NULL, 0, 5); }
+static ir_node *a_50(ir_node *b, ir_node *const *i)      { (void)i; return element(b, NULL, 0, 50); }
+static ir_node *a_150(ir_node *b, ir_node *const *i)     { (void)i; return element(b, NULL, 0, 150); }
+
+static ir_node *matrix(ir_node *const base, ir_node *const *const ivs,
+                       long const di, long const dj)
+{
+	ir_node *const row = new_Sel(base, new_Add(ivs[0], new_long(di)),
+	                             matrix_type);
+	return new_Sel(row, new_Add(ivs[1], new_long(dj)), row_type);
+}
+
+static ir_node *m_ij(ir_node *b, ir_node *const *i)  { return matrix(b, i, 0, 0); }
+static ir_node *m_ij1(ir_node *b, ir_node *const *i) { return matrix(b, i, 0, 1); }
+static ir_node *m_i1j(ir_node *b, ir_node *const *i) { return matrix(b, i, 1, 0); }
+
+int main(void)
+{
+	ir_init();
+	int_type    = new_type_primitive(mode_Is);
+	row_type    = new_type_array(int_type, 10);
+	matrix_type = new_type_array(row_type, 10);
+
+	long const n100[]     = { 100 };
+	long const unknown[]  = { -1 };
+	long const n10x8[]    = { 10, 8 };
+	long const unknown2[] = { -1, -1 };
+	dep_result r;
+
+	/* a[i + 1] = ...; ... = a[i]: the load reads the store one iteration
+	 * later. */
+	assert(test(1, n100, a_i1, a_i, &r));
+	assert(r.directions[0] == DEP_DIR_LT);
+	assert(r.distance_known[0] && r.distances[0] == 1);
+	assert(test(1, n100, a_i, a_i1, &r));
+	assert(r.directions[0] == DEP_DIR_GT);
+	assert(r.distance_known[0] && r.distances[0] == -1);
+
+	/* Same element in the same iteration. */
+	assert(test(1, n100, a_i, a_i, &r));
+	assert(r.directions[0] == DEP_DIR_EQ);
+	assert(r.distance_known[0] && r.distances[0] == 0);
+
+	/* GCD test: even and odd elements. */
+	assert(!test(1, n100, a_2i, a_2i1, &r));
+
+	/* Strong SIV: the distance exceeds the trip count. */
+	assert(!test(1, n100, a_i, a_i200, &r));
+	assert(test(1, unknown, a_i, a_i200, &r));
+	assert(r.directions[0] == DEP_DIR_GT);
+	assert(r.distance_known[0] && r.distances[0] == -200);
+
+	/* ZIV */
+	assert(!test(1, n100, a_3, a_5, &r));
+	assert(test(1, n100, a_3, a_3, &r));
+	assert(r.directions[0] == DEP_DIR_ALL);
+
+	/* Weak-zero SIV */
+	assert(!test(1, n100, a_i, a_150, &r));
+	assert(test(1, n100, a_i, a_50, &r));
+
+	/* Different arrays are left to the alias analysis. */
+	assert(test(1, n100, a_i, NULL, &r));
+	assert(r.directions[0] == DEP_DIR_ALL);
+
+	/* a[i][j + 1] = ...; ... = a[i][j] with j + 1 inside the rows. */
+	assert(test(2, n10x8, m_ij1, m_ij, &r));
+	assert(r.directions[0] == DEP_DIR_EQ);
+	assert(r.directions[1] == DEP_DIR_LT);
+	assert(r.distance_known[1] && r.distances[1] == 1);
+
+	/* a[i + 1][j] = ...; ... = a[i][j] */
+	assert(test(2, n10x8, m_i1j, m_ij, &r));
+	assert(r.directions[0] == DEP_DIR_LT);
+	assert(r.directions[1] & DEP_DIR_EQ);
+
+	/* Same matrix element in the same iteration. */
+	assert(test(2, n10x8, m_ij, m_ij, &r));
+	assert(r.directions[0] == DEP_DIR_EQ && r.directions[1] == DEP_DIR_EQ);
+
+	/* The indices are compared separately, so unknown bounds do not matter. */
+	assert(test(2, unknown2, m_ij, m_ij, &r));
+	assert(r.directions[0] == DEP_DIR_EQ && r.directions[1] == DEP_DIR_EQ);
+	assert(test(2, unknown2, m_i1j, m_ij, &r));
+	assert(r.directions[0] == DEP_DIR_LT && r.directions[1] == DEP_DIR_EQ);
+	assert(r.distance_known[0] && r.distances[0] == 1);
+
+	ir_finish();
+	return 0;
+}
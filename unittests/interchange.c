@@ -0,0 +1,169 @@
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Builds the loop nest
+ *   for (i = 0; n > i; ++i)
+ *     for (j = 0; m > j; ++j)
+ *       a[j][i] = b[j][i] + c[i][j];
+ * with the bounds on the left of the exit tests.  Interchanging the loops
+ * lowers the strides, and the new inner loop is tiled as c[i][j] is close to
+ * the element of the previous outer iteration. */
+
+static ir_type   *row_type;
+static ir_type   *matrix_type;
+static ir_entity *arrays[3];
+static ir_node   *bound_n;
+static ir_node   *tile_cmp;
+static ir_node   *tile_start;
+
+static ir_node *new_long(long const value)
+{
+	return new_Const_long(mode_Ls, value);
+}
+
+static ir_node *element(ir_entity *const array, ir_node *const row,
+                        ir_node *const column)
+{
+	ir_node *const base = new_Address(array);
+	return new_Sel(new_Sel(base, row, matrix_type), column, row_type);
+}
+
+static ir_node *load(ir_node *const ptr)
+{
+	ir_type *const type = get_array_element_type(row_type);
+	ir_node *const ld   = new_Load(get_store(), ptr, mode_Is, type, cons_none);
+	set_store(new_Proj(ld, mode_M, pn_Load_M));
+	return new_Proj(ld, mode_Is, pn_Load_res);
+}
+
+/* Emits a[j][i] = b[j][i] + c[i][j]. */
+static void build_body(ir_node *const i, ir_node *const j)
+{
+	ir_node *const sum = new_Add(load(element(arrays[1], j, i)),
+	                             load(element(arrays[2], i, j)));
+	ir_type *const type  = get_array_element_type(row_type);
+	ir_node *const store = new_Store(get_store(), element(arrays[0], j, i),
+	                                 sum, type, cons_none);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+}
+
+/* Builds the nest, with the accesses in the inner loop header if
+ * @p in_header is set. */
+static ir_graph *build(bool const in_header)
+{
+	static unsigned n_graphs;
+	char name[16];
+	snprintf(name, sizeof(name), "f%u", n_graphs++);
+
+	ir_type *const long_type = new_type_primitive(mode_Ls);
+	ir_type *const mtp = new_type_method(2, 0, false, cc_cdecl_set,
+	                                     mtp_no_property);
+	set_method_param_type(mtp, 0, long_type);
+	set_method_param_type(mtp, 1, long_type);
+	ir_entity *const ent = new_global_entity(get_glob_type(),
+	                                         new_id_from_str(name), mtp,
+	                                         ir_visibility_external,
+	                                         IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(ent, 2);
+	set_current_ir_graph(irg);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const n    = new_Proj(args, mode_Ls, 0);
+	ir_node *const m    = new_Proj(args, mode_Ls, 1);
+	bound_n = n;
+
+	ir_node *heads[2];
+	ir_node *exits[2];
+	ir_node *const bounds[] = { n, m };
+	for (unsigned k = 0; k < 2; ++k) {
+		set_value(k, new_long(0));
+		ir_node *const jmp = new_Jmp();
+		heads[k] = new_immBlock();
+		add_immBlock_pred(heads[k], jmp);
+		set_cur_block(heads[k]);
+		if (k == 1 && in_header)
+			build_body(get_value(0, mode_Ls), get_value(1, mode_Ls));
+		ir_node *const cmp  = new_Cmp(bounds[k], get_value(k, mode_Ls),
+		                              ir_relation_greater);
+		ir_node *const cond = new_Cond(cmp);
+		exits[k] = new_immBlock();
+		add_immBlock_pred(exits[k], new_Proj(cond, mode_X, pn_Cond_false));
+		ir_node *const body = new_immBlock();
+		add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+		mature_immBlock(body);
+		set_cur_block(body);
+	}
+	if (!in_header)
+		build_body(get_value(0, mode_Ls), get_value(1, mode_Ls));
+
+	for (unsigned k = 2; k-- > 0;) {
+		set_value(k, new_Add(get_value(k, mode_Ls), new_long(1)));
+		add_immBlock_pred(heads[k], new_Jmp());
+		mature_immBlock(heads[k]);
+		mature_immBlock(exits[k]);
+		set_cur_block(exits[k]);
+	}
+	ir_node *const ret = new_Return(get_store(), 0, NULL);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+/* Finds the test of the tile loop, which compares the start of the tile
+ * with the outer bound.  Unlike the loop tests it is not evaluated in the
+ * block of the compared Phi. */
+static void find_tile_cmp(ir_node *const node, void *const data)
+{
+	(void)data;
+	if (!is_Cmp(node))
+		return;
+	ir_node *const left  = get_Cmp_left(node);
+	ir_node *const right = get_Cmp_right(node);
+	ir_node *const phi   = left == bound_n ? right : left;
+	if ((left == bound_n || right == bound_n) && is_Phi(phi)
+	 && get_nodes_block(phi) != get_nodes_block(node)) {
+		tile_cmp   = node;
+		tile_start = phi;
+	}
+}
+
+int main(void)
+{
+	ir_init();
+	ir_type *const int_type = new_type_primitive(mode_Is);
+	row_type    = new_type_array(int_type, 10);
+	matrix_type = new_type_array(row_type, 10);
+	char const *const names[] = { "a", "b", "c" };
+	for (unsigned i = 0; i < 3; ++i) {
+		arrays[i] = new_global_entity(get_glob_type(),
+		                              new_id_from_str(names[i]), matrix_type,
+		                              ir_visibility_external,
+		                              IR_LINKAGE_DEFAULT);
+	}
+
+	/* The tile loop continues while its start is below the bound, although
+	 * the bound is the left operand of the original test. */
+	ir_graph *irg = build(false);
+	interchange_loops(irg, 4);
+	irg_assert_verify(irg);
+	tile_cmp = NULL;
+	irg_walk_graph(irg, NULL, find_tile_cmp, NULL);
+	assert(tile_cmp != NULL);
+	ir_relation relation = get_Cmp_relation(tile_cmp);
+	if (get_Cmp_right(tile_cmp) == tile_start)
+		relation = get_inversed_relation(relation);
+	assert(relation == ir_relation_less);
+
+	/* Accesses in the inner loop header are executed once more than the
+	 * body, so the nest is left alone. */
+	irg = build(true);
+	unsigned const last_idx = get_irg_last_idx(irg);
+	interchange_loops(irg, 4);
+	irg_assert_verify(irg);
+	assert(get_irg_last_idx(irg) == last_idx);
+
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,189 @@
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Builds loops selecting the minimum or maximum with control flow
+ *   for (i = 0; i < n; ++i) {
+ *     x = a[i];
+ *     m = x < m ? x : m;    (or c[i] = x > m ? x : m)
+ *   }
+ * and counts the Muxes left after vectorization. */
+
+static ir_type *int_type;
+
+typedef enum kind_t {
+	MIN_REDUCTION,  /**< m = min(a[i], m), the result is m */
+	MIN_STORED,     /**< like MIN_REDUCTION, also stores m to *c */
+	MAX_ELEMENTS,   /**< c[i] = max(a[i], m) */
+} kind_t;
+
+typedef struct counts_t {
+	unsigned n_muxes;
+	unsigned n_vector_muxes;
+} counts_t;
+
+static ir_node *element(ir_node *const base, ir_node *const index)
+{
+	ir_node *const offset = new_Mul(index, new_Const_long(mode_Ls, 4));
+	return new_Add(base, offset);
+}
+
+/* Builds the loop, tested at its end if @p at_end is set. */
+static ir_graph *build(kind_t const kind, bool const at_end)
+{
+	static unsigned n_graphs;
+	char name[16];
+	snprintf(name, sizeof(name), "f%u", n_graphs++);
+
+	ir_type *const ptr_type  = new_type_pointer(int_type);
+	ir_type *const long_type = new_type_primitive(mode_Ls);
+	ir_type *const mtp = new_type_method(4, 1, false, cc_cdecl_set,
+	                                     mtp_no_property);
+	set_method_param_type(mtp, 0, ptr_type);
+	set_method_param_type(mtp, 1, ptr_type);
+	set_method_param_type(mtp, 2, long_type);
+	set_method_param_type(mtp, 3, int_type);
+	set_method_res_type(mtp, 0, int_type);
+	ir_entity *const ent = new_global_entity(get_glob_type(),
+	                                         new_id_from_str(name), mtp,
+	                                         ir_visibility_external,
+	                                         IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(ent, 3);
+	set_current_ir_graph(irg);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const a    = new_Proj(args, mode_P, 0);
+	ir_node *const c    = new_Proj(args, mode_P, 1);
+	ir_node *const n    = new_Proj(args, mode_Ls, 2);
+	set_value(0, new_Const_long(mode_Ls, 0));
+	set_value(1, new_Proj(args, mode_Is, 3));
+
+	ir_node *const jmp    = new_Jmp();
+	ir_node *const header = new_immBlock();
+	ir_node *const exit   = new_immBlock();
+	add_immBlock_pred(header, jmp);
+	set_cur_block(header);
+	if (!at_end) {
+		ir_node *const cmp  = new_Cmp(get_value(0, mode_Ls), n,
+		                              ir_relation_less);
+		ir_node *const cond = new_Cond(cmp);
+		add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+		ir_node *const body = new_immBlock();
+		add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+		mature_immBlock(body);
+		set_cur_block(body);
+	}
+
+	ir_node *const i  = get_value(0, mode_Ls);
+	ir_node *const m  = get_value(1, mode_Is);
+	ir_node *const ld = new_Load(get_store(), element(a, i), mode_Is,
+	                             int_type, cons_none);
+	set_store(new_Proj(ld, mode_M, pn_Load_M));
+	ir_node *const x = new_Proj(ld, mode_Is, pn_Load_res);
+
+	/* Select x if the Cmp holds, m otherwise. */
+	ir_relation const relation = kind == MAX_ELEMENTS ? ir_relation_greater
+	                                                  : ir_relation_less;
+	ir_node *const select = new_Cond(new_Cmp(x, m, relation));
+	ir_node *const join   = new_immBlock();
+	for (unsigned pn = pn_Cond_false; pn <= pn_Cond_true; ++pn) {
+		ir_node *const arm = new_immBlock();
+		add_immBlock_pred(arm, new_Proj(select, mode_X, pn));
+		mature_immBlock(arm);
+		set_cur_block(arm);
+		set_value(2, pn == pn_Cond_true ? x : m);
+		add_immBlock_pred(join, new_Jmp());
+	}
+	mature_immBlock(join);
+	set_cur_block(join);
+
+	ir_node *const value = get_value(2, mode_Is);
+	if (kind == MAX_ELEMENTS || kind == MIN_STORED) {
+		ir_node *const ptr   = kind == MAX_ELEMENTS ? element(c, i) : c;
+		ir_node *const store = new_Store(get_store(), ptr, value, int_type,
+		                                 cons_none);
+		set_store(new_Proj(store, mode_M, pn_Store_M));
+	}
+	if (kind != MAX_ELEMENTS)
+		set_value(1, value);
+	set_value(0, new_Add(i, new_Const_long(mode_Ls, 1)));
+
+	if (at_end) {
+		ir_node *const cmp  = new_Cmp(get_value(0, mode_Ls), n,
+		                              ir_relation_less);
+		ir_node *const cond = new_Cond(cmp);
+		add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+		add_immBlock_pred(header, new_Proj(cond, mode_X, pn_Cond_true));
+	} else {
+		add_immBlock_pred(header, new_Jmp());
+	}
+	mature_immBlock(header);
+	mature_immBlock(exit);
+	set_cur_block(exit);
+
+	ir_node *const res = get_value(1, mode_Is);
+	ir_node *const ret = new_Return(get_store(), 1, &res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+static void count_node(ir_node *const node, void *const data)
+{
+	counts_t *const counts = (counts_t*)data;
+	if (!is_Mux(node))
+		return;
+	++counts->n_muxes;
+	if (mode_is_vector(get_irn_mode(node)))
+		++counts->n_vector_muxes;
+}
+
+static counts_t test(kind_t const kind, bool const at_end,
+                     bool *const changed)
+{
+	ir_graph *const irg      = build(kind, at_end);
+	unsigned  const last_idx = get_irg_last_idx(irg);
+	loop_vectorize(irg);
+	irg_assert_verify(irg);
+	*changed = get_irg_last_idx(irg) != last_idx;
+
+	counts_t counts = { 0, 0 };
+	irg_walk_graph(irg, NULL, count_node, &counts);
+	return counts;
+}
+
+int main(void)
+{
+	ir_init();
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+	int_type = new_type_primitive(mode_Is);
+	assert(ir_target_vector_size() == 16);
+
+	bool     changed;
+	counts_t c;
+
+	/* The minimum is selected lane-wise in the vector loop. */
+	c = test(MIN_REDUCTION, false, &changed);
+	assert(changed);
+	assert(c.n_vector_muxes == 1);
+
+	c = test(MIN_REDUCTION, true, &changed);
+	assert(changed);
+	assert(c.n_vector_muxes == 1);
+
+	/* The maximum of each element and an invariant. */
+	c = test(MAX_ELEMENTS, false, &changed);
+	assert(changed);
+	assert(c.n_vector_muxes == 1);
+
+	/* Storing the minimum to the same address in each iteration prevents
+	 * vectorization, and the loop keeps its control flow. */
+	c = test(MIN_STORED, false, &changed);
+	assert(!changed);
+	assert(c.n_muxes == 0);
+
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+
+/* Builds
+ *   static int x, y;
+ *   static struct { int *p; int *q; } s;
+ *   void f(void) { s.p = &x; s.q = &y; *s.p = 1; *s.q = 2; }
+ * and queries the alias relation of the loaded pointers.  They only differ
+ * if the members of s are distinguished. */
+
+static ir_type *int_type;
+static ir_node *ptr_p;
+static ir_node *ptr_q;
+
+static ir_entity *new_local(ir_type *const type, char const *const name)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name), type,
+	                         ir_visibility_local, IR_LINKAGE_DEFAULT);
+}
+
+static void store(ir_node *const ptr, ir_node *const value,
+                  ir_type *const type)
+{
+	ir_node *const st = new_Store(get_store(), ptr, value, type, cons_none);
+	set_store(new_Proj(st, mode_M, pn_Store_M));
+}
+
+static ir_node *load(ir_node *const ptr, ir_type *const type)
+{
+	ir_node *const ld = new_Load(get_store(), ptr, mode_P, type, cons_none);
+	set_store(new_Proj(ld, mode_M, pn_Load_M));
+	return new_Proj(ld, mode_P, pn_Load_res);
+}
+
+static void build(void)
+{
+	ir_type *const ptr_type    = new_type_pointer(int_type);
+	ir_type *const struct_type = new_type_struct(new_id_from_str("S"));
+	ir_entity *const member_p = new_entity(struct_type, new_id_from_str("p"),
+	                                       ptr_type);
+	ir_entity *const member_q = new_entity(struct_type, new_id_from_str("q"),
+	                                       ptr_type);
+	default_layout_compound_type(struct_type);
+
+	ir_entity *const x = new_local(int_type, "x");
+	ir_entity *const y = new_local(int_type, "y");
+	ir_entity *const s = new_local(struct_type, "s");
+
+	ir_type *const mtp = new_type_method(0, 0, false, cc_cdecl_set,
+	                                     mtp_no_property);
+	ir_entity *const ent = new_global_entity(get_glob_type(),
+	                                         new_id_from_str("f"), mtp,
+	                                         ir_visibility_external,
+	                                         IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(ent, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const base = new_Address(s);
+	ir_node *const p    = new_Member(base, member_p);
+	ir_node *const q    = new_Member(base, member_q);
+	store(p, new_Address(x), ptr_type);
+	store(q, new_Address(y), ptr_type);
+	ptr_p = load(p, ptr_type);
+	ptr_q = load(q, ptr_type);
+	store(ptr_p, new_Const_long(mode_Is, 1), int_type);
+	store(ptr_q, new_Const_long(mode_Is, 2), int_type);
+
+	ir_node *const ret = new_Return(get_store(), 0, NULL);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+static ir_alias_relation relation(ir_node *const addr1, ir_node *const addr2)
+{
+	return get_alias_relation(addr1, int_type, 4, addr2, int_type, 4);
+}
+
+int main(void)
+{
+	ir_init();
+	int_type = new_type_primitive(mode_Is);
+	build();
+
+	/* Without points-to information the loaded pointers may alias. */
+	assert(relation(ptr_p, ptr_q) == ir_may_alias);
+
+	/* The members of s point to different objects. */
+	assure_irp_points_to_computed();
+	assert(relation(ptr_p, ptr_q) == ir_no_alias);
+
+	/* Addresses created later are traced back to the analyzed nodes... */
+	ir_graph *const irg    = get_irn_irg(ptr_p);
+	ir_node  *const block  = get_nodes_block(ptr_p);
+	ir_node  *const offset = new_r_Const_long(irg, mode_Ls, 4);
+	ir_node  *const next_p = new_r_Add(block, ptr_p, offset);
+	assert(relation(next_p, ptr_q) == ir_no_alias);
+
+	/* ...while unknown values are treated conservatively. */
+	ir_node *const unknown = new_r_Unknown(irg, mode_P);
+	assert(relation(unknown, ptr_q) == ir_may_alias);
+
+	free_irp_points_to();
+	assert(relation(ptr_p, ptr_q) == ir_may_alias);
+
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,140 @@
+#include "firm.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Builds straight-line code
+ *   a[offsets_a[i]] = b[offsets_b[i]] + c[offsets_a[i]]
+ * for up to four consecutive i and counts the Stores and vector Loads left
+ * after vectorization. */
+
+static ir_type *int_type;
+
+typedef struct counts_t {
+	unsigned n_stores;
+	unsigned n_vector_stores;
+	unsigned n_vector_loads;
+} counts_t;
+
+static ir_node *element(ir_node *const base, long const index)
+{
+	ir_node *const offset = new_Const_long(mode_Ls, index * 4);
+	return new_Add(base, offset);
+}
+
+static ir_node *load(ir_node *const ptr)
+{
+	ir_node *const ld = new_Load(get_store(), ptr, mode_Is, int_type,
+	                             cons_none);
+	set_store(new_Proj(ld, mode_M, pn_Load_M));
+	return new_Proj(ld, mode_Is, pn_Load_res);
+}
+
+static ir_graph *build(unsigned const n_lanes, long const *const offsets_a,
+                       long const *const offsets_b)
+{
+	static unsigned n_graphs;
+	char name[16];
+	snprintf(name, sizeof(name), "f%u", n_graphs++);
+
+	ir_type *const ptr_type = new_type_pointer(int_type);
+	ir_type *const mtp = new_type_method(3, 0, false, cc_cdecl_set,
+	                                     mtp_no_property);
+	for (unsigned i = 0; i < 3; ++i)
+		set_method_param_type(mtp, i, ptr_type);
+	ir_entity *const ent = new_global_entity(get_glob_type(),
+	                                         new_id_from_str(name), mtp,
+	                                         ir_visibility_external,
+	                                         IR_LINKAGE_DEFAULT);
+	ir_graph *const irg = new_ir_graph(ent, 0);
+	set_current_ir_graph(irg);
+
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const a    = new_Proj(args, mode_P, 0);
+	ir_node *const b    = new_Proj(args, mode_P, 1);
+	ir_node *const c    = new_Proj(args, mode_P, 2);
+	/* The Loads come first, as the parameters may alias. */
+	ir_node *sums[4];
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		sums[i] = new_Add(load(element(b, offsets_b[i])),
+		                  load(element(c, offsets_a[i])));
+	}
+	for (unsigned i = 0; i < n_lanes; ++i) {
+		ir_node *const store = new_Store(get_store(),
+		                                 element(a, offsets_a[i]), sums[i],
+		                                 int_type, cons_none);
+		set_store(new_Proj(store, mode_M, pn_Store_M));
+	}
+	ir_node *const ret = new_Return(get_store(), 0, NULL);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+static void count_node(ir_node *const node, void *const data)
+{
+	counts_t *const counts = (counts_t*)data;
+	if (is_Store(node)) {
+		++counts->n_stores;
+		if (mode_is_vector(get_irn_mode(get_Store_value(node))))
+			++counts->n_vector_stores;
+	} else if (is_Load(node) && mode_is_vector(get_Load_mode(node))) {
+		++counts->n_vector_loads;
+	}
+}
+
+static counts_t test(unsigned const n_lanes, long const *const offsets_a,
+                     long const *const offsets_b)
+{
+	ir_graph *const irg = build(n_lanes, offsets_a, offsets_b);
+	slp_vectorize(irg);
+	irg_assert_verify(irg);
+
+	counts_t counts = { 0, 0, 0 };
+	irg_walk_graph(irg, NULL, count_node, &counts);
+	return counts;
+}
+
+int main(void)
+{
+	ir_init();
+	ir_target_set("x86_64-linux-gnu");
+	ir_target_init();
+	int_type = new_type_primitive(mode_Is);
+	assert(ir_target_vector_size() == 16);
+
+	long const linear[]   = { 0, 1, 2, 3 };
+	long const reversed[] = { 3, 2, 1, 0 };
+	long const strided[]  = { 0, 2, 4, 6 };
+	long const twice[]    = { 0, 1, 1, 2 };
+	counts_t c;
+
+	/* Four adjacent Stores of sums of adjacent Loads. */
+	c = test(4, linear, linear);
+	assert(c.n_stores == 1 && c.n_vector_stores == 1);
+	assert(c.n_vector_loads == 2);
+
+	/* The order of the Stores in the chain does not matter. */
+	c = test(4, reversed, reversed);
+	assert(c.n_stores == 1 && c.n_vector_stores == 1);
+
+	/* Too few Stores to fill a vector. */
+	c = test(3, linear, linear);
+	assert(c.n_stores == 3 && c.n_vector_stores == 0);
+
+	/* The Stores do not cover a whole vector. */
+	c = test(4, twice, linear);
+	assert(c.n_vector_stores == 0);
+
+	/* The Loads are not adjacent. */
+	c = test(4, linear, strided);
+	assert(c.n_stores == 4 && c.n_vector_stores == 0);
+	assert(c.n_vector_loads == 0);
+
+	/* Lanes reading permuted elements are not packed. */
+	c = test(4, linear, reversed);
+	assert(c.n_stores == 4 && c.n_vector_stores == 0);
+
+	ir_finish();
+	return 0;
+}